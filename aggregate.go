@@ -0,0 +1,101 @@
+package shp
+
+import (
+	"fmt"
+	"math"
+	"strconv"
+)
+
+// Stats are the statistics of the non NULL values of a numeric field.
+type Stats struct {
+	Count         int
+	Sum, Min, Max float64
+}
+
+// Mean is the mean of the values, NaN if there are none.
+func (s Stats) Mean() float64 {
+	if s.Count == 0 {
+		return math.NaN()
+	}
+	return s.Sum / float64(s.Count)
+}
+
+// Group holds the records with one value of the group field.
+type Group struct {
+	// Key is the value of the group field: an int for integer fields, a
+	// string otherwise, and nil for NULL values or without a group field.
+	Key interface{}
+	// Records is the number of records of the group.
+	Records int
+	// Stats holds the statistics of each of the aggregated fields.
+	Stats []Stats
+}
+
+// GroupBy computes the count, sum, minimum and maximum of the numeric
+// fields among the count records from start, grouped by the value of
+// groupField, or in a single group if groupField is "". The groups are in
+// the order of their first record. The values are aggregated straight from
+// the attribute records, which is much faster than reading them one by one.
+func (f *ShapeFile) GroupBy(groupField string, fields []string, start, count int) ([]Group, error) {
+	return f.groupBy(groupField, fields, func(agg DBFAggregateHandle) bool {
+		return goDBFAggregateRange(agg, start, count)
+	})
+}
+
+// GroupBySelection is GroupBy over the records of indexes, in increasing
+// order, as Select returns them.
+func (f *ShapeFile) GroupBySelection(groupField string, fields []string, indexes []int) ([]Group, error) {
+	return f.groupBy(groupField, fields, func(agg DBFAggregateHandle) bool {
+		return goDBFAggregateSelection(agg, indexes)
+	})
+}
+
+func (f *ShapeFile) groupBy(groupField string, fields []string, add func(DBFAggregateHandle) bool) ([]Group, error) {
+	group, groupType := -1, String
+	if groupField != "" {
+		if group = goDBFGetFieldIndex(f.hDb, groupField); group < 0 {
+			return nil, fmt.Errorf("no field %q", groupField)
+		}
+		_, type_, _, decimals := goDBFGetFieldInfo(f.hDb, group)
+		if groupType = FieldType(type_); groupType == Double {
+			if decimals > 0 {
+				return nil, fmt.Errorf("cannot group by field %q with decimals", groupField)
+			}
+			groupType = Integer
+		}
+	}
+	indexes := make([]int, len(fields))
+	for i, field := range fields {
+		if indexes[i] = goDBFGetFieldIndex(f.hDb, field); indexes[i] < 0 {
+			return nil, fmt.Errorf("no field %q", field)
+		}
+	}
+
+	agg := goDBFCreateAggregate(f.hDb, group, indexes)
+	if agg == nil {
+		return nil, fmt.Errorf("cannot aggregate %v", fields)
+	}
+	defer goDBFDestroyAggregate(agg)
+	if !add(agg) {
+		return nil, fmt.Errorf("cannot read records")
+	}
+
+	groups := make([]Group, goDBFAggregateGetGroupCount(agg))
+	for i := range groups {
+		g := &groups[i]
+		if key := goDBFAggregateGetKey(agg, i); key != "" {
+			if groupType == Integer {
+				g.Key, _ = strconv.Atoi(key)
+			} else {
+				g.Key = key
+			}
+		}
+		g.Records = goDBFAggregateGetRecordCount(agg, i)
+		g.Stats = make([]Stats, len(fields))
+		for j := range g.Stats {
+			s := &g.Stats[j]
+			s.Count, s.Sum, s.Min, s.Max = goDBFAggregateGetStats(agg, i, j)
+		}
+	}
+	return groups, nil
+}
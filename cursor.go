@@ -0,0 +1,132 @@
+package shp
+
+import "sync"
+
+// Cursor reads the attributes of a ShapeFile with its own buffers, so that
+// several goroutines can read one open file at the same time, each with its
+// own cursor. A cursor is not safe for concurrent use itself, and the file
+// must not be read otherwise while cursors are in use.
+type Cursor struct {
+	f *ShapeFile
+	h DBFCursorHandle
+}
+
+// NewCursor creates a cursor on the attributes of f, to be closed before f.
+func (f *ShapeFile) NewCursor() *Cursor {
+	h := goDBFCreateCursor(f.hDb)
+	if h == nil {
+		panic("Cannot create cursor")
+	}
+	return &Cursor{f: f, h: h}
+}
+
+// Attrs returns the attributes of a shape, as Shape.Attrs would without a
+// projection.
+func (c *Cursor) Attrs(shapeIndex int) map[string]interface{} {
+	attrs := make(map[string]interface{}, c.f.FieldCount)
+	for j := 0; j < c.f.FieldCount; j++ {
+		name, type_, _, _ := goDBFGetFieldInfo(c.f.hDb, j)
+		switch FieldType(type_) {
+		case String:
+			attrs[name] = goDBFCursorReadStringView(c.h, shapeIndex, j)
+		case Integer, Logical:
+			attrs[name] = goDBFCursorReadIntegerAttribute(c.h, shapeIndex, j)
+		case Double:
+			attrs[name] = goDBFCursorReadDoubleAttribute(c.h, shapeIndex, j)
+		default:
+			panic("Unkown field type.")
+		}
+	}
+	return attrs
+}
+
+// IsNull tells whether the value of a field of a shape is NULL.
+func (c *Cursor) IsNull(shapeIndex int, field string) bool {
+	return goDBFCursorIsAttributeNULL(c.h, shapeIndex, goDBFGetFieldIndex(c.f.hDb, field))
+}
+
+// IntColumn is ShapeFile.IntColumn read through the cursor.
+func (c *Cursor) IntColumn(field string, start, count int) (values []int, null []bool) {
+	j := goDBFGetFieldIndex(c.f.hDb, field)
+	if j < 0 {
+		return nil, nil
+	}
+	return goDBFCursorReadIntegerColumn(c.h, j, start, count)
+}
+
+// FloatColumn is ShapeFile.FloatColumn read through the cursor.
+func (c *Cursor) FloatColumn(field string, start, count int) (values []float64, null []bool) {
+	j := goDBFGetFieldIndex(c.f.hDb, field)
+	if j < 0 {
+		return nil, nil
+	}
+	return goDBFCursorReadDoubleColumn(c.h, j, start, count)
+}
+
+// StringColumn is ShapeFile.StringColumn read through the cursor.
+func (c *Cursor) StringColumn(field string, start, count int) (values []string, null []bool) {
+	j := goDBFGetFieldIndex(c.f.hDb, field)
+	if j < 0 {
+		return nil, nil
+	}
+	_, _, width, _ := goDBFGetFieldInfo(c.f.hDb, j)
+	if c.f.utf8 {
+		width *= 3
+	}
+	return goDBFCursorReadStringColumn(c.h, j, start, count, width)
+}
+
+func (c *Cursor) Close() {
+	goDBFDestroyCursor(c.h)
+}
+
+// Scan splits the records of f into ranges of rangeRecords records (65536
+// if 0) and calls fn for each range from workers goroutines at once, each
+// with its own cursor. fn stores its results by range, for instance in a
+// slice indexed by start/rangeRecords, so that merging them in range order
+// gives the same result as a serial scan whatever the number of workers.
+// Scan returns the error of the first range, in record order, that failed.
+func (f *ShapeFile) Scan(workers, rangeRecords int, fn func(c *Cursor, start, count int) error) error {
+	if rangeRecords <= 0 {
+		rangeRecords = 65536
+	}
+	ranges := (f.ShapeCount + rangeRecords - 1) / rangeRecords
+	if workers > ranges {
+		workers = ranges
+	}
+	if workers < 1 {
+		workers = 1
+	}
+
+	errs := make([]error, ranges)
+	next := make(chan int)
+	var wg sync.WaitGroup
+	for w := 0; w < workers; w++ {
+		c := f.NewCursor()
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			defer c.Close()
+			for r := range next {
+				start := r * rangeRecords
+				count := rangeRecords
+				if count > f.ShapeCount-start {
+					count = f.ShapeCount - start
+				}
+				errs[r] = fn(c, start, count)
+			}
+		}()
+	}
+	for r := 0; r < ranges; r++ {
+		next <- r
+	}
+	close(next)
+	wg.Wait()
+
+	for _, err := range errs {
+		if err != nil {
+			return err
+		}
+	}
+	return nil
+}
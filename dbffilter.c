@@ -0,0 +1,711 @@
+/******************************************************************************
+ *
+ * Project:  Shapelib
+ * Purpose:  Attribute filters evaluated on the raw records of .dbf files.
+ *
+ ******************************************************************************
+ *
+ * This software is available under the following "MIT Style" license,
+ * or at the option of the licensee under the LGPL (see COPYING).  This
+ * option is discussed in more detail in shapelib.html.
+ *
+ * --
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************
+ *
+ * A filter is a tree of comparisons combined with AND, OR and NOT.  It is
+ * evaluated a block of records at a time, straight on the field bytes of
+ * the records, one node at a time over a selection vector: the indexes of
+ * the records of the block still in play.  AND hands the records selected
+ * by its left operand to its right one, OR only evaluates its right operand
+ * on the records its left one rejected, so every field is decoded at most
+ * once per record and only for the records that can still match.
+ *
+ * As with SQL, a NULL value never satisfies a comparison, while NOT
+ * selects the records its operand rejected, NULL values included.
+ */
+
+#include "shapefil.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+SHP_CVSID("$Id$")
+
+#ifndef FALSE
+#  define FALSE		0
+#  define TRUE		1
+#endif
+
+#ifdef __cplusplus
+#define STATIC_CAST(type,x) static_cast<type>(x)
+#else
+#define STATIC_CAST(type,x) ((type)(x))
+#endif
+
+/* records read at a time when the file is not mapped */
+#define DBF_FILTER_BLOCK (1024 * 1024)
+
+typedef enum {
+    DBFF_DOUBLE,
+    DBFF_STRING,
+    DBFF_LOGICAL,
+    DBFF_NULL,
+    DBFF_AND,
+    DBFF_OR,
+    DBFF_NOT
+} DBFFilterKind;
+
+struct DBFFilterInfo
+{
+    DBFFilterKind eKind;
+
+    /* comparisons */
+    int         iField;
+    DBFCompareOp eOp;
+    double      dfValue;
+    char        *pszValue;
+    int         nValueLength;
+    int         bValue;
+
+    /* AND, OR and NOT */
+    struct DBFFilterInfo *psLeft;
+    struct DBFFilterInfo *psRight;
+};
+
+/************************************************************************/
+/*                           DBFFilterCreate()                          */
+/************************************************************************/
+
+static DBFFilterHandle DBFFilterCreate( DBFHandle psDBF, int iField,
+                                        DBFFilterKind eKind )
+{
+    if( iField < 0 || iField >= psDBF->nFields )
+    {
+        char szMessage[64];
+        snprintf( szMessage, sizeof(szMessage),
+                  "Invalid filter field %d.", iField );
+        psDBF->sHooks.Error( szMessage );
+        return NULL;
+    }
+
+    DBFFilterHandle psFilter =
+        STATIC_CAST(DBFFilterHandle, calloc(1, sizeof(struct DBFFilterInfo)));
+    if( psFilter == NULL )
+        return NULL;
+
+    psFilter->eKind = eKind;
+    psFilter->iField = iField;
+    return psFilter;
+}
+
+/************************************************************************/
+/*                      goDBFFilterCompareDouble()                      */
+/*                                                                      */
+/*      Select the records where the field parsed as a number compares  */
+/*      to dfValue with eOp.                                            */
+/************************************************************************/
+
+DBFFilterHandle SHPAPI_CALL
+goDBFFilterCompareDouble( DBFHandle psDBF, int iField, DBFCompareOp eOp,
+                          double dfValue )
+{
+    DBFFilterHandle psFilter = DBFFilterCreate( psDBF, iField, DBFF_DOUBLE );
+    if( psFilter == NULL )
+        return NULL;
+
+    psFilter->eOp = eOp;
+    psFilter->dfValue = dfValue;
+    return psFilter;
+}
+
+/************************************************************************/
+/*                      goDBFFilterCompareString()                      */
+/*                                                                      */
+/*      Select the records where the field, without leading and         */
+/*      trailing blanks, compares bytewise to pszValue with eOp.  Date  */
+/*      fields compare in order as "YYYYMMDD" strings.                  */
+/************************************************************************/
+
+DBFFilterHandle SHPAPI_CALL
+goDBFFilterCompareString( DBFHandle psDBF, int iField, DBFCompareOp eOp,
+                          const char *pszValue )
+{
+    DBFFilterHandle psFilter = DBFFilterCreate( psDBF, iField, DBFF_STRING );
+    if( psFilter == NULL )
+        return NULL;
+
+    psFilter->eOp = eOp;
+    psFilter->nValueLength = STATIC_CAST(int, strlen(pszValue));
+    psFilter->pszValue = STATIC_CAST(char *, malloc(psFilter->nValueLength + 1));
+    if( psFilter->pszValue == NULL )
+    {
+        free( psFilter );
+        return NULL;
+    }
+    memcpy( psFilter->pszValue, pszValue, psFilter->nValueLength + 1 );
+    return psFilter;
+}
+
+/************************************************************************/
+/*                      goDBFFilterCompareLogical()                     */
+/*                                                                      */
+/*      Select the records where the logical field is bValue.           */
+/************************************************************************/
+
+DBFFilterHandle SHPAPI_CALL
+goDBFFilterCompareLogical( DBFHandle psDBF, int iField, int bValue )
+{
+    DBFFilterHandle psFilter = DBFFilterCreate( psDBF, iField, DBFF_LOGICAL );
+    if( psFilter == NULL )
+        return NULL;
+
+    psFilter->bValue = bValue ? TRUE : FALSE;
+    return psFilter;
+}
+
+/************************************************************************/
+/*                          goDBFFilterIsNull()                         */
+/*                                                                      */
+/*      Select the records where the field is NULL, as told by          */
+/*      goDBFIsAttributeNULL().                                         */
+/************************************************************************/
+
+DBFFilterHandle SHPAPI_CALL
+goDBFFilterIsNull( DBFHandle psDBF, int iField )
+{
+    return DBFFilterCreate( psDBF, iField, DBFF_NULL );
+}
+
+/************************************************************************/
+/*                          DBFFilterCombine()                          */
+/*                                                                      */
+/*      Takes ownership of both operands, even on failure.              */
+/************************************************************************/
+
+static DBFFilterHandle DBFFilterCombine( DBFFilterKind eKind,
+                                         DBFFilterHandle psLeft,
+                                         DBFFilterHandle psRight )
+{
+    DBFFilterHandle psFilter = NULL;
+    if( psLeft != NULL && (psRight != NULL || eKind == DBFF_NOT) )
+        psFilter = STATIC_CAST(DBFFilterHandle,
+                               calloc(1, sizeof(struct DBFFilterInfo)));
+
+    if( psFilter == NULL )
+    {
+        goDBFFilterDestroy( psLeft );
+        goDBFFilterDestroy( psRight );
+        return NULL;
+    }
+
+    psFilter->eKind = eKind;
+    psFilter->iField = -1;
+    psFilter->psLeft = psLeft;
+    psFilter->psRight = psRight;
+    return psFilter;
+}
+
+/************************************************************************/
+/*                 goDBFFilterAnd() / Or() / Not()                      */
+/*                                                                      */
+/*      The combined filter owns its operands.  A NULL operand, as      */
+/*      returned by a failed constructor, gives a NULL result.          */
+/************************************************************************/
+
+DBFFilterHandle SHPAPI_CALL
+goDBFFilterAnd( DBFFilterHandle psLeft, DBFFilterHandle psRight )
+{
+    return DBFFilterCombine( DBFF_AND, psLeft, psRight );
+}
+
+DBFFilterHandle SHPAPI_CALL
+goDBFFilterOr( DBFFilterHandle psLeft, DBFFilterHandle psRight )
+{
+    return DBFFilterCombine( DBFF_OR, psLeft, psRight );
+}
+
+DBFFilterHandle SHPAPI_CALL
+goDBFFilterNot( DBFFilterHandle psOperand )
+{
+    return DBFFilterCombine( DBFF_NOT, psOperand, NULL );
+}
+
+/************************************************************************/
+/*                         goDBFFilterDestroy()                         */
+/************************************************************************/
+
+void SHPAPI_CALL
+goDBFFilterDestroy( DBFFilterHandle psFilter )
+{
+    if( psFilter == NULL )
+        return;
+
+    goDBFFilterDestroy( psFilter->psLeft );
+    goDBFFilterDestroy( psFilter->psRight );
+    free( psFilter->pszValue );
+    free( psFilter );
+}
+
+/************************************************************************/
+/*                          DBFFilterCompare()                          */
+/************************************************************************/
+
+static bool DBFFilterCompare( DBFCompareOp eOp, int nOrder )
+{
+    switch( eOp )
+    {
+      case DBFC_EQ: return nOrder == 0;
+      case DBFC_NE: return nOrder != 0;
+      case DBFC_LT: return nOrder < 0;
+      case DBFC_LE: return nOrder <= 0;
+      case DBFC_GT: return nOrder > 0;
+      case DBFC_GE: return nOrder >= 0;
+    }
+    return false;
+}
+
+/************************************************************************/
+/*                          DBFFilterTrim()                             */
+/*                                                                      */
+/*      Find the field bytes without leading and trailing blanks, or    */
+/*      the zero terminated prefix when the field holds a NUL.          */
+/************************************************************************/
+
+static const char *DBFFilterTrim( const char *pachField, int nWidth,
+                                  int *pnLength )
+{
+    const char *pchEnd = STATIC_CAST(const char *, memchr(pachField, '\0', nWidth));
+    if( pchEnd == NULL )
+        pchEnd = pachField + nWidth;
+
+    while( pachField < pchEnd && *pachField == ' ' )
+        pachField++;
+    while( pchEnd > pachField && pchEnd[-1] == ' ' )
+        pchEnd--;
+
+    *pnLength = STATIC_CAST(int, pchEnd - pachField);
+    return pachField;
+}
+
+/************************************************************************/
+/*                        DBFFilterLogicalValue()                       */
+/*                                                                      */
+/*      1 for true, 0 for false, -1 for NULL or unknown.                */
+/************************************************************************/
+
+static int DBFFilterLogicalValue( char chValue )
+{
+    switch( chValue )
+    {
+      case 'T': case 't': case 'Y': case 'y':
+        return 1;
+      case 'F': case 'f': case 'N': case 'n':
+        return 0;
+      default:
+        return -1;
+    }
+}
+
+/************************************************************************/
+/*                          DBFFilterLeaf()                             */
+/*                                                                      */
+/*      Evaluate a comparison on the records of panIn, appending the    */
+/*      ones that match to panOut.                                      */
+/************************************************************************/
+
+static int DBFFilterLeaf( DBFHandle psDBF, DBFFilterHandle psFilter,
+                          const char *pabyRecords,
+                          const int *panIn, int nIn, int *panOut )
+{
+    const int nRecordLength = psDBF->nRecordLength;
+    const int nWidth = psDBF->panFieldSize[psFilter->iField];
+    const char chType = psDBF->pachFieldType[psFilter->iField];
+    const char *pachFields = pabyRecords + psDBF->panFieldOffset[psFilter->iField];
+    int nOut = 0;
+
+    switch( psFilter->eKind )
+    {
+      case DBFF_DOUBLE:
+        for( int i = 0; i < nIn; i++ )
+        {
+            double dfValue;
+            if( !goDBFParseDouble( pachFields + panIn[i] * nRecordLength,
+                                   nWidth, &dfValue ) || dfValue != dfValue )
+                continue;
+
+            if( DBFFilterCompare( psFilter->eOp,
+                                  (dfValue > psFilter->dfValue) -
+                                  (dfValue < psFilter->dfValue) ) )
+                panOut[nOut++] = panIn[i];
+        }
+        break;
+
+      case DBFF_STRING:
+        for( int i = 0; i < nIn; i++ )
+        {
+            const char *pachField = pachFields + panIn[i] * nRecordLength;
+            if( goDBFIsRawValueNULL( chType, pachField, nWidth ) )
+                continue;
+
+            int nLength;
+            const char *pachValue = DBFFilterTrim( pachField, nWidth, &nLength );
+            const int nCommon = nLength < psFilter->nValueLength ?
+                nLength : psFilter->nValueLength;
+            int nOrder = memcmp( pachValue, psFilter->pszValue, nCommon );
+            if( nOrder == 0 )
+                nOrder = (nLength > psFilter->nValueLength) -
+                    (nLength < psFilter->nValueLength);
+
+            if( DBFFilterCompare( psFilter->eOp, nOrder ) )
+                panOut[nOut++] = panIn[i];
+        }
+        break;
+
+      case DBFF_LOGICAL:
+        for( int i = 0; i < nIn; i++ )
+        {
+            int nLength;
+            const char *pachValue =
+                DBFFilterTrim( pachFields + panIn[i] * nRecordLength,
+                               nWidth, &nLength );
+            if( nLength > 0 &&
+                DBFFilterLogicalValue( pachValue[0] ) == psFilter->bValue )
+                panOut[nOut++] = panIn[i];
+        }
+        break;
+
+      case DBFF_NULL:
+        for( int i = 0; i < nIn; i++ )
+        {
+            if( goDBFIsRawValueNULL( chType, pachFields + panIn[i] * nRecordLength,
+                                     nWidth ) )
+                panOut[nOut++] = panIn[i];
+        }
+        break;
+
+      default:
+        break;
+    }
+
+    return nOut;
+}
+
+/************************************************************************/
+/*                          DBFFilterExcept()                           */
+/*                                                                      */
+/*      panIn minus panMinus, both sorted and the latter a subset of    */
+/*      the former.                                                     */
+/************************************************************************/
+
+static int DBFFilterExcept( const int *panIn, int nIn,
+                            const int *panMinus, int nMinus, int *panOut )
+{
+    int nOut = 0;
+    for( int i = 0, j = 0; i < nIn; i++ )
+    {
+        if( j < nMinus && panMinus[j] == panIn[i] )
+            j++;
+        else
+            panOut[nOut++] = panIn[i];
+    }
+    return nOut;
+}
+
+/************************************************************************/
+/*                          DBFFilterEvaluate()                         */
+/*                                                                      */
+/*      Store in panOut the records of the sorted selection panIn that  */
+/*      match the filter, in order.  panOut may alias panIn.  Returns   */
+/*      their count, or -1 when out of memory.                          */
+/************************************************************************/
+
+static int DBFFilterEvaluate( DBFHandle psDBF, DBFFilterHandle psFilter,
+                              const char *pabyRecords,
+                              const int *panIn, int nIn, int *panOut )
+{
+    if( nIn == 0 )
+        return 0;
+
+    if( psFilter->eKind != DBFF_AND && psFilter->eKind != DBFF_OR &&
+        psFilter->eKind != DBFF_NOT )
+        return DBFFilterLeaf( psDBF, psFilter, pabyRecords, panIn, nIn, panOut );
+
+    int *panWork = STATIC_CAST(int *, malloc(sizeof(int) * 2 * nIn));
+    if( panWork == NULL )
+        return -1;
+    int *panLeft = panWork;
+    int *panOther = panWork + nIn;
+
+    int nOut = -1;
+    int nLeft = DBFFilterEvaluate( psDBF, psFilter->psLeft, pabyRecords,
+                                   panIn, nIn, panLeft );
+    if( nLeft >= 0 )
+    {
+        switch( psFilter->eKind )
+        {
+          case DBFF_AND:
+            nOut = DBFFilterEvaluate( psDBF, psFilter->psRight, pabyRecords,
+                                      panLeft, nLeft, panOut );
+            break;
+
+          case DBFF_NOT:
+            nOut = DBFFilterExcept( panIn, nIn, panLeft, nLeft, panOut );
+            break;
+
+          default:
+          {
+            /* right operand only on what the left one rejected, then merge */
+            const int nRest = DBFFilterExcept( panIn, nIn, panLeft, nLeft,
+                                               panOther );
+            const int nRight = DBFFilterEvaluate( psDBF, psFilter->psRight,
+                                                  pabyRecords, panOther, nRest,
+                                                  panOther );
+            if( nRight < 0 )
+                break;
+
+            int i = 0, j = 0;
+            nOut = 0;
+            while( i < nLeft || j < nRight )
+            {
+                if( j == nRight || (i < nLeft && panLeft[i] < panOther[j]) )
+                    panOut[nOut++] = panLeft[i++];
+                else
+                    panOut[nOut++] = panOther[j++];
+            }
+            break;
+          }
+        }
+    }
+
+    free( panWork );
+    return nOut;
+}
+
+/************************************************************************/
+/*                          DBFFilterIsValid()                          */
+/************************************************************************/
+
+static bool DBFFilterIsValid( DBFHandle psDBF, DBFFilterHandle psFilter )
+{
+    if( psFilter->eKind == DBFF_AND || psFilter->eKind == DBFF_OR )
+        return DBFFilterIsValid( psDBF, psFilter->psLeft ) &&
+            DBFFilterIsValid( psDBF, psFilter->psRight );
+    if( psFilter->eKind == DBFF_NOT )
+        return DBFFilterIsValid( psDBF, psFilter->psLeft );
+    return psFilter->iField < psDBF->nFields;
+}
+
+/************************************************************************/
+/*                          DBFFilterMayMatch()                         */
+/*                                                                      */
+/*      Whether a record of block iBlock of the zone map may match.     */
+/************************************************************************/
+
+static bool DBFFilterMayMatch( DBFFilterHandle psFilter,
+                               DBFZoneMapHandle psZoneMap, int iBlock )
+{
+    switch( psFilter->eKind )
+    {
+      case DBFF_AND:
+        return DBFFilterMayMatch( psFilter->psLeft, psZoneMap, iBlock ) &&
+            DBFFilterMayMatch( psFilter->psRight, psZoneMap, iBlock );
+      case DBFF_OR:
+        return DBFFilterMayMatch( psFilter->psLeft, psZoneMap, iBlock ) ||
+            DBFFilterMayMatch( psFilter->psRight, psZoneMap, iBlock );
+      case DBFF_NOT:
+        return true;
+      case DBFF_DOUBLE:
+        return goDBFZoneMapMayMatchDouble( psZoneMap, iBlock, psFilter->iField,
+                                           psFilter->eOp, psFilter->dfValue ) != 0;
+      case DBFF_STRING:
+        return goDBFZoneMapMayMatchString( psZoneMap, iBlock, psFilter->iField,
+                                           psFilter->eOp, psFilter->pszValue ) != 0;
+      case DBFF_LOGICAL:
+        return goDBFZoneMapMayMatchLogical( psZoneMap, iBlock, psFilter->iField,
+                                            psFilter->bValue ) != 0;
+      case DBFF_NULL:
+        return goDBFZoneMapHasNulls( psZoneMap, iBlock, psFilter->iField ) != 0;
+    }
+    return true;
+}
+
+/************************************************************************/
+/*                          goDBFFilterSelect()                         */
+/*                                                                      */
+/*      Store in panSelected the ids of the records among the nCount    */
+/*      ones from iStart that match the filter, in increasing order.    */
+/*      panSelected must have room for nCount ids.  Returns the number  */
+/*      of records selected, or -1 on failure.  Deleted records are     */
+/*      evaluated like the others.                                      */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFFilterSelect( DBFHandle psDBF, DBFFilterHandle psFilter,
+                   int iStart, int nCount, int *panSelected )
+{
+    return goDBFFilterSelectEx( psDBF, psFilter, NULL, iStart, nCount,
+                                panSelected );
+}
+
+/************************************************************************/
+/*                          DBFFilterSelect()                           */
+/*                                                                      */
+/*      goDBFFilterSelectEx(), reading the records through psCursor     */
+/*      if it is not NULL.  The filter and the zone map are only read,  */
+/*      so threads can share them, each with its own cursor.            */
+/************************************************************************/
+
+static int DBFFilterSelect( DBFHandle psDBF, DBFCursorHandle psCursor,
+                            DBFFilterHandle psFilter,
+                            DBFZoneMapHandle psZoneMap,
+                            int iStart, int nCount, int *panSelected )
+{
+    if( psFilter == NULL || iStart < 0 || iStart > psDBF->nRecords || nCount < 0 )
+        return -1;
+    if( nCount > psDBF->nRecords - iStart )
+        nCount = psDBF->nRecords - iStart;
+    if( nCount == 0 )
+        return 0;
+
+    /* the fields may have changed since the filter was built */
+    if( !DBFFilterIsValid( psDBF, psFilter ) )
+    {
+        psDBF->sHooks.Error( "Filter field no longer exists." );
+        return -1;
+    }
+
+    const int nZoneRecords =
+        psZoneMap != NULL ? goDBFZoneMapGetBlockRecords( psZoneMap ) : 0;
+
+/* -------------------------------------------------------------------- */
+/*      Evaluate a block of records at a time.                          */
+/* -------------------------------------------------------------------- */
+    int nBlockRecords = DBF_FILTER_BLOCK / psDBF->nRecordLength;
+    if( nBlockRecords < 1 )
+        nBlockRecords = 1;
+    if( nBlockRecords > nCount )
+        nBlockRecords = nCount;
+
+    char *pabyBlock = NULL;
+    if( psDBF->pabyMap == NULL )
+    {
+        pabyBlock = STATIC_CAST(char *,
+            malloc(STATIC_CAST(size_t, nBlockRecords) * psDBF->nRecordLength));
+        if( pabyBlock == NULL )
+            return -1;
+    }
+
+    int *panBlock = STATIC_CAST(int *, malloc(sizeof(int) * nBlockRecords));
+    if( panBlock == NULL )
+    {
+        free( pabyBlock );
+        return -1;
+    }
+
+    int nSelected = 0;
+    for( int iDone = 0; iDone < nCount; )
+    {
+        int nRecords = nCount - iDone;
+        if( nRecords > nBlockRecords )
+            nRecords = nBlockRecords;
+
+/* -------------------------------------------------------------------- */
+/*      Stay within a block of the zone map, and skip it all when it    */
+/*      cannot match.                                                   */
+/* -------------------------------------------------------------------- */
+        if( nZoneRecords > 0 )
+        {
+            const int iZone = (iStart + iDone) / nZoneRecords;
+            const int nZoneLeft = (iZone + 1) * nZoneRecords - (iStart + iDone);
+            if( nRecords > nZoneLeft )
+                nRecords = nZoneLeft;
+
+            if( !DBFFilterMayMatch( psFilter, psZoneMap, iZone ) )
+            {
+                iDone += nZoneLeft < nCount - iDone ? nZoneLeft : nCount - iDone;
+                continue;
+            }
+        }
+
+        const char *pabyRecords = psCursor != NULL
+            ? goDBFCursorReadRecords( psCursor, iStart + iDone, nRecords, pabyBlock )
+            : goDBFReadRecords( psDBF, iStart + iDone, nRecords, pabyBlock );
+        if( pabyRecords == NULL )
+        {
+            nSelected = -1;
+            break;
+        }
+
+        for( int i = 0; i < nRecords; i++ )
+            panBlock[i] = i;
+
+        const int nMatches = DBFFilterEvaluate( psDBF, psFilter, pabyRecords,
+                                                panBlock, nRecords, panBlock );
+        if( nMatches < 0 )
+        {
+            nSelected = -1;
+            break;
+        }
+
+        for( int i = 0; i < nMatches; i++ )
+            panSelected[nSelected++] = iStart + iDone + panBlock[i];
+
+        iDone += nRecords;
+    }
+
+    free( panBlock );
+    free( pabyBlock );
+    return nSelected;
+}
+
+/************************************************************************/
+/*                         goDBFFilterSelectEx()                        */
+/*                                                                      */
+/*      goDBFFilterSelect() skipping the blocks of records that the     */
+/*      statistics of psZoneMap, if not NULL, show cannot match.        */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFFilterSelectEx( DBFHandle psDBF, DBFFilterHandle psFilter,
+                     DBFZoneMapHandle psZoneMap,
+                     int iStart, int nCount, int *panSelected )
+{
+    return DBFFilterSelect( psDBF, NULL, psFilter, psZoneMap, iStart, nCount,
+                            panSelected );
+}
+
+/************************************************************************/
+/*                       goDBFCursorFilterSelect()                      */
+/*                                                                      */
+/*      goDBFFilterSelectEx() through a cursor, so that threads can     */
+/*      each select within their own range of records of one handle.    */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFCursorFilterSelect( DBFCursorHandle psCursor, DBFFilterHandle psFilter,
+                         DBFZoneMapHandle psZoneMap,
+                         int iStart, int nCount, int *panSelected )
+{
+    return DBFFilterSelect( goDBFCursorGetDBF( psCursor ), psCursor, psFilter,
+                            psZoneMap, iStart, nCount, panSelected );
+}
@@ -0,0 +1,912 @@
+/******************************************************************************
+ *
+ * Project:  Shapelib
+ * Purpose:  Persistent single field indexes of .dbf files.
+ *
+ ******************************************************************************
+ *
+ * This software is available under the following "MIT Style" license,
+ * or at the option of the licensee under the LGPL (see COPYING).  This
+ * option is discussed in more detail in shapelib.html.
+ *
+ * --
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************
+ *
+ * An index file holds the keys of one field of a .dbf file with the ids of
+ * their records, NULL values left out.  It is built once from the whole
+ * file, for layers that do not change afterwards, and is either:
+ *
+ *  - a B+tree on the numeric value of N, F and D fields (dates as the
+ *    number YYYYMMDD), bulk loaded: the (key, id) entries sorted on key
+ *    fill 4 KB leaf pages, and the first key of each leaf forms the inner
+ *    level, loaded in memory when the index is opened.  A range search
+ *    reads the leaves holding the range, one page for an equality.
+ *
+ *  - a hash index on the field bytes with the surrounding blanks removed,
+ *    for equality searches on codes of any field type.  A directory of
+ *    buckets, loaded in memory at open, points to the entries of each
+ *    bucket, read with a single FRead per search.
+ *
+ * All the values of the file are little endian:
+ *
+ *   Bytes 0-3    "DBX" and 'B' (B+tree) or 'H' (hash)
+ *   Byte  4      version, 1
+ *   Byte  5      type of the field in the .dbf file
+ *   Bytes 8-19   name of the field
+ *   Bytes 20-35  field number, field width, record count and record
+ *                length of the .dbf file the index was built from
+ *   Bytes 36-39  number of entries
+ *   Bytes 40-43  number of leaves (B+tree) or buckets (hash)
+ *   Bytes 44-47  key width (hash)
+ *   Bytes 48-63  reserved
+ *
+ * followed by the first key of each leaf (doubles) and then the leaves
+ * from the next multiple of 4096 bytes, each of DBX_LEAF_ENTRIES entries
+ * (double key, int32 id); or by the bucket directory (nBuckets + 1 int32
+ * indexes of the first entry of each bucket) and the entries (int32 id,
+ * key padded with zeros to the key width).
+ */
+
+#include "shapefil.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+SHP_CVSID("$Id$")
+
+#ifndef FALSE
+#  define FALSE		0
+#  define TRUE		1
+#endif
+
+#ifdef __cplusplus
+#define STATIC_CAST(type,x) static_cast<type>(x)
+#define REINTERPRET_CAST(type,x) reinterpret_cast<type>(x)
+#define SHPLIB_NULLPTR nullptr
+#else
+#define STATIC_CAST(type,x) ((type)(x))
+#define REINTERPRET_CAST(type,x) ((type)(x))
+#define SHPLIB_NULLPTR NULL
+#endif
+
+#define DBX_HEADER_SIZE  64
+#define DBX_PAGE_SIZE    4096
+#define DBX_ENTRY_SIZE   12
+#define DBX_LEAF_ENTRIES (DBX_PAGE_SIZE / DBX_ENTRY_SIZE)
+
+/* records read at a time while building */
+#define DBX_BUILD_BLOCK  (1024 * 1024)
+
+struct DBFIndexInfo
+{
+    SAHooks     sHooks;
+    SAFile      fp;
+
+    char        chKind;         /* 'B' or 'H' */
+    int         nEntries;
+
+    /* B+tree */
+    int         nLeaves;
+    double      *padfFences;    /* first key of each leaf */
+    SAOffset    nLeafOffset;
+
+    /* hash */
+    int         nBuckets;       /* a power of two */
+    int         nKeyWidth;
+    int         *panBuckets;    /* nBuckets + 1 first entries */
+    SAOffset    nEntryOffset;
+
+    unsigned char *pabyPage;    /* a leaf, or the entries of a bucket */
+    int         nPageSize;
+};
+
+typedef struct
+{
+    double      dfKey;
+    int         nId;
+} DBFIndexEntry;
+
+/************************************************************************/
+/*                   Little endian (de)serialization.                   */
+/************************************************************************/
+
+static bool DBFIndexBigEndian( void )
+{
+    const int i = 1;
+    return *REINTERPRET_CAST(const unsigned char *, &i) != 1;
+}
+
+static void DBFIndexSwap( unsigned char *pabyWord, int nLength )
+{
+    for( int i = 0; i < nLength / 2; i++ )
+    {
+        const unsigned char byTemp = pabyWord[i];
+        pabyWord[i] = pabyWord[nLength - i - 1];
+        pabyWord[nLength - i - 1] = byTemp;
+    }
+}
+
+static void DBFIndexPutInt( unsigned char *pabyDst, int nValue )
+{
+    memcpy( pabyDst, &nValue, 4 );
+    if( DBFIndexBigEndian() )
+        DBFIndexSwap( pabyDst, 4 );
+}
+
+static int DBFIndexGetInt( const unsigned char *pabySrc )
+{
+    unsigned char abyWord[4];
+    memcpy( abyWord, pabySrc, 4 );
+    if( DBFIndexBigEndian() )
+        DBFIndexSwap( abyWord, 4 );
+
+    int nValue;
+    memcpy( &nValue, abyWord, 4 );
+    return nValue;
+}
+
+static void DBFIndexPutDouble( unsigned char *pabyDst, double dfValue )
+{
+    memcpy( pabyDst, &dfValue, 8 );
+    if( DBFIndexBigEndian() )
+        DBFIndexSwap( pabyDst, 8 );
+}
+
+static double DBFIndexGetDouble( const unsigned char *pabySrc )
+{
+    unsigned char abyWord[8];
+    memcpy( abyWord, pabySrc, 8 );
+    if( DBFIndexBigEndian() )
+        DBFIndexSwap( abyWord, 8 );
+
+    double dfValue;
+    memcpy( &dfValue, abyWord, 8 );
+    return dfValue;
+}
+
+/************************************************************************/
+/*                           DBFIndexTrim()                             */
+/*                                                                      */
+/*      Find the field bytes without leading and trailing blanks, or    */
+/*      the zero terminated prefix when the field holds a NUL.          */
+/************************************************************************/
+
+static const char *DBFIndexTrim( const char *pachField, int nWidth,
+                                 int *pnLength )
+{
+    const char *pchEnd = STATIC_CAST(const char *, memchr(pachField, '\0', nWidth));
+    if( pchEnd == SHPLIB_NULLPTR )
+        pchEnd = pachField + nWidth;
+
+    while( pachField < pchEnd && *pachField == ' ' )
+        pachField++;
+    while( pchEnd > pachField && pchEnd[-1] == ' ' )
+        pchEnd--;
+
+    *pnLength = STATIC_CAST(int, pchEnd - pachField);
+    return pachField;
+}
+
+/************************************************************************/
+/*                           DBFIndexHash()                             */
+/*                                                                      */
+/*      32 bit FNV-1a.                                                  */
+/************************************************************************/
+
+static uint32_t DBFIndexHash( const char *pachKey, int nLength )
+{
+    uint32_t nHash = 2166136261U;
+    for( int i = 0; i < nLength; i++ )
+    {
+        nHash ^= STATIC_CAST(unsigned char, pachKey[i]);
+        nHash *= 16777619U;
+    }
+    return nHash;
+}
+
+/************************************************************************/
+/*                        DBFIndexCompareEntries()                      */
+/************************************************************************/
+
+static int DBFIndexCompareEntries( const void *pA, const void *pB )
+{
+    const DBFIndexEntry *psA = STATIC_CAST(const DBFIndexEntry *, pA);
+    const DBFIndexEntry *psB = STATIC_CAST(const DBFIndexEntry *, pB);
+
+    if( psA->dfKey != psB->dfKey )
+        return psA->dfKey < psB->dfKey ? -1 : 1;
+    return (psA->nId > psB->nId) - (psA->nId < psB->nId);
+}
+
+/************************************************************************/
+/*                         DBFIndexWriteHeader()                        */
+/************************************************************************/
+
+static bool DBFIndexWriteHeader( DBFHandle psDBF, SAFile fp, int iField,
+                                 char chKind, int nEntries, int nBlocks,
+                                 int nKeyWidth )
+{
+    unsigned char abyHeader[DBX_HEADER_SIZE];
+    memset( abyHeader, 0, sizeof(abyHeader) );
+
+    memcpy( abyHeader, "DBX", 3 );
+    abyHeader[3] = STATIC_CAST(unsigned char, chKind);
+    abyHeader[4] = 1;
+    abyHeader[5] = STATIC_CAST(unsigned char, psDBF->pachFieldType[iField]);
+
+    char szName[XBASE_FLDNAME_LEN_READ + 1];
+    goDBFGetFieldInfo( psDBF, iField, szName, SHPLIB_NULLPTR, SHPLIB_NULLPTR );
+    memcpy( abyHeader + 8, szName, strlen(szName) );
+
+    DBFIndexPutInt( abyHeader + 20, iField );
+    DBFIndexPutInt( abyHeader + 24, psDBF->panFieldSize[iField] );
+    DBFIndexPutInt( abyHeader + 28, psDBF->nRecords );
+    DBFIndexPutInt( abyHeader + 32, psDBF->nRecordLength );
+    DBFIndexPutInt( abyHeader + 36, nEntries );
+    DBFIndexPutInt( abyHeader + 40, nBlocks );
+    DBFIndexPutInt( abyHeader + 44, nKeyWidth );
+
+    return psDBF->sHooks.FSeek( fp, 0, SEEK_SET ) == 0 &&
+        psDBF->sHooks.FWrite( abyHeader, DBX_HEADER_SIZE, 1, fp ) == 1;
+}
+
+/************************************************************************/
+/*                         DBFIndexWriteBTree()                         */
+/************************************************************************/
+
+static bool DBFIndexWriteBTree( DBFHandle psDBF, SAFile fp, int iField,
+                                DBFIndexEntry *pasEntries, int nEntries )
+{
+    qsort( pasEntries, nEntries, sizeof(DBFIndexEntry), DBFIndexCompareEntries );
+
+    const int nLeaves = (nEntries + DBX_LEAF_ENTRIES - 1) / DBX_LEAF_ENTRIES;
+    if( !DBFIndexWriteHeader( psDBF, fp, iField, 'B', nEntries, nLeaves, 0 ) )
+        return false;
+
+    unsigned char abyPage[DBX_PAGE_SIZE];
+
+/* -------------------------------------------------------------------- */
+/*      The inner level, padded to the first page boundary.             */
+/* -------------------------------------------------------------------- */
+    const SAOffset nFencesEnd = DBX_HEADER_SIZE + STATIC_CAST(SAOffset, nLeaves) * 8;
+    const SAOffset nLeafOffset =
+        (nFencesEnd + DBX_PAGE_SIZE - 1) / DBX_PAGE_SIZE * DBX_PAGE_SIZE;
+
+    for( int iLeaf = 0; iLeaf < nLeaves; iLeaf++ )
+    {
+        DBFIndexPutDouble( abyPage, pasEntries[iLeaf * DBX_LEAF_ENTRIES].dfKey );
+        if( psDBF->sHooks.FWrite( abyPage, 8, 1, fp ) != 1 )
+            return false;
+    }
+
+    memset( abyPage, 0, sizeof(abyPage) );
+    if( nLeafOffset > nFencesEnd &&
+        psDBF->sHooks.FWrite( abyPage, STATIC_CAST(SAOffset, nLeafOffset - nFencesEnd),
+                              1, fp ) != 1 )
+        return false;
+
+/* -------------------------------------------------------------------- */
+/*      The leaves.                                                     */
+/* -------------------------------------------------------------------- */
+    for( int iLeaf = 0; iLeaf < nLeaves; iLeaf++ )
+    {
+        memset( abyPage, 0, sizeof(abyPage) );
+        const DBFIndexEntry *psEntry = pasEntries + iLeaf * DBX_LEAF_ENTRIES;
+        int nLeafEntries = nEntries - iLeaf * DBX_LEAF_ENTRIES;
+        if( nLeafEntries > DBX_LEAF_ENTRIES )
+            nLeafEntries = DBX_LEAF_ENTRIES;
+
+        for( int i = 0; i < nLeafEntries; i++ )
+        {
+            DBFIndexPutDouble( abyPage + i * DBX_ENTRY_SIZE, psEntry[i].dfKey );
+            DBFIndexPutInt( abyPage + i * DBX_ENTRY_SIZE + 8, psEntry[i].nId );
+        }
+
+        if( psDBF->sHooks.FWrite( abyPage, DBX_PAGE_SIZE, 1, fp ) != 1 )
+            return false;
+    }
+
+    return true;
+}
+
+/************************************************************************/
+/*                          DBFIndexWriteHash()                         */
+/*                                                                      */
+/*      panIds and pachKeys hold nEntries ids and keys of nKeyWidth     */
+/*      bytes, in increasing id order.                                  */
+/************************************************************************/
+
+static bool DBFIndexWriteHash( DBFHandle psDBF, SAFile fp, int iField,
+                               const int *panIds, const char *pachKeys,
+                               int nEntries, int nKeyWidth )
+{
+    int nBuckets = 1;
+    while( nBuckets < nEntries && nBuckets < (1 << 30) )
+        nBuckets *= 2;
+
+    if( !DBFIndexWriteHeader( psDBF, fp, iField, 'H', nEntries, nBuckets,
+                              nKeyWidth ) )
+        return false;
+
+/* -------------------------------------------------------------------- */
+/*      Count the entries of each bucket, and order them by bucket,     */
+/*      keeping the ids increasing within a bucket.                     */
+/* -------------------------------------------------------------------- */
+    int *panFirst = STATIC_CAST(int *, calloc(STATIC_CAST(size_t, nBuckets) + 1,
+                                              sizeof(int)));
+    int *panOrder = STATIC_CAST(int *, malloc(sizeof(int) * (nEntries + 1)));
+    uint32_t *panBucket = STATIC_CAST(uint32_t *,
+                                      malloc(sizeof(uint32_t) * (nEntries + 1)));
+    const size_t nEntrySize = 4 + STATIC_CAST(size_t, nKeyWidth);
+    unsigned char *pabyEntry = STATIC_CAST(unsigned char *, malloc(nEntrySize));
+    bool bOK = panFirst != SHPLIB_NULLPTR && panOrder != SHPLIB_NULLPTR &&
+        panBucket != SHPLIB_NULLPTR && pabyEntry != SHPLIB_NULLPTR;
+
+    if( bOK )
+    {
+        for( int i = 0; i < nEntries; i++ )
+        {
+            const char *pachKey = pachKeys + STATIC_CAST(size_t, i) * nKeyWidth;
+            const char *pchEnd = STATIC_CAST(const char *, memchr(pachKey, '\0', nKeyWidth));
+            const int nLength = pchEnd == SHPLIB_NULLPTR ?
+                nKeyWidth : STATIC_CAST(int, pchEnd - pachKey);
+            panBucket[i] = DBFIndexHash( pachKey, nLength ) & (nBuckets - 1);
+            panFirst[panBucket[i] + 1]++;
+        }
+        for( int i = 0; i < nBuckets; i++ )
+            panFirst[i + 1] += panFirst[i];
+
+        int *panNext = STATIC_CAST(int *, malloc(sizeof(int) * nBuckets));
+        bOK = panNext != SHPLIB_NULLPTR;
+        if( bOK )
+        {
+            memcpy( panNext, panFirst, sizeof(int) * nBuckets );
+            for( int i = 0; i < nEntries; i++ )
+                panOrder[panNext[panBucket[i]]++] = i;
+            free( panNext );
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Write the directory, then the entries.                          */
+/* -------------------------------------------------------------------- */
+    for( int i = 0; bOK && i <= nBuckets; i++ )
+    {
+        unsigned char abyFirst[4];
+        DBFIndexPutInt( abyFirst, panFirst[i] );
+        bOK = psDBF->sHooks.FWrite( abyFirst, 4, 1, fp ) == 1;
+    }
+
+    for( int i = 0; bOK && i < nEntries; i++ )
+    {
+        DBFIndexPutInt( pabyEntry, panIds[panOrder[i]] );
+        memcpy( pabyEntry + 4, pachKeys + STATIC_CAST(size_t, panOrder[i]) * nKeyWidth,
+                nKeyWidth );
+        bOK = psDBF->sHooks.FWrite( pabyEntry, nEntrySize, 1, fp ) == 1;
+    }
+
+    free( pabyEntry );
+    free( panBucket );
+    free( panOrder );
+    free( panFirst );
+    return bOK;
+}
+
+/************************************************************************/
+/*                          goDBFCreateIndex()                          */
+/*                                                                      */
+/*      Build an index of field iField in pszIndexFile, a B+tree or a   */
+/*      hash index according to eKind.  B+trees take N, F and D         */
+/*      fields only.                                                    */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFCreateIndex( DBFHandle psDBF, int iField, const char *pszIndexFile,
+                  DBFIndexKind eKind )
+{
+    if( iField < 0 || iField >= psDBF->nFields )
+        return FALSE;
+
+    const char chType = psDBF->pachFieldType[iField];
+    if( eKind == DBFIDX_BTREE && chType != 'N' && chType != 'F' && chType != 'D' )
+    {
+        char szMessage[128];
+        snprintf( szMessage, sizeof(szMessage),
+                  "Cannot build a B+tree index on field %d of type %c.",
+                  iField, chType );
+        psDBF->sHooks.Error( szMessage );
+        return FALSE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Collect the keys of the non NULL values.                        */
+/* -------------------------------------------------------------------- */
+    const int nWidth = psDBF->panFieldSize[iField];
+    const int nRecords = psDBF->nRecords;
+
+    int nBlockRecords = DBX_BUILD_BLOCK / psDBF->nRecordLength;
+    if( nBlockRecords < 1 )
+        nBlockRecords = 1;
+
+    char *pabyBlock = STATIC_CAST(char *,
+        malloc(STATIC_CAST(size_t, nBlockRecords) * psDBF->nRecordLength));
+    DBFIndexEntry *pasEntries = SHPLIB_NULLPTR;
+    int *panIds = SHPLIB_NULLPTR;
+    char *pachKeys = SHPLIB_NULLPTR;
+
+    if( eKind == DBFIDX_BTREE )
+        pasEntries = STATIC_CAST(DBFIndexEntry *,
+            malloc(sizeof(DBFIndexEntry) * (STATIC_CAST(size_t, nRecords) + 1)));
+    else
+    {
+        panIds = STATIC_CAST(int *, malloc(sizeof(int) * (STATIC_CAST(size_t, nRecords) + 1)));
+        pachKeys = STATIC_CAST(char *, calloc(STATIC_CAST(size_t, nRecords) + 1, nWidth));
+    }
+
+    bool bOK = pabyBlock != SHPLIB_NULLPTR &&
+        (pasEntries != SHPLIB_NULLPTR || (panIds != SHPLIB_NULLPTR && pachKeys != SHPLIB_NULLPTR));
+    int nEntries = 0;
+    int nKeyWidth = 1;
+
+    for( int iStart = 0; bOK && iStart < nRecords; iStart += nBlockRecords )
+    {
+        int nBlock = nRecords - iStart;
+        if( nBlock > nBlockRecords )
+            nBlock = nBlockRecords;
+
+        const char *pabyRecords = goDBFReadRecords( psDBF, iStart, nBlock, pabyBlock );
+        if( pabyRecords == SHPLIB_NULLPTR )
+        {
+            bOK = false;
+            break;
+        }
+
+        for( int i = 0; i < nBlock; i++ )
+        {
+            const char *pachField = pabyRecords + STATIC_CAST(size_t, i) * psDBF->nRecordLength
+                + psDBF->panFieldOffset[iField];
+
+            if( eKind == DBFIDX_BTREE )
+            {
+                double dfKey;
+                if( !goDBFParseDouble( pachField, nWidth, &dfKey ) || dfKey != dfKey ||
+                    (chType == 'D' && dfKey == 0.0) )
+                    continue;
+                pasEntries[nEntries].dfKey = dfKey;
+                pasEntries[nEntries].nId = iStart + i;
+            }
+            else
+            {
+                int nLength;
+                const char *pachKey = DBFIndexTrim( pachField, nWidth, &nLength );
+                if( nLength == 0 )
+                    continue;
+                panIds[nEntries] = iStart + i;
+                memcpy( pachKeys + STATIC_CAST(size_t, nEntries) * nWidth, pachKey, nLength );
+                if( nLength > nKeyWidth )
+                    nKeyWidth = nLength;
+            }
+            nEntries++;
+        }
+    }
+    free( pabyBlock );
+
+/* -------------------------------------------------------------------- */
+/*      Write the index.                                                */
+/* -------------------------------------------------------------------- */
+    SAFile fp = SHPLIB_NULLPTR;
+    if( bOK )
+    {
+        fp = psDBF->sHooks.FOpen( pszIndexFile, "wb" );
+        if( fp == SHPLIB_NULLPTR )
+        {
+            char szMessage[256];
+            snprintf( szMessage, sizeof(szMessage),
+                      "Unable to create index file %s.", pszIndexFile );
+            psDBF->sHooks.Error( szMessage );
+            bOK = false;
+        }
+    }
+
+    if( bOK && eKind == DBFIDX_BTREE )
+        bOK = DBFIndexWriteBTree( psDBF, fp, iField, pasEntries, nEntries );
+    else if( bOK )
+    {
+        /* narrow the keys to the longest one */
+        for( int i = 1; nKeyWidth < nWidth && i < nEntries; i++ )
+            memmove( pachKeys + STATIC_CAST(size_t, i) * nKeyWidth,
+                     pachKeys + STATIC_CAST(size_t, i) * nWidth, nKeyWidth );
+        bOK = DBFIndexWriteHash( psDBF, fp, iField, panIds, pachKeys,
+                                 nEntries, nKeyWidth );
+    }
+
+    if( fp != SHPLIB_NULLPTR )
+    {
+        psDBF->sHooks.FClose( fp );
+        if( !bOK )
+        {
+            psDBF->sHooks.Error( "Failure writing index file." );
+            psDBF->sHooks.Remove( pszIndexFile );
+        }
+    }
+
+    free( pasEntries );
+    free( panIds );
+    free( pachKeys );
+    return bOK ? TRUE : FALSE;
+}
+
+/************************************************************************/
+/*                           goDBFOpenIndex()                           */
+/*                                                                      */
+/*      Open an index built by goDBFCreateIndex() for searching.  It    */
+/*      must have been built from a file with the same fields and       */
+/*      number of records as psDBF, whose hooks are used.               */
+/************************************************************************/
+
+DBFIndexHandle SHPAPI_CALL
+goDBFOpenIndex( DBFHandle psDBF, const char *pszIndexFile )
+{
+    SAFile fp = psDBF->sHooks.FOpen( pszIndexFile, "rb" );
+    if( fp == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+/* -------------------------------------------------------------------- */
+/*      Check the header against the .dbf file.                         */
+/* -------------------------------------------------------------------- */
+    unsigned char abyHeader[DBX_HEADER_SIZE];
+    if( psDBF->sHooks.FRead( abyHeader, DBX_HEADER_SIZE, 1, fp ) != 1 ||
+        memcmp( abyHeader, "DBX", 3 ) != 0 || abyHeader[4] != 1 ||
+        (abyHeader[3] != 'B' && abyHeader[3] != 'H') )
+    {
+        char szMessage[256];
+        snprintf( szMessage, sizeof(szMessage),
+                  "%s is not a DBF index file.", pszIndexFile );
+        psDBF->sHooks.Error( szMessage );
+        psDBF->sHooks.FClose( fp );
+        return SHPLIB_NULLPTR;
+    }
+
+    const int iField = DBFIndexGetInt( abyHeader + 20 );
+    char szName[XBASE_FLDNAME_LEN_READ + 1];
+    char szIndexedName[XBASE_FLDNAME_LEN_READ + 1];
+    memcpy( szIndexedName, abyHeader + 8, XBASE_FLDNAME_LEN_READ );
+    szIndexedName[XBASE_FLDNAME_LEN_READ] = '\0';
+
+    if( iField < 0 || iField >= psDBF->nFields ||
+        goDBFGetFieldInfo( psDBF, iField, szName, SHPLIB_NULLPTR, SHPLIB_NULLPTR ) == FTInvalid ||
+        strcmp( szName, szIndexedName ) != 0 ||
+        abyHeader[5] != STATIC_CAST(unsigned char, psDBF->pachFieldType[iField]) ||
+        DBFIndexGetInt( abyHeader + 24 ) != psDBF->panFieldSize[iField] ||
+        DBFIndexGetInt( abyHeader + 28 ) != psDBF->nRecords ||
+        DBFIndexGetInt( abyHeader + 32 ) != psDBF->nRecordLength )
+    {
+        char szMessage[256];
+        snprintf( szMessage, sizeof(szMessage),
+                  "Index file %s does not match the DBF file.", pszIndexFile );
+        psDBF->sHooks.Error( szMessage );
+        psDBF->sHooks.FClose( fp );
+        return SHPLIB_NULLPTR;
+    }
+
+    DBFIndexHandle psIndex = STATIC_CAST(DBFIndexHandle,
+                                         calloc(1, sizeof(struct DBFIndexInfo)));
+    if( psIndex == SHPLIB_NULLPTR )
+    {
+        psDBF->sHooks.FClose( fp );
+        return SHPLIB_NULLPTR;
+    }
+    memcpy( &(psIndex->sHooks), &(psDBF->sHooks), sizeof(SAHooks) );
+    psIndex->fp = fp;
+    psIndex->chKind = STATIC_CAST(char, abyHeader[3]);
+    psIndex->nEntries = DBFIndexGetInt( abyHeader + 36 );
+
+/* -------------------------------------------------------------------- */
+/*      Load the inner level or the bucket directory.                   */
+/* -------------------------------------------------------------------- */
+    const int nBlocks = DBFIndexGetInt( abyHeader + 40 );
+    bool bOK = psIndex->nEntries >= 0 && psIndex->nEntries <= psDBF->nRecords &&
+               nBlocks >= 0;
+    unsigned char *pabyBlocks = SHPLIB_NULLPTR;
+    int nBlockSize = 0;
+
+    if( bOK && psIndex->chKind == 'B' )
+    {
+        /* every leaf is full but the last, which has an entry or more */
+        bOK = nBlocks == (psIndex->nEntries + DBX_LEAF_ENTRIES - 1) / DBX_LEAF_ENTRIES;
+        psIndex->nLeaves = nBlocks;
+        nBlockSize = 8;
+        psIndex->nPageSize = DBX_PAGE_SIZE;
+        psIndex->nLeafOffset = (DBX_HEADER_SIZE + STATIC_CAST(SAOffset, nBlocks) * 8
+                                + DBX_PAGE_SIZE - 1) / DBX_PAGE_SIZE * DBX_PAGE_SIZE;
+        psIndex->padfFences = STATIC_CAST(double *,
+            malloc(sizeof(double) * (STATIC_CAST(size_t, nBlocks) + 1)));
+        bOK = bOK && psIndex->padfFences != SHPLIB_NULLPTR;
+    }
+    else if( bOK )
+    {
+        psIndex->nBuckets = nBlocks;
+        psIndex->nKeyWidth = DBFIndexGetInt( abyHeader + 44 );
+        nBlockSize = 4;
+        psIndex->nEntryOffset = DBX_HEADER_SIZE + (STATIC_CAST(SAOffset, nBlocks) + 1) * 4;
+        psIndex->panBuckets = STATIC_CAST(int *,
+            malloc(sizeof(int) * (STATIC_CAST(size_t, nBlocks) + 1)));
+        bOK = psIndex->panBuckets != SHPLIB_NULLPTR && nBlocks > 0 &&
+            (nBlocks & (nBlocks - 1)) == 0 &&
+            psIndex->nKeyWidth > 0 && psIndex->nKeyWidth <= XBASE_FLD_MAX_WIDTH;
+    }
+
+    const int nBlockCount = psIndex->chKind == 'B' ? nBlocks : nBlocks + 1;
+    if( bOK )
+    {
+        pabyBlocks = STATIC_CAST(unsigned char *,
+            malloc(STATIC_CAST(size_t, nBlockCount) * nBlockSize + 1));
+        bOK = pabyBlocks != SHPLIB_NULLPTR &&
+            STATIC_CAST(int, psIndex->sHooks.FRead( pabyBlocks, nBlockSize,
+                                                    nBlockCount, fp )) == nBlockCount;
+    }
+
+    for( int i = 0; bOK && i < nBlockCount; i++ )
+    {
+        if( psIndex->chKind == 'B' )
+            psIndex->padfFences[i] = DBFIndexGetDouble( pabyBlocks + i * 8 );
+        else
+            psIndex->panBuckets[i] = DBFIndexGetInt( pabyBlocks + i * 4 );
+    }
+    free( pabyBlocks );
+
+    /* the buckets must cover the entries in order */
+    for( int i = 0; bOK && psIndex->chKind == 'H' && i < nBlockCount; i++ )
+    {
+        bOK = i == 0 ? psIndex->panBuckets[0] == 0
+                     : psIndex->panBuckets[i] >= psIndex->panBuckets[i - 1];
+    }
+    if( bOK && psIndex->chKind == 'H' )
+        bOK = psIndex->panBuckets[nBlocks] == psIndex->nEntries;
+
+    if( bOK && psIndex->chKind == 'H' )
+    {
+        /* the buffer grows to the largest bucket read */
+        psIndex->nPageSize = 4 + psIndex->nKeyWidth;
+    }
+    if( bOK )
+    {
+        psIndex->pabyPage = STATIC_CAST(unsigned char *, malloc(psIndex->nPageSize));
+        bOK = psIndex->pabyPage != SHPLIB_NULLPTR;
+    }
+
+    if( !bOK )
+    {
+        psDBF->sHooks.Error( "Failure reading index file." );
+        goDBFCloseIndex( psIndex );
+        return SHPLIB_NULLPTR;
+    }
+
+    return psIndex;
+}
+
+/************************************************************************/
+/*                          goDBFCloseIndex()                           */
+/************************************************************************/
+
+void SHPAPI_CALL
+goDBFCloseIndex( DBFIndexHandle psIndex )
+{
+    if( psIndex == SHPLIB_NULLPTR )
+        return;
+
+    psIndex->sHooks.FClose( psIndex->fp );
+    free( psIndex->padfFences );
+    free( psIndex->panBuckets );
+    free( psIndex->pabyPage );
+    free( psIndex );
+}
+
+/************************************************************************/
+/*                          DBFIndexAddResult()                         */
+/************************************************************************/
+
+static bool DBFIndexAddResult( int **ppanResult, int *pnCount, int *pnMax,
+                               int nId )
+{
+    if( *pnCount == *pnMax )
+    {
+        const int nNewMax = *pnMax * 2 + 16;
+        int *panNew = STATIC_CAST(int *, realloc(*ppanResult, sizeof(int) * nNewMax));
+        if( panNew == SHPLIB_NULLPTR )
+            return false;
+        *ppanResult = panNew;
+        *pnMax = nNewMax;
+    }
+    (*ppanResult)[(*pnCount)++] = nId;
+    return true;
+}
+
+/************************************************************************/
+/*                        goDBFIndexSearchRange()                       */
+/*                                                                      */
+/*      Return the ids of the records whose key is between dfMin and    */
+/*      dfMax included, in key order and by increasing id for equal     */
+/*      keys, in a buffer to free() with their count in *pnCount.       */
+/*      Dates are searched as the number YYYYMMDD.  Returns NULL if     */
+/*      the index is not a B+tree or on read failure.                   */
+/************************************************************************/
+
+int SHPAPI_CALL1(*)
+goDBFIndexSearchRange( DBFIndexHandle psIndex, double dfMin, double dfMax,
+                       int *pnCount )
+{
+    *pnCount = 0;
+    if( psIndex->chKind != 'B' )
+        return SHPLIB_NULLPTR;
+
+    int nMax = 0;
+    int *panResult = SHPLIB_NULLPTR;
+
+/* -------------------------------------------------------------------- */
+/*      The first leaf that may hold dfMin is the last whose first key  */
+/*      is below it, as equal keys can spill over from it.              */
+/* -------------------------------------------------------------------- */
+    int nLow = 0;
+    int nHigh = psIndex->nLeaves;
+    while( nLow < nHigh )
+    {
+        const int nMid = nLow + (nHigh - nLow) / 2;
+        if( psIndex->padfFences[nMid] < dfMin )
+            nLow = nMid + 1;
+        else
+            nHigh = nMid;
+    }
+
+    bool bDone = !(dfMin <= dfMax);
+    for( int iLeaf = nLow > 0 ? nLow - 1 : 0;
+         !bDone && iLeaf < psIndex->nLeaves; iLeaf++ )
+    {
+        if( psIndex->padfFences[iLeaf] > dfMax )
+            break;
+
+        const SAOffset nOffset = psIndex->nLeafOffset
+            + STATIC_CAST(SAOffset, iLeaf) * DBX_PAGE_SIZE;
+        int nLeafEntries = psIndex->nEntries - iLeaf * DBX_LEAF_ENTRIES;
+        if( nLeafEntries > DBX_LEAF_ENTRIES )
+            nLeafEntries = DBX_LEAF_ENTRIES;
+
+        if( psIndex->sHooks.FSeek( psIndex->fp, nOffset, SEEK_SET ) != 0 ||
+            psIndex->sHooks.FRead( psIndex->pabyPage, DBX_ENTRY_SIZE,
+                                   nLeafEntries, psIndex->fp )
+                != STATIC_CAST(SAOffset, nLeafEntries) )
+        {
+            psIndex->sHooks.Error( "Failure reading index leaf." );
+            free( panResult );
+            *pnCount = 0;
+            return SHPLIB_NULLPTR;
+        }
+
+        for( int i = 0; i < nLeafEntries; i++ )
+        {
+            const unsigned char *pabyEntry = psIndex->pabyPage + i * DBX_ENTRY_SIZE;
+            const double dfKey = DBFIndexGetDouble( pabyEntry );
+            if( dfKey < dfMin )
+                continue;
+            if( dfKey > dfMax )
+            {
+                bDone = true;
+                break;
+            }
+            if( !DBFIndexAddResult( &panResult, pnCount, &nMax,
+                                    DBFIndexGetInt( pabyEntry + 8 ) ) )
+            {
+                free( panResult );
+                *pnCount = 0;
+                return SHPLIB_NULLPTR;
+            }
+        }
+    }
+
+    /* To distinguish between no match and the error case */
+    if( panResult == SHPLIB_NULLPTR )
+        panResult = STATIC_CAST(int *, calloc(1, sizeof(int)));
+
+    return panResult;
+}
+
+/************************************************************************/
+/*                       goDBFIndexSearchString()                       */
+/*                                                                      */
+/*      Return the ids of the records whose value, without surrounding  */
+/*      blanks, is pszKey, in increasing order, in a buffer to free()   */
+/*      with their count in *pnCount.  Returns NULL if the index is     */
+/*      not a hash index or on read failure.                            */
+/************************************************************************/
+
+int SHPAPI_CALL1(*)
+goDBFIndexSearchString( DBFIndexHandle psIndex, const char *pszKey,
+                        int *pnCount )
+{
+    *pnCount = 0;
+    if( psIndex->chKind != 'H' )
+        return SHPLIB_NULLPTR;
+
+    int nKeyLength = STATIC_CAST(int, strlen(pszKey));
+    pszKey = DBFIndexTrim( pszKey, nKeyLength, &nKeyLength );
+
+    int *panResult = STATIC_CAST(int *, calloc(1, sizeof(int)));
+    if( nKeyLength == 0 || nKeyLength > psIndex->nKeyWidth )
+        return panResult;
+
+    const uint32_t iBucket = DBFIndexHash( pszKey, nKeyLength ) &
+        STATIC_CAST(uint32_t, psIndex->nBuckets - 1);
+    const int iFirst = psIndex->panBuckets[iBucket];
+    const int nBucketEntries = psIndex->panBuckets[iBucket + 1] - iFirst;
+    if( nBucketEntries <= 0 )
+        return panResult;
+
+/* -------------------------------------------------------------------- */
+/*      Read the entries of the bucket.                                 */
+/* -------------------------------------------------------------------- */
+    const int nEntrySize = 4 + psIndex->nKeyWidth;
+    const size_t nBucketSize = STATIC_CAST(size_t, nBucketEntries) * nEntrySize;
+    if( nBucketSize > STATIC_CAST(size_t, psIndex->nPageSize) )
+    {
+        unsigned char *pabyNew = nBucketSize > INT_MAX ? SHPLIB_NULLPTR :
+            STATIC_CAST(unsigned char *, realloc(psIndex->pabyPage, nBucketSize));
+        if( pabyNew == SHPLIB_NULLPTR )
+        {
+            free( panResult );
+            return SHPLIB_NULLPTR;
+        }
+        psIndex->pabyPage = pabyNew;
+        psIndex->nPageSize = STATIC_CAST(int, nBucketSize);
+    }
+
+    const SAOffset nOffset = psIndex->nEntryOffset
+        + STATIC_CAST(SAOffset, iFirst) * nEntrySize;
+    if( psIndex->sHooks.FSeek( psIndex->fp, nOffset, SEEK_SET ) != 0 ||
+        psIndex->sHooks.FRead( psIndex->pabyPage, nEntrySize, nBucketEntries,
+                               psIndex->fp ) != STATIC_CAST(SAOffset, nBucketEntries) )
+    {
+        psIndex->sHooks.Error( "Failure reading index bucket." );
+        free( panResult );
+        return SHPLIB_NULLPTR;
+    }
+
+    int nMax = 1;
+    for( int i = 0; i < nBucketEntries; i++ )
+    {
+        const unsigned char *pabyEntry = psIndex->pabyPage + i * nEntrySize;
+        if( memcmp( pabyEntry + 4, pszKey, nKeyLength ) != 0 ||
+            (nKeyLength < psIndex->nKeyWidth && pabyEntry[4 + nKeyLength] != '\0') )
+            continue;
+
+        if( !DBFIndexAddResult( &panResult, pnCount, &nMax,
+                                DBFIndexGetInt( pabyEntry ) ) )
+        {
+            free( panResult );
+            *pnCount = 0;
+            return SHPLIB_NULLPTR;
+        }
+    }
+
+    return panResult;
+}
@@ -0,0 +1,550 @@
+/******************************************************************************
+ *
+ * Project:  Shapelib
+ * Purpose:  Parsers for the fixed width numeric fields of .dbf files,
+ *           working in place on the field bytes.
+ *
+ ******************************************************************************
+ *
+ * This software is available under the following "MIT Style" license,
+ * or at the option of the licensee under the LGPL (see COPYING).  This
+ * option is discussed in more detail in shapelib.html.
+ *
+ * --
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************
+ *
+ * N, F and I fields hold a right aligned decimal number padded with blanks,
+ * and are NULL when blank or filled with asterisks.  Integers take runs of
+ * eight digits at a time with SWAR arithmetic on little endian hosts.
+ * Doubles with at most 19 significant digits and a small exponent are
+ * computed exactly from the integer mantissa and a power of ten (Clinger's
+ * fast path); the rest goes through strtod() with the decimal point of the
+ * current locale substituted, so that results never depend on the locale.
+ * D fields hold YYYYMMDD dates, decoded to days since 1970-01-01 after
+ * checking that they name a real day.
+ *
+ * Numbers are written as printf("%W.Df") would, from the integer digits of
+ * the value scaled by 10^D, two digits at a time.  Values whose scaled form
+ * is too large to be exact, or too close to a rounding tie to be rounded
+ * safely after one multiplication, go through snprintf().
+ */
+
+#include "shapefil.h"
+
+#include <float.h>
+#include <locale.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+SHP_CVSID("$Id$")
+
+#ifndef FALSE
+#  define FALSE		0
+#  define TRUE		1
+#endif
+
+#ifdef __cplusplus
+#define STATIC_CAST(type,x) static_cast<type>(x)
+#else
+#define STATIC_CAST(type,x) ((type)(x))
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#  define DBF_SWAR_DIGITS
+#elif defined(_M_X64) || defined(_M_IX86) || defined(_M_ARM64)
+#  define DBF_SWAR_DIGITS
+#endif
+
+/* The fast path relies on doubles being evaluated in double precision */
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0
+#  define DBF_EXACT_FAST_PATH
+#endif
+
+#define DBF_MAX_MANTISSA (STATIC_CAST(uint64_t, 1) << 53)
+
+static const char achDigitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const double adfPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/************************************************************************/
+/*                          DBFSkipNullField()                          */
+/*                                                                      */
+/*      Skip the leading blanks of a field, returning the index of the  */
+/*      first other character, or -1 if the field is NULL.              */
+/************************************************************************/
+
+static int DBFSkipNullField( const char *pachField, int nWidth )
+{
+    int i = 0;
+    while( i < nWidth && pachField[i] == ' ' )
+        i++;
+
+    if( i == nWidth || pachField[i] == '*' || pachField[i] == '\0' )
+        return -1;
+
+    return i;
+}
+
+#ifdef DBF_SWAR_DIGITS
+/************************************************************************/
+/*                          DBFEightDigits()                            */
+/*                                                                      */
+/*      If the 8 bytes at pachDigits are all decimal digits, store      */
+/*      their value in *pnValue.                                        */
+/************************************************************************/
+
+static bool DBFEightDigits( const char *pachDigits, uint64_t *pnValue )
+{
+    uint64_t nChunk;
+    memcpy( &nChunk, pachDigits, 8 );
+
+    /* every byte in 0x30-0x39 */
+    if( ((nChunk & UINT64_C(0xF0F0F0F0F0F0F0F0)) |
+         (((nChunk + UINT64_C(0x0606060606060606)) & UINT64_C(0xF0F0F0F0F0F0F0F0)) >> 4))
+        != UINT64_C(0x3333333333333333) )
+        return false;
+
+    /* combine pairs, then quads, then both halves */
+    nChunk = ((nChunk & UINT64_C(0x0F0F0F0F0F0F0F0F)) * 2561) >> 8;
+    nChunk = ((nChunk & UINT64_C(0x00FF00FF00FF00FF)) * 6553601) >> 16;
+    *pnValue = ((nChunk & UINT64_C(0x0000FFFF0000FFFF)) *
+                UINT64_C(42949672960001)) >> 32;
+    return true;
+}
+#endif
+
+/************************************************************************/
+/*                         goDBFParseInteger()                          */
+/*                                                                      */
+/*      Parse the leading integer of a field of nWidth bytes, as        */
+/*      atoi() would, clamping to the int range.  Returns FALSE with    */
+/*      a value of 0 if the field is NULL.                              */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFParseInteger( const char *pachField, int nWidth, int *pnValue )
+{
+    int i = DBFSkipNullField( pachField, nWidth );
+    if( i < 0 )
+    {
+        *pnValue = 0;
+        return FALSE;
+    }
+
+    bool bNegative = false;
+    if( pachField[i] == '-' || pachField[i] == '+' )
+        bNegative = pachField[i++] == '-';
+
+    /* saturates above INT_MAX, which cannot overflow the next step */
+    const uint64_t nLimit = STATIC_CAST(uint64_t, INT_MAX) + 1;
+    uint64_t nValue = 0;
+
+#ifdef DBF_SWAR_DIGITS
+    uint64_t nEight;
+    while( nWidth - i >= 8 && DBFEightDigits( pachField + i, &nEight ) )
+    {
+        nValue = nValue * 100000000 + nEight;
+        if( nValue > nLimit )
+            nValue = nLimit;
+        i += 8;
+    }
+#endif
+
+    for( ; i < nWidth && pachField[i] >= '0' && pachField[i] <= '9'; i++ )
+    {
+        nValue = nValue * 10 + STATIC_CAST(uint64_t, pachField[i] - '0');
+        if( nValue > nLimit )
+            nValue = nLimit;
+    }
+
+    if( bNegative )
+        *pnValue = nValue >= nLimit ? INT_MIN : -STATIC_CAST(int, nValue);
+    else
+        *pnValue = nValue >= nLimit ? INT_MAX : STATIC_CAST(int, nValue);
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                          DBFParseDoubleSlow()                        */
+/*                                                                      */
+/*      strtod() on a zero terminated copy of the field, with the       */
+/*      decimal point of the current locale.                            */
+/************************************************************************/
+
+static double DBFParseDoubleSlow( const char *pachField, int nWidth )
+{
+    char szValue[XBASE_FLD_MAX_WIDTH + 1];
+    if( nWidth > XBASE_FLD_MAX_WIDTH )
+        nWidth = XBASE_FLD_MAX_WIDTH;
+    memcpy( szValue, pachField, nWidth );
+    szValue[nWidth] = '\0';
+
+    const char chPoint = localeconv()->decimal_point[0];
+    if( chPoint != '.' && chPoint != '\0' )
+    {
+        char *pchPoint = strchr( szValue, '.' );
+        if( pchPoint != NULL )
+            *pchPoint = chPoint;
+    }
+
+    return strtod( szValue, NULL );
+}
+
+/************************************************************************/
+/*                          goDBFParseDouble()                          */
+/*                                                                      */
+/*      Parse a field of nWidth bytes as a double, as atof() would in   */
+/*      the C locale.  Returns FALSE with a value of 0 if the field is  */
+/*      NULL.                                                           */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFParseDouble( const char *pachField, int nWidth, double *pdfValue )
+{
+    const int iStart = DBFSkipNullField( pachField, nWidth );
+    if( iStart < 0 )
+    {
+        *pdfValue = 0.0;
+        return FALSE;
+    }
+
+#ifdef DBF_EXACT_FAST_PATH
+/* -------------------------------------------------------------------- */
+/*      Collect the significant digits and the decimal exponent.        */
+/* -------------------------------------------------------------------- */
+    int i = iStart;
+    bool bNegative = false;
+    if( pachField[i] == '-' || pachField[i] == '+' )
+        bNegative = pachField[i++] == '-';
+
+    uint64_t nMantissa = 0;
+    int nDigits = 0;         /* significant digits in nMantissa */
+    int nExponent = 0;
+    bool bAnyDigit = false;
+    bool bPoint = false;
+
+    for( ; i < nWidth; i++ )
+    {
+        const char ch = pachField[i];
+        if( ch >= '0' && ch <= '9' )
+        {
+            bAnyDigit = true;
+            if( nDigits > 0 || ch != '0' )
+            {
+                nMantissa = nMantissa * 10 + STATIC_CAST(uint64_t, ch - '0');
+                nDigits++;
+            }
+            if( bPoint )
+                nExponent--;
+            if( nDigits > 19 )
+                break;
+        }
+        else if( ch == '.' && !bPoint )
+            bPoint = true;
+        else
+            break;
+    }
+
+    if( i < nWidth && (pachField[i] == 'e' || pachField[i] == 'E') &&
+        bAnyDigit && nDigits <= 19 )
+    {
+        int j = i + 1;
+        bool bNegativeExp = false;
+        if( j < nWidth && (pachField[j] == '-' || pachField[j] == '+') )
+            bNegativeExp = pachField[j++] == '-';
+
+        int nExp = 0;
+        const int jDigits = j;
+        for( ; j < nWidth && pachField[j] >= '0' && pachField[j] <= '9'; j++ )
+        {
+            if( nExp < 10000 )
+                nExp = nExp * 10 + (pachField[j] - '0');
+        }
+        if( j > jDigits )
+        {
+            nExponent += bNegativeExp ? -nExp : nExp;
+            i = j;
+        }
+    }
+
+    /* only trailing blanks may follow */
+    while( i < nWidth && pachField[i] == ' ' )
+        i++;
+
+/* -------------------------------------------------------------------- */
+/*      Both the mantissa and the power of ten are exact doubles, so    */
+/*      a single correctly rounded operation gives the exact result.    */
+/* -------------------------------------------------------------------- */
+    if( bAnyDigit && nDigits <= 19 && (i == nWidth || pachField[i] == '\0') &&
+        nMantissa <= DBF_MAX_MANTISSA )
+    {
+        double dfValue = -1.0;
+        if( nMantissa == 0 )
+            dfValue = 0.0;
+        else if( nExponent >= 0 && nExponent <= 22 )
+            dfValue = STATIC_CAST(double, nMantissa) * adfPow10[nExponent];
+        else if( nExponent < 0 && nExponent >= -22 )
+            dfValue = STATIC_CAST(double, nMantissa) / adfPow10[-nExponent];
+        else if( nExponent > 22 && nExponent <= 22 + 15 )
+        {
+            /* move the excess exponent into the mantissa if it stays exact */
+            uint64_t nScaled = nMantissa;
+            for( int k = 22; k < nExponent && nScaled <= DBF_MAX_MANTISSA; k++ )
+                nScaled *= 10;
+            if( nScaled <= DBF_MAX_MANTISSA )
+                dfValue = STATIC_CAST(double, nScaled) * adfPow10[22];
+        }
+
+        if( dfValue >= 0.0 )
+        {
+            *pdfValue = bNegative ? -dfValue : dfValue;
+            return TRUE;
+        }
+    }
+#endif
+
+    *pdfValue = DBFParseDoubleSlow( pachField + iStart, nWidth - iStart );
+    return TRUE;
+}
+
+/************************************************************************/
+/*                           goDBFParseDate()                           */
+/*                                                                      */
+/*      Parse a YYYYMMDD field of nWidth bytes, blanks around it        */
+/*      allowed, into days since 1970-01-01.  Returns FALSE with a      */
+/*      value of 0 if the field is NULL or not a valid date.            */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFParseDate( const char *pachField, int nWidth, int *pnDays )
+{
+    *pnDays = 0;
+
+    int i = 0;
+    while( i < nWidth && pachField[i] == ' ' )
+        i++;
+    if( nWidth - i < 8 )
+        return FALSE;
+    for( int j = i + 8; j < nWidth && pachField[j] != '\0'; j++ )
+    {
+        if( pachField[j] != ' ' )
+            return FALSE;
+    }
+
+    int nDate = 0;
+#ifdef DBF_SWAR_DIGITS
+    uint64_t nEight;
+    if( !DBFEightDigits( pachField + i, &nEight ) )
+        return FALSE;
+    nDate = STATIC_CAST(int, nEight);
+#else
+    for( int j = i; j < i + 8; j++ )
+    {
+        if( pachField[j] < '0' || pachField[j] > '9' )
+            return FALSE;
+        nDate = nDate * 10 + (pachField[j] - '0');
+    }
+#endif
+
+    int nYear = nDate / 10000;
+    const int nMonth = nDate / 100 % 100;
+    const int nDay = nDate % 100;
+
+    static const int anMonthDays[12] = { 31, 29, 31, 30, 31, 30,
+                                         31, 31, 30, 31, 30, 31 };
+    if( nMonth < 1 || nMonth > 12 || nDay < 1 || nDay > anMonthDays[nMonth - 1] )
+        return FALSE;
+    if( nMonth == 2 && nDay == 29 &&
+        (nYear % 4 != 0 || (nYear % 100 == 0 && nYear % 400 != 0)) )
+        return FALSE;
+
+/* -------------------------------------------------------------------- */
+/*      Count the days of the 400 year cycles, then of the cycle from   */
+/*      March 1st, which puts leap days at the end of years.            */
+/* -------------------------------------------------------------------- */
+    if( nMonth <= 2 )
+        nYear--;
+    const int nEra = (nYear >= 0 ? nYear : nYear - 399) / 400;
+    const int nYearOfEra = nYear - nEra * 400;
+    const int nDayOfYear = (153 * (nMonth + (nMonth > 2 ? -3 : 9)) + 2) / 5 + nDay - 1;
+    const int nDayOfEra = nYearOfEra * 365 + nYearOfEra / 4 - nYearOfEra / 100 + nDayOfYear;
+
+    *pnDays = nEra * 146097 + nDayOfEra - 719468;
+    return TRUE;
+}
+
+/************************************************************************/
+/*                          DBFFormatDigits()                           */
+/*                                                                      */
+/*      Write the decimal digits of nValue, at least nMinDigits of      */
+/*      them, so that they end just before pchEnd.  Returns the first   */
+/*      digit.                                                          */
+/************************************************************************/
+
+static char *DBFFormatDigits( uint64_t nValue, int nMinDigits, char *pchEnd )
+{
+    char *pch = pchEnd;
+    while( nValue >= 100 )
+    {
+        const unsigned i = STATIC_CAST(unsigned, nValue % 100) * 2;
+        nValue /= 100;
+        *--pch = achDigitPairs[i + 1];
+        *--pch = achDigitPairs[i];
+    }
+    if( nValue >= 10 )
+    {
+        const unsigned i = STATIC_CAST(unsigned, nValue) * 2;
+        *--pch = achDigitPairs[i + 1];
+        *--pch = achDigitPairs[i];
+    }
+    else
+        *--pch = STATIC_CAST(char, '0' + nValue);
+
+    while( pchEnd - pch < nMinDigits )
+        *--pch = '0';
+
+    return pch;
+}
+
+/************************************************************************/
+/*                          DBFFormatFixed()                            */
+/*                                                                      */
+/*      Write dfValue with nDecimals decimals so that it ends just      */
+/*      before pchEnd, returning its first character, or NULL if it     */
+/*      cannot be formatted exactly without snprintf().                 */
+/************************************************************************/
+
+static char *DBFFormatFixed( double dfValue, int nDecimals, char *pchEnd )
+{
+#ifdef DBF_EXACT_FAST_PATH
+    /* also rejects NaN */
+    if( !(fabs(dfValue) < 1e18) )
+        return NULL;
+
+    const double dfAbs = fabs(dfValue);
+    uint64_t nInteger;
+    uint64_t nFraction = 0;
+
+    if( dfAbs == floor(dfAbs) )
+        nInteger = STATIC_CAST(uint64_t, dfAbs);
+    else
+    {
+        if( nDecimals > 15 )
+            return NULL;
+
+        const double dfScaled = dfAbs * adfPow10[nDecimals];
+        if( !(dfScaled < 1e15) )
+            return NULL;
+
+        /* the product is within half an ulp of the exact scaled value, */
+        /* which is only rounded the other way near a tie               */
+        const double dfFloor = floor(dfScaled);
+        const double dfFraction = dfScaled - dfFloor;
+        if( fabs(dfFraction - 0.5) <= dfScaled * 4 * DBL_EPSILON )
+            return NULL;
+
+        const uint64_t nScaled = STATIC_CAST(uint64_t, dfFloor) +
+                                 (dfFraction > 0.5 ? 1 : 0);
+        const uint64_t nPow10 = STATIC_CAST(uint64_t, adfPow10[nDecimals]);
+        nInteger = nScaled / nPow10;
+        nFraction = nScaled % nPow10;
+    }
+
+    char *pch = pchEnd;
+    if( nDecimals > 0 )
+    {
+        pch = DBFFormatDigits( nFraction, nDecimals, pch );
+        *--pch = '.';
+    }
+    pch = DBFFormatDigits( nInteger, 1, pch );
+    if( signbit(dfValue) )
+        *--pch = '-';
+
+    return pch;
+#else
+    (void)dfValue;
+    (void)nDecimals;
+    (void)pchEnd;
+    return NULL;
+#endif
+}
+
+/************************************************************************/
+/*                          goDBFFormatDouble()                         */
+/*                                                                      */
+/*      Write dfValue with nDecimals decimals right aligned in the      */
+/*      nWidth bytes at pachField, as printf("%W.Df") in the C locale   */
+/*      would.  Returns FALSE, with the leading nWidth characters       */
+/*      written, if the value does not fit.                             */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFFormatDouble( double dfValue, int nWidth, int nDecimals, char *pachField )
+{
+    if( nDecimals < 0 )
+        nDecimals = 0;
+    else if( nDecimals > XBASE_FLD_MAX_WIDTH )
+        nDecimals = XBASE_FLD_MAX_WIDTH;
+
+    /* room for the widest fixed formatting, and then some for snprintf() */
+    char szValue[2 * XBASE_FLD_MAX_WIDTH + 64];
+    char *pchEnd = szValue + sizeof(szValue);
+    const char *pszValue = DBFFormatFixed( dfValue, nDecimals, pchEnd );
+    int nLength;
+
+    if( pszValue != NULL )
+        nLength = STATIC_CAST(int, pchEnd - pszValue);
+    else
+    {
+        snprintf( szValue, sizeof(szValue), "%.*f", nDecimals, dfValue );
+
+        const char chPoint = localeconv()->decimal_point[0];
+        if( chPoint != '.' && chPoint != '\0' )
+        {
+            char *pchPoint = strchr( szValue, chPoint );
+            if( pchPoint != NULL )
+                *pchPoint = '.';
+        }
+        pszValue = szValue;
+        nLength = STATIC_CAST(int, strlen(szValue));
+    }
+
+    if( nLength >= nWidth )
+    {
+        memcpy( pachField, pszValue, nWidth );
+        return nLength == nWidth;
+    }
+
+    memset( pachField, ' ', nWidth - nLength );
+    memcpy( pachField + nWidth - nLength, pszValue, nLength );
+    return TRUE;
+}
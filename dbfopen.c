@@ -33,15 +33,30 @@
  * DEALINGS IN THE SOFTWARE.
  ******************************************************************************/
 
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64 /* pread() and mmap() beyond 2 GB */
+#endif
+
 #include "shapefil.h"
 
 #include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
 
+#ifndef SHPAPI_WINDOWS
+#  include <errno.h>
+#  include <pthread.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#else
+#  include <windows.h>
+#endif
+
 #ifdef USE_CPL
 #include "cpl_string.h"
 #else
@@ -214,6 +229,13 @@ static bool DBFFlushRecord( DBFHandle psDBF ) {
 /* -------------------------------------------------------------------- */
 	psDBF->bRequireNextWriteSeek = FALSE;
 
+        /* Keep the read-ahead copy of the record current */
+        const int iSlot = psDBF->nCurrentRecord - psDBF->nReadAheadFirst;
+        if( iSlot >= 0 && iSlot < psDBF->nReadAheadCount )
+            memcpy( psDBF->pabyReadAhead +
+                        STATIC_CAST(size_t, iSlot) * psDBF->nRecordLength,
+                    psDBF->pszCurrentRecord, psDBF->nRecordLength );
+
         if( psDBF->nCurrentRecord == psDBF->nRecords - 1 )
         {
             if( psDBF->bWriteEndOfFileChar )
@@ -227,16 +249,98 @@ static bool DBFFlushRecord( DBFHandle psDBF ) {
     return true;
 }
 
+#define DBF_READ_AHEAD_SIZE (1024 * 1024)
+
+/************************************************************************/
+/*                       DBFLoadRecordReadAhead()                       */
+/*                                                                      */
+/*      Serve the record from the read-ahead window, refilling the      */
+/*      window with a single read starting at (or, when reading in     */
+/*      reverse, ending at) the record if it is not there.              */
+/************************************************************************/
+
+static bool DBFLoadRecordReadAhead( DBFHandle psDBF, int iRecord ) {
+    if( iRecord < psDBF->nReadAheadFirst ||
+        iRecord >= psDBF->nReadAheadFirst + psDBF->nReadAheadCount )
+    {
+        int nCount = psDBF->nReadAheadSize / psDBF->nRecordLength;
+        if( nCount < 1 )
+            nCount = 1;
+
+        int iFirst = iRecord;
+        if( psDBF->bReadAheadReverse )
+            iFirst = iRecord - nCount + 1 < 0 ? 0 : iRecord - nCount + 1;
+        if( nCount > psDBF->nRecords - iFirst )
+            nCount = psDBF->nRecords - iFirst;
+        if( nCount < 1 )
+            nCount = 1;
+
+        psDBF->nReadAheadCount = 0;
+
+        char *pabyReadAhead = STATIC_CAST(char *,
+            realloc( psDBF->pabyReadAhead,
+                     STATIC_CAST(size_t, nCount) * psDBF->nRecordLength ));
+        if( pabyReadAhead == SHPLIB_NULLPTR )
+        {
+            psDBF->sHooks.Error( "Not enough memory for DBF read-ahead." );
+            return false;
+        }
+        psDBF->pabyReadAhead = pabyReadAhead;
+
+        const SAOffset nOffset =
+            psDBF->nRecordLength * STATIC_CAST(SAOffset, iFirst) + psDBF->nHeaderLength;
+
+        if( psDBF->sHooks.FSeek( psDBF->fp, nOffset, SEEK_SET ) != 0 )
+        {
+            char szMessage[128];
+            snprintf( szMessage, sizeof(szMessage), "fseek(%ld) failed on DBF file.",
+                      STATIC_CAST(long, nOffset) );
+            psDBF->sHooks.Error( szMessage );
+            return false;
+        }
+
+        /* A short read at the end of a truncated file is not an error */
+        /* unless it misses the requested record */
+        const int nRead = STATIC_CAST(int, psDBF->sHooks.FRead(
+            pabyReadAhead, psDBF->nRecordLength, nCount, psDBF->fp ));
+        if( nRead <= iRecord - iFirst )
+        {
+            char szMessage[128];
+            snprintf( szMessage, sizeof(szMessage), "fread(%d) failed on DBF file.",
+                     psDBF->nRecordLength );
+            psDBF->sHooks.Error( szMessage );
+            return false;
+        }
+
+        psDBF->nReadAheadFirst = iFirst;
+        psDBF->nReadAheadCount = nRead;
+        psDBF->bRequireNextWriteSeek = TRUE;
+    }
+
+    memcpy( psDBF->pszCurrentRecord,
+            psDBF->pabyReadAhead +
+                STATIC_CAST(size_t, iRecord - psDBF->nReadAheadFirst) * psDBF->nRecordLength,
+            psDBF->nRecordLength );
+    psDBF->nCurrentRecord = iRecord;
+
+    return true;
+}
+
 /************************************************************************/
 /*                           DBFLoadRecord()                            */
 /************************************************************************/
 
 static bool DBFLoadRecord( DBFHandle psDBF, int iRecord ) {
-    if( psDBF->nCurrentRecord != iRecord )
+    if( psDBF->nCurrentRecord != iRecord || psDBF->bCurrentRecordPartial )
     {
 	if( !DBFFlushRecord( psDBF ) )
             return false;
 
+        psDBF->bCurrentRecordPartial = FALSE;
+
+        if( psDBF->nReadAheadSize > 0 )
+            return DBFLoadRecordReadAhead( psDBF, iRecord );
+
         const SAOffset nRecordOffset =
             psDBF->nRecordLength * STATIC_CAST(SAOffset,iRecord) + psDBF->nHeaderLength;
 
@@ -269,6 +373,51 @@ static bool DBFLoadRecord( DBFHandle psDBF, int iRecord ) {
     return true;
 }
 
+/************************************************************************/
+/*                       DBFLoadProjectedRecord()                       */
+/*                                                                      */
+/*      Load the record for reading field iField.  With a clustered     */
+/*      projection covering the field, only the projected byte span    */
+/*      is read into pszCurrentRecord; anything else loads the whole   */
+/*      record.                                                         */
+/************************************************************************/
+
+static bool DBFLoadProjectedRecord( DBFHandle psDBF, int iRecord, int iField ) {
+    if( psDBF->nProjectionLength == 0 || psDBF->nReadAheadSize > 0 ||
+        psDBF->panFieldOffset[iField] < psDBF->nProjectionStart ||
+        psDBF->panFieldOffset[iField] + psDBF->panFieldSize[iField] >
+            psDBF->nProjectionStart + psDBF->nProjectionLength )
+        return DBFLoadRecord( psDBF, iRecord );
+
+    if( psDBF->nCurrentRecord == iRecord )
+        return true;
+
+    if( !DBFFlushRecord( psDBF ) )
+        return false;
+
+    const SAOffset nOffset =
+        psDBF->nRecordLength * STATIC_CAST(SAOffset,iRecord) + psDBF->nHeaderLength
+        + psDBF->nProjectionStart;
+
+    if( psDBF->sHooks.FSeek( psDBF->fp, nOffset, SEEK_SET ) != 0 ||
+        psDBF->sHooks.FRead( psDBF->pszCurrentRecord + psDBF->nProjectionStart,
+                             psDBF->nProjectionLength, 1, psDBF->fp ) != 1 )
+    {
+        char szMessage[128];
+        snprintf( szMessage, sizeof(szMessage),
+                  "Failure reading projected fields of DBF record %d.", iRecord );
+        psDBF->sHooks.Error( szMessage );
+        psDBF->nCurrentRecord = -1;
+        return false;
+    }
+
+    psDBF->nCurrentRecord = iRecord;
+    psDBF->bCurrentRecordPartial = TRUE;
+    psDBF->bRequireNextWriteSeek = TRUE;
+
+    return true;
+}
+
 /************************************************************************/
 /*                          goDBFUpdateHeader()                           */
 /************************************************************************/
@@ -312,6 +461,103 @@ goDBFSetLastModifiedDate( DBFHandle psDBF, int nYYSince1900, int nMM, int nDD )
     psDBF->nUpdateDay = nDD;
 }
 
+/************************************************************************/
+/*                          DBFFoldFieldName()                          */
+/*                                                                      */
+/*      Copy a field name upper-cased into pszOut, which holds          */
+/*      XBASE_FLDNAME_LEN_READ+1 bytes.  Returns false if the name is   */
+/*      too long to be the name of a field.                             */
+/************************************************************************/
+
+static bool DBFFoldFieldName( const char *pszName, char *pszOut )
+{
+    int i = 0;
+    for( ; pszName[i] != '\0'; i++ )
+    {
+        if( i == XBASE_FLDNAME_LEN_READ )
+            return false;
+        const unsigned char ch = STATIC_CAST(unsigned char, pszName[i]);
+        pszOut[i] = STATIC_CAST(char, ch >= 'a' && ch <= 'z' ? ch - 32 : ch);
+    }
+    pszOut[i] = '\0';
+    return true;
+}
+
+static unsigned DBFHashFieldName( const char *pszName )
+{
+    /* FNV-1a */
+    unsigned nHash = 2166136261U;
+    for( ; *pszName != '\0'; pszName++ )
+    {
+        nHash ^= STATIC_CAST(unsigned char, *pszName);
+        nHash *= 16777619U;
+    }
+    return nHash;
+}
+
+/************************************************************************/
+/*                         DBFBuildFieldHash()                          */
+/*                                                                      */
+/*      Rebuild the table of field names searched by                    */
+/*      goDBFGetFieldIndex().  Called whenever the fields change.  If   */
+/*      it cannot be allocated, goDBFGetFieldIndex() scans the fields.  */
+/************************************************************************/
+
+static void DBFBuildFieldHash( DBFHandle psDBF )
+{
+    free( psDBF->pachFieldNames );
+    free( psDBF->panFieldHash );
+    psDBF->pachFieldNames = SHPLIB_NULLPTR;
+    psDBF->panFieldHash = SHPLIB_NULLPTR;
+    psDBF->nFieldHashMask = 0;
+
+    if( psDBF->nFields <= 0 )
+        return;
+
+    /* Keep the table at most half full */
+    int nSlots = 16;
+    while( nSlots < 2 * psDBF->nFields )
+        nSlots *= 2;
+
+    char *pachNames = STATIC_CAST(char *,
+        malloc( STATIC_CAST(size_t, psDBF->nFields) *
+                (XBASE_FLDNAME_LEN_READ + 1) ) );
+    int *panHash = STATIC_CAST(int *,
+        malloc( sizeof(int) * STATIC_CAST(size_t, nSlots) ) );
+    if( pachNames == SHPLIB_NULLPTR || panHash == SHPLIB_NULLPTR )
+    {
+        free( pachNames );
+        free( panHash );
+        return;
+    }
+
+    for( int i = 0; i < nSlots; i++ )
+        panHash[i] = -1;
+
+    const unsigned nMask = STATIC_CAST(unsigned, nSlots - 1);
+    for( int iField = 0; iField < psDBF->nFields; iField++ )
+    {
+        char szName[XBASE_FLDNAME_LEN_READ+1];
+        char *pszFolded = pachNames + iField * (XBASE_FLDNAME_LEN_READ + 1);
+        goDBFGetFieldInfo( psDBF, iField, szName,
+                           SHPLIB_NULLPTR, SHPLIB_NULLPTR );
+        DBFFoldFieldName( szName, pszFolded );
+
+        /* Duplicates are skipped, so a name keeps finding its first field */
+        unsigned iSlot = DBFHashFieldName( pszFolded ) & nMask;
+        while( panHash[iSlot] >= 0 &&
+               strcmp( pachNames + panHash[iSlot] * (XBASE_FLDNAME_LEN_READ + 1),
+                       pszFolded ) != 0 )
+            iSlot = (iSlot + 1) & nMask;
+        if( panHash[iSlot] < 0 )
+            panHash[iSlot] = iField;
+    }
+
+    psDBF->pachFieldNames = pachNames;
+    psDBF->panFieldHash = panHash;
+    psDBF->nFieldHashMask = STATIC_CAST(int, nMask);
+}
+
 /************************************************************************/
 /*                              goDBFOpen()                               */
 /*                                                                      */
@@ -347,6 +593,62 @@ static int DBFGetLenWithoutExtension(const char* pszBasename) {
     return nLen;
 }
 
+/************************************************************************/
+/*                            DBFAdviseMap()                            */
+/************************************************************************/
+
+static void DBFAdviseMap( DBFHandle psDBF ) {
+#if !defined(SHPAPI_WINDOWS) && defined(POSIX_MADV_SEQUENTIAL)
+    if( psDBF->pabyMap == SHPLIB_NULLPTR )
+        return;
+
+    int nAdvice = POSIX_MADV_NORMAL;
+    if( psDBF->nAccessPattern == SA_ADVICE_SEQUENTIAL )
+        nAdvice = POSIX_MADV_SEQUENTIAL;
+    else if( psDBF->nAccessPattern == SA_ADVICE_RANDOM )
+        nAdvice = POSIX_MADV_RANDOM;
+    posix_madvise( CONST_CAST(char *, psDBF->pabyMap), psDBF->nMapSize, nAdvice );
+#else
+    (void)psDBF;
+#endif
+}
+
+/************************************************************************/
+/*                             DBFMapFile()                             */
+/*                                                                      */
+/*      Map the records of a read-only file, so that they are read in   */
+/*      place rather than copied into pszCurrentRecord.  Files which    */
+/*      cannot be mapped (no descriptor behind the hooks, Windows, or   */
+/*      shorter than the header claims) keep being read normally.       */
+/************************************************************************/
+
+static void DBFMapFile( DBFHandle psDBF ) {
+#ifndef SHPAPI_WINDOWS
+    const int fd = psDBF->sHooks.FFileno != SHPLIB_NULLPTR ?
+                   psDBF->sHooks.FFileno( psDBF->fp ) : -1;
+    struct stat sStat;
+    if( fd < 0 || fstat( fd, &sStat ) != 0 )
+        return;
+
+    const SAOffset nSize = STATIC_CAST(SAOffset, sStat.st_size);
+    if( nSize == 0 ||
+        nSize < psDBF->nHeaderLength +
+                STATIC_CAST(SAOffset, psDBF->nRecords) * psDBF->nRecordLength )
+        return;
+
+    void *pMap = mmap( SHPLIB_NULLPTR, nSize, PROT_READ, MAP_SHARED, fd, 0 );
+    if( pMap == MAP_FAILED )
+        return;
+
+    psDBF->pabyMap = STATIC_CAST(const char *, pMap);
+    psDBF->nMapSize = nSize;
+
+    DBFAdviseMap( psDBF );
+#else
+    (void)psDBF;
+#endif
+}
+
 /************************************************************************/
 /*                              goDBFOpen()                               */
 /*                                                                      */
@@ -355,6 +657,30 @@ static int DBFGetLenWithoutExtension(const char* pszBasename) {
 
 DBFHandle SHPAPI_CALL
 goDBFOpenLL( const char * pszFilename, const char * pszAccess, SAHooks *psHooks ) {
+/* -------------------------------------------------------------------- */
+/*      Split off the access pattern modifiers: 's' declares a full     */
+/*      scan, 'i' index driven reads, 'm' maps the file in read mode.   */
+/* -------------------------------------------------------------------- */
+    char szAccess[8];
+    int nAccessPattern = SA_ADVICE_NORMAL;
+    bool bMap = false;
+    int nAccessLen = 0;
+    for( const char *pszIter = pszAccess; *pszIter != '\0'; pszIter++ )
+    {
+        if( *pszIter == 's' )
+            nAccessPattern = SA_ADVICE_SEQUENTIAL;
+        else if( *pszIter == 'i' )
+            nAccessPattern = SA_ADVICE_RANDOM;
+        else if( *pszIter == 'm' )
+            bMap = true;
+        else if( nAccessLen < STATIC_CAST(int, sizeof(szAccess)) - 1 )
+            szAccess[nAccessLen++] = *pszIter;
+        else
+            return SHPLIB_NULLPTR;
+    }
+    szAccess[nAccessLen] = '\0';
+    pszAccess = szAccess;
+
 /* -------------------------------------------------------------------- */
 /*      We only allow the access strings "rb" and "r+".                  */
 /* -------------------------------------------------------------------- */
@@ -409,6 +735,9 @@ goDBFOpenLL( const char * pszFilename, const char * pszAccess, SAHooks *psHooks
     psDBF->nCurrentRecord = -1;
     psDBF->bCurrentRecordModified = FALSE;
 
+    if( nAccessPattern != SA_ADVICE_NORMAL )
+        goDBFSetAccessPattern( psDBF, nAccessPattern );
+
 /* -------------------------------------------------------------------- */
 /*  Read Table Header info                                              */
 /* -------------------------------------------------------------------- */
@@ -545,6 +874,11 @@ goDBFOpenLL( const char * pszFilename, const char * pszAccess, SAHooks *psHooks
 
     psDBF->bRequireNextWriteSeek = TRUE;
 
+    if( bMap && strcmp(pszAccess, "rb") == 0 )
+        DBFMapFile( psDBF );
+
+    DBFBuildFieldHash( psDBF );
+
     return( psDBF );
 }
 
@@ -589,6 +923,17 @@ goDBFClose(DBFHandle psDBF)
     if( psDBF->pszWorkField != SHPLIB_NULLPTR )
         free( psDBF->pszWorkField );
 
+#ifndef SHPAPI_WINDOWS
+    if( psDBF->pabyMap != SHPLIB_NULLPTR )
+        munmap( CONST_CAST(char *, psDBF->pabyMap), psDBF->nMapSize );
+#endif
+
+    free( psDBF->pabyReadAhead );
+    free( psDBF->panProjection );
+    free( psDBF->pachFieldNames );
+    free( psDBF->panFieldHash );
+    free( psDBF->pabyDeletedBitmap );
+    free( psDBF->pabyNullBitmaps );
     free( psDBF->pszHeader );
     free( psDBF->pszCurrentRecord );
     free( psDBF->pszCodePage );
@@ -812,129 +1157,127 @@ goDBFAddNativeFieldType(DBFHandle psDBF, const char * pszFieldName,
         return -1;
     }
 
-    const int nOldRecordLength = psDBF->nRecordLength;
-    const int nOldHeaderLength = psDBF->nHeaderLength;
-
 /* -------------------------------------------------------------------- */
-/*      realloc all the arrays larger to hold the additional field      */
-/*      information.                                                    */
+/*      Append the field, NULL in the existing records.                 */
 /* -------------------------------------------------------------------- */
-    psDBF->nFields++;
-
-    psDBF->panFieldOffset = STATIC_CAST(int *,
-        realloc( psDBF->panFieldOffset, sizeof(int) * psDBF->nFields ));
-
-    psDBF->panFieldSize = STATIC_CAST(int *,
-        realloc( psDBF->panFieldSize, sizeof(int) * psDBF->nFields ));
-
-    psDBF->panFieldDecimals = STATIC_CAST(int *,
-        realloc( psDBF->panFieldDecimals, sizeof(int) * psDBF->nFields ));
+    DBFSchemaEditHandle psEdit = goDBFCreateSchemaEdit( psDBF );
+    if( psEdit == SHPLIB_NULLPTR )
+        return -1;
 
-    psDBF->pachFieldType = STATIC_CAST(char *,
-        realloc( psDBF->pachFieldType, sizeof(char) * psDBF->nFields ));
+    goDBFSchemaAddField( psEdit, pszFieldName, chType, nWidth, nDecimals );
 
-/* -------------------------------------------------------------------- */
-/*      Assign the new field information fields.                        */
-/* -------------------------------------------------------------------- */
-    psDBF->panFieldOffset[psDBF->nFields-1] = psDBF->nRecordLength;
-    psDBF->nRecordLength += nWidth;
-    psDBF->panFieldSize[psDBF->nFields-1] = nWidth;
-    psDBF->panFieldDecimals[psDBF->nFields-1] = nDecimals;
-    psDBF->pachFieldType[psDBF->nFields-1] = chType;
+    if( !goDBFCommitSchemaEdit( psEdit, SHPLIB_NULLPTR ) )
+        return -1;
 
-/* -------------------------------------------------------------------- */
-/*      Extend the required header information.                         */
-/* -------------------------------------------------------------------- */
-    psDBF->nHeaderLength += XBASE_FLDHDR_SZ;
-    psDBF->bUpdated = FALSE;
+    return( psDBF->nFields-1 );
+}
 
-    psDBF->pszHeader = STATIC_CAST(char *, realloc(psDBF->pszHeader,
-                                          psDBF->nFields*XBASE_FLDHDR_SZ));
+/************************************************************************/
+/*                            DBFGetRecord()                            */
+/*                                                                      */
+/*      Return the raw bytes of a record: in place when the file is     */
+/*      mapped, otherwise loaded into pszCurrentRecord.  Only field     */
+/*      iField is guaranteed to be loaded, or all if iField is -1.      */
+/************************************************************************/
 
-    char *pszFInfo = psDBF->pszHeader + XBASE_FLDHDR_SZ * (psDBF->nFields-1);
+static const char *DBFGetRecord( DBFHandle psDBF, int iRecord, int iField ) {
+    if( psDBF->pabyMap != SHPLIB_NULLPTR )
+        return psDBF->pabyMap + psDBF->nHeaderLength +
+               STATIC_CAST(SAOffset, iRecord) * psDBF->nRecordLength;
 
-    for( int i = 0; i < XBASE_FLDHDR_SZ; i++ )
-        pszFInfo[i] = '\0';
+    if( !(iField < 0 ? DBFLoadRecord( psDBF, iRecord )
+                     : DBFLoadProjectedRecord( psDBF, iRecord, iField )) )
+        return SHPLIB_NULLPTR;
 
-    strncpy( pszFInfo, pszFieldName, XBASE_FLDNAME_LEN_WRITE );
+    return psDBF->pszCurrentRecord;
+}
 
-    pszFInfo[11] = psDBF->pachFieldType[psDBF->nFields-1];
+/************************************************************************/
+/*                           DBFSkipBlanks()                            */
+/*                                                                      */
+/*      Return the offset of the first non blank byte of a field, or    */
+/*      nWidth.  Blank runs are skipped eight bytes at a time.          */
+/************************************************************************/
 
-    if( chType == 'C' )
-    {
-        pszFInfo[16] = STATIC_CAST(unsigned char, nWidth % 256);
-        pszFInfo[17] = STATIC_CAST(unsigned char, nWidth / 256);
-    }
-    else
+static int DBFSkipBlanks( const char *pachField, int nWidth )
+{
+    int i = 0;
+    for( ; nWidth - i >= 8; i += 8 )
     {
-        pszFInfo[16] = STATIC_CAST(unsigned char, nWidth);
-        pszFInfo[17] = STATIC_CAST(unsigned char, nDecimals);
+        uint64_t nChunk;
+        memcpy( &nChunk, pachField + i, 8 );
+        if( nChunk != UINT64_C(0x2020202020202020) )
+            break;
     }
+    while( i < nWidth && pachField[i] == ' ' )
+        i++;
+    return i;
+}
 
-/* -------------------------------------------------------------------- */
-/*      Make the current record buffer appropriately larger.            */
-/* -------------------------------------------------------------------- */
-    psDBF->pszCurrentRecord = STATIC_CAST(char *, realloc(psDBF->pszCurrentRecord,
-                                                 psDBF->nRecordLength));
-
-    /* we're done if dealing with new .dbf */
-    if( psDBF->bNoHeader )
-        return( psDBF->nFields - 1 );
-
-/* -------------------------------------------------------------------- */
-/*      For existing .dbf file, shift records                           */
-/* -------------------------------------------------------------------- */
-
-    /* alloc record */
-    char *pszRecord = STATIC_CAST(char *, malloc(sizeof(char) * psDBF->nRecordLength));
-
-    const char chFieldFill = DBFGetNullCharacter(chType);
+/************************************************************************/
+/*                        DBFTrimTrailingBlanks()                       */
+/*                                                                      */
+/*      Return the length of a field once its trailing blanks are       */
+/*      dropped, eight bytes at a time as DBFSkipBlanks().              */
+/************************************************************************/
 
-    SAOffset nRecordOffset;
-    for (int i = psDBF->nRecords-1; i >= 0; --i)
+static int DBFTrimTrailingBlanks( const char *pachField, int nLength )
+{
+    for( ; nLength >= 8; nLength -= 8 )
     {
-        nRecordOffset = nOldRecordLength * STATIC_CAST(SAOffset, i) + nOldHeaderLength;
-
-        /* load record */
-        psDBF->sHooks.FSeek( psDBF->fp, nRecordOffset, 0 );
-        if (psDBF->sHooks.FRead(pszRecord, nOldRecordLength, 1, psDBF->fp) != 1) {
-          free(pszRecord);
-          return -1;
-        }
-
-        /* set new field's value to NULL */
-        memset(pszRecord + nOldRecordLength, chFieldFill, nWidth);
-
-        nRecordOffset = psDBF->nRecordLength * STATIC_CAST(SAOffset, i) + psDBF->nHeaderLength;
-
-        /* move record to the new place*/
-        psDBF->sHooks.FSeek( psDBF->fp, nRecordOffset, 0 );
-        psDBF->sHooks.FWrite( pszRecord, psDBF->nRecordLength, 1, psDBF->fp );
+        uint64_t nChunk;
+        memcpy( &nChunk, pachField + nLength - 8, 8 );
+        if( nChunk != UINT64_C(0x2020202020202020) )
+            break;
     }
+    while( nLength > 0 && pachField[nLength - 1] == ' ' )
+        nLength--;
+    return nLength;
+}
 
-    if( psDBF->bWriteEndOfFileChar )
-    {
-        char ch = END_OF_FILE_CHARACTER;
-
-        nRecordOffset =
-            psDBF->nRecordLength * STATIC_CAST(SAOffset,psDBF->nRecords) + psDBF->nHeaderLength;
+/************************************************************************/
+/*                           DBFStringView()                            */
+/*                                                                      */
+/*      Locate the string value of a field in its raw bytes: up to the  */
+/*      first NUL, without its leading and trailing blanks if           */
+/*      TRIM_DBF_WHITESPACE is defined.  Returns its start and sets     */
+/*      *pnLength.                                                      */
+/************************************************************************/
 
-        psDBF->sHooks.FSeek( psDBF->fp, nRecordOffset, 0 );
-        psDBF->sHooks.FWrite( &ch, 1, 1, psDBF->fp );
-    }
+static const char *DBFStringView( const char *pachField, int nWidth,
+                                  int *pnLength )
+{
+    const char *pachNul = STATIC_CAST(const char *,
+                                      memchr( pachField, '\0', nWidth ));
+    int nLength = pachNul != SHPLIB_NULLPTR ?
+                  STATIC_CAST(int, pachNul - pachField) : nWidth;
 
-    /* free record */
-    free(pszRecord);
+#ifdef TRIM_DBF_WHITESPACE
+    const int iStart = DBFSkipBlanks( pachField, nLength );
+    pachField += iStart;
+    nLength = DBFTrimTrailingBlanks( pachField, nLength - iStart );
+#endif
 
-    /* force update of header with new header, record length and new field */
-    psDBF->bNoHeader = TRUE;
-    goDBFUpdateHeader( psDBF );
+    *pnLength = nLength;
+    return pachField;
+}
 
-    psDBF->nCurrentRecord = -1;
-    psDBF->bCurrentRecordModified = FALSE;
-    psDBF->bUpdated = TRUE;
+/************************************************************************/
+/*                         DBFEnsureWorkField()                         */
+/*                                                                      */
+/*      Ensure we have room to extract a field of nWidth bytes.         */
+/************************************************************************/
 
-    return( psDBF->nFields-1 );
+static void DBFEnsureWorkField( DBFHandle psDBF, int nWidth ) {
+    if( nWidth >= psDBF->nWorkFieldLength )
+    {
+        psDBF->nWorkFieldLength = nWidth + 100;
+        if( psDBF->pszWorkField == SHPLIB_NULLPTR )
+            psDBF->pszWorkField = STATIC_CAST(char *, malloc(psDBF->nWorkFieldLength));
+        else
+            psDBF->pszWorkField = STATIC_CAST(char *, realloc(psDBF->pszWorkField,
+                                                   psDBF->nWorkFieldLength));
+    }
 }
 
 /************************************************************************/
@@ -957,72 +1300,51 @@ static void *DBFReadAttribute(DBFHandle psDBF, int hEntity, int iField,
 /* -------------------------------------------------------------------- */
 /*	Have we read the record?					*/
 /* -------------------------------------------------------------------- */
-    if( !DBFLoadRecord( psDBF, hEntity ) )
+    const unsigned char *pabyRec = REINTERPRET_CAST(const unsigned char *,
+                                                    DBFGetRecord( psDBF, hEntity, iField ));
+    if( pabyRec == SHPLIB_NULLPTR )
         return SHPLIB_NULLPTR;
 
-    unsigned char *pabyRec = REINTERPRET_CAST(unsigned char *, psDBF->pszCurrentRecord);
-
-/* -------------------------------------------------------------------- */
-/*      Ensure we have room to extract the target field.                */
-/* -------------------------------------------------------------------- */
-    if( psDBF->panFieldSize[iField] >= psDBF->nWorkFieldLength )
-    {
-        psDBF->nWorkFieldLength = psDBF->panFieldSize[iField] + 100;
-        if( psDBF->pszWorkField == SHPLIB_NULLPTR )
-            psDBF->pszWorkField = STATIC_CAST(char *, malloc(psDBF->nWorkFieldLength));
-        else
-            psDBF->pszWorkField = STATIC_CAST(char *, realloc(psDBF->pszWorkField,
-                                                   psDBF->nWorkFieldLength));
-    }
-
-/* -------------------------------------------------------------------- */
-/*	Extract the requested field.					*/
-/* -------------------------------------------------------------------- */
-    memcpy( psDBF->pszWorkField,
-	     REINTERPRET_CAST(const char *, pabyRec) + psDBF->panFieldOffset[iField],
-	     psDBF->panFieldSize[iField] );
-    psDBF->pszWorkField[psDBF->panFieldSize[iField]] = '\0';
-
-    void *pReturnField = psDBF->pszWorkField;
-
 /* -------------------------------------------------------------------- */
-/*      Decode the field.                                               */
+/*      Numbers are decoded in place.                                   */
 /* -------------------------------------------------------------------- */
+    const char *pachField = REINTERPRET_CAST(const char *, pabyRec)
+                            + psDBF->panFieldOffset[iField];
     if( chReqType == 'I' )
     {
-        psDBF->fieldValue.nIntField = atoi(psDBF->pszWorkField);
-
-        pReturnField = &(psDBF->fieldValue.nIntField);
+        goDBFParseInteger( pachField, psDBF->panFieldSize[iField],
+                           &(psDBF->fieldValue.nIntField) );
+        return &(psDBF->fieldValue.nIntField);
     }
     else if( chReqType == 'N' )
     {
-        psDBF->fieldValue.dfDoubleField = psDBF->sHooks.Atof(psDBF->pszWorkField);
-
-        pReturnField = &(psDBF->fieldValue.dfDoubleField);
+        goDBFParseDouble( pachField, psDBF->panFieldSize[iField],
+                          &(psDBF->fieldValue.dfDoubleField) );
+        return &(psDBF->fieldValue.dfDoubleField);
     }
 
 /* -------------------------------------------------------------------- */
-/*      Should we trim white space off the string attribute value?      */
+/*      Extract the requested field, recoded if need be.                */
 /* -------------------------------------------------------------------- */
-#ifdef TRIM_DBF_WHITESPACE
+    int nLength;
+    const char *pachValue = DBFStringView( pachField, psDBF->panFieldSize[iField],
+                                           &nLength );
+
+    if( psDBF->nRecodeCodePage != 0 )
+    {
+        const int nRecodeSize = 3 * nLength + 1;
+        DBFEnsureWorkField( psDBF, nRecodeSize );
+        goDBFRecodeToUTF8( psDBF->nRecodeCodePage, pachValue, nLength,
+                           psDBF->pszWorkField, nRecodeSize );
+    }
     else
     {
-        char *pchSrc = psDBF->pszWorkField;
-        char *pchDst = pchSrc;
-
-        while( *pchSrc == ' ' )
-            pchSrc++;
-
-        while( *pchSrc != '\0' )
-            *(pchDst++) = *(pchSrc++);
-        *pchDst = '\0';
-
-        while( pchDst != psDBF->pszWorkField && *(--pchDst) == ' ' )
-            *pchDst = '\0';
+        DBFEnsureWorkField( psDBF, nLength );
+        memcpy( psDBF->pszWorkField, pachValue, nLength );
+        psDBF->pszWorkField[nLength] = '\0';
     }
-#endif
 
-    return pReturnField;
+    return psDBF->pszWorkField;
 }
 
 /************************************************************************/
@@ -1085,14 +1407,22 @@ goDBFReadLogicalAttribute( DBFHandle psDBF, int iRecord, int iField )
 
 
 /************************************************************************/
-/*                         DBFIsValueNULL()                             */
+/*                        goDBFIsRawValueNULL()                         */
 /*                                                                      */
-/*      Return TRUE if the passed string is NULL.                       */
+/*      Whether the nWidth field bytes of a value of type chType are    */
+/*      NULL, without copying and terminating them first.  This is      */
+/*      the one place the NULL rules of each field type are kept.       */
 /************************************************************************/
 
-static bool DBFIsValueNULL( char chType, const char* pszValue ) {
-    if( pszValue == SHPLIB_NULLPTR )
-        return true;
+int SHPAPI_CALL
+goDBFIsRawValueNULL( char chType, const char *pachField, int nWidth )
+{
+    const int iBlank = DBFSkipBlanks( pachField, nWidth );
+#ifdef TRIM_DBF_WHITESPACE
+    const int iValue = iBlank;
+#else
+    const int iValue = 0;
+#endif
 
     switch(chType)
     {
@@ -1103,32 +1433,67 @@ static bool DBFIsValueNULL( char chType, const char* pszValue ) {
         ** though according to the spec I think it should be all
         ** asterisks.
         */
-        if( pszValue[0] == '*' )
-            return true;
-
-        for( int i = 0; pszValue[i] != '\0'; i++ )
-        {
-            if( pszValue[i] != ' ' )
-                return false;
-        }
-        return true;
+        if( iValue < nWidth && pachField[iValue] == '*' )
+            return TRUE;
+        return iBlank == nWidth || pachField[iBlank] == '\0';
 
       case 'D':
         /* NULL date fields have value "00000000" */
-        return strncmp(pszValue,"00000000",8) == 0;
+        return nWidth - iValue >= 8 &&
+               memcmp( pachField + iValue, "00000000", 8 ) == 0;
 
       case 'L':
         /* NULL boolean fields have value "?" */
-        return pszValue[0] == '?';
+        return iValue < nWidth && pachField[iValue] == '?';
 
       default:
         /* empty string fields are considered NULL */
-        return strlen(pszValue) == 0;
+        return iValue == nWidth || pachField[iValue] == '\0';
     }
 }
 
 /************************************************************************/
-/*                         goDBFIsAttributeNULL()                         */
+/*                         DBFIsValueNULL()                             */
+/*                                                                      */
+/*      Return TRUE if the passed string is NULL.                       */
+/************************************************************************/
+
+static bool DBFIsValueNULL( char chType, const char* pszValue ) {
+    return pszValue == SHPLIB_NULLPTR ||
+           goDBFIsRawValueNULL( chType, pszValue,
+                                STATIC_CAST(int, strlen(pszValue)) );
+}
+
+/************************************************************************/
+/*                          DBFDropBitmaps()                            */
+/*                                                                      */
+/*      Forget the bitmaps of goDBFLoadBitmaps(), once records change.  */
+/************************************************************************/
+
+static void DBFDropBitmaps( DBFHandle psDBF )
+{
+    free( psDBF->pabyDeletedBitmap );
+    free( psDBF->pabyNullBitmaps );
+    psDBF->pabyDeletedBitmap = SHPLIB_NULLPTR;
+    psDBF->pabyNullBitmaps = SHPLIB_NULLPTR;
+    psDBF->nBitmapStart = 0;
+    psDBF->nBitmapCount = 0;
+}
+
+static bool DBFInBitmaps( DBFHandle psDBF, int iRecord )
+{
+    return psDBF->pabyDeletedBitmap != SHPLIB_NULLPTR &&
+           iRecord >= psDBF->nBitmapStart &&
+           iRecord - psDBF->nBitmapStart < psDBF->nBitmapCount;
+}
+
+static bool DBFTestBit( const unsigned char *pabyBitmap, int i )
+{
+    return (pabyBitmap[i >> 3] >> (i & 7)) & 1;
+}
+
+/************************************************************************/
+/*                         goDBFIsAttributeNULL()                         */
 /*                                                                      */
 /*      Return TRUE if value for field is NULL.                         */
 /*                                                                      */
@@ -1137,6 +1502,10 @@ static bool DBFIsValueNULL( char chType, const char* pszValue ) {
 
 int SHPAPI_CALL
 goDBFIsAttributeNULL( DBFHandle psDBF, int iRecord, int iField ) {
+    if( DBFInBitmaps( psDBF, iRecord ) && iField >= 0 && iField < psDBF->nFields )
+        return DBFTestBit( goDBFGetNullBitmap( psDBF, iField ),
+                           iRecord - psDBF->nBitmapStart );
+
     const char *pszValue = goDBFReadStringAttribute( psDBF, iRecord, iField );
 
     if( pszValue == SHPLIB_NULLPTR )
@@ -1145,6 +1514,460 @@ goDBFIsAttributeNULL( DBFHandle psDBF, int iRecord, int iField ) {
     return DBFIsValueNULL( psDBF->pachFieldType[iField], pszValue );
 }
 
+/************************************************************************/
+/*                          goDBFReadRecords()                          */
+/*                                                                      */
+/*      Return the raw bytes of nCount consecutive records from         */
+/*      iStart: in place if the file is mapped, else read with one      */
+/*      FRead into pBuffer, which must hold nCount records.  Pending    */
+/*      changes to the current record are written first.               */
+/************************************************************************/
+
+const char SHPAPI_CALL1(*)
+goDBFReadRecords( DBFHandle psDBF, int iStart, int nCount, void *pBuffer )
+
+{
+    if( iStart < 0 || nCount < 0 || nCount > psDBF->nRecords - iStart )
+        return SHPLIB_NULLPTR;
+
+    if( !DBFFlushRecord( psDBF ) )
+        return SHPLIB_NULLPTR;
+
+    const SAOffset nOffset =
+        psDBF->nRecordLength * STATIC_CAST(SAOffset, iStart) + psDBF->nHeaderLength;
+
+    if( psDBF->pabyMap != SHPLIB_NULLPTR )
+        return psDBF->pabyMap + nOffset;
+
+    /* Our reads move the file position under a pending write */
+    psDBF->bRequireNextWriteSeek = TRUE;
+
+    if( psDBF->sHooks.FSeek( psDBF->fp, nOffset, SEEK_SET ) != 0 ||
+        STATIC_CAST(int, psDBF->sHooks.FRead( pBuffer, psDBF->nRecordLength,
+                                              nCount, psDBF->fp )) != nCount )
+    {
+        char szMessage[128];
+        snprintf( szMessage, sizeof(szMessage),
+                  "Failure reading DBF records %d to %d.",
+                  iStart, iStart + nCount - 1 );
+        psDBF->sHooks.Error( szMessage );
+        return SHPLIB_NULLPTR;
+    }
+
+    return STATIC_CAST(const char *, pBuffer);
+}
+
+/************************************************************************/
+/*                        DBFStoreColumnValue()                         */
+/*                                                                      */
+/*      Store a zero terminated field value, or NULL, as entry i of a   */
+/*      column array.                                                   */
+/************************************************************************/
+
+static void DBFStoreColumnValue( char chReqType, void *pValues, int nStride,
+                                 int i, const char *pszValue )
+{
+    if( chReqType == 'I' )
+    {
+        int nValue = 0;
+        if( pszValue != SHPLIB_NULLPTR )
+            goDBFParseInteger( pszValue, STATIC_CAST(int, strlen(pszValue)), &nValue );
+        STATIC_CAST(int *, pValues)[i] = nValue;
+    }
+    else if( chReqType == 'N' )
+    {
+        double dfValue = 0.0;
+        if( pszValue != SHPLIB_NULLPTR )
+            goDBFParseDouble( pszValue, STATIC_CAST(int, strlen(pszValue)), &dfValue );
+        STATIC_CAST(double *, pValues)[i] = dfValue;
+    }
+    else
+    {
+        char *pszDst = STATIC_CAST(char *, pValues) + STATIC_CAST(size_t, i) * nStride;
+        strncpy( pszDst, pszValue ? pszValue : "", nStride - 1 );
+        pszDst[nStride - 1] = '\0';
+    }
+}
+
+/************************************************************************/
+/*                          DBFParseLogical()                           */
+/*                                                                      */
+/*      Decode a logical field to 1 for T or Y, 0 for F or N, and -1    */
+/*      (NULL, returning false) for '?', blanks or anything else.       */
+/************************************************************************/
+
+static bool DBFParseLogical( const char *pachField, int nWidth,
+                             signed char *pchValue )
+{
+    int i = 0;
+    while( i < nWidth && pachField[i] == ' ' )
+        i++;
+
+    switch( i < nWidth ? pachField[i] : ' ' )
+    {
+      case 'T': case 't': case 'Y': case 'y':
+        *pchValue = 1;
+        return true;
+      case 'F': case 'f': case 'N': case 'n':
+        *pchValue = 0;
+        return true;
+      default:
+        *pchValue = -1;
+        return false;
+    }
+}
+
+/************************************************************************/
+/*                           DBFReadColumn()                            */
+/*                                                                      */
+/*      Decode one field of a range of records into a caller array,     */
+/*      setting bit i of pabyNull (if not NULL) for NULL values.        */
+/*      Records are read in blocks of about DBF_COLUMN_BLOCK bytes      */
+/*      rather than one at a time through DBFLoadRecord(), through      */
+/*      psCursor and into its pszWorkField if psCursor is not NULL.     */
+/*      Returns the number of records decoded, or -1 on failure.        */
+/************************************************************************/
+
+#define DBF_COLUMN_BLOCK (1024 * 1024)
+
+static int DBFReadColumn( DBFHandle psDBF, DBFCursorHandle psCursor,
+                          char *pszWorkField, int iField, int iStart,
+                          int nCount, char chReqType, void *pValues,
+                          int nStride, unsigned char *pabyNull )
+{
+/* -------------------------------------------------------------------- */
+/*      Verify selection.                                               */
+/* -------------------------------------------------------------------- */
+    if( iField < 0 || iField >= psDBF->nFields ||
+        iStart < 0 || nCount < 0 || (chReqType == 'C' && nStride < 1) )
+        return -1;
+
+    if( iStart >= psDBF->nRecords )
+        return 0;
+    if( nCount > psDBF->nRecords - iStart )
+        nCount = psDBF->nRecords - iStart;
+    if( nCount == 0 )
+        return 0;
+
+    const int nWidth = psDBF->panFieldSize[iField];
+    const int nFieldOffset = psDBF->panFieldOffset[iField];
+    const char chType = psDBF->pachFieldType[iField];
+    const bool bNumericField = chType == 'N' || chType == 'F';
+
+    int nBlockRecords = DBF_COLUMN_BLOCK / psDBF->nRecordLength;
+    if( nBlockRecords < 1 )
+        nBlockRecords = 1;
+    if( nBlockRecords > nCount )
+        nBlockRecords = nCount;
+
+    /* A mapped file is decoded in place */
+    char *pabyBlock = SHPLIB_NULLPTR;
+    if( psDBF->pabyMap == SHPLIB_NULLPTR )
+    {
+        pabyBlock = STATIC_CAST(char *,
+            malloc(STATIC_CAST(size_t, nBlockRecords) * psDBF->nRecordLength));
+        if( pabyBlock == SHPLIB_NULLPTR )
+        {
+            psDBF->sHooks.Error( "Not enough memory to read DBF column." );
+            return -1;
+        }
+    }
+
+    if( psCursor == SHPLIB_NULLPTR )
+    {
+        DBFEnsureWorkField( psDBF, nWidth );
+        pszWorkField = psDBF->pszWorkField;
+    }
+    if( pabyNull != SHPLIB_NULLPTR )
+        memset( pabyNull, 0, (STATIC_CAST(size_t, nCount) + 7) / 8 );
+
+    for( int iDone = 0; iDone < nCount; )
+    {
+        int nRecords = nCount - iDone;
+        if( nRecords > nBlockRecords )
+            nRecords = nBlockRecords;
+
+        const char *pabyRecords = psCursor != SHPLIB_NULLPTR
+            ? goDBFCursorReadRecords( psCursor, iStart + iDone, nRecords, pabyBlock )
+            : goDBFReadRecords( psDBF, iStart + iDone, nRecords, pabyBlock );
+        if( pabyRecords == SHPLIB_NULLPTR )
+        {
+            free( pabyBlock );
+            return -1;
+        }
+
+/* -------------------------------------------------------------------- */
+/*      Decode the field of each record.                                */
+/* -------------------------------------------------------------------- */
+        for( int iRecord = 0; iRecord < nRecords; iRecord++, iDone++ )
+        {
+            const char *pachField = pabyRecords
+                + STATIC_CAST(size_t, iRecord) * psDBF->nRecordLength + nFieldOffset;
+            bool bNull;
+
+            /* Numeric fields are decoded in place */
+            if( bNumericField && chReqType == 'I' )
+            {
+                bNull = !goDBFParseInteger( pachField, nWidth,
+                                            STATIC_CAST(int *, pValues) + iDone );
+            }
+            else if( bNumericField && chReqType == 'N' )
+            {
+                bNull = !goDBFParseDouble( pachField, nWidth,
+                                           STATIC_CAST(double *, pValues) + iDone );
+            }
+            else if( chReqType == 'D' )
+            {
+                bNull = !goDBFParseDate( pachField, nWidth,
+                                         STATIC_CAST(int *, pValues) + iDone );
+            }
+            else if( chReqType == 'L' )
+            {
+                bNull = !DBFParseLogical( pachField, nWidth,
+                                          STATIC_CAST(signed char *, pValues) + iDone );
+            }
+            else
+            {
+                int nLength;
+                const char *pachValue = DBFStringView( pachField, nWidth, &nLength );
+                char *pszValue = pszWorkField;
+                memcpy( pszValue, pachValue, nLength );
+                pszValue[nLength] = '\0';
+                bNull = DBFIsValueNULL( chType, pszValue );
+                if( chReqType == 'C' && psDBF->nRecodeCodePage != 0 )
+                    goDBFRecodeToUTF8( psDBF->nRecodeCodePage, pachValue, nLength,
+                                       STATIC_CAST(char *, pValues) +
+                                           STATIC_CAST(size_t, iDone) * nStride,
+                                       nStride );
+                else
+                    DBFStoreColumnValue( chReqType, pValues, nStride, iDone,
+                                         bNull && chReqType != 'C' ? SHPLIB_NULLPTR
+                                                                   : pszValue );
+            }
+
+            if( bNull && pabyNull != SHPLIB_NULLPTR )
+                pabyNull[iDone >> 3] |= STATIC_CAST(unsigned char, 1 << (iDone & 7));
+        }
+    }
+
+    free( pabyBlock );
+
+    return nCount;
+}
+
+/************************************************************************/
+/*                        goDBFReadIntegerColumn()                      */
+/*                                                                      */
+/*      Read an integer field for nCount records from iStart.           */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFReadIntegerColumn( DBFHandle psDBF, int iField, int iStart, int nCount,
+                        int *panValues, unsigned char *pabyNull )
+{
+    return DBFReadColumn( psDBF, SHPLIB_NULLPTR, SHPLIB_NULLPTR, iField,
+                          iStart, nCount, 'I', panValues, 0, pabyNull );
+}
+
+/************************************************************************/
+/*                        goDBFReadDoubleColumn()                       */
+/*                                                                      */
+/*      Read a double field for nCount records from iStart.             */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFReadDoubleColumn( DBFHandle psDBF, int iField, int iStart, int nCount,
+                       double *padfValues, unsigned char *pabyNull )
+{
+    return DBFReadColumn( psDBF, SHPLIB_NULLPTR, SHPLIB_NULLPTR, iField,
+                          iStart, nCount, 'N', padfValues, 0, pabyNull );
+}
+
+/************************************************************************/
+/*                        goDBFReadStringColumn()                       */
+/*                                                                      */
+/*      Read a string field for nCount records from iStart.  Value i    */
+/*      is stored zero terminated at pszValues + i * nStride; a stride  */
+/*      of the field width plus one avoids truncation.                  */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFReadStringColumn( DBFHandle psDBF, int iField, int iStart, int nCount,
+                       char *pszValues, int nStride, unsigned char *pabyNull )
+{
+    return DBFReadColumn( psDBF, SHPLIB_NULLPTR, SHPLIB_NULLPTR, iField,
+                          iStart, nCount, 'C', pszValues, nStride, pabyNull );
+}
+
+/************************************************************************/
+/*                         goDBFReadDateColumn()                        */
+/*                                                                      */
+/*      Read a YYYYMMDD field for nCount records from iStart as days    */
+/*      since 1970-01-01.  Invalid dates are NULL, with a value of 0.   */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFReadDateColumn( DBFHandle psDBF, int iField, int iStart, int nCount,
+                     int *panDays, unsigned char *pabyNull )
+{
+    return DBFReadColumn( psDBF, SHPLIB_NULLPTR, SHPLIB_NULLPTR, iField,
+                          iStart, nCount, 'D', panDays, 0, pabyNull );
+}
+
+/************************************************************************/
+/*                       goDBFReadLogicalColumn()                       */
+/*                                                                      */
+/*      Read a logical field for nCount records from iStart as 1 for    */
+/*      true, 0 for false and -1 for NULL or invalid values.            */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFReadLogicalColumn( DBFHandle psDBF, int iField, int iStart, int nCount,
+                        signed char *pachValues, unsigned char *pabyNull )
+{
+    return DBFReadColumn( psDBF, SHPLIB_NULLPTR, SHPLIB_NULLPTR, iField,
+                          iStart, nCount, 'L', pachValues, 0, pabyNull );
+}
+
+/************************************************************************/
+/*                          goDBFLoadBitmaps()                          */
+/*                                                                      */
+/*      Compute in one pass over nCount records from iStart which are   */
+/*      deleted and which fields are NULL, and keep the bitmaps on the  */
+/*      handle, where goDBFIsRecordDeleted() and                        */
+/*      goDBFIsAttributeNULL() find them without loading the records.   */
+/*      They replace any previous ones, and are dropped when a record   */
+/*      or the fields change.  Returns the number of records covered,   */
+/*      or -1 on failure.                                               */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFLoadBitmaps( DBFHandle psDBF, int iStart, int nCount )
+{
+    DBFDropBitmaps( psDBF );
+
+    if( iStart < 0 || nCount < 0 )
+        return -1;
+    if( iStart >= psDBF->nRecords )
+        return 0;
+    if( nCount > psDBF->nRecords - iStart )
+        nCount = psDBF->nRecords - iStart;
+    if( nCount == 0 )
+        return 0;
+
+    const size_t nBitmapBytes = (STATIC_CAST(size_t, nCount) + 7) / 8;
+    unsigned char *pabyDeleted =
+        STATIC_CAST(unsigned char *, calloc( nBitmapBytes, 1 ));
+    unsigned char *pabyNulls = STATIC_CAST(unsigned char *,
+        calloc( nBitmapBytes * (psDBF->nFields > 0 ? psDBF->nFields : 1), 1 ));
+
+    int nBlockRecords = DBF_COLUMN_BLOCK / psDBF->nRecordLength;
+    if( nBlockRecords < 1 )
+        nBlockRecords = 1;
+    if( nBlockRecords > nCount )
+        nBlockRecords = nCount;
+
+    char *pabyBlock = SHPLIB_NULLPTR;
+    if( psDBF->pabyMap == SHPLIB_NULLPTR )
+        pabyBlock = STATIC_CAST(char *,
+            malloc(STATIC_CAST(size_t, nBlockRecords) * psDBF->nRecordLength));
+
+    if( pabyDeleted == SHPLIB_NULLPTR || pabyNulls == SHPLIB_NULLPTR ||
+        (psDBF->pabyMap == SHPLIB_NULLPTR && pabyBlock == SHPLIB_NULLPTR) )
+    {
+        psDBF->sHooks.Error( "Not enough memory to load DBF bitmaps." );
+        free( pabyDeleted );
+        free( pabyNulls );
+        free( pabyBlock );
+        return -1;
+    }
+
+    for( int iDone = 0; iDone < nCount; )
+    {
+        int nRecords = nCount - iDone;
+        if( nRecords > nBlockRecords )
+            nRecords = nBlockRecords;
+
+        const char *pabyRecords =
+            goDBFReadRecords( psDBF, iStart + iDone, nRecords, pabyBlock );
+        if( pabyRecords == SHPLIB_NULLPTR )
+        {
+            free( pabyDeleted );
+            free( pabyNulls );
+            free( pabyBlock );
+            return -1;
+        }
+
+/* -------------------------------------------------------------------- */
+/*      Set the bits of each record of the block.                       */
+/* -------------------------------------------------------------------- */
+        for( int iRecord = 0; iRecord < nRecords; iRecord++, iDone++ )
+        {
+            const char *pabyRec = pabyRecords
+                + STATIC_CAST(size_t, iRecord) * psDBF->nRecordLength;
+            const unsigned char byBit =
+                STATIC_CAST(unsigned char, 1 << (iDone & 7));
+
+            if( pabyRec[0] == '*' )
+                pabyDeleted[iDone >> 3] |= byBit;
+
+            unsigned char *pabyNull = pabyNulls + (iDone >> 3);
+            for( int iField = 0; iField < psDBF->nFields;
+                 iField++, pabyNull += nBitmapBytes )
+            {
+                if( goDBFIsRawValueNULL( psDBF->pachFieldType[iField],
+                                         pabyRec + psDBF->panFieldOffset[iField],
+                                         psDBF->panFieldSize[iField] ) )
+                    *pabyNull |= byBit;
+            }
+        }
+    }
+
+    free( pabyBlock );
+
+    psDBF->pabyDeletedBitmap = pabyDeleted;
+    psDBF->pabyNullBitmaps = pabyNulls;
+    psDBF->nBitmapStart = iStart;
+    psDBF->nBitmapCount = nCount;
+
+    return nCount;
+}
+
+/************************************************************************/
+/*                        goDBFGetDeletedBitmap()                       */
+/*                                                                      */
+/*      Return the deleted bitmap of goDBFLoadBitmaps(), bit i for      */
+/*      record *piStart + i, or NULL if there is none.                  */
+/************************************************************************/
+
+const unsigned char SHPAPI_CALL1(*)
+goDBFGetDeletedBitmap( DBFHandle psDBF, int *piStart, int *pnCount )
+{
+    if( piStart != SHPLIB_NULLPTR )
+        *piStart = psDBF->nBitmapStart;
+    if( pnCount != SHPLIB_NULLPTR )
+        *pnCount = psDBF->nBitmapCount;
+    return psDBF->pabyDeletedBitmap;
+}
+
+/************************************************************************/
+/*                         goDBFGetNullBitmap()                         */
+/*                                                                      */
+/*      Return the NULL bitmap of field iField, laid out as the         */
+/*      deleted bitmap, or NULL if there is none.                       */
+/************************************************************************/
+
+const unsigned char SHPAPI_CALL1(*)
+goDBFGetNullBitmap( DBFHandle psDBF, int iField )
+{
+    if( psDBF->pabyNullBitmaps == SHPLIB_NULLPTR ||
+        iField < 0 || iField >= psDBF->nFields )
+        return SHPLIB_NULLPTR;
+
+    return psDBF->pabyNullBitmaps +
+           STATIC_CAST(size_t, iField) * ((psDBF->nBitmapCount + 7) / 8);
+}
+
 /************************************************************************/
 /*                          goDBFGetFieldCount()                          */
 /*                                                                      */
@@ -1224,64 +2047,30 @@ goDBFGetFieldInfo( DBFHandle psDBF, int iField, char * pszFieldName,
 }
 
 /************************************************************************/
-/*                         DBFWriteAttribute()                          */
-/*									*/
-/*	Write an attribute record to the file.				*/
+/*                         DBFFormatAttribute()                         */
+/*                                                                      */
+/*      Format a value, or NULL if pValue is NULL, into field iField    */
+/*      of the record pabyRec.  Returns false if it had to be           */
+/*      truncated.                                                      */
 /************************************************************************/
 
-static bool DBFWriteAttribute(DBFHandle psDBF, int hEntity, int iField,
-			     void * pValue ) {
-/* -------------------------------------------------------------------- */
-/*	Is this a valid record?						*/
-/* -------------------------------------------------------------------- */
-    if( hEntity < 0 || hEntity > psDBF->nRecords )
-        return false;
-
-    if( psDBF->bNoHeader )
-        DBFWriteHeader(psDBF);
-
+static bool DBFFormatAttribute( DBFHandle psDBF, unsigned char *pabyRec,
+                                int iField, const void *pValue ) {
 /* -------------------------------------------------------------------- */
-/*      Is this a brand new record?                                     */
+/*      Translate NULL value to valid DBF file representation.          */
+/*                                                                      */
+/*      Contributed by Jim Matthews.                                    */
 /* -------------------------------------------------------------------- */
-    if( hEntity == psDBF->nRecords )
+    if( pValue == SHPLIB_NULLPTR )
     {
-	if( !DBFFlushRecord( psDBF ) )
-            return false;
-
-	psDBF->nRecords++;
-	for( int i = 0; i < psDBF->nRecordLength; i++ )
-	    psDBF->pszCurrentRecord[i] = ' ';
-
-	psDBF->nCurrentRecord = hEntity;
+        memset( pabyRec+psDBF->panFieldOffset[iField],
+                DBFGetNullCharacter(psDBF->pachFieldType[iField]),
+                psDBF->panFieldSize[iField] );
+        return true;
     }
 
 /* -------------------------------------------------------------------- */
-/*      Is this an existing record, but different than the last one     */
-/*      we accessed?                                                    */
-/* -------------------------------------------------------------------- */
-    if( !DBFLoadRecord( psDBF, hEntity ) )
-        return false;
-
-    unsigned char *pabyRec = REINTERPRET_CAST(unsigned char *, psDBF->pszCurrentRecord);
-
-    psDBF->bCurrentRecordModified = TRUE;
-    psDBF->bUpdated = TRUE;
-
-/* -------------------------------------------------------------------- */
-/*      Translate NULL value to valid DBF file representation.          */
-/*                                                                      */
-/*      Contributed by Jim Matthews.                                    */
-/* -------------------------------------------------------------------- */
-    if( pValue == SHPLIB_NULLPTR )
-    {
-        memset( pabyRec+psDBF->panFieldOffset[iField],
-                DBFGetNullCharacter(psDBF->pachFieldType[iField]),
-                psDBF->panFieldSize[iField] );
-        return true;
-    }
-
-/* -------------------------------------------------------------------- */
-/*      Assign all the record fields.                                   */
+/*      Assign all the record fields.                                   */
 /* -------------------------------------------------------------------- */
     bool nRetResult = true;
 
@@ -1290,38 +2079,22 @@ static bool DBFWriteAttribute(DBFHandle psDBF, int hEntity, int iField,
       case 'D':
       case 'N':
       case 'F':
-      {
-        int nWidth = psDBF->panFieldSize[iField];
-
-        char szSField[XBASE_FLD_MAX_WIDTH+1];
-        if( STATIC_CAST(int,sizeof(szSField))-2 < nWidth )
-            nWidth = sizeof(szSField)-2;
-
-        char szFormat[20];
-        snprintf( szFormat, sizeof(szFormat), "%%%d.%df",
-                    nWidth, psDBF->panFieldDecimals[iField] );
-        CPLsnprintf(szSField, sizeof(szSField), szFormat, *STATIC_CAST(double *, pValue) );
-        szSField[sizeof(szSField)-1] = '\0';
-        if( STATIC_CAST(int,strlen(szSField)) > psDBF->panFieldSize[iField] )
-        {
-            szSField[psDBF->panFieldSize[iField]] = '\0';
-            nRetResult = false;
-        }
-        memcpy(REINTERPRET_CAST(char *, pabyRec+psDBF->panFieldOffset[iField]),
-            szSField, strlen(szSField) );
+        nRetResult = goDBFFormatDouble( *STATIC_CAST(const double *, pValue),
+                                        psDBF->panFieldSize[iField],
+                                        psDBF->panFieldDecimals[iField],
+                                        REINTERPRET_CAST(char *, pabyRec+psDBF->panFieldOffset[iField]) ) != FALSE;
         break;
-      }
 
       case 'L':
         if (psDBF->panFieldSize[iField] >= 1  &&
-            (*STATIC_CAST(char*,pValue) == 'F' || *STATIC_CAST(char*,pValue) == 'T'))
-            *(pabyRec+psDBF->panFieldOffset[iField]) = *STATIC_CAST(char*,pValue);
+            (*STATIC_CAST(const char*,pValue) == 'F' || *STATIC_CAST(const char*,pValue) == 'T'))
+            *(pabyRec+psDBF->panFieldOffset[iField]) = *STATIC_CAST(const char*,pValue);
         break;
 
       default:
       {
         int j;
-	if( STATIC_CAST(int, strlen(STATIC_CAST(char *,pValue))) > psDBF->panFieldSize[iField] )
+	if( STATIC_CAST(int, strlen(STATIC_CAST(const char *,pValue))) > psDBF->panFieldSize[iField] )
         {
 	    j = psDBF->panFieldSize[iField];
             nRetResult = false;
@@ -1330,7 +2103,7 @@ static bool DBFWriteAttribute(DBFHandle psDBF, int hEntity, int iField,
         {
             memset( pabyRec+psDBF->panFieldOffset[iField], ' ',
                     psDBF->panFieldSize[iField] );
-	    j = STATIC_CAST(int, strlen(STATIC_CAST(char *,pValue)));
+	    j = STATIC_CAST(int, strlen(STATIC_CAST(const char *,pValue)));
         }
 
 	strncpy(REINTERPRET_CAST(char *, pabyRec+psDBF->panFieldOffset[iField]),
@@ -1342,6 +2115,55 @@ static bool DBFWriteAttribute(DBFHandle psDBF, int hEntity, int iField,
     return nRetResult;
 }
 
+/************************************************************************/
+/*                         DBFWriteAttribute()                          */
+/*									*/
+/*	Write an attribute record to the file.				*/
+/************************************************************************/
+
+static bool DBFWriteAttribute(DBFHandle psDBF, int hEntity, int iField,
+			     void * pValue ) {
+/* -------------------------------------------------------------------- */
+/*	Is this a valid record?						*/
+/* -------------------------------------------------------------------- */
+    if( hEntity < 0 || hEntity > psDBF->nRecords )
+        return false;
+
+    if( psDBF->bNoHeader )
+        DBFWriteHeader(psDBF);
+
+/* -------------------------------------------------------------------- */
+/*      Is this a brand new record?                                     */
+/* -------------------------------------------------------------------- */
+    if( hEntity == psDBF->nRecords )
+    {
+	if( !DBFFlushRecord( psDBF ) )
+            return false;
+
+	psDBF->nRecords++;
+	for( int i = 0; i < psDBF->nRecordLength; i++ )
+	    psDBF->pszCurrentRecord[i] = ' ';
+
+	psDBF->nCurrentRecord = hEntity;
+	psDBF->bCurrentRecordPartial = FALSE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Is this an existing record, but different than the last one     */
+/*      we accessed?                                                    */
+/* -------------------------------------------------------------------- */
+    if( !DBFLoadRecord( psDBF, hEntity ) )
+        return false;
+
+    unsigned char *pabyRec = REINTERPRET_CAST(unsigned char *, psDBF->pszCurrentRecord);
+
+    psDBF->bCurrentRecordModified = TRUE;
+    psDBF->bUpdated = TRUE;
+    DBFDropBitmaps( psDBF );
+
+    return DBFFormatAttribute( psDBF, pabyRec, iField, pValue );
+}
+
 /************************************************************************/
 /*                     goDBFWriteAttributeDirectly()                      */
 /*                                                                      */
@@ -1375,6 +2197,7 @@ goDBFWriteAttributeDirectly(DBFHandle psDBF, int hEntity, int iField,
 	    psDBF->pszCurrentRecord[i] = ' ';
 
 	psDBF->nCurrentRecord = hEntity;
+	psDBF->bCurrentRecordPartial = FALSE;
     }
 
 /* -------------------------------------------------------------------- */
@@ -1404,6 +2227,7 @@ goDBFWriteAttributeDirectly(DBFHandle psDBF, int hEntity, int iField,
 
     psDBF->bCurrentRecordModified = TRUE;
     psDBF->bUpdated = TRUE;
+    DBFDropBitmaps( psDBF );
 
     return( TRUE );
 }
@@ -1505,6 +2329,7 @@ goDBFWriteTuple(DBFHandle psDBF, int hEntity, void * pRawTuple ) {
 	    psDBF->pszCurrentRecord[i] = ' ';
 
 	psDBF->nCurrentRecord = hEntity;
+	psDBF->bCurrentRecordPartial = FALSE;
     }
 
 /* -------------------------------------------------------------------- */
@@ -1520,6 +2345,7 @@ goDBFWriteTuple(DBFHandle psDBF, int hEntity, void * pRawTuple ) {
 
     psDBF->bCurrentRecordModified = TRUE;
     psDBF->bUpdated = TRUE;
+    DBFDropBitmaps( psDBF );
 
     return( TRUE );
 }
@@ -1528,7 +2354,8 @@ goDBFWriteTuple(DBFHandle psDBF, int hEntity, void * pRawTuple ) {
 /*                            goDBFReadTuple()                            */
 /*                                                                      */
 /*      Read a complete record.  Note that the result is only valid     */
-/*      till the next record read for any reason.                       */
+/*      till the next record read for any reason, or till the file is   */
+/*      closed if it is mapped.                                         */
 /************************************************************************/
 
 const char SHPAPI_CALL1(*)
@@ -1538,10 +2365,65 @@ goDBFReadTuple(DBFHandle psDBF, int hEntity )
     if( hEntity < 0 || hEntity >= psDBF->nRecords )
         return SHPLIB_NULLPTR;
 
-    if( !DBFLoadRecord( psDBF, hEntity ) )
+    return DBFGetRecord( psDBF, hEntity, -1 );
+}
+
+/************************************************************************/
+/*                         goDBFReadFieldBytes()                        */
+/*                                                                      */
+/*      Return the raw, not zero terminated, bytes of a field and set   */
+/*      *pnWidth to their count.  For a mapped file this points into    */
+/*      the mapping and stays valid until the file is closed, else it   */
+/*      is only valid till the next record read, as for goDBFReadTuple. */
+/************************************************************************/
+
+const char SHPAPI_CALL1(*)
+goDBFReadFieldBytes( DBFHandle psDBF, int hEntity, int iField, int *pnWidth )
+
+{
+    if( hEntity < 0 || hEntity >= psDBF->nRecords ||
+        iField < 0 || iField >= psDBF->nFields )
+        return SHPLIB_NULLPTR;
+
+    const char *pabyRec = DBFGetRecord( psDBF, hEntity, iField );
+    if( pabyRec == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+    if( pnWidth != SHPLIB_NULLPTR )
+        *pnWidth = psDBF->panFieldSize[iField];
+
+    return pabyRec + psDBF->panFieldOffset[iField];
+}
+
+/************************************************************************/
+/*                          goDBFReadStringView()                       */
+/*                                                                      */
+/*      Return the value goDBFReadStringAttribute() would, set          */
+/*      *pnLength to its length and skip the copy: the value is not     */
+/*      zero terminated, and lasts as the bytes of                      */
+/*      goDBFReadFieldBytes() do.  Recoded values are copied to the     */
+/*      work field as usual.                                            */
+/************************************************************************/
+
+const char SHPAPI_CALL1(*)
+goDBFReadStringView( DBFHandle psDBF, int hEntity, int iField, int *pnLength )
+
+{
+    if( psDBF->nRecodeCodePage != 0 )
+    {
+        const char *pszValue = goDBFReadStringAttribute( psDBF, hEntity, iField );
+        if( pszValue == SHPLIB_NULLPTR )
+            return SHPLIB_NULLPTR;
+        *pnLength = STATIC_CAST(int, strlen(pszValue));
+        return pszValue;
+    }
+
+    int nWidth;
+    const char *pachField = goDBFReadFieldBytes( psDBF, hEntity, iField, &nWidth );
+    if( pachField == SHPLIB_NULLPTR )
         return SHPLIB_NULLPTR;
 
-    return STATIC_CAST(const char *, psDBF->pszCurrentRecord);
+    return DBFStringView( pachField, nWidth, pnLength );
 }
 
 /************************************************************************/
@@ -1620,6 +2502,23 @@ int SHPAPI_CALL
 goDBFGetFieldIndex(DBFHandle psDBF, const char *pszFieldName) {
     char name[XBASE_FLDNAME_LEN_READ+1];
 
+    if( psDBF->panFieldHash != SHPLIB_NULLPTR )
+    {
+        if( !DBFFoldFieldName( pszFieldName, name ) )
+            return(-1);
+
+        const unsigned nMask = STATIC_CAST(unsigned, psDBF->nFieldHashMask);
+        unsigned iSlot = DBFHashFieldName( name ) & nMask;
+        for( int iField; (iField = psDBF->panFieldHash[iSlot]) >= 0;
+             iSlot = (iSlot + 1) & nMask )
+        {
+            if( strcmp( psDBF->pachFieldNames +
+                            iField * (XBASE_FLDNAME_LEN_READ + 1), name ) == 0 )
+                return(iField);
+        }
+        return(-1);
+    }
+
     for( int i = 0; i < goDBFGetFieldCount(psDBF); i++ )
     {
         goDBFGetFieldInfo( psDBF, i, name, SHPLIB_NULLPTR, SHPLIB_NULLPTR );
@@ -1643,16 +2542,21 @@ int SHPAPI_CALL goDBFIsRecordDeleted( DBFHandle psDBF, int iShape ) {
     if( iShape < 0 || iShape >= psDBF->nRecords )
         return TRUE;
 
+    if( DBFInBitmaps( psDBF, iShape ) )
+        return DBFTestBit( psDBF->pabyDeletedBitmap,
+                           iShape - psDBF->nBitmapStart );
+
 /* -------------------------------------------------------------------- */
 /*	Have we read the record?					*/
 /* -------------------------------------------------------------------- */
-    if( !DBFLoadRecord( psDBF, iShape ) )
+    const char *pabyRec = DBFGetRecord( psDBF, iShape, -1 );
+    if( pabyRec == SHPLIB_NULLPTR )
         return FALSE;
 
 /* -------------------------------------------------------------------- */
 /*      '*' means deleted.                                              */
 /* -------------------------------------------------------------------- */
-    return psDBF->pszCurrentRecord[0] == '*';
+    return pabyRec[0] == '*';
 }
 
 /************************************************************************/
@@ -1683,515 +2587,2447 @@ int SHPAPI_CALL goDBFMarkRecordDeleted( DBFHandle psDBF, int iShape,
     else
         chNewFlag = ' ';
 
-    if( psDBF->pszCurrentRecord[0] != chNewFlag )
-    {
-        psDBF->bCurrentRecordModified = TRUE;
-        psDBF->bUpdated = TRUE;
-        psDBF->pszCurrentRecord[0] = chNewFlag;
-    }
+    if( psDBF->pszCurrentRecord[0] != chNewFlag )
+    {
+        psDBF->bCurrentRecordModified = TRUE;
+        psDBF->bUpdated = TRUE;
+        psDBF->pszCurrentRecord[0] = chNewFlag;
+        DBFDropBitmaps( psDBF );
+    }
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                            goDBFGetCodePage                            */
+/************************************************************************/
+
+const char SHPAPI_CALL1(*)
+goDBFGetCodePage(DBFHandle psDBF )
+{
+    if( psDBF == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+    return psDBF->pszCodePage;
+}
+
+/************************************************************************/
+/*                        goDBFSetRecodeToUTF8()                        */
+/*                                                                      */
+/*      Return the string attributes read through the handle and its    */
+/*      cursors in UTF-8, recoded from code page pszCodePage, usually   */
+/*      goDBFGetCodePage().  A NULL code page returns them raw again.   */
+/*      Returns FALSE, leaving the handle unchanged, if the code page   */
+/*      is not supported by goDBFRecodeToUTF8().                        */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFSetRecodeToUTF8( DBFHandle psDBF, const char *pszCodePage )
+{
+    int nCodePage = 0;
+    if( pszCodePage != SHPLIB_NULLPTR )
+    {
+        nCodePage = goDBFCodePageID( pszCodePage );
+        if( nCodePage == 0 )
+            return FALSE;
+    }
+
+    psDBF->nRecodeCodePage = nCodePage;
+    return TRUE;
+}
+
+/************************************************************************/
+/*                          goDBFDeleteField()                            */
+/*                                                                      */
+/*      Remove a field from a .dbf file                                 */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFDeleteField(DBFHandle psDBF, int iField) {
+    if (iField < 0 || iField >= psDBF->nFields)
+        return FALSE;
+
+    DBFSchemaEditHandle psEdit = goDBFCreateSchemaEdit( psDBF );
+    if( psEdit == SHPLIB_NULLPTR )
+        return FALSE;
+
+    goDBFSchemaDeleteField( psEdit, iField );
+
+    return goDBFCommitSchemaEdit( psEdit, SHPLIB_NULLPTR );
+}
+
+/************************************************************************/
+/*                          goDBFReorderFields()                          */
+/*                                                                      */
+/*      Reorder the fields of a .dbf file                               */
+/*                                                                      */
+/* panMap must be exactly psDBF->nFields long and be a permutation      */
+/* of [0, psDBF->nFields-1]. This assumption will not be asserted in the*/
+/* code of goDBFReorderFields.                                            */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFReorderFields( DBFHandle psDBF, int* panMap ) {
+    if ( psDBF->nFields == 0 )
+        return TRUE;
+
+    DBFSchemaEditHandle psEdit = goDBFCreateSchemaEdit( psDBF );
+    if( psEdit == SHPLIB_NULLPTR )
+        return FALSE;
+
+    if( !goDBFSchemaReorderFields( psEdit, panMap ) )
+    {
+        goDBFDestroySchemaEdit( psEdit );
+        return FALSE;
+    }
+
+    return goDBFCommitSchemaEdit( psEdit, SHPLIB_NULLPTR );
+}
+
+/************************************************************************/
+/*                          goDBFAlterFieldDefn()                         */
+/*                                                                      */
+/*      Alter a field definition in a .dbf file                         */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFAlterFieldDefn( DBFHandle psDBF, int iField, const char * pszFieldName,
+                    char chType, int nWidth, int nDecimals ) {
+    if (iField < 0 || iField >= psDBF->nFields)
+        return FALSE;
+
+/* -------------------------------------------------------------------- */
+/*      Do some checking to ensure we can add records to this file.     */
+/* -------------------------------------------------------------------- */
+    if( nWidth < 1 )
+        return -1;
+
+    DBFSchemaEditHandle psEdit = goDBFCreateSchemaEdit( psDBF );
+    if( psEdit == SHPLIB_NULLPTR )
+        return FALSE;
+
+    goDBFSchemaAlterField( psEdit, iField, pszFieldName, chType, nWidth,
+                           nDecimals );
+
+    return goDBFCommitSchemaEdit( psEdit, SHPLIB_NULLPTR );
+}
+
+/************************************************************************/
+/*                    goDBFSetWriteEndOfFileChar()                        */
+/************************************************************************/
+
+void SHPAPI_CALL goDBFSetWriteEndOfFileChar( DBFHandle psDBF, int bWriteFlag )
+{
+    psDBF->bWriteEndOfFileChar = bWriteFlag;
+}
+
+/************************************************************************/
+/*                       goDBFSetAccessPattern()                        */
+/*                                                                      */
+/*      Declare how records will be read: SA_ADVICE_SEQUENTIAL for      */
+/*      full scans, SA_ADVICE_RANDOM for index driven reads, or         */
+/*      SA_ADVICE_NORMAL.                                               */
+/************************************************************************/
+
+void SHPAPI_CALL goDBFSetAccessPattern( DBFHandle psDBF, int nAccessPattern )
+{
+    if( nAccessPattern != SA_ADVICE_NORMAL &&
+        nAccessPattern != SA_ADVICE_SEQUENTIAL &&
+        nAccessPattern != SA_ADVICE_RANDOM )
+        return;
+
+    psDBF->nAccessPattern = nAccessPattern;
+
+    if( psDBF->sHooks.FAdvise != SHPLIB_NULLPTR )
+        psDBF->sHooks.FAdvise( psDBF->fp, 0, 0, nAccessPattern );
+    DBFAdviseMap( psDBF );
+
+    /* Full scans read many records at a time unless told otherwise */
+    if( nAccessPattern == SA_ADVICE_SEQUENTIAL && psDBF->nReadAheadSize == 0 )
+        goDBFSetReadAhead( psDBF, DBF_READ_AHEAD_SIZE, FALSE );
+}
+
+/************************************************************************/
+/*                         goDBFSetReadAhead()                          */
+/*                                                                      */
+/*      Load records nBytes at a time, so that scans do one read per    */
+/*      block rather than a seek and a read per record.  bReverse       */
+/*      loads the records preceding the requested one instead, for      */
+/*      scans from the last record down.  nBytes of 0 disables it.      */
+/************************************************************************/
+
+void SHPAPI_CALL goDBFSetReadAhead( DBFHandle psDBF, int nBytes, int bReverse )
+{
+    free( psDBF->pabyReadAhead );
+    psDBF->pabyReadAhead = SHPLIB_NULLPTR;
+    psDBF->nReadAheadCount = 0;
+    psDBF->nReadAheadSize = nBytes > 0 ? nBytes : 0;
+    psDBF->bReadAheadReverse = bReverse;
+}
+
+/************************************************************************/
+/*                         goDBFSetProjection()                         */
+/*                                                                      */
+/*      Declare the only fields that will be read, or all of them if    */
+/*      nCount is 0.  When the projected fields are clustered within    */
+/*      the record, attribute reads load just the byte span covering   */
+/*      them.  Returns the length of the tuples of goDBFReadProjected-  */
+/*      Tuple(), or -1 if a field is invalid.                           */
+/************************************************************************/
+
+#define DBF_PROJECTION_CLUSTERED(nSpan, nRecordLength) ((nSpan) * 2 <= (nRecordLength))
+
+int SHPAPI_CALL goDBFSetProjection( DBFHandle psDBF, const int *panFields,
+                                    int nCount )
+{
+    for( int i = 0; i < nCount; i++ )
+    {
+        if( panFields[i] < 0 || panFields[i] >= psDBF->nFields )
+            return -1;
+    }
+
+    /* A record loaded under the old span misses the bytes of the new one */
+    if( psDBF->bCurrentRecordPartial )
+    {
+        psDBF->nCurrentRecord = -1;
+        psDBF->bCurrentRecordPartial = FALSE;
+    }
+
+    free( psDBF->panProjection );
+    psDBF->panProjection = SHPLIB_NULLPTR;
+    psDBF->nProjectionCount = 0;
+    psDBF->nProjectionStart = 0;
+    psDBF->nProjectionLength = 0;
+
+    if( nCount <= 0 || panFields == SHPLIB_NULLPTR )
+        return psDBF->nRecordLength;
+
+    psDBF->panProjection = STATIC_CAST(int *, malloc(sizeof(int) * nCount));
+    if( psDBF->panProjection == SHPLIB_NULLPTR )
+        return -1;
+    memcpy( psDBF->panProjection, panFields, sizeof(int) * nCount );
+    psDBF->nProjectionCount = nCount;
+
+    int nStart = psDBF->nRecordLength;
+    int nEnd = 0;
+    int nTupleLength = 0;
+    for( int i = 0; i < nCount; i++ )
+    {
+        const int iField = panFields[i];
+        if( psDBF->panFieldOffset[iField] < nStart )
+            nStart = psDBF->panFieldOffset[iField];
+        if( psDBF->panFieldOffset[iField] + psDBF->panFieldSize[iField] > nEnd )
+            nEnd = psDBF->panFieldOffset[iField] + psDBF->panFieldSize[iField];
+        nTupleLength += psDBF->panFieldSize[iField];
+    }
+
+    /* A span over most of the record costs as much as reading it all */
+    if( DBF_PROJECTION_CLUSTERED(nEnd - nStart, psDBF->nRecordLength) )
+    {
+        psDBF->nProjectionStart = nStart;
+        psDBF->nProjectionLength = nEnd - nStart;
+    }
+
+    return nTupleLength;
+}
+
+/************************************************************************/
+/*                      goDBFReadProjectedTuple()                       */
+/*                                                                      */
+/*      Copy the raw bytes of the projected fields of a record, in      */
+/*      projection order and without separators, to pDst.               */
+/************************************************************************/
+
+int SHPAPI_CALL goDBFReadProjectedTuple( DBFHandle psDBF, int hEntity,
+                                         void *pDst )
+{
+    if( hEntity < 0 || hEntity >= psDBF->nRecords )
+        return FALSE;
+
+    if( psDBF->nProjectionCount == 0 )
+    {
+        const char *pabyRec = DBFGetRecord( psDBF, hEntity, -1 );
+        if( pabyRec == SHPLIB_NULLPTR )
+            return FALSE;
+        memcpy( pDst, pabyRec, psDBF->nRecordLength );
+        return TRUE;
+    }
+
+    char *pabyDst = STATIC_CAST(char *, pDst);
+    for( int i = 0; i < psDBF->nProjectionCount; i++ )
+    {
+        const int iField = psDBF->panProjection[i];
+        const char *pabyRec = DBFGetRecord( psDBF, hEntity, iField );
+        if( pabyRec == SHPLIB_NULLPTR )
+            return FALSE;
+        memcpy( pabyDst, pabyRec + psDBF->panFieldOffset[iField],
+                psDBF->panFieldSize[iField] );
+        pabyDst += psDBF->panFieldSize[iField];
+    }
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                          Dictionary columns                          */
+/*                                                                      */
+/*      A dictionary column holds each distinct value of a field once,  */
+/*      and a code per record indexing them, which is far smaller than  */
+/*      the values of fields with few distinct ones.  Values are found  */
+/*      by hashing their bytes as stored, eight at a time, so each      */
+/*      distinct value is copied, and recoded, only once.               */
+/************************************************************************/
+
+struct DBFDictionaryInfo
+{
+    int         nValues;
+    char        *pachValues;    /* values, each zero terminated */
+    int         nValueBytes;
+    int         nValueCapacity;
+    int         *panOffsets;    /* start of each value, then the end */
+    unsigned    *panHashes;     /* of each value */
+    int         nCapacity;      /* of panOffsets and panHashes */
+
+    int         *panSlots;      /* value per slot, -1 if empty */
+    int         nSlotMask;
+};
+
+static unsigned DBFHashBytes( const char *pachBytes, int nLength )
+{
+    uint64_t nHash = UINT64_C(0x9E3779B97F4A7C15) ^ STATIC_CAST(uint64_t, nLength);
+    for( int i = 0; i < nLength; i += 8 )
+    {
+        uint64_t nChunk = 0;
+        memcpy( &nChunk, pachBytes + i, nLength - i < 8 ? nLength - i : 8 );
+        nHash = (nHash ^ nChunk) * UINT64_C(0xFF51AFD7ED558CCD);
+        nHash ^= nHash >> 32;
+    }
+    return STATIC_CAST(unsigned, nHash ^ (nHash >> 29));
+}
+
+/************************************************************************/
+/*                         DBFDictionaryCreate()                        */
+/*                                                                      */
+/*      Create an empty dictionary, or return NULL if out of memory.    */
+/************************************************************************/
+
+static DBFDictionaryHandle DBFDictionaryCreate( void )
+{
+    DBFDictionaryHandle psDict = STATIC_CAST(DBFDictionaryHandle,
+        calloc( 1, sizeof(struct DBFDictionaryInfo) ));
+    if( psDict == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+    psDict->nCapacity = 64;
+    psDict->panOffsets = STATIC_CAST(int *, malloc( sizeof(int) * psDict->nCapacity ));
+    psDict->panHashes = STATIC_CAST(unsigned *,
+        malloc( sizeof(unsigned) * psDict->nCapacity ));
+    psDict->nValueCapacity = 1024;
+    psDict->pachValues = STATIC_CAST(char *, malloc( psDict->nValueCapacity ));
+    psDict->nSlotMask = 127;
+    psDict->panSlots = STATIC_CAST(int *,
+        malloc( sizeof(int) * (psDict->nSlotMask + 1) ));
+
+    if( psDict->panOffsets == SHPLIB_NULLPTR || psDict->panHashes == SHPLIB_NULLPTR ||
+        psDict->pachValues == SHPLIB_NULLPTR || psDict->panSlots == SHPLIB_NULLPTR )
+    {
+        goDBFDestroyDictionary( psDict );
+        return SHPLIB_NULLPTR;
+    }
+
+    psDict->panOffsets[0] = 0;
+    for( int i = 0; i <= psDict->nSlotMask; i++ )
+        psDict->panSlots[i] = -1;
+    return psDict;
+}
+
+/************************************************************************/
+/*                          DBFDictionaryFind()                         */
+/*                                                                      */
+/*      Return the code of a value, added if new, or -1 if out of       */
+/*      memory.                                                         */
+/************************************************************************/
+
+static int DBFDictionaryFind( DBFDictionaryHandle psDict,
+                              const char *pachValue, int nLength )
+{
+    const unsigned nHash = DBFHashBytes( pachValue, nLength );
+
+    unsigned iSlot = nHash & STATIC_CAST(unsigned, psDict->nSlotMask);
+    for( int iValue; (iValue = psDict->panSlots[iSlot]) >= 0;
+         iSlot = (iSlot + 1) & STATIC_CAST(unsigned, psDict->nSlotMask) )
+    {
+        if( psDict->panHashes[iValue] == nHash &&
+            psDict->panOffsets[iValue + 1] - psDict->panOffsets[iValue] - 1 == nLength &&
+            memcmp( psDict->pachValues + psDict->panOffsets[iValue],
+                    pachValue, nLength ) == 0 )
+            return iValue;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Append the new value, growing the arrays as needed.             */
+/* -------------------------------------------------------------------- */
+    const int iValue = psDict->nValues;
+    if( iValue + 2 > psDict->nCapacity )
+    {
+        const int nCapacity = psDict->nCapacity * 2;
+        int *panOffsets = STATIC_CAST(int *,
+            realloc( psDict->panOffsets, sizeof(int) * nCapacity ));
+        if( panOffsets == SHPLIB_NULLPTR )
+            return -1;
+        psDict->panOffsets = panOffsets;
+        unsigned *panHashes = STATIC_CAST(unsigned *,
+            realloc( psDict->panHashes, sizeof(unsigned) * nCapacity ));
+        if( panHashes == SHPLIB_NULLPTR )
+            return -1;
+        psDict->panHashes = panHashes;
+        psDict->nCapacity = nCapacity;
+    }
+    if( psDict->nValueBytes + nLength + 1 > psDict->nValueCapacity )
+    {
+        int nValueCapacity = psDict->nValueCapacity * 2;
+        while( psDict->nValueBytes + nLength + 1 > nValueCapacity )
+            nValueCapacity *= 2;
+        char *pachValues = STATIC_CAST(char *,
+            realloc( psDict->pachValues, nValueCapacity ));
+        if( pachValues == SHPLIB_NULLPTR )
+            return -1;
+        psDict->pachValues = pachValues;
+        psDict->nValueCapacity = nValueCapacity;
+    }
+
+    memcpy( psDict->pachValues + psDict->nValueBytes, pachValue, nLength );
+    psDict->pachValues[psDict->nValueBytes + nLength] = '\0';
+    psDict->nValueBytes += nLength + 1;
+    psDict->panHashes[iValue] = nHash;
+    psDict->panOffsets[iValue + 1] = psDict->nValueBytes;
+    psDict->nValues++;
+    psDict->panSlots[iSlot] = iValue;
+
+/* -------------------------------------------------------------------- */
+/*      Keep the slots at most half full.                               */
+/* -------------------------------------------------------------------- */
+    if( psDict->nValues * 2 > psDict->nSlotMask + 1 )
+    {
+        const int nSlots = (psDict->nSlotMask + 1) * 2;
+        int *panSlots = STATIC_CAST(int *, malloc( sizeof(int) * nSlots ));
+        if( panSlots == SHPLIB_NULLPTR )
+            return -1;
+        for( int i = 0; i < nSlots; i++ )
+            panSlots[i] = -1;
+        for( int i = 0; i < psDict->nValues; i++ )
+        {
+            unsigned iNewSlot = psDict->panHashes[i] & STATIC_CAST(unsigned, nSlots - 1);
+            while( panSlots[iNewSlot] >= 0 )
+                iNewSlot = (iNewSlot + 1) & STATIC_CAST(unsigned, nSlots - 1);
+            panSlots[iNewSlot] = i;
+        }
+        free( psDict->panSlots );
+        psDict->panSlots = panSlots;
+        psDict->nSlotMask = nSlots - 1;
+    }
+
+    return iValue;
+}
+
+/************************************************************************/
+/*                          DBFDictionaryRecode()                       */
+/*                                                                      */
+/*      Replace the values by their UTF-8 form.                         */
+/************************************************************************/
+
+static bool DBFDictionaryRecode( DBFDictionaryHandle psDict, int nCodePage )
+{
+    const int nCapacity = 3 * psDict->nValueBytes + 1;
+    char *pachValues = STATIC_CAST(char *, malloc( nCapacity ));
+    if( pachValues == SHPLIB_NULLPTR )
+        return false;
+
+    int nBytes = 0;
+    for( int i = 0; i < psDict->nValues; i++ )
+    {
+        const int nLength = psDict->panOffsets[i + 1] - psDict->panOffsets[i] - 1;
+        const int nRecoded = goDBFRecodeToUTF8(
+            nCodePage, psDict->pachValues + psDict->panOffsets[i], nLength,
+            pachValues + nBytes, 3 * nLength + 1 );
+        psDict->panOffsets[i] = nBytes;
+        nBytes += nRecoded + 1;
+    }
+    psDict->panOffsets[psDict->nValues] = nBytes;
+
+    free( psDict->pachValues );
+    psDict->pachValues = pachValues;
+    psDict->nValueBytes = nBytes;
+    psDict->nValueCapacity = nCapacity;
+    return true;
+}
+
+/************************************************************************/
+/*                       goDBFReadDictionaryColumn()                    */
+/*                                                                      */
+/*      Read a field for nCount records from iStart, or up to the last  */
+/*      record, as a dictionary of its distinct string values and the   */
+/*      code of the value of each record in panCodes, -1 for NULL.      */
+/*      Values are those of goDBFReadStringAttribute().  Returns NULL   */
+/*      on failure.                                                     */
+/************************************************************************/
+
+DBFDictionaryHandle SHPAPI_CALL
+goDBFReadDictionaryColumn( DBFHandle psDBF, int iField, int iStart, int nCount,
+                           int *panCodes )
+{
+    if( iField < 0 || iField >= psDBF->nFields || iStart < 0 || nCount < 0 )
+        return SHPLIB_NULLPTR;
+
+    if( iStart >= psDBF->nRecords )
+        nCount = 0;
+    else if( nCount > psDBF->nRecords - iStart )
+        nCount = psDBF->nRecords - iStart;
+
+    DBFDictionaryHandle psDict = DBFDictionaryCreate();
+
+    int nBlockRecords = DBF_COLUMN_BLOCK / psDBF->nRecordLength;
+    if( nBlockRecords < 1 )
+        nBlockRecords = 1;
+    if( nBlockRecords > nCount )
+        nBlockRecords = nCount;
+
+    char *pabyBlock = SHPLIB_NULLPTR;
+    if( psDBF->pabyMap == SHPLIB_NULLPTR && nCount > 0 )
+        pabyBlock = STATIC_CAST(char *,
+            malloc(STATIC_CAST(size_t, nBlockRecords) * psDBF->nRecordLength));
+
+    if( psDict == SHPLIB_NULLPTR ||
+        (psDBF->pabyMap == SHPLIB_NULLPTR && nCount > 0 && pabyBlock == SHPLIB_NULLPTR) )
+    {
+        psDBF->sHooks.Error( "Not enough memory to read DBF dictionary column." );
+        free( pabyBlock );
+        goDBFDestroyDictionary( psDict );
+        return SHPLIB_NULLPTR;
+    }
+
+    const int nWidth = psDBF->panFieldSize[iField];
+    const int nFieldOffset = psDBF->panFieldOffset[iField];
+    const char chType = psDBF->pachFieldType[iField];
+
+    for( int iDone = 0; iDone < nCount; )
+    {
+        int nRecords = nCount - iDone;
+        if( nRecords > nBlockRecords )
+            nRecords = nBlockRecords;
+
+        const char *pabyRecords =
+            goDBFReadRecords( psDBF, iStart + iDone, nRecords, pabyBlock );
+        if( pabyRecords == SHPLIB_NULLPTR )
+        {
+            free( pabyBlock );
+            goDBFDestroyDictionary( psDict );
+            return SHPLIB_NULLPTR;
+        }
+
+        for( int iRecord = 0; iRecord < nRecords; iRecord++, iDone++ )
+        {
+            const char *pachField = pabyRecords
+                + STATIC_CAST(size_t, iRecord) * psDBF->nRecordLength + nFieldOffset;
+
+            if( goDBFIsRawValueNULL( chType, pachField, nWidth ) )
+            {
+                panCodes[iDone] = -1;
+                continue;
+            }
+
+            int nLength;
+            const char *pachValue = DBFStringView( pachField, nWidth, &nLength );
+            panCodes[iDone] = DBFDictionaryFind( psDict, pachValue, nLength );
+            if( panCodes[iDone] < 0 )
+            {
+                psDBF->sHooks.Error( "Not enough memory to read DBF dictionary column." );
+                free( pabyBlock );
+                goDBFDestroyDictionary( psDict );
+                return SHPLIB_NULLPTR;
+            }
+        }
+    }
+
+    free( pabyBlock );
+
+    if( psDBF->nRecodeCodePage != 0 &&
+        !DBFDictionaryRecode( psDict, psDBF->nRecodeCodePage ) )
+    {
+        goDBFDestroyDictionary( psDict );
+        return SHPLIB_NULLPTR;
+    }
+
+    return psDict;
+}
+
+/************************************************************************/
+/*                        goDBFGetDictionarySize()                      */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFGetDictionarySize( DBFDictionaryHandle psDict )
+{
+    return psDict->nValues;
+}
+
+/************************************************************************/
+/*                        goDBFGetDictionaryValue()                     */
+/*                                                                      */
+/*      Return value iCode, zero terminated, and set *pnLength (if not  */
+/*      NULL) to its length.                                            */
+/************************************************************************/
+
+const char SHPAPI_CALL1(*)
+goDBFGetDictionaryValue( DBFDictionaryHandle psDict, int iCode, int *pnLength )
+{
+    if( iCode < 0 || iCode >= psDict->nValues )
+        return SHPLIB_NULLPTR;
+
+    if( pnLength != SHPLIB_NULLPTR )
+        *pnLength = psDict->panOffsets[iCode + 1] - psDict->panOffsets[iCode] - 1;
+    return psDict->pachValues + psDict->panOffsets[iCode];
+}
+
+/************************************************************************/
+/*                        goDBFDestroyDictionary()                      */
+/************************************************************************/
+
+void SHPAPI_CALL
+goDBFDestroyDictionary( DBFDictionaryHandle psDict )
+{
+    if( psDict == SHPLIB_NULLPTR )
+        return;
+
+    free( psDict->pachValues );
+    free( psDict->panOffsets );
+    free( psDict->panHashes );
+    free( psDict->panSlots );
+    free( psDict );
+}
+
+/************************************************************************/
+/*                              Aggregates                              */
+/*                                                                      */
+/*      An aggregate gathers the count, sum, minimum and maximum of     */
+/*      numeric fields per value of a group field, straight from the    */
+/*      field bytes of blocks of records.  The groups are a dictionary  */
+/*      of the group keys, found once per record, or once per run of    */
+/*      records with the same key bytes; each numeric field is then     */
+/*      parsed and accumulated for the whole block in one loop.         */
+/************************************************************************/
+
+typedef struct
+{
+    int         nCount;
+    double      dfSum;
+    double      dfMin;
+    double      dfMax;
+} DBFAggregateStats;
+
+struct DBFAggregateInfo
+{
+    DBFHandle   psDBF;
+    int         iGroupField;    /* -1 for a single group */
+    int         nFields;
+    int         *panFields;
+
+    DBFDictionaryHandle psKeys; /* key of each group, empty for NULL */
+    int         nGroups;
+    int         nGroupCapacity;
+    int         *panRecords;    /* records of each group */
+    DBFAggregateStats *pasStats; /* nFields per group */
+};
+
+/************************************************************************/
+/*                         DBFAggregateAddGroup()                       */
+/*                                                                      */
+/*      Append the statistics of a new group.                           */
+/************************************************************************/
+
+static bool DBFAggregateAddGroup( DBFAggregateHandle psAgg )
+{
+    if( psAgg->nGroups == psAgg->nGroupCapacity )
+    {
+        const int nCapacity = psAgg->nGroupCapacity * 2;
+        int *panRecords = STATIC_CAST(int *,
+            realloc( psAgg->panRecords, sizeof(int) * nCapacity ));
+        if( panRecords == SHPLIB_NULLPTR )
+            return false;
+        psAgg->panRecords = panRecords;
+        DBFAggregateStats *pasStats = STATIC_CAST(DBFAggregateStats *,
+            realloc( psAgg->pasStats, sizeof(DBFAggregateStats) *
+                     (STATIC_CAST(size_t, nCapacity) * psAgg->nFields + 1) ));
+        if( pasStats == SHPLIB_NULLPTR )
+            return false;
+        psAgg->pasStats = pasStats;
+        psAgg->nGroupCapacity = nCapacity;
+    }
+
+    psAgg->panRecords[psAgg->nGroups] = 0;
+    DBFAggregateStats *psStats =
+        psAgg->pasStats + STATIC_CAST(size_t, psAgg->nGroups) * psAgg->nFields;
+    for( int i = 0; i < psAgg->nFields; i++ )
+    {
+        psStats[i].nCount = 0;
+        psStats[i].dfSum = 0.0;
+        psStats[i].dfMin = HUGE_VAL;
+        psStats[i].dfMax = -HUGE_VAL;
+    }
+    psAgg->nGroups++;
+    return true;
+}
+
+/************************************************************************/
+/*                        DBFAggregateFindGroup()                       */
+/*                                                                      */
+/*      Return the group of the key of nLength bytes, added if new, or  */
+/*      -1 if out of memory.                                            */
+/************************************************************************/
+
+static int DBFAggregateFindGroup( DBFAggregateHandle psAgg,
+                                  const char *pachKey, int nLength )
+{
+    const int iGroup = DBFDictionaryFind( psAgg->psKeys, pachKey, nLength );
+    if( iGroup == psAgg->nGroups && !DBFAggregateAddGroup( psAgg ) )
+        return -1;
+    return iGroup;
+}
+
+/************************************************************************/
+/*                          goDBFCreateAggregate()                      */
+/*                                                                      */
+/*      Create an aggregate of the nFields numeric fields of panFields  */
+/*      grouped by the value of iGroupField, or in a single group if    */
+/*      iGroupField is -1.  Numeric group fields are grouped by their   */
+/*      value, whatever its width or leading zeros, the others by their */
+/*      string value; NULL values form a group of their own, with an    */
+/*      empty key.                                                      */
+/************************************************************************/
+
+DBFAggregateHandle SHPAPI_CALL
+goDBFCreateAggregate( DBFHandle psDBF, int iGroupField,
+                      const int *panFields, int nFields )
+{
+    if( iGroupField < -1 || iGroupField >= psDBF->nFields || nFields < 0 )
+        return SHPLIB_NULLPTR;
+
+    for( int i = 0; i < nFields; i++ )
+    {
+        if( panFields[i] < 0 || panFields[i] >= psDBF->nFields ||
+            (psDBF->pachFieldType[panFields[i]] != 'N' &&
+             psDBF->pachFieldType[panFields[i]] != 'F') )
+        {
+            char szMessage[64];
+            snprintf( szMessage, sizeof(szMessage),
+                      "Field %d cannot be aggregated.", panFields[i] );
+            psDBF->sHooks.Error( szMessage );
+            return SHPLIB_NULLPTR;
+        }
+    }
+
+    DBFAggregateHandle psAgg = STATIC_CAST(DBFAggregateHandle,
+        calloc( 1, sizeof(struct DBFAggregateInfo) ));
+    if( psAgg == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+    psAgg->psDBF = psDBF;
+    psAgg->iGroupField = iGroupField;
+    psAgg->nFields = nFields;
+    psAgg->panFields = STATIC_CAST(int *, malloc( sizeof(int) * (nFields + 1) ));
+    psAgg->psKeys = DBFDictionaryCreate();
+    psAgg->nGroupCapacity = 16;
+    psAgg->panRecords = STATIC_CAST(int *,
+        malloc( sizeof(int) * psAgg->nGroupCapacity ));
+    psAgg->pasStats = STATIC_CAST(DBFAggregateStats *,
+        malloc( sizeof(DBFAggregateStats) * (psAgg->nGroupCapacity * nFields + 1) ));
+
+    if( psAgg->panFields == SHPLIB_NULLPTR || psAgg->psKeys == SHPLIB_NULLPTR ||
+        psAgg->panRecords == SHPLIB_NULLPTR || psAgg->pasStats == SHPLIB_NULLPTR ||
+        (iGroupField < 0 && DBFAggregateFindGroup( psAgg, "", 0 ) < 0) )
+    {
+        psDBF->sHooks.Error( "Not enough memory for DBF aggregate." );
+        goDBFDestroyAggregate( psAgg );
+        return SHPLIB_NULLPTR;
+    }
+
+    if( nFields > 0 )
+        memcpy( psAgg->panFields, panFields, sizeof(int) * nFields );
+    return psAgg;
+}
+
+/************************************************************************/
+/*                          DBFAggregateBlock()                         */
+/*                                                                      */
+/*      Aggregate the nRows records at offsets panRows of the records   */
+/*      in pabyRecords, using panGroups for the group of each.          */
+/************************************************************************/
+
+static bool DBFAggregateBlock( DBFAggregateHandle psAgg,
+                               const char *pabyRecords,
+                               const int *panRows, int nRows, int *panGroups )
+{
+    DBFHandle psDBF = psAgg->psDBF;
+    const size_t nRecordLength = psDBF->nRecordLength;
+
+/* -------------------------------------------------------------------- */
+/*      Find the group of each record, reusing that of the previous     */
+/*      record when the key bytes are the same, as they are along runs  */
+/*      of sorted records.                                              */
+/* -------------------------------------------------------------------- */
+    if( psAgg->iGroupField < 0 )
+    {
+        memset( panGroups, 0, sizeof(int) * nRows );
+    }
+    else
+    {
+        const int iField = psAgg->iGroupField;
+        const int nWidth = psDBF->panFieldSize[iField];
+        const int nFieldOffset = psDBF->panFieldOffset[iField];
+        const char chType = psDBF->pachFieldType[iField];
+        const bool bNumeric = chType == 'N' || chType == 'F';
+        const bool bInteger = psDBF->panFieldDecimals[iField] == 0;
+
+        const char *pachPrevious = SHPLIB_NULLPTR;
+        int iPrevious = -1;
+        for( int i = 0; i < nRows; i++ )
+        {
+            const char *pachField =
+                pabyRecords + panRows[i] * nRecordLength + nFieldOffset;
+            if( pachPrevious != SHPLIB_NULLPTR &&
+                memcmp( pachField, pachPrevious, nWidth ) == 0 )
+            {
+                panGroups[i] = iPrevious;
+                continue;
+            }
+
+            int iGroup;
+            double dfValue;
+            if( bNumeric && goDBFParseDouble( pachField, nWidth, &dfValue ) )
+            {
+                char szKey[64];
+                const int nLength =
+                    snprintf( szKey, sizeof(szKey), bInteger ? "%.0f" : "%.15g",
+                              dfValue );
+                iGroup = DBFAggregateFindGroup( psAgg, szKey, nLength );
+            }
+            else if( bNumeric || goDBFIsRawValueNULL( chType, pachField, nWidth ) )
+            {
+                iGroup = DBFAggregateFindGroup( psAgg, "", 0 );
+            }
+            else
+            {
+                int nLength;
+                const char *pachKey = DBFStringView( pachField, nWidth, &nLength );
+                iGroup = DBFAggregateFindGroup( psAgg, pachKey, nLength );
+            }
+            if( iGroup < 0 )
+                return false;
+
+            panGroups[i] = iPrevious = iGroup;
+            pachPrevious = pachField;
+        }
+    }
+
+    for( int i = 0; i < nRows; i++ )
+        psAgg->panRecords[panGroups[i]]++;
+
+/* -------------------------------------------------------------------- */
+/*      Accumulate one field at a time over the block.                  */
+/* -------------------------------------------------------------------- */
+    for( int iValue = 0; iValue < psAgg->nFields; iValue++ )
+    {
+        const int iField = psAgg->panFields[iValue];
+        const int nWidth = psDBF->panFieldSize[iField];
+        const char *pachFields = pabyRecords + psDBF->panFieldOffset[iField];
+        DBFAggregateStats *pasStats = psAgg->pasStats + iValue;
+
+        for( int i = 0; i < nRows; i++ )
+        {
+            double dfValue;
+            if( !goDBFParseDouble( pachFields + panRows[i] * nRecordLength,
+                                   nWidth, &dfValue ) )
+                continue;
+
+            DBFAggregateStats *psStats =
+                pasStats + STATIC_CAST(size_t, panGroups[i]) * psAgg->nFields;
+            psStats->nCount++;
+            psStats->dfSum += dfValue;
+            if( dfValue < psStats->dfMin )
+                psStats->dfMin = dfValue;
+            if( dfValue > psStats->dfMax )
+                psStats->dfMax = dfValue;
+        }
+    }
+
+    return true;
+}
+
+/************************************************************************/
+/*                          DBFAggregateRecords()                       */
+/*                                                                      */
+/*      Aggregate the nSelected records of panSelected, in increasing   */
+/*      order, or the nCount records from iStart if it is NULL.         */
+/************************************************************************/
+
+static int DBFAggregateRecords( DBFAggregateHandle psAgg,
+                                const int *panSelected, int nSelected,
+                                int iStart, int nCount )
+{
+    DBFHandle psDBF = psAgg->psDBF;
+
+    if( panSelected != SHPLIB_NULLPTR )
+    {
+        for( int i = 0; i < nSelected; i++ )
+        {
+            if( panSelected[i] < 0 || panSelected[i] >= psDBF->nRecords ||
+                (i > 0 && panSelected[i] <= panSelected[i - 1]) )
+            {
+                psDBF->sHooks.Error( "Invalid selection of DBF records." );
+                return FALSE;
+            }
+        }
+        nCount = nSelected;
+    }
+    else
+    {
+        if( iStart < 0 || nCount < 0 || iStart > psDBF->nRecords )
+            return FALSE;
+        if( nCount > psDBF->nRecords - iStart )
+            nCount = psDBF->nRecords - iStart;
+    }
+    if( nCount == 0 )
+        return TRUE;
+
+    int nBlockRecords = DBF_COLUMN_BLOCK / psDBF->nRecordLength;
+    if( nBlockRecords < 1 )
+        nBlockRecords = 1;
+    if( panSelected == SHPLIB_NULLPTR && nBlockRecords > nCount )
+        nBlockRecords = nCount;
+
+    char *pabyBlock = SHPLIB_NULLPTR;
+    if( psDBF->pabyMap == SHPLIB_NULLPTR )
+        pabyBlock = STATIC_CAST(char *,
+            malloc(STATIC_CAST(size_t, nBlockRecords) * psDBF->nRecordLength));
+    int *panRows = STATIC_CAST(int *, malloc( sizeof(int) * nBlockRecords ));
+    int *panGroups = STATIC_CAST(int *, malloc( sizeof(int) * nBlockRecords ));
+
+    bool bOK = panRows != SHPLIB_NULLPTR && panGroups != SHPLIB_NULLPTR &&
+               (psDBF->pabyMap != SHPLIB_NULLPTR || pabyBlock != SHPLIB_NULLPTR);
+    if( !bOK )
+        psDBF->sHooks.Error( "Not enough memory for DBF aggregate." );
+
+/* -------------------------------------------------------------------- */
+/*      Read the span of each block of records in one go, and           */
+/*      aggregate those of its records that are selected.               */
+/* -------------------------------------------------------------------- */
+    for( int iDone = 0; bOK && iDone < nCount; )
+    {
+        int iFirst;
+        int nSpan;
+        int nRows = 0;
+        if( panSelected != SHPLIB_NULLPTR )
+        {
+            iFirst = panSelected[iDone];
+            while( iDone + nRows < nCount &&
+                   panSelected[iDone + nRows] - iFirst < nBlockRecords )
+            {
+                panRows[nRows] = panSelected[iDone + nRows] - iFirst;
+                nRows++;
+            }
+            nSpan = panRows[nRows - 1] + 1;
+        }
+        else
+        {
+            iFirst = iStart + iDone;
+            nRows = nCount - iDone < nBlockRecords ? nCount - iDone : nBlockRecords;
+            for( int i = 0; i < nRows; i++ )
+                panRows[i] = i;
+            nSpan = nRows;
+        }
+
+        const char *pabyRecords =
+            goDBFReadRecords( psDBF, iFirst, nSpan, pabyBlock );
+        bOK = pabyRecords != SHPLIB_NULLPTR;
+        if( bOK && !DBFAggregateBlock( psAgg, pabyRecords, panRows, nRows,
+                                       panGroups ) )
+        {
+            psDBF->sHooks.Error( "Not enough memory for DBF aggregate." );
+            bOK = false;
+        }
+        iDone += nRows;
+    }
+
+    free( panGroups );
+    free( panRows );
+    free( pabyBlock );
+    return bOK ? TRUE : FALSE;
+}
+
+/************************************************************************/
+/*                          goDBFAggregateRange()                       */
+/*                                                                      */
+/*      Add the nCount records from iStart, or up to the last record,   */
+/*      to the aggregate.  Returns FALSE on failure.                    */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFAggregateRange( DBFAggregateHandle psAgg, int iStart, int nCount )
+{
+    return DBFAggregateRecords( psAgg, SHPLIB_NULLPTR, 0, iStart, nCount );
+}
+
+/************************************************************************/
+/*                        goDBFAggregateSelection()                     */
+/*                                                                      */
+/*      Add the nSelected records of panSelected, in increasing order   */
+/*      as goDBFFilterSelect() returns them, to the aggregate.          */
+/*      Returns FALSE on failure.                                       */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFAggregateSelection( DBFAggregateHandle psAgg, const int *panSelected,
+                         int nSelected )
+{
+    if( panSelected == SHPLIB_NULLPTR || nSelected < 0 )
+        return FALSE;
+    return DBFAggregateRecords( psAgg, panSelected, nSelected, 0, 0 );
+}
+
+/************************************************************************/
+/*                       goDBFAggregateGetGroupCount()                  */
+/*                                                                      */
+/*      Groups are numbered in the order their first record was added.  */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFAggregateGetGroupCount( DBFAggregateHandle psAgg )
+{
+    return psAgg->nGroups;
+}
+
+/************************************************************************/
+/*                          goDBFAggregateGetKey()                      */
+/*                                                                      */
+/*      Copy the key of a group, zero terminated and recoded as string  */
+/*      values are, into pszKey of nKeySize bytes, of which 3 *         */
+/*      XBASE_FLD_MAX_WIDTH + 1 are always enough.  Returns the length  */
+/*      of the key, 0 for the group of NULL values, or -1 on failure.   */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFAggregateGetKey( DBFAggregateHandle psAgg, int iGroup, char *pszKey,
+                      int nKeySize )
+{
+    int nLength;
+    const char *pachKey =
+        goDBFGetDictionaryValue( psAgg->psKeys, iGroup, &nLength );
+    if( pachKey == SHPLIB_NULLPTR || nKeySize < 1 )
+        return -1;
+
+    if( psAgg->psDBF->nRecodeCodePage != 0 )
+        return goDBFRecodeToUTF8( psAgg->psDBF->nRecodeCodePage, pachKey,
+                                  nLength, pszKey, nKeySize );
+
+    if( nLength > nKeySize - 1 )
+        nLength = nKeySize - 1;
+    memcpy( pszKey, pachKey, nLength );
+    pszKey[nLength] = '\0';
+    return nLength;
+}
+
+/************************************************************************/
+/*                      goDBFAggregateGetRecordCount()                  */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFAggregateGetRecordCount( DBFAggregateHandle psAgg, int iGroup )
+{
+    if( iGroup < 0 || iGroup >= psAgg->nGroups )
+        return 0;
+    return psAgg->panRecords[iGroup];
+}
+
+/************************************************************************/
+/*                         goDBFAggregateGetStats()                     */
+/*                                                                      */
+/*      Return the number of non NULL values of field iValue of         */
+/*      panFields in a group, and set their sum, minimum and maximum,   */
+/*      0 if there are none.                                            */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFAggregateGetStats( DBFAggregateHandle psAgg, int iGroup, int iValue,
+                        double *pdfSum, double *pdfMin, double *pdfMax )
+{
+    *pdfSum = *pdfMin = *pdfMax = 0.0;
+    if( iGroup < 0 || iGroup >= psAgg->nGroups ||
+        iValue < 0 || iValue >= psAgg->nFields )
+        return 0;
+
+    const DBFAggregateStats *psStats =
+        psAgg->pasStats + STATIC_CAST(size_t, iGroup) * psAgg->nFields + iValue;
+    if( psStats->nCount > 0 )
+    {
+        *pdfSum = psStats->dfSum;
+        *pdfMin = psStats->dfMin;
+        *pdfMax = psStats->dfMax;
+    }
+    return psStats->nCount;
+}
+
+/************************************************************************/
+/*                         goDBFDestroyAggregate()                      */
+/************************************************************************/
+
+void SHPAPI_CALL
+goDBFDestroyAggregate( DBFAggregateHandle psAgg )
+{
+    if( psAgg == SHPLIB_NULLPTR )
+        return;
+
+    goDBFDestroyDictionary( psAgg->psKeys );
+    free( psAgg->panFields );
+    free( psAgg->panRecords );
+    free( psAgg->pasStats );
+    free( psAgg );
+}
+
+/************************************************************************/
+/*                              Cursors                                 */
+/*                                                                      */
+/*      A cursor reads the records of a handle into its own buffers,    */
+/*      with pread() on the descriptor of the file, so that any number  */
+/*      of threads can read one handle at the same time, each through   */
+/*      its own cursor.  Files without a descriptor, such as            */
+/*      compressed ones, are read with the hooks of the handle under a  */
+/*      lock shared by all of them.                                     */
+/************************************************************************/
+
+struct DBFCursorInfo
+{
+    DBFHandle   psDBF;
+    int         fd;             /* -1 to go through the hooks */
+
+    int         nCurrentRecord;
+    char        *pszCurrentRecord;
+
+    char        *pszWorkField;
+    int         nWorkFieldLength;
+};
+
+#ifndef SHPAPI_WINDOWS
+static pthread_mutex_t hDBFCursorLock = PTHREAD_MUTEX_INITIALIZER;
+#  define DBF_CURSOR_LOCK()   pthread_mutex_lock( &hDBFCursorLock )
+#  define DBF_CURSOR_UNLOCK() pthread_mutex_unlock( &hDBFCursorLock )
+#else
+static SRWLOCK hDBFCursorLock = SRWLOCK_INIT;
+#  define DBF_CURSOR_LOCK()   AcquireSRWLockExclusive( &hDBFCursorLock )
+#  define DBF_CURSOR_UNLOCK() ReleaseSRWLockExclusive( &hDBFCursorLock )
+#endif
+
+/************************************************************************/
+/*                         goDBFCreateCursor()                          */
+/*                                                                      */
+/*      Create a cursor on psDBF, writing out pending changes first.    */
+/*      Cursors see the records as they are in the file; the handle     */
+/*      must not be modified, nor read other than through cursors,      */
+/*      while they are in use by other threads.                         */
+/************************************************************************/
+
+DBFCursorHandle SHPAPI_CALL
+goDBFCreateCursor( DBFHandle psDBF )
+{
+    if( !DBFFlushRecord( psDBF ) )
+        return SHPLIB_NULLPTR;
+    psDBF->sHooks.FFlush( psDBF->fp );
+
+    DBFCursorHandle psCursor = STATIC_CAST(DBFCursorHandle,
+        calloc(1, sizeof(struct DBFCursorInfo)));
+    if( psCursor == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+    psCursor->psDBF = psDBF;
+    psCursor->nCurrentRecord = -1;
+    psCursor->pszCurrentRecord = STATIC_CAST(char *, malloc(psDBF->nRecordLength));
+    /* Room for a field recoded to UTF-8 */
+    psCursor->nWorkFieldLength = 3 * XBASE_FLD_MAX_WIDTH + 1;
+    psCursor->pszWorkField = STATIC_CAST(char *, malloc(psCursor->nWorkFieldLength));
+    if( psCursor->pszCurrentRecord == SHPLIB_NULLPTR ||
+        psCursor->pszWorkField == SHPLIB_NULLPTR )
+    {
+        goDBFDestroyCursor( psCursor );
+        return SHPLIB_NULLPTR;
+    }
+
+#ifndef SHPAPI_WINDOWS
+    psCursor->fd = psDBF->sHooks.FFileno != SHPLIB_NULLPTR ?
+                   psDBF->sHooks.FFileno( psDBF->fp ) : -1;
+#else
+    psCursor->fd = -1;
+#endif
+
+    return psCursor;
+}
+
+/************************************************************************/
+/*                         goDBFDestroyCursor()                         */
+/************************************************************************/
+
+void SHPAPI_CALL
+goDBFDestroyCursor( DBFCursorHandle psCursor )
+{
+    if( psCursor == SHPLIB_NULLPTR )
+        return;
+
+    free( psCursor->pszCurrentRecord );
+    free( psCursor->pszWorkField );
+    free( psCursor );
+}
+
+/************************************************************************/
+/*                           DBFCursorRead()                            */
+/*                                                                      */
+/*      Read nBytes at nOffset of the file into pBuffer, with pread()   */
+/*      if the cursor has a descriptor, else under the cursor lock.     */
+/************************************************************************/
+
+static bool DBFCursorRead( DBFCursorHandle psCursor, SAOffset nOffset,
+                           void *pBuffer, size_t nBytes )
+{
+    DBFHandle psDBF = psCursor->psDBF;
+    bool bOK = true;
+#ifndef SHPAPI_WINDOWS
+    if( psCursor->fd >= 0 )
+    {
+        size_t nDone = 0;
+        while( bOK && nDone < nBytes )
+        {
+            const ssize_t nRead = pread( psCursor->fd,
+                                         STATIC_CAST(char *, pBuffer) + nDone,
+                                         nBytes - nDone,
+                                         STATIC_CAST(off_t, nOffset + nDone) );
+            if( nRead < 0 && errno == EINTR )
+                continue;
+            bOK = nRead > 0;
+            if( bOK )
+                nDone += nRead;
+        }
+    }
+    else
+#endif
+    {
+        DBF_CURSOR_LOCK();
+        bOK = psDBF->sHooks.FSeek( psDBF->fp, nOffset, SEEK_SET ) == 0 &&
+            psDBF->sHooks.FRead( pBuffer, nBytes, 1, psDBF->fp ) == 1;
+        psDBF->bRequireNextWriteSeek = TRUE;
+        DBF_CURSOR_UNLOCK();
+    }
+    return bOK;
+}
+
+/************************************************************************/
+/*                        DBFCursorGetRecord()                          */
+/*                                                                      */
+/*      The bytes of record hEntity: in place if the file is mapped,    */
+/*      else read into the buffer of the cursor.                        */
+/************************************************************************/
+
+static const char *DBFCursorGetRecord( DBFCursorHandle psCursor, int hEntity )
+{
+    DBFHandle psDBF = psCursor->psDBF;
+    if( hEntity < 0 || hEntity >= psDBF->nRecords )
+        return SHPLIB_NULLPTR;
+
+    const SAOffset nOffset = psDBF->nRecordLength * STATIC_CAST(SAOffset, hEntity)
+                             + psDBF->nHeaderLength;
+
+    if( psDBF->pabyMap != SHPLIB_NULLPTR )
+        return psDBF->pabyMap + nOffset;
+
+    if( psCursor->nCurrentRecord == hEntity )
+        return psCursor->pszCurrentRecord;
+
+    if( !DBFCursorRead( psCursor, nOffset, psCursor->pszCurrentRecord,
+                        psDBF->nRecordLength ) )
+    {
+        char szMessage[128];
+        snprintf( szMessage, sizeof(szMessage),
+                  "Failure reading DBF record %d.", hEntity );
+        psDBF->sHooks.Error( szMessage );
+        psCursor->nCurrentRecord = -1;
+        return SHPLIB_NULLPTR;
+    }
+
+    psCursor->nCurrentRecord = hEntity;
+    return psCursor->pszCurrentRecord;
+}
+
+/************************************************************************/
+/*                       goDBFCursorReadRecords()                       */
+/*                                                                      */
+/*      goDBFReadRecords() through a cursor: the nCount records from    */
+/*      iStart, in place if the file is mapped, else read into          */
+/*      pBuffer.  Any number of threads can read this way at once.      */
+/************************************************************************/
+
+const char SHPAPI_CALL1(*)
+goDBFCursorReadRecords( DBFCursorHandle psCursor, int iStart, int nCount,
+                        void *pBuffer )
+{
+    DBFHandle psDBF = psCursor->psDBF;
+    if( iStart < 0 || nCount < 0 || nCount > psDBF->nRecords - iStart )
+        return SHPLIB_NULLPTR;
+
+    const SAOffset nOffset =
+        psDBF->nRecordLength * STATIC_CAST(SAOffset, iStart) + psDBF->nHeaderLength;
+
+    if( psDBF->pabyMap != SHPLIB_NULLPTR )
+        return psDBF->pabyMap + nOffset;
+
+    if( nCount > 0 &&
+        !DBFCursorRead( psCursor, nOffset, pBuffer,
+                        STATIC_CAST(size_t, nCount) * psDBF->nRecordLength ) )
+    {
+        char szMessage[128];
+        snprintf( szMessage, sizeof(szMessage),
+                  "Failure reading DBF records %d to %d.",
+                  iStart, iStart + nCount - 1 );
+        psDBF->sHooks.Error( szMessage );
+        return SHPLIB_NULLPTR;
+    }
+
+    return STATIC_CAST(const char *, pBuffer);
+}
+
+/************************************************************************/
+/*                         goDBFCursorGetDBF()                          */
+/************************************************************************/
+
+DBFHandle SHPAPI_CALL
+goDBFCursorGetDBF( DBFCursorHandle psCursor )
+{
+    return psCursor->psDBF;
+}
+
+/************************************************************************/
+/*                         DBFCursorGetField()                          */
+/************************************************************************/
+
+static const char *DBFCursorGetField( DBFCursorHandle psCursor, int hEntity,
+                                      int iField )
+{
+    if( iField < 0 || iField >= psCursor->psDBF->nFields )
+        return SHPLIB_NULLPTR;
+
+    const char *pabyRec = DBFCursorGetRecord( psCursor, hEntity );
+    if( pabyRec == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+    return pabyRec + psCursor->psDBF->panFieldOffset[iField];
+}
+
+/************************************************************************/
+/*                  goDBFCursorReadIntegerAttribute()                   */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFCursorReadIntegerAttribute( DBFCursorHandle psCursor, int iRecord,
+                                 int iField )
+{
+    const char *pachField = DBFCursorGetField( psCursor, iRecord, iField );
+    int nValue = 0;
+
+    if( pachField != SHPLIB_NULLPTR )
+        goDBFParseInteger( pachField, psCursor->psDBF->panFieldSize[iField], &nValue );
+    return nValue;
+}
+
+/************************************************************************/
+/*                   goDBFCursorReadDoubleAttribute()                   */
+/************************************************************************/
+
+double SHPAPI_CALL
+goDBFCursorReadDoubleAttribute( DBFCursorHandle psCursor, int iRecord,
+                                int iField )
+{
+    const char *pachField = DBFCursorGetField( psCursor, iRecord, iField );
+    double dfValue = 0.0;
+
+    if( pachField != SHPLIB_NULLPTR )
+        goDBFParseDouble( pachField, psCursor->psDBF->panFieldSize[iField], &dfValue );
+    return dfValue;
+}
+
+/************************************************************************/
+/*                   goDBFCursorReadStringAttribute()                   */
+/*                                                                      */
+/*      The value stays valid until the next read through the cursor.   */
+/************************************************************************/
+
+const char SHPAPI_CALL1(*)
+goDBFCursorReadStringAttribute( DBFCursorHandle psCursor, int iRecord,
+                                int iField )
+{
+    const char *pachField = DBFCursorGetField( psCursor, iRecord, iField );
+    if( pachField == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+    int nLength;
+    const char *pachValue = DBFStringView(
+        pachField, psCursor->psDBF->panFieldSize[iField], &nLength );
+
+    if( psCursor->psDBF->nRecodeCodePage != 0 )
+    {
+        goDBFRecodeToUTF8( psCursor->psDBF->nRecodeCodePage, pachValue, nLength,
+                           psCursor->pszWorkField, psCursor->nWorkFieldLength );
+    }
+    else
+    {
+        memcpy( psCursor->pszWorkField, pachValue, nLength );
+        psCursor->pszWorkField[nLength] = '\0';
+    }
+
+    return psCursor->pszWorkField;
+}
+
+/************************************************************************/
+/*                      goDBFCursorReadStringView()                     */
+/*                                                                      */
+/*      goDBFReadStringView() through a cursor.  The value stays valid  */
+/*      until the next read through the cursor.                         */
+/************************************************************************/
+
+const char SHPAPI_CALL1(*)
+goDBFCursorReadStringView( DBFCursorHandle psCursor, int iRecord, int iField,
+                           int *pnLength )
+{
+    if( psCursor->psDBF->nRecodeCodePage != 0 )
+    {
+        const char *pszValue =
+            goDBFCursorReadStringAttribute( psCursor, iRecord, iField );
+        if( pszValue == SHPLIB_NULLPTR )
+            return SHPLIB_NULLPTR;
+        *pnLength = STATIC_CAST(int, strlen(pszValue));
+        return pszValue;
+    }
+
+    const char *pachField = DBFCursorGetField( psCursor, iRecord, iField );
+    if( pachField == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+    return DBFStringView( pachField, psCursor->psDBF->panFieldSize[iField],
+                          pnLength );
+}
+
+/************************************************************************/
+/*                    goDBFCursorIsAttributeNULL()                      */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFCursorIsAttributeNULL( DBFCursorHandle psCursor, int iRecord, int iField )
+{
+    const char *pszValue =
+        goDBFCursorReadStringAttribute( psCursor, iRecord, iField );
+
+    if( pszValue == SHPLIB_NULLPTR )
+        return TRUE;
+
+    return DBFIsValueNULL( psCursor->psDBF->pachFieldType[iField], pszValue );
+}
+
+/************************************************************************/
+/*                     goDBFCursorReadIntegerColumn()                   */
+/*                                                                      */
+/*      goDBFReadIntegerColumn() through a cursor, so that threads      */
+/*      can each decode their own range of records of one handle.      */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFCursorReadIntegerColumn( DBFCursorHandle psCursor, int iField, int iStart,
+                              int nCount, int *panValues,
+                              unsigned char *pabyNull )
+{
+    return DBFReadColumn( psCursor->psDBF, psCursor, psCursor->pszWorkField,
+                          iField, iStart, nCount, 'I', panValues, 0, pabyNull );
+}
+
+/************************************************************************/
+/*                     goDBFCursorReadDoubleColumn()                    */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFCursorReadDoubleColumn( DBFCursorHandle psCursor, int iField, int iStart,
+                             int nCount, double *padfValues,
+                             unsigned char *pabyNull )
+{
+    return DBFReadColumn( psCursor->psDBF, psCursor, psCursor->pszWorkField,
+                          iField, iStart, nCount, 'N', padfValues, 0, pabyNull );
+}
+
+/************************************************************************/
+/*                     goDBFCursorReadStringColumn()                    */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFCursorReadStringColumn( DBFCursorHandle psCursor, int iField, int iStart,
+                             int nCount, char *pszValues, int nStride,
+                             unsigned char *pabyNull )
+{
+    return DBFReadColumn( psCursor->psDBF, psCursor, psCursor->pszWorkField,
+                          iField, iStart, nCount, 'C', pszValues, nStride,
+                          pabyNull );
+}
+
+/************************************************************************/
+/*                             Batch writers                            */
+/*                                                                      */
+/*      A batch writer appends records to a handle without going        */
+/*      through pszCurrentRecord: rows are formatted in place in a      */
+/*      large buffer, which is written with one seek and one write      */
+/*      whenever it fills up, and the record count of the header is     */
+/*      updated once, when the writer is closed.                        */
+/************************************************************************/
+
+struct DBFWriterInfo
+{
+    DBFHandle   psDBF;
+
+    unsigned char *pabyBuffer;
+    int         nBufferRecords; /* capacity of pabyBuffer, in records */
+    int         nBuffered;      /* complete rows in pabyBuffer */
+
+    bool        bRowStarted;
+    bool        bFailed;        /* a chunk could not be written */
+};
+
+#define DBF_WRITER_BUFFER_SIZE (1024 * 1024)
+
+/************************************************************************/
+/*                         goDBFCreateWriter()                          */
+/*                                                                      */
+/*      Create a writer appending to psDBF, buffering about nBytes      */
+/*      (1 MB if 0) of records.  The handle must not be used other      */
+/*      than through the writer until it is closed.  Mapped handles,    */
+/*      which are read-only, cannot be written.                         */
+/************************************************************************/
+
+DBFWriterHandle SHPAPI_CALL
+goDBFCreateWriter( DBFHandle psDBF, int nBytes )
+{
+    if( psDBF->pabyMap != SHPLIB_NULLPTR || psDBF->nRecordLength <= 0 )
+        return SHPLIB_NULLPTR;
+
+    if( psDBF->bNoHeader )
+        DBFWriteHeader( psDBF );
+
+    if( !DBFFlushRecord( psDBF ) )
+        return SHPLIB_NULLPTR;
+
+    if( nBytes <= 0 )
+        nBytes = DBF_WRITER_BUFFER_SIZE;
+
+    DBFWriterHandle psWriter = STATIC_CAST(DBFWriterHandle,
+        calloc(1, sizeof(struct DBFWriterInfo)));
+    if( psWriter == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+    psWriter->psDBF = psDBF;
+    psWriter->nBufferRecords = nBytes / psDBF->nRecordLength;
+    if( psWriter->nBufferRecords < 1 )
+        psWriter->nBufferRecords = 1;
+    psWriter->pabyBuffer = STATIC_CAST(unsigned char *,
+        malloc(STATIC_CAST(size_t, psWriter->nBufferRecords) *
+               psDBF->nRecordLength));
+    if( psWriter->pabyBuffer == SHPLIB_NULLPTR )
+    {
+        free( psWriter );
+        return SHPLIB_NULLPTR;
+    }
+
+    return psWriter;
+}
+
+/************************************************************************/
+/*                          DBFWriterFlush()                            */
+/*                                                                      */
+/*      Append the complete rows of the buffer to the file.             */
+/************************************************************************/
+
+static bool DBFWriterFlush( DBFWriterHandle psWriter )
+{
+    DBFHandle psDBF = psWriter->psDBF;
+
+    if( psWriter->bFailed )
+        return false;
+    if( psWriter->nBuffered == 0 )
+        return true;
+
+    const SAOffset nOffset = psDBF->nHeaderLength +
+        STATIC_CAST(SAOffset, psDBF->nRecords) * psDBF->nRecordLength;
+
+    if( psDBF->sHooks.FSeek( psDBF->fp, nOffset, 0 ) != 0 ||
+        psDBF->sHooks.FWrite( psWriter->pabyBuffer, psDBF->nRecordLength,
+                              psWriter->nBuffered, psDBF->fp )
+            != STATIC_CAST(SAOffset, psWriter->nBuffered) )
+    {
+        char szMessage[128];
+        snprintf( szMessage, sizeof(szMessage),
+                  "Failure writing DBF records %d to %d.",
+                  psDBF->nRecords, psDBF->nRecords + psWriter->nBuffered - 1 );
+        psDBF->sHooks.Error( szMessage );
+        /* the rows are lost, and so are any that follow */
+        psWriter->bFailed = true;
+        psWriter->nBuffered = 0;
+        return false;
+    }
+
+    psDBF->nRecords += psWriter->nBuffered;
+    psDBF->bUpdated = TRUE;
+    psDBF->bRequireNextWriteSeek = TRUE;
+    psWriter->nBuffered = 0;
+
+    return true;
+}
+
+/************************************************************************/
+/*                          DBFWriterGetRow()                           */
+/*                                                                      */
+/*      Return the row being formatted, starting it as a blank record   */
+/*      if needed.                                                      */
+/************************************************************************/
+
+static unsigned char *DBFWriterGetRow( DBFWriterHandle psWriter )
+{
+    const int nRecordLength = psWriter->psDBF->nRecordLength;
+    unsigned char *pabyRow = psWriter->pabyBuffer +
+        STATIC_CAST(size_t, psWriter->nBuffered) * nRecordLength;
+
+    if( !psWriter->bRowStarted )
+    {
+        memset( pabyRow, ' ', nRecordLength );
+        psWriter->bRowStarted = true;
+    }
+
+    return pabyRow;
+}
+
+/************************************************************************/
+/*                          DBFWriterSetField()                         */
+/************************************************************************/
+
+static int DBFWriterSetField( DBFWriterHandle psWriter, int iField,
+                              const void *pValue )
+{
+    if( iField < 0 || iField >= psWriter->psDBF->nFields || psWriter->bFailed )
+        return FALSE;
+
+    return DBFFormatAttribute( psWriter->psDBF, DBFWriterGetRow( psWriter ),
+                               iField, pValue ) ? TRUE : FALSE;
+}
+
+/************************************************************************/
+/*                         goDBFWriterSet*()                            */
+/*                                                                      */
+/*      Set a field of the row being written, formatted as by the       */
+/*      goDBFWrite*Attribute() functions.  Fields which are not set     */
+/*      are left blank.  Return FALSE if the value had to be truncated. */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFWriterSetDouble( DBFWriterHandle psWriter, int iField, double dValue )
+{
+    return DBFWriterSetField( psWriter, iField, &dValue );
+}
+
+int SHPAPI_CALL
+goDBFWriterSetInteger( DBFWriterHandle psWriter, int iField, int nValue )
+{
+    const double dValue = nValue;
+
+    return DBFWriterSetField( psWriter, iField, &dValue );
+}
+
+int SHPAPI_CALL
+goDBFWriterSetString( DBFWriterHandle psWriter, int iField,
+                      const char *pszValue )
+{
+    return DBFWriterSetField( psWriter, iField, pszValue );
+}
+
+int SHPAPI_CALL
+goDBFWriterSetLogical( DBFWriterHandle psWriter, int iField, char lValue )
+{
+    return DBFWriterSetField( psWriter, iField, &lValue );
+}
+
+int SHPAPI_CALL
+goDBFWriterSetNULL( DBFWriterHandle psWriter, int iField )
+{
+    return DBFWriterSetField( psWriter, iField, SHPLIB_NULLPTR );
+}
+
+/************************************************************************/
+/*                          goDBFWriterEndRow()                         */
+/*                                                                      */
+/*      Complete the row being written, writing the buffer out when     */
+/*      it is full.  Returns FALSE if it could not be written; once a   */
+/*      write failed, all further rows are rejected.                    */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFWriterEndRow( DBFWriterHandle psWriter )
+{
+    if( psWriter->bFailed )
+        return FALSE;
+
+    DBFWriterGetRow( psWriter );
+    psWriter->bRowStarted = false;
+    psWriter->nBuffered++;
+
+    if( psWriter->nBuffered == psWriter->nBufferRecords )
+        return DBFWriterFlush( psWriter ) ? TRUE : FALSE;
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                          goDBFCloseWriter()                          */
+/*                                                                      */
+/*      Write the buffered rows, dropping a row which was started but   */
+/*      not ended, then the end of file character and the record        */
+/*      count of the header.  Returns FALSE if any row could not be     */
+/*      written.                                                        */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFCloseWriter( DBFWriterHandle psWriter )
+{
+    if( psWriter == SHPLIB_NULLPTR )
+        return FALSE;
+
+    DBFHandle psDBF = psWriter->psDBF;
+
+    psWriter->bRowStarted = false;
+    const bool bOK = DBFWriterFlush( psWriter );
+
+    if( psDBF->bUpdated )
+    {
+        if( psDBF->bWriteEndOfFileChar )
+        {
+            char ch = END_OF_FILE_CHARACTER;
+
+            psDBF->sHooks.FSeek( psDBF->fp, psDBF->nHeaderLength +
+                STATIC_CAST(SAOffset, psDBF->nRecords) * psDBF->nRecordLength, 0 );
+            psDBF->sHooks.FWrite( &ch, 1, 1, psDBF->fp );
+        }
+        goDBFUpdateHeader( psDBF );
+    }
+
+    free( psWriter->pabyBuffer );
+    free( psWriter );
+
+    return bOK ? TRUE : FALSE;
+}
+
+/************************************************************************/
+/*                             Schema edits                             */
+/*                                                                      */
+/*      A schema edit collects field additions, deletions, changes     */
+/*      and reorderings, and applies them all in a single pass over     */
+/*      the records, which are moved block by block.  The records are   */
+/*      rewritten in place, in an order that never overwrites a record  */
+/*      not yet read, or into a new file which then replaces the old    */
+/*      one with rename(), so that the table is never seen half         */
+/*      rewritten.                                                      */
+/************************************************************************/
+
+typedef struct
+{
+    int         iSource;        /* field of the handle, -1 for a new one */
+    char        chType;
+    int         nWidth;
+    int         nDecimals;
+    char        achDescriptor[XBASE_FLDHDR_SZ];
+} DBFSchemaField;
+
+struct DBFSchemaEditInfo
+{
+    DBFHandle       psDBF;
+    int             nFields;
+    DBFSchemaField  *pasFields;
+};
+
+#define DBF_REWRITE_BLOCK_SIZE (4 * 1024 * 1024)
+
+/************************************************************************/
+/*                       goDBFCreateSchemaEdit()                        */
+/************************************************************************/
+
+DBFSchemaEditHandle SHPAPI_CALL
+goDBFCreateSchemaEdit( DBFHandle psDBF )
+{
+    DBFSchemaEditHandle psEdit = STATIC_CAST(DBFSchemaEditHandle,
+        calloc(1, sizeof(struct DBFSchemaEditInfo)));
+    if( psEdit == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+    psEdit->psDBF = psDBF;
+    psEdit->nFields = psDBF->nFields;
+    psEdit->pasFields = STATIC_CAST(DBFSchemaField *,
+        malloc(sizeof(DBFSchemaField) * (psDBF->nFields + 1)));
+    if( psEdit->pasFields == SHPLIB_NULLPTR )
+    {
+        free( psEdit );
+        return SHPLIB_NULLPTR;
+    }
+
+    for( int i = 0; i < psDBF->nFields; i++ )
+    {
+        DBFSchemaField *psField = psEdit->pasFields + i;
+        psField->iSource = i;
+        psField->chType = psDBF->pachFieldType[i];
+        psField->nWidth = psDBF->panFieldSize[i];
+        psField->nDecimals = psDBF->panFieldDecimals[i];
+        memcpy( psField->achDescriptor, psDBF->pszHeader + i * XBASE_FLDHDR_SZ,
+                XBASE_FLDHDR_SZ );
+    }
+
+    return psEdit;
+}
+
+/************************************************************************/
+/*                       goDBFDestroySchemaEdit()                       */
+/*                                                                      */
+/*      Drop an edit without applying it.                               */
+/************************************************************************/
+
+void SHPAPI_CALL
+goDBFDestroySchemaEdit( DBFSchemaEditHandle psEdit )
+{
+    if( psEdit == SHPLIB_NULLPTR )
+        return;
+
+    free( psEdit->pasFields );
+    free( psEdit );
+}
+
+/************************************************************************/
+/*                        DBFSchemaSetField()                           */
+/*                                                                      */
+/*      Define a field of the edited schema, as goDBFAddField() would.  */
+/************************************************************************/
+
+static void DBFSchemaSetField( DBFSchemaField *psField,
+                               const char *pszFieldName, char chType,
+                               int nWidth, int nDecimals )
+{
+    if( nWidth > XBASE_FLD_MAX_WIDTH )
+        nWidth = XBASE_FLD_MAX_WIDTH;
+
+    psField->chType = chType;
+    psField->nWidth = nWidth;
+    psField->nDecimals = nDecimals;
+
+    char *pszFInfo = psField->achDescriptor;
+    memset( pszFInfo, 0, XBASE_FLDHDR_SZ );
+    strncpy( pszFInfo, pszFieldName, XBASE_FLDNAME_LEN_WRITE );
+    pszFInfo[11] = chType;
+
+    if( chType == 'C' )
+    {
+        pszFInfo[16] = STATIC_CAST(unsigned char, nWidth % 256);
+        pszFInfo[17] = STATIC_CAST(unsigned char, nWidth / 256);
+    }
+    else
+    {
+        pszFInfo[16] = STATIC_CAST(unsigned char, nWidth);
+        pszFInfo[17] = STATIC_CAST(unsigned char, nDecimals);
+    }
+}
+
+/************************************************************************/
+/*                        goDBFSchemaAddField()                         */
+/*                                                                      */
+/*      Append a field, NULL in every record.  Returns its index in     */
+/*      the edited schema, or -1.                                       */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFSchemaAddField( DBFSchemaEditHandle psEdit, const char *pszFieldName,
+                     char chType, int nWidth, int nDecimals )
+{
+    if( nWidth < 1 )
+        return -1;
+
+    DBFSchemaField *pasFields = STATIC_CAST(DBFSchemaField *,
+        realloc(psEdit->pasFields, sizeof(DBFSchemaField) * (psEdit->nFields + 1)));
+    if( pasFields == SHPLIB_NULLPTR )
+        return -1;
+    psEdit->pasFields = pasFields;
+
+    DBFSchemaField *psField = pasFields + psEdit->nFields;
+    psField->iSource = -1;
+    DBFSchemaSetField( psField, pszFieldName, chType, nWidth, nDecimals );
+
+    return psEdit->nFields++;
+}
+
+/************************************************************************/
+/*                       goDBFSchemaDeleteField()                       */
+/*                                                                      */
+/*      Remove field iField of the edited schema.                       */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFSchemaDeleteField( DBFSchemaEditHandle psEdit, int iField )
+{
+    if( iField < 0 || iField >= psEdit->nFields )
+        return FALSE;
+
+    memmove( psEdit->pasFields + iField, psEdit->pasFields + iField + 1,
+             sizeof(DBFSchemaField) * (psEdit->nFields - iField - 1) );
+    psEdit->nFields--;
 
     return TRUE;
 }
 
 /************************************************************************/
-/*                            goDBFGetCodePage                            */
+/*                       goDBFSchemaAlterField()                        */
+/*                                                                      */
+/*      Change the definition of field iField of the edited schema,     */
+/*      converting its values as goDBFAlterFieldDefn() does.            */
 /************************************************************************/
 
-const char SHPAPI_CALL1(*)
-goDBFGetCodePage(DBFHandle psDBF )
+int SHPAPI_CALL
+goDBFSchemaAlterField( DBFSchemaEditHandle psEdit, int iField,
+                       const char *pszFieldName, char chType,
+                       int nWidth, int nDecimals )
 {
-    if( psDBF == SHPLIB_NULLPTR )
-        return SHPLIB_NULLPTR;
-    return psDBF->pszCodePage;
+    if( iField < 0 || iField >= psEdit->nFields || nWidth < 1 )
+        return FALSE;
+
+    DBFSchemaSetField( psEdit->pasFields + iField, pszFieldName, chType,
+                       nWidth, nDecimals );
+
+    return TRUE;
 }
 
 /************************************************************************/
-/*                          goDBFDeleteField()                            */
+/*                      goDBFSchemaReorderFields()                      */
 /*                                                                      */
-/*      Remove a field from a .dbf file                                 */
+/*      Field i of the edited schema becomes field panMap[i]; panMap    */
+/*      must be a permutation of the field indexes.                     */
 /************************************************************************/
 
 int SHPAPI_CALL
-goDBFDeleteField(DBFHandle psDBF, int iField) {
-    if (iField < 0 || iField >= psDBF->nFields)
-        return FALSE;
+goDBFSchemaReorderFields( DBFSchemaEditHandle psEdit, const int *panMap )
+{
+    if( psEdit->nFields == 0 )
+        return TRUE;
 
-    /* make sure that everything is written in .dbf */
-    if( !DBFFlushRecord( psDBF ) )
+    DBFSchemaField *pasFields = STATIC_CAST(DBFSchemaField *,
+        malloc(sizeof(DBFSchemaField) * psEdit->nFields));
+    if( pasFields == SHPLIB_NULLPTR )
         return FALSE;
 
-    /* get information about field to be deleted */
-    int nOldRecordLength = psDBF->nRecordLength;
-    int nOldHeaderLength = psDBF->nHeaderLength;
-    int nDeletedFieldOffset = psDBF->panFieldOffset[iField];
-    int nDeletedFieldSize = psDBF->panFieldSize[iField];
-
-    /* update fields info */
-    for (int i = iField + 1; i < psDBF->nFields; i++)
+    for( int i = 0; i < psEdit->nFields; i++ )
     {
-        psDBF->panFieldOffset[i-1] = psDBF->panFieldOffset[i] - nDeletedFieldSize;
-        psDBF->panFieldSize[i-1] = psDBF->panFieldSize[i];
-        psDBF->panFieldDecimals[i-1] = psDBF->panFieldDecimals[i];
-        psDBF->pachFieldType[i-1] = psDBF->pachFieldType[i];
+        if( panMap[i] < 0 || panMap[i] >= psEdit->nFields )
+        {
+            free( pasFields );
+            return FALSE;
+        }
+        pasFields[i] = psEdit->pasFields[panMap[i]];
     }
 
-    /* resize fields arrays */
-    psDBF->nFields--;
-
-    psDBF->panFieldOffset = STATIC_CAST(int *,
-        realloc( psDBF->panFieldOffset, sizeof(int) * psDBF->nFields ));
+    free( psEdit->pasFields );
+    psEdit->pasFields = pasFields;
 
-    psDBF->panFieldSize = STATIC_CAST(int *,
-        realloc( psDBF->panFieldSize, sizeof(int) * psDBF->nFields ));
-
-    psDBF->panFieldDecimals = STATIC_CAST(int *,
-        realloc( psDBF->panFieldDecimals, sizeof(int) * psDBF->nFields ));
-
-    psDBF->pachFieldType = STATIC_CAST(char *,
-        realloc( psDBF->pachFieldType, sizeof(char) * psDBF->nFields ));
+    return TRUE;
+}
 
-    /* update header information */
-    psDBF->nHeaderLength -= XBASE_FLDHDR_SZ;
-    psDBF->nRecordLength -= nDeletedFieldSize;
+/************************************************************************/
+/*                         DBFSchemaConvert()                           */
+/*                                                                      */
+/*      Build a record of the edited schema from a record of the        */
+/*      handle.                                                         */
+/************************************************************************/
 
-    /* overwrite field information in header */
-    memmove(psDBF->pszHeader + iField*XBASE_FLDHDR_SZ,
-           psDBF->pszHeader + (iField+1)*XBASE_FLDHDR_SZ,
-           sizeof(char) * (psDBF->nFields - iField)*XBASE_FLDHDR_SZ);
+static void DBFSchemaConvert( DBFSchemaEditHandle psEdit,
+                              const int *panNewOffset,
+                              const char *pabySrc, char *pabyDst )
+{
+    const DBFHandle psDBF = psEdit->psDBF;
 
-    psDBF->pszHeader = STATIC_CAST(char *, realloc(psDBF->pszHeader,
-                                          psDBF->nFields*XBASE_FLDHDR_SZ));
+    pabyDst[0] = pabySrc[0];
 
-    /* update size of current record appropriately */
-    psDBF->pszCurrentRecord = STATIC_CAST(char *, realloc(psDBF->pszCurrentRecord,
-                                                 psDBF->nRecordLength));
+    for( int i = 0; i < psEdit->nFields; i++ )
+    {
+        const DBFSchemaField *psField = psEdit->pasFields + i;
+        char *pachDst = pabyDst + panNewOffset[i];
+        const int nWidth = psField->nWidth;
 
-    /* we're done if we're dealing with not yet created .dbf */
-    if ( psDBF->bNoHeader && psDBF->nRecords == 0 )
-        return TRUE;
+        if( psField->iSource < 0 )
+        {
+            memset( pachDst, DBFGetNullCharacter(psField->chType), nWidth );
+            continue;
+        }
 
-    /* force update of header with new header and record length */
-    psDBF->bNoHeader = TRUE;
-    goDBFUpdateHeader( psDBF );
+        const char *pachSrc = pabySrc + psDBF->panFieldOffset[psField->iSource];
+        const int nOldWidth = psDBF->panFieldSize[psField->iSource];
+        const char chOldType = psDBF->pachFieldType[psField->iSource];
 
-    /* alloc record */
-    char *pszRecord = STATIC_CAST(char *, malloc(sizeof(char) * nOldRecordLength));
+        if( nWidth == nOldWidth && psField->chType == chOldType )
+        {
+            memcpy( pachDst, pachSrc, nWidth );
+            continue;
+        }
 
-    /* shift records to their new positions */
-    for (int iRecord = 0; iRecord < psDBF->nRecords; iRecord++)
-    {
-        SAOffset nRecordOffset =
-            nOldRecordLength * STATIC_CAST(SAOffset,iRecord) + nOldHeaderLength;
+        char szOldField[XBASE_FLD_MAX_WIDTH + 1];
+        memcpy( szOldField, pachSrc, nOldWidth );
+        szOldField[nOldWidth] = '\0';
 
-        /* load record */
-        psDBF->sHooks.FSeek( psDBF->fp, nRecordOffset, 0 );
-        if (psDBF->sHooks.FRead(pszRecord, nOldRecordLength, 1, psDBF->fp) != 1) {
-          free(pszRecord);
-          return FALSE;
+        if( DBFIsValueNULL( chOldType, szOldField ) )
+            memset( pachDst, DBFGetNullCharacter(psField->chType), nWidth );
+        else if( nWidth <= nOldWidth )
+        {
+            /* Strip leading spaces when truncating a numeric field */
+            if( (chOldType == 'N' || chOldType == 'F' || chOldType == 'D') &&
+                pachSrc[0] == ' ' )
+                memcpy( pachDst, pachSrc + nOldWidth - nWidth, nWidth );
+            else
+                memcpy( pachDst, pachSrc, nWidth );
         }
+        else if( chOldType == 'N' || chOldType == 'F' )
+        {
+            /* Add leading spaces when expanding a numeric field */
+            memset( pachDst, ' ', nWidth - nOldWidth );
+            memcpy( pachDst + nWidth - nOldWidth, pachSrc, nOldWidth );
+        }
+        else
+        {
+            /* Add trailing spaces */
+            memcpy( pachDst, pachSrc, nOldWidth );
+            memset( pachDst + nOldWidth, ' ', nWidth - nOldWidth );
+        }
+    }
+}
 
-        nRecordOffset =
-            psDBF->nRecordLength * STATIC_CAST(SAOffset,iRecord) + psDBF->nHeaderLength;
-
-        /* move record in two steps */
-        psDBF->sHooks.FSeek( psDBF->fp, nRecordOffset, 0 );
-        psDBF->sHooks.FWrite( pszRecord, nDeletedFieldOffset, 1, psDBF->fp );
-        psDBF->sHooks.FWrite( pszRecord + nDeletedFieldOffset + nDeletedFieldSize,
-                              nOldRecordLength - nDeletedFieldOffset - nDeletedFieldSize,
-                              1, psDBF->fp );
+/************************************************************************/
+/*                          DBFSchemaMove()                             */
+/*                                                                      */
+/*      Convert records iStart to iEnd-1, from nOldHeaderLength and     */
+/*      nOldRecordLength in fpIn to nNewHeaderLength and                */
+/*      nNewRecordLength in fpOut, a block at a time, going from the    */
+/*      last block down if bBackward.                                   */
+/************************************************************************/
 
-    }
+static bool DBFSchemaMove( DBFSchemaEditHandle psEdit, const int *panNewOffset,
+                           SAFile fpOut, int nNewHeaderLength,
+                           int nNewRecordLength, int iStart, int iEnd,
+                           bool bBackward, char *pabyOld, char *pabyNew,
+                           int nBlockRecords )
+{
+    const DBFHandle psDBF = psEdit->psDBF;
+    const int nOldRecordLength = psDBF->nRecordLength;
 
-    if( psDBF->bWriteEndOfFileChar )
+    for( int iDone = 0; iDone < iEnd - iStart; )
     {
-        char ch = END_OF_FILE_CHARACTER;
-        SAOffset nEOFOffset =
-            psDBF->nRecordLength * STATIC_CAST(SAOffset,psDBF->nRecords) + psDBF->nHeaderLength;
-
-        psDBF->sHooks.FSeek( psDBF->fp, nEOFOffset, 0 );
-        psDBF->sHooks.FWrite( &ch, 1, 1, psDBF->fp );
-    }
+        int nCount = iEnd - iStart - iDone;
+        if( nCount > nBlockRecords )
+            nCount = nBlockRecords;
+        const int iFirst = bBackward ? iEnd - iDone - nCount : iStart + iDone;
+
+        const SAOffset nOldOffset = psDBF->nHeaderLength +
+            STATIC_CAST(SAOffset, iFirst) * nOldRecordLength;
+        if( psDBF->sHooks.FSeek( psDBF->fp, nOldOffset, 0 ) != 0 ||
+            psDBF->sHooks.FRead( pabyOld, nOldRecordLength, nCount, psDBF->fp )
+                != STATIC_CAST(SAOffset, nCount) )
+        {
+            char szMessage[128];
+            snprintf( szMessage, sizeof(szMessage),
+                      "Failure reading DBF records %d to %d.",
+                      iFirst, iFirst + nCount - 1 );
+            psDBF->sHooks.Error( szMessage );
+            return false;
+        }
 
-    /* TODO: truncate file */
+        for( int i = 0; i < nCount; i++ )
+            DBFSchemaConvert( psEdit, panNewOffset,
+                              pabyOld + STATIC_CAST(size_t, i) * nOldRecordLength,
+                              pabyNew + STATIC_CAST(size_t, i) * nNewRecordLength );
 
-    /* free record */
-    free(pszRecord);
+        const SAOffset nNewOffset = nNewHeaderLength +
+            STATIC_CAST(SAOffset, iFirst) * nNewRecordLength;
+        if( psDBF->sHooks.FSeek( fpOut, nNewOffset, 0 ) != 0 ||
+            psDBF->sHooks.FWrite( pabyNew, nNewRecordLength, nCount, fpOut )
+                != STATIC_CAST(SAOffset, nCount) )
+        {
+            char szMessage[128];
+            snprintf( szMessage, sizeof(szMessage),
+                      "Failure writing DBF records %d to %d.",
+                      iFirst, iFirst + nCount - 1 );
+            psDBF->sHooks.Error( szMessage );
+            return false;
+        }
 
-    psDBF->nCurrentRecord = -1;
-    psDBF->bCurrentRecordModified = FALSE;
-    psDBF->bUpdated = TRUE;
+        iDone += nCount;
+    }
 
-    return TRUE;
+    return true;
 }
 
 /************************************************************************/
-/*                          goDBFReorderFields()                          */
-/*                                                                      */
-/*      Reorder the fields of a .dbf file                               */
+/*                         DBFSchemaRewrite()                           */
 /*                                                                      */
-/* panMap must be exactly psDBF->nFields long and be a permutation      */
-/* of [0, psDBF->nFields-1]. This assumption will not be asserted in the*/
-/* code of goDBFReorderFields.                                            */
+/*      Convert all the records into fpOut, which may be the file of    */
+/*      the handle itself.                                              */
 /************************************************************************/
 
-int SHPAPI_CALL
-goDBFReorderFields( DBFHandle psDBF, int* panMap ) {
-    if ( psDBF->nFields == 0 )
-        return TRUE;
-
-    /* make sure that everything is written in .dbf */
-    if( !DBFFlushRecord( psDBF ) )
-        return FALSE;
-
-    /* a simple malloc() would be enough, but calloc() helps clang static analyzer */
-    int *panFieldOffsetNew = STATIC_CAST(int *, calloc(sizeof(int), psDBF->nFields));
-    int *panFieldSizeNew = STATIC_CAST(int *, calloc(sizeof(int),  psDBF->nFields));
-    int *panFieldDecimalsNew = STATIC_CAST(int *, calloc(sizeof(int), psDBF->nFields));
-    char *pachFieldTypeNew = STATIC_CAST(char *, calloc(sizeof(char), psDBF->nFields));
-    char *pszHeaderNew = STATIC_CAST(char*, malloc(sizeof(char) * XBASE_FLDHDR_SZ *
-                                  psDBF->nFields));
+static bool DBFSchemaRewrite( DBFSchemaEditHandle psEdit,
+                              const int *panNewOffset, SAFile fpOut,
+                              int nNewHeaderLength, int nNewRecordLength )
+{
+    const DBFHandle psDBF = psEdit->psDBF;
+    const int nRecords = psDBF->nRecords;
+    if( nRecords == 0 )
+        return true;
 
-    /* shuffle fields definitions */
-    for(int i = 0; i < psDBF->nFields; i++)
-    {
-        panFieldSizeNew[i] = psDBF->panFieldSize[panMap[i]];
-        panFieldDecimalsNew[i] = psDBF->panFieldDecimals[panMap[i]];
-        pachFieldTypeNew[i] = psDBF->pachFieldType[panMap[i]];
-        memcpy(pszHeaderNew + i * XBASE_FLDHDR_SZ,
-               psDBF->pszHeader + panMap[i] * XBASE_FLDHDR_SZ, XBASE_FLDHDR_SZ);
-    }
-    panFieldOffsetNew[0] = 1;
-    for(int i = 1; i < psDBF->nFields; i++)
+    const int nMaxLength = psDBF->nRecordLength > nNewRecordLength ?
+                           psDBF->nRecordLength : nNewRecordLength;
+    int nBlockRecords = DBF_REWRITE_BLOCK_SIZE / nMaxLength;
+    if( nBlockRecords < 1 )
+        nBlockRecords = 1;
+    if( nBlockRecords > nRecords )
+        nBlockRecords = nRecords;
+
+    char *pabyOld = STATIC_CAST(char *,
+        malloc(STATIC_CAST(size_t, nBlockRecords) * psDBF->nRecordLength));
+    char *pabyNew = STATIC_CAST(char *,
+        malloc(STATIC_CAST(size_t, nBlockRecords) * nNewRecordLength));
+    if( pabyOld == SHPLIB_NULLPTR || pabyNew == SHPLIB_NULLPTR )
     {
-        panFieldOffsetNew[i] = panFieldOffsetNew[i - 1] + panFieldSizeNew[i - 1];
+        free( pabyOld );
+        free( pabyNew );
+        psDBF->sHooks.Error( "Cannot allocate DBF rewrite buffers." );
+        return false;
     }
 
-    free(psDBF->pszHeader);
-    psDBF->pszHeader = pszHeaderNew;
-
-    bool errorAbort = false;
+/* -------------------------------------------------------------------- */
+/*      In place, record i moves by nHeaderDelta + i * nRecordDelta.    */
+/*      The records moving towards the end of the file, all at one end */
+/*      of the table, are moved first, last one first, then those       */
+/*      moving towards the start, first one first, so that no record    */
+/*      is overwritten before it is read.                               */
+/* -------------------------------------------------------------------- */
+    int iSplit = nRecords;      /* first record moving the other way */
+    bool bLaterFirst = false;   /* whether the first records move towards the end */
 
-    /* we're done if we're dealing with not yet created .dbf */
-    if ( !(psDBF->bNoHeader && psDBF->nRecords == 0) )
+    if( fpOut == psDBF->fp )
     {
-        /* force update of header with new header and record length */
-        psDBF->bNoHeader = TRUE;
-        goDBFUpdateHeader( psDBF );
-
-        /* alloc record */
-        char *pszRecord = STATIC_CAST(char *, malloc(sizeof(char) * psDBF->nRecordLength));
-        char *pszRecordNew = STATIC_CAST(char *, malloc(sizeof(char) * psDBF->nRecordLength));
-
-        /* shuffle fields in records */
-        for (int iRecord = 0; iRecord < psDBF->nRecords; iRecord++)
-        {
-            const SAOffset nRecordOffset =
-                psDBF->nRecordLength * STATIC_CAST(SAOffset,iRecord) + psDBF->nHeaderLength;
-
-            /* load record */
-            psDBF->sHooks.FSeek( psDBF->fp, nRecordOffset, 0 );
-            if (psDBF->sHooks.FRead(pszRecord, psDBF->nRecordLength, 1, psDBF->fp) != 1) {
-              errorAbort = true;
-              break;
-            }
-
-            pszRecordNew[0] = pszRecord[0];
+        const long long nHeaderDelta =
+            STATIC_CAST(long long, nNewHeaderLength) - psDBF->nHeaderLength;
+        const long long nRecordDelta =
+            STATIC_CAST(long long, nNewRecordLength) - psDBF->nRecordLength;
+
+        bLaterFirst = nHeaderDelta > 0;
+        long long nSplit = nRecords;
+        if( bLaterFirst && nRecordDelta < 0 )
+            nSplit = (nHeaderDelta - nRecordDelta - 1) / -nRecordDelta;
+        else if( !bLaterFirst && nRecordDelta > 0 )
+            nSplit = -nHeaderDelta / nRecordDelta + 1;
+        if( nSplit < nRecords )
+            iSplit = STATIC_CAST(int, nSplit);
+    }
 
-            for(int i = 0; i < psDBF->nFields; i++)
-            {
-                memcpy(pszRecordNew + panFieldOffsetNew[i],
-                       pszRecord + psDBF->panFieldOffset[panMap[i]],
-                       psDBF->panFieldSize[panMap[i]]);
-            }
+    bool bOK;
+    if( bLaterFirst )
+        bOK = DBFSchemaMove( psEdit, panNewOffset, fpOut, nNewHeaderLength,
+                             nNewRecordLength, 0, iSplit, true,
+                             pabyOld, pabyNew, nBlockRecords ) &&
+              DBFSchemaMove( psEdit, panNewOffset, fpOut, nNewHeaderLength,
+                             nNewRecordLength, iSplit, nRecords, false,
+                             pabyOld, pabyNew, nBlockRecords );
+    else
+        bOK = DBFSchemaMove( psEdit, panNewOffset, fpOut, nNewHeaderLength,
+                             nNewRecordLength, iSplit, nRecords, true,
+                             pabyOld, pabyNew, nBlockRecords ) &&
+              DBFSchemaMove( psEdit, panNewOffset, fpOut, nNewHeaderLength,
+                             nNewRecordLength, 0, iSplit, false,
+                             pabyOld, pabyNew, nBlockRecords );
 
-            /* write record */
-            psDBF->sHooks.FSeek( psDBF->fp, nRecordOffset, 0 );
-            psDBF->sHooks.FWrite( pszRecordNew, psDBF->nRecordLength, 1, psDBF->fp );
-        }
+    free( pabyOld );
+    free( pabyNew );
 
-        /* free record */
-        free(pszRecord);
-        free(pszRecordNew);
-    }
+    return bOK;
+}
 
-    if (errorAbort) {
-      free(panFieldOffsetNew);
-      free(panFieldSizeNew);
-      free(panFieldDecimalsNew);
-      free(pachFieldTypeNew);
-      psDBF->nCurrentRecord = -1;
-      psDBF->bCurrentRecordModified = FALSE;
-      psDBF->bUpdated = FALSE;
-      return FALSE;
-    }
+/************************************************************************/
+/*                          DBFSchemaLayout                             */
+/*                                                                      */
+/*      The parts of a handle that describe its records, swapped in     */
+/*      and out of the handle as a whole.                               */
+/************************************************************************/
 
-    free(psDBF->panFieldOffset);
-    free(psDBF->panFieldSize);
-    free(psDBF->panFieldDecimals);
-    free(psDBF->pachFieldType);
+typedef struct
+{
+    SAFile      fp;
+    int         nFields;
+    int         nRecordLength;
+    int         nHeaderLength;
+    int         *panFieldOffset;
+    int         *panFieldSize;
+    int         *panFieldDecimals;
+    char        *pachFieldType;
+    char        *pszHeader;
+} DBFSchemaLayout;
+
+static void DBFSchemaSwap( DBFHandle psDBF, DBFSchemaLayout *psLayout )
+{
+    DBFSchemaLayout sOld;
+    sOld.fp = psDBF->fp;
+    sOld.nFields = psDBF->nFields;
+    sOld.nRecordLength = psDBF->nRecordLength;
+    sOld.nHeaderLength = psDBF->nHeaderLength;
+    sOld.panFieldOffset = psDBF->panFieldOffset;
+    sOld.panFieldSize = psDBF->panFieldSize;
+    sOld.panFieldDecimals = psDBF->panFieldDecimals;
+    sOld.pachFieldType = psDBF->pachFieldType;
+    sOld.pszHeader = psDBF->pszHeader;
+
+    psDBF->fp = psLayout->fp;
+    psDBF->nFields = psLayout->nFields;
+    psDBF->nRecordLength = psLayout->nRecordLength;
+    psDBF->nHeaderLength = psLayout->nHeaderLength;
+    psDBF->panFieldOffset = psLayout->panFieldOffset;
+    psDBF->panFieldSize = psLayout->panFieldSize;
+    psDBF->panFieldDecimals = psLayout->panFieldDecimals;
+    psDBF->pachFieldType = psLayout->pachFieldType;
+    psDBF->pszHeader = psLayout->pszHeader;
+
+    *psLayout = sOld;
+
+    DBFBuildFieldHash( psDBF );
+    DBFDropBitmaps( psDBF );
+}
 
-    psDBF->panFieldOffset = panFieldOffsetNew;
-    psDBF->panFieldSize = panFieldSizeNew;
-    psDBF->panFieldDecimals =panFieldDecimalsNew;
-    psDBF->pachFieldType = pachFieldTypeNew;
+static void DBFSchemaFreeLayout( DBFSchemaLayout *psLayout )
+{
+    free( psLayout->panFieldOffset );
+    free( psLayout->panFieldSize );
+    free( psLayout->panFieldDecimals );
+    free( psLayout->pachFieldType );
+    free( psLayout->pszHeader );
+}
 
-    psDBF->nCurrentRecord = -1;
-    psDBF->bCurrentRecordModified = FALSE;
-    psDBF->bUpdated = TRUE;
+/************************************************************************/
+/*                        DBFSchemaReplaceFile()                        */
+/*                                                                      */
+/*      Move pszTmpFile over pszFilename, replacing it atomically.      */
+/************************************************************************/
 
-    return TRUE;
+static bool DBFSchemaReplaceFile( const char *pszTmpFile,
+                                  const char *pszFilename )
+{
+#ifdef SHPAPI_WINDOWS
+    return MoveFileExA( pszTmpFile, pszFilename,
+                        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) != 0;
+#else
+    return rename( pszTmpFile, pszFilename ) == 0;
+#endif
 }
 
-
 /************************************************************************/
-/*                          goDBFAlterFieldDefn()                         */
+/*                        goDBFCommitSchemaEdit()                       */
 /*                                                                      */
-/*      Alter a field definition in a .dbf file                         */
+/*      Apply an edit to its handle and destroy it.  If pszFilename is  */
+/*      NULL the records are rewritten in place, else pszFilename must  */
+/*      name the file of the handle: the new table is written to        */
+/*      pszFilename.tmp, which then replaces it, and the handle is      */
+/*      reopened on it.  Returns FALSE if the edit could not be         */
+/*      applied, in which case the handle keeps its previous fields,    */
+/*      although a failed rewrite in place may have damaged records,    */
+/*      and a replaced file which cannot be reopened leaves the handle  */
+/*      without a file.                                                 */
 /************************************************************************/
 
 int SHPAPI_CALL
-goDBFAlterFieldDefn( DBFHandle psDBF, int iField, const char * pszFieldName,
-                    char chType, int nWidth, int nDecimals ) {
-    if (iField < 0 || iField >= psDBF->nFields)
-        return FALSE;
+goDBFCommitSchemaEdit( DBFSchemaEditHandle psEdit, const char *pszFilename )
+{
+    DBFHandle psDBF = psEdit->psDBF;
+    const int nFields = psEdit->nFields;
 
-    /* make sure that everything is written in .dbf */
-    if( !DBFFlushRecord( psDBF ) )
+    if( psDBF->pabyMap != SHPLIB_NULLPTR || !DBFFlushRecord( psDBF ) )
+    {
+        goDBFDestroySchemaEdit( psEdit );
         return FALSE;
-
-    const char chFieldFill = DBFGetNullCharacter(chType);
-
-    const char chOldType = psDBF->pachFieldType[iField];
-    const int nOffset = psDBF->panFieldOffset[iField];
-    const int nOldWidth = psDBF->panFieldSize[iField];
-    const int nOldRecordLength = psDBF->nRecordLength;
-
-/* -------------------------------------------------------------------- */
-/*      Do some checking to ensure we can add records to this file.     */
-/* -------------------------------------------------------------------- */
-    if( nWidth < 1 )
-        return -1;
-
-    if( nWidth > XBASE_FLD_MAX_WIDTH )
-        nWidth = XBASE_FLD_MAX_WIDTH;
-
-/* -------------------------------------------------------------------- */
-/*      Assign the new field information fields.                        */
-/* -------------------------------------------------------------------- */
-    psDBF->panFieldSize[iField] = nWidth;
-    psDBF->panFieldDecimals[iField] = nDecimals;
-    psDBF->pachFieldType[iField] = chType;
+    }
 
 /* -------------------------------------------------------------------- */
-/*      Update the header information.                                  */
+/*      Lay out the new records and header.                             */
 /* -------------------------------------------------------------------- */
-    char* pszFInfo = psDBF->pszHeader + XBASE_FLDHDR_SZ * iField;
-
-    for( int i = 0; i < XBASE_FLDHDR_SZ; i++ )
-        pszFInfo[i] = '\0';
-
-    strncpy( pszFInfo, pszFieldName, XBASE_FLDNAME_LEN_WRITE );
-
-    pszFInfo[11] = psDBF->pachFieldType[iField];
+    DBFSchemaLayout sLayout;
+    sLayout.fp = psDBF->fp;
+    sLayout.nFields = nFields;
+    sLayout.nHeaderLength = psDBF->nHeaderLength +
+                            (nFields - psDBF->nFields) * XBASE_FLDHDR_SZ;
+    sLayout.nRecordLength = 1;
+    for( int i = 0; i < nFields; i++ )
+        sLayout.nRecordLength += psEdit->pasFields[i].nWidth;
+
+    if( sLayout.nHeaderLength > 65535 || sLayout.nRecordLength > 65535 )
+    {
+        char szMessage[128];
+        snprintf( szMessage, sizeof(szMessage),
+                  "Cannot change fields. %s length limit reached "
+                  "(max 65535 bytes).",
+                  sLayout.nHeaderLength > 65535 ? "Header" : "Record" );
+        psDBF->sHooks.Error( szMessage );
+        goDBFDestroySchemaEdit( psEdit );
+        return FALSE;
+    }
 
-    if( chType == 'C' )
+    sLayout.panFieldOffset = STATIC_CAST(int *, malloc(sizeof(int) * (nFields + 1)));
+    sLayout.panFieldSize = STATIC_CAST(int *, malloc(sizeof(int) * (nFields + 1)));
+    sLayout.panFieldDecimals = STATIC_CAST(int *, malloc(sizeof(int) * (nFields + 1)));
+    sLayout.pachFieldType = STATIC_CAST(char *, malloc(sizeof(char) * (nFields + 1)));
+    sLayout.pszHeader = STATIC_CAST(char *,
+        malloc(sizeof(char) * XBASE_FLDHDR_SZ * (nFields + 1)));
+    char *pszRecord = STATIC_CAST(char *,
+        realloc(psDBF->pszCurrentRecord, sLayout.nRecordLength > psDBF->nRecordLength ?
+                                         sLayout.nRecordLength : psDBF->nRecordLength));
+    if( pszRecord != SHPLIB_NULLPTR )
+        psDBF->pszCurrentRecord = pszRecord;
+    if( sLayout.panFieldOffset == SHPLIB_NULLPTR ||
+        sLayout.panFieldSize == SHPLIB_NULLPTR ||
+        sLayout.panFieldDecimals == SHPLIB_NULLPTR ||
+        sLayout.pachFieldType == SHPLIB_NULLPTR ||
+        sLayout.pszHeader == SHPLIB_NULLPTR || pszRecord == SHPLIB_NULLPTR )
     {
-        pszFInfo[16] = STATIC_CAST(unsigned char, nWidth % 256);
-        pszFInfo[17] = STATIC_CAST(unsigned char, nWidth / 256);
+        DBFSchemaFreeLayout( &sLayout );
+        goDBFDestroySchemaEdit( psEdit );
+        return FALSE;
     }
-    else
+
+    bool bSameRecords = nFields == psDBF->nFields;
+    for( int i = 0; i < nFields; i++ )
     {
-        pszFInfo[16] = STATIC_CAST(unsigned char, nWidth);
-        pszFInfo[17] = STATIC_CAST(unsigned char, nDecimals);
+        const DBFSchemaField *psField = psEdit->pasFields + i;
+        sLayout.panFieldOffset[i] = i == 0 ? 1 :
+            sLayout.panFieldOffset[i - 1] + sLayout.panFieldSize[i - 1];
+        sLayout.panFieldSize[i] = psField->nWidth;
+        sLayout.panFieldDecimals[i] = psField->nDecimals;
+        sLayout.pachFieldType[i] = psField->chType;
+        memcpy( sLayout.pszHeader + i * XBASE_FLDHDR_SZ, psField->achDescriptor,
+                XBASE_FLDHDR_SZ );
+
+        if( psField->iSource != i || psField->chType != psDBF->pachFieldType[i] ||
+            psField->nWidth != psDBF->panFieldSize[i] )
+            bSameRecords = false;
     }
 
 /* -------------------------------------------------------------------- */
-/*      Update offsets                                                  */
+/*      A table without a header yet has no records to move.            */
 /* -------------------------------------------------------------------- */
-    if (nWidth != nOldWidth)
+    if( psDBF->bNoHeader && psDBF->nRecords == 0 )
     {
-        for (int i = iField + 1; i < psDBF->nFields; i++)
-             psDBF->panFieldOffset[i] += nWidth - nOldWidth;
-        psDBF->nRecordLength += nWidth - nOldWidth;
-
-        psDBF->pszCurrentRecord = STATIC_CAST(char *, realloc(psDBF->pszCurrentRecord,
-                                                     psDBF->nRecordLength));
-    }
-
-    /* we're done if we're dealing with not yet created .dbf */
-    if ( psDBF->bNoHeader && psDBF->nRecords == 0 )
+        DBFSchemaSwap( psDBF, &sLayout );
+        DBFSchemaFreeLayout( &sLayout );
+        goDBFDestroySchemaEdit( psEdit );
+        goDBFSetProjection( psDBF, SHPLIB_NULLPTR, 0 );
         return TRUE;
+    }
 
-    /* force update of header with new header and record length */
-    psDBF->bNoHeader = TRUE;
-    goDBFUpdateHeader( psDBF );
-
-    bool errorAbort = false;
-
-    if (nWidth < nOldWidth || (nWidth == nOldWidth && chType != chOldType))
+/* -------------------------------------------------------------------- */
+/*      Write the records, then the header, in the new file or in       */
+/*      place.                                                          */
+/* -------------------------------------------------------------------- */
+    char *pszTmpFile = SHPLIB_NULLPTR;
+    if( pszFilename != SHPLIB_NULLPTR )
     {
-        char* pszRecord = STATIC_CAST(char *, malloc(sizeof(char) * nOldRecordLength));
-        char* pszOldField = STATIC_CAST(char *, malloc(sizeof(char) * (nOldWidth + 1)));
-
-        /* cppcheck-suppress uninitdata */
-        pszOldField[nOldWidth] = 0;
-
-        /* move records to their new positions */
-        for (int iRecord = 0; iRecord < psDBF->nRecords; iRecord++)
+        pszTmpFile = STATIC_CAST(char *, malloc(strlen(pszFilename) + 5));
+        if( pszTmpFile != SHPLIB_NULLPTR )
         {
-            SAOffset nRecordOffset =
-                nOldRecordLength * STATIC_CAST(SAOffset,iRecord) + psDBF->nHeaderLength;
-
-            /* load record */
-            psDBF->sHooks.FSeek( psDBF->fp, nRecordOffset, 0 );
-            if (psDBF->sHooks.FRead( pszRecord, nOldRecordLength, 1, psDBF->fp ) != 1) {
-              errorAbort = true;
-              break;
-            }
-
-            memcpy(pszOldField, pszRecord + nOffset, nOldWidth);
-            const bool bIsNULL = DBFIsValueNULL( chOldType, pszOldField );
-
-            if (nWidth != nOldWidth)
-            {
-                if ((chOldType == 'N' || chOldType == 'F' || chOldType == 'D') && pszOldField[0] == ' ')
-                {
-                    /* Strip leading spaces when truncating a numeric field */
-                    memmove( pszRecord + nOffset,
-                            pszRecord + nOffset + nOldWidth - nWidth,
-                            nWidth );
-                }
-                if (nOffset + nOldWidth < nOldRecordLength)
-                {
-                    memmove( pszRecord + nOffset + nWidth,
-                            pszRecord + nOffset + nOldWidth,
-                            nOldRecordLength - (nOffset + nOldWidth));
-                }
-            }
-
-            /* Convert null value to the appropriate value of the new type */
-            if (bIsNULL)
-            {
-                memset( pszRecord + nOffset, chFieldFill, nWidth);
-            }
+            sprintf( pszTmpFile, "%s.tmp", pszFilename );
+            sLayout.fp = psDBF->sHooks.FOpen( pszTmpFile, "wb+" );
+        }
+        if( pszTmpFile == SHPLIB_NULLPTR || sLayout.fp == SHPLIB_NULLPTR )
+        {
+            char szMessage[128];
+            snprintf( szMessage, sizeof(szMessage),
+                      "Cannot create %.100s.tmp.", pszFilename );
+            psDBF->sHooks.Error( szMessage );
+            free( pszTmpFile );
+            DBFSchemaFreeLayout( &sLayout );
+            goDBFDestroySchemaEdit( psEdit );
+            return FALSE;
+        }
+    }
 
-            nRecordOffset =
-                psDBF->nRecordLength * STATIC_CAST(SAOffset,iRecord) + psDBF->nHeaderLength;
+    bool bOK = true;
+    if( pszTmpFile != SHPLIB_NULLPTR || !bSameRecords )
+        bOK = DBFSchemaRewrite( psEdit, sLayout.panFieldOffset, sLayout.fp,
+                                sLayout.nHeaderLength, sLayout.nRecordLength );
+    goDBFDestroySchemaEdit( psEdit );
 
-            /* write record */
-            psDBF->sHooks.FSeek( psDBF->fp, nRecordOffset, 0 );
-            psDBF->sHooks.FWrite( pszRecord, psDBF->nRecordLength, 1, psDBF->fp );
-        }
+    DBFSchemaSwap( psDBF, &sLayout );
+    if( bOK )
+    {
+        psDBF->bNoHeader = TRUE;
+        goDBFUpdateHeader( psDBF );
 
-        if( !errorAbort && psDBF->bWriteEndOfFileChar )
+        if( psDBF->bWriteEndOfFileChar )
         {
             char ch = END_OF_FILE_CHARACTER;
+            const SAOffset nEOFOffset = psDBF->nHeaderLength +
+                STATIC_CAST(SAOffset, psDBF->nRecords) * psDBF->nRecordLength;
 
-            SAOffset nRecordOffset =
-                psDBF->nRecordLength * STATIC_CAST(SAOffset,psDBF->nRecords) + psDBF->nHeaderLength;
-
-            psDBF->sHooks.FSeek( psDBF->fp, nRecordOffset, 0 );
+            psDBF->sHooks.FSeek( psDBF->fp, nEOFOffset, 0 );
             psDBF->sHooks.FWrite( &ch, 1, 1, psDBF->fp );
         }
-        /* TODO: truncate file */
-
-        free(pszRecord);
-        free(pszOldField);
     }
-    else if (nWidth > nOldWidth)
-    {
-        char* pszRecord = STATIC_CAST(char *, malloc(sizeof(char) * psDBF->nRecordLength));
-        char* pszOldField = STATIC_CAST(char *, malloc(sizeof(char) * (nOldWidth + 1)));
 
-        /* cppcheck-suppress uninitdata */
-        pszOldField[nOldWidth] = 0;
+    bool bReplaced = false;
+    if( pszTmpFile != SHPLIB_NULLPTR )
+    {
+        /* the handle has the new file now, and sLayout the old one */
+        if( psDBF->sHooks.FClose( psDBF->fp ) != 0 )
+            bOK = false;
+        psDBF->fp = SHPLIB_NULLPTR;
 
-        /* move records to their new positions */
-        for (int iRecord = psDBF->nRecords - 1; iRecord >= 0; iRecord--)
+        if( bOK )
         {
-            SAOffset nRecordOffset =
-                nOldRecordLength * STATIC_CAST(SAOffset,iRecord) + psDBF->nHeaderLength;
-
-            /* load record */
-            psDBF->sHooks.FSeek( psDBF->fp, nRecordOffset, 0 );
-            if (psDBF->sHooks.FRead( pszRecord, nOldRecordLength, 1, psDBF->fp )!= 1) {
-              errorAbort = true;
-              break;
-            }
-
-            memcpy(pszOldField, pszRecord + nOffset, nOldWidth);
-            const bool bIsNULL = DBFIsValueNULL( chOldType, pszOldField );
-
-            if (nOffset + nOldWidth < nOldRecordLength)
+            psDBF->sHooks.FClose( sLayout.fp );
+            bReplaced = DBFSchemaReplaceFile( pszTmpFile, pszFilename );
+            sLayout.fp = psDBF->sHooks.FOpen( pszFilename, "rb+" );
+            if( bReplaced )
+                psDBF->fp = sLayout.fp;
+            if( !bReplaced || psDBF->fp == SHPLIB_NULLPTR )
             {
-                memmove( pszRecord + nOffset + nWidth,
-                         pszRecord + nOffset + nOldWidth,
-                         nOldRecordLength - (nOffset + nOldWidth));
-            }
-
-            /* Convert null value to the appropriate value of the new type */
-            if (bIsNULL)
-            {
-                memset( pszRecord + nOffset, chFieldFill, nWidth);
-            }
-            else
-            {
-                if ((chOldType == 'N' || chOldType == 'F'))
-                {
-                    /* Add leading spaces when expanding a numeric field */
-                    memmove( pszRecord + nOffset + nWidth - nOldWidth,
-                             pszRecord + nOffset, nOldWidth );
-                    memset( pszRecord + nOffset, ' ', nWidth - nOldWidth );
-                }
-                else
-                {
-                    /* Add trailing spaces */
-                    memset(pszRecord + nOffset + nOldWidth, ' ', nWidth - nOldWidth);
-                }
+                char szMessage[128];
+                snprintf( szMessage, sizeof(szMessage),
+                          "Cannot replace %.100s.", pszFilename );
+                psDBF->sHooks.Error( szMessage );
+                bOK = false;
             }
-
-            nRecordOffset =
-                psDBF->nRecordLength * STATIC_CAST(SAOffset,iRecord) + psDBF->nHeaderLength;
-
-            /* write record */
-            psDBF->sHooks.FSeek( psDBF->fp, nRecordOffset, 0 );
-            psDBF->sHooks.FWrite( pszRecord, psDBF->nRecordLength, 1, psDBF->fp );
-        }
-
-        if( !errorAbort && psDBF->bWriteEndOfFileChar )
-        {
-            char ch = END_OF_FILE_CHARACTER;
-
-            SAOffset nRecordOffset =
-                psDBF->nRecordLength * STATIC_CAST(SAOffset,psDBF->nRecords) + psDBF->nHeaderLength;
-
-            psDBF->sHooks.FSeek( psDBF->fp, nRecordOffset, 0 );
-            psDBF->sHooks.FWrite( &ch, 1, 1, psDBF->fp );
         }
 
-        free(pszRecord);
-        free(pszOldField);
+        if( !bReplaced )
+            psDBF->sHooks.Remove( pszTmpFile );
+        free( pszTmpFile );
     }
 
-    if (errorAbort) {
-      psDBF->nCurrentRecord = -1;
-      psDBF->bCurrentRecordModified = TRUE;
-      psDBF->bUpdated = FALSE;
+    /* once replaced, the file has the new fields whatever happens */
+    if( !bOK && !bReplaced )
+        DBFSchemaSwap( psDBF, &sLayout );
+    DBFSchemaFreeLayout( &sLayout );
 
-      return FALSE;
-    }
     psDBF->nCurrentRecord = -1;
+    psDBF->nReadAheadCount = 0;
+    goDBFSetProjection( psDBF, SHPLIB_NULLPTR, 0 );
     psDBF->bCurrentRecordModified = FALSE;
-    psDBF->bUpdated = TRUE;
-
-    return TRUE;
-}
-
-/************************************************************************/
-/*                    goDBFSetWriteEndOfFileChar()                        */
-/************************************************************************/
+    if( bOK )
+        psDBF->bUpdated = TRUE;
 
-void SHPAPI_CALL goDBFSetWriteEndOfFileChar( DBFHandle psDBF, int bWriteFlag )
-{
-    psDBF->bWriteEndOfFileChar = bWriteFlag;
+    return bOK ? TRUE : FALSE;
 }
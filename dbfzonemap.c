@@ -0,0 +1,728 @@
+/******************************************************************************
+ *
+ * Project:  Shapelib
+ * Purpose:  Per block statistics of .dbf files, for skipping the blocks of
+ *           records a filter cannot match.
+ *
+ ******************************************************************************
+ *
+ * This software is available under the following "MIT Style" license,
+ * or at the option of the licensee under the LGPL (see COPYING).  This
+ * option is discussed in more detail in shapelib.html.
+ *
+ * --
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************
+ *
+ * A zone map splits the records in blocks of a fixed count and keeps for
+ * every field of every block the number of NULL values, and
+ *
+ *  - for N, F and D fields, the number of values that parse as numbers and
+ *    their minimum and maximum (dates as the number YYYYMMDD);
+ *
+ *  - for the other fields, a 2048 bit bloom filter of the values without
+ *    their surrounding blanks (their first character for L fields).
+ *
+ * The goDBFZoneMapMayMatch*() functions tell from these whether any record
+ * of a block may satisfy a comparison; goDBFFilterSelectEx() uses them to
+ * skip whole blocks without reading them.  The statistics describe the file
+ * they were computed from and must be recomputed after it is modified.
+ *
+ * All the values of the file are little endian:
+ *
+ *   Bytes 0-3    "DBZ" and the version, 1
+ *   Bytes 4-23   record count, record length, field count, records per
+ *                block and block count
+ *   Bytes 24-63  reserved
+ *
+ * followed by the type (1 byte), a reserved byte and the width (2 bytes)
+ * of each field, then by the statistics of the fields of each block: the
+ * NULL count, then either the number count, minimum and maximum or the
+ * bloom filter.
+ */
+
+#include "shapefil.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+SHP_CVSID("$Id$")
+
+#ifndef FALSE
+#  define FALSE		0
+#  define TRUE		1
+#endif
+
+#ifdef __cplusplus
+#define STATIC_CAST(type,x) static_cast<type>(x)
+#define REINTERPRET_CAST(type,x) reinterpret_cast<type>(x)
+#define SHPLIB_NULLPTR nullptr
+#else
+#define STATIC_CAST(type,x) ((type)(x))
+#define REINTERPRET_CAST(type,x) ((type)(x))
+#define SHPLIB_NULLPTR NULL
+#endif
+
+#define DBZ_HEADER_SIZE     64
+#define DBZ_DEFAULT_BLOCK   65536
+#define DBZ_BLOOM_BITS      2048
+#define DBZ_BLOOM_HASHES    3
+#define DBZ_NUMERIC_SIZE    (4 + 4 + 8 + 8)
+#define DBZ_BLOOM_SIZE      (4 + DBZ_BLOOM_BITS / 8)
+
+/* records read at a time while computing the statistics */
+#define DBZ_READ_BLOCK      (1024 * 1024)
+
+struct DBFZoneMapInfo
+{
+    int         nRecords;
+    int         nFields;
+    int         nBlockRecords;
+    int         nBlocks;
+
+    char        *pachFieldType;
+    int         *panStatsOffset;   /* of each field within a block */
+    int         nBlockSize;        /* bytes of statistics per block */
+
+    unsigned char *pabyStats;
+};
+
+/************************************************************************/
+/*                   Little endian (de)serialization.                   */
+/************************************************************************/
+
+static bool DBFZoneMapBigEndian( void )
+{
+    const int i = 1;
+    return *REINTERPRET_CAST(const unsigned char *, &i) != 1;
+}
+
+static void DBFZoneMapSwap( unsigned char *pabyWord, int nLength )
+{
+    for( int i = 0; i < nLength / 2; i++ )
+    {
+        const unsigned char byTemp = pabyWord[i];
+        pabyWord[i] = pabyWord[nLength - i - 1];
+        pabyWord[nLength - i - 1] = byTemp;
+    }
+}
+
+static void DBFZoneMapPutInt( unsigned char *pabyDst, int nValue )
+{
+    memcpy( pabyDst, &nValue, 4 );
+    if( DBFZoneMapBigEndian() )
+        DBFZoneMapSwap( pabyDst, 4 );
+}
+
+static int DBFZoneMapGetInt( const unsigned char *pabySrc )
+{
+    unsigned char abyWord[4];
+    memcpy( abyWord, pabySrc, 4 );
+    if( DBFZoneMapBigEndian() )
+        DBFZoneMapSwap( abyWord, 4 );
+
+    int nValue;
+    memcpy( &nValue, abyWord, 4 );
+    return nValue;
+}
+
+static void DBFZoneMapPutDouble( unsigned char *pabyDst, double dfValue )
+{
+    memcpy( pabyDst, &dfValue, 8 );
+    if( DBFZoneMapBigEndian() )
+        DBFZoneMapSwap( pabyDst, 8 );
+}
+
+static double DBFZoneMapGetDouble( const unsigned char *pabySrc )
+{
+    unsigned char abyWord[8];
+    memcpy( abyWord, pabySrc, 8 );
+    if( DBFZoneMapBigEndian() )
+        DBFZoneMapSwap( abyWord, 8 );
+
+    double dfValue;
+    memcpy( &dfValue, abyWord, 8 );
+    return dfValue;
+}
+
+/************************************************************************/
+/*                         DBFZoneMapNumeric()                          */
+/************************************************************************/
+
+static bool DBFZoneMapNumeric( char chType )
+{
+    return chType == 'N' || chType == 'F' || chType == 'D';
+}
+
+/************************************************************************/
+/*                          DBFZoneMapTrim()                            */
+/*                                                                      */
+/*      The value of a field for the bloom filter: the field bytes      */
+/*      without surrounding blanks, only the first for L fields.        */
+/************************************************************************/
+
+static const char *DBFZoneMapTrim( char chType, const char *pachField,
+                                   int nWidth, int *pnLength )
+{
+    const char *pchEnd = STATIC_CAST(const char *, memchr(pachField, '\0', nWidth));
+    if( pchEnd == SHPLIB_NULLPTR )
+        pchEnd = pachField + nWidth;
+
+    while( pachField < pchEnd && *pachField == ' ' )
+        pachField++;
+    while( pchEnd > pachField && pchEnd[-1] == ' ' )
+        pchEnd--;
+
+    *pnLength = STATIC_CAST(int, pchEnd - pachField);
+    if( chType == 'L' && *pnLength > 1 )
+        *pnLength = 1;
+    return pachField;
+}
+
+/************************************************************************/
+/*                         DBFZoneMapBloomBits()                        */
+/*                                                                      */
+/*      The bits of a value in the bloom filter, by double hashing a    */
+/*      64 bit FNV-1a hash.                                             */
+/************************************************************************/
+
+static void DBFZoneMapBloomBits( const char *pachValue, int nLength,
+                                 int *panBits )
+{
+    uint64_t nHash = UINT64_C(14695981039346656037);
+    for( int i = 0; i < nLength; i++ )
+    {
+        nHash ^= STATIC_CAST(unsigned char, pachValue[i]);
+        nHash *= UINT64_C(1099511628211);
+    }
+
+    const uint32_t nHash1 = STATIC_CAST(uint32_t, nHash);
+    const uint32_t nHash2 = STATIC_CAST(uint32_t, nHash >> 32) | 1;
+    for( int i = 0; i < DBZ_BLOOM_HASHES; i++ )
+        panBits[i] = STATIC_CAST(int, (nHash1 + STATIC_CAST(uint32_t, i) * nHash2)
+                                 % DBZ_BLOOM_BITS);
+}
+
+/************************************************************************/
+/*                          DBFZoneMapLayout()                          */
+/*                                                                      */
+/*      Place the statistics of each field within a block.              */
+/************************************************************************/
+
+static bool DBFZoneMapLayout( DBFZoneMapHandle psZoneMap )
+{
+    psZoneMap->panStatsOffset = STATIC_CAST(int *,
+        malloc(sizeof(int) * (STATIC_CAST(size_t, psZoneMap->nFields) + 1)));
+    if( psZoneMap->panStatsOffset == SHPLIB_NULLPTR )
+        return false;
+
+    psZoneMap->nBlockSize = 0;
+    for( int iField = 0; iField < psZoneMap->nFields; iField++ )
+    {
+        psZoneMap->panStatsOffset[iField] = psZoneMap->nBlockSize;
+        psZoneMap->nBlockSize +=
+            DBFZoneMapNumeric( psZoneMap->pachFieldType[iField] ) ?
+            DBZ_NUMERIC_SIZE : DBZ_BLOOM_SIZE;
+    }
+    return true;
+}
+
+/************************************************************************/
+/*                         goDBFCloseZoneMap()                          */
+/************************************************************************/
+
+void SHPAPI_CALL
+goDBFCloseZoneMap( DBFZoneMapHandle psZoneMap )
+{
+    if( psZoneMap == SHPLIB_NULLPTR )
+        return;
+
+    free( psZoneMap->pachFieldType );
+    free( psZoneMap->panStatsOffset );
+    free( psZoneMap->pabyStats );
+    free( psZoneMap );
+}
+
+/************************************************************************/
+/*                         DBFZoneMapCompute()                          */
+/*                                                                      */
+/*      Compute the statistics of all the blocks of psDBF.              */
+/************************************************************************/
+
+static DBFZoneMapHandle DBFZoneMapCompute( DBFHandle psDBF, int nBlockRecords )
+{
+    DBFZoneMapHandle psZoneMap = STATIC_CAST(DBFZoneMapHandle,
+        calloc(1, sizeof(struct DBFZoneMapInfo)));
+    if( psZoneMap == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+    psZoneMap->nRecords = psDBF->nRecords;
+    psZoneMap->nFields = psDBF->nFields;
+    psZoneMap->nBlockRecords = nBlockRecords;
+    psZoneMap->nBlocks = (psDBF->nRecords + nBlockRecords - 1) / nBlockRecords;
+    psZoneMap->pachFieldType = STATIC_CAST(char *, malloc(psDBF->nFields + 1));
+    if( psZoneMap->pachFieldType == SHPLIB_NULLPTR )
+    {
+        goDBFCloseZoneMap( psZoneMap );
+        return SHPLIB_NULLPTR;
+    }
+    memcpy( psZoneMap->pachFieldType, psDBF->pachFieldType, psDBF->nFields );
+
+    int nReadRecords = DBZ_READ_BLOCK / psDBF->nRecordLength;
+    if( nReadRecords < 1 )
+        nReadRecords = 1;
+    if( nReadRecords > nBlockRecords )
+        nReadRecords = nBlockRecords;
+
+    char *pabyRead = STATIC_CAST(char *,
+        malloc(STATIC_CAST(size_t, nReadRecords) * psDBF->nRecordLength));
+    if( !DBFZoneMapLayout( psZoneMap ) || pabyRead == SHPLIB_NULLPTR ||
+        (psZoneMap->pabyStats = STATIC_CAST(unsigned char *,
+            calloc(STATIC_CAST(size_t, psZoneMap->nBlocks) + 1,
+                   psZoneMap->nBlockSize + 1))) == SHPLIB_NULLPTR )
+    {
+        free( pabyRead );
+        goDBFCloseZoneMap( psZoneMap );
+        return SHPLIB_NULLPTR;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Accumulate the statistics of each block, reading whole records  */
+/*      within the block at a time.                                     */
+/* -------------------------------------------------------------------- */
+    for( int iBlock = 0; iBlock < psZoneMap->nBlocks; iBlock++ )
+    {
+        unsigned char *pabyBlock = psZoneMap->pabyStats
+            + STATIC_CAST(size_t, iBlock) * psZoneMap->nBlockSize;
+        const int iFirst = iBlock * nBlockRecords;
+        int nRecords = psDBF->nRecords - iFirst;
+        if( nRecords > nBlockRecords )
+            nRecords = nBlockRecords;
+
+        for( int iDone = 0; iDone < nRecords; )
+        {
+            int nRead = nRecords - iDone;
+            if( nRead > nReadRecords )
+                nRead = nReadRecords;
+
+            const char *pabyRecords =
+                goDBFReadRecords( psDBF, iFirst + iDone, nRead, pabyRead );
+            if( pabyRecords == SHPLIB_NULLPTR )
+            {
+                free( pabyRead );
+                goDBFCloseZoneMap( psZoneMap );
+                return SHPLIB_NULLPTR;
+            }
+
+            for( int iField = 0; iField < psDBF->nFields; iField++ )
+            {
+                const char chType = psDBF->pachFieldType[iField];
+                const int nWidth = psDBF->panFieldSize[iField];
+                const char *pachFields = pabyRecords + psDBF->panFieldOffset[iField];
+                unsigned char *pabyField = pabyBlock + psZoneMap->panStatsOffset[iField];
+
+                int nNulls = DBFZoneMapGetInt( pabyField );
+                if( DBFZoneMapNumeric( chType ) )
+                {
+                    int nValues = DBFZoneMapGetInt( pabyField + 4 );
+                    double dfMin = DBFZoneMapGetDouble( pabyField + 8 );
+                    double dfMax = DBFZoneMapGetDouble( pabyField + 16 );
+
+                    for( int i = 0; i < nRead; i++ )
+                    {
+                        const char *pachField = pachFields
+                            + STATIC_CAST(size_t, i) * psDBF->nRecordLength;
+                        double dfValue;
+                        if( goDBFIsRawValueNULL( chType, pachField, nWidth ) )
+                            nNulls++;
+                        if( !goDBFParseDouble( pachField, nWidth, &dfValue ) ||
+                            dfValue != dfValue )
+                            continue;
+                        if( nValues == 0 || dfValue < dfMin )
+                            dfMin = dfValue;
+                        if( nValues == 0 || dfValue > dfMax )
+                            dfMax = dfValue;
+                        nValues++;
+                    }
+
+                    DBFZoneMapPutInt( pabyField + 4, nValues );
+                    DBFZoneMapPutDouble( pabyField + 8, dfMin );
+                    DBFZoneMapPutDouble( pabyField + 16, dfMax );
+                }
+                else
+                {
+                    unsigned char *pabyBloom = pabyField + 4;
+                    for( int i = 0; i < nRead; i++ )
+                    {
+                        const char *pachField = pachFields
+                            + STATIC_CAST(size_t, i) * psDBF->nRecordLength;
+                        if( goDBFIsRawValueNULL( chType, pachField, nWidth ) )
+                        {
+                            nNulls++;
+                            continue;
+                        }
+
+                        int nLength;
+                        int anBits[DBZ_BLOOM_HASHES];
+                        const char *pachValue =
+                            DBFZoneMapTrim( chType, pachField, nWidth, &nLength );
+                        DBFZoneMapBloomBits( pachValue, nLength, anBits );
+                        for( int k = 0; k < DBZ_BLOOM_HASHES; k++ )
+                            pabyBloom[anBits[k] >> 3] |=
+                                STATIC_CAST(unsigned char, 1 << (anBits[k] & 7));
+                    }
+                }
+                DBFZoneMapPutInt( pabyField, nNulls );
+            }
+
+            iDone += nRead;
+        }
+    }
+
+    free( pabyRead );
+    return psZoneMap;
+}
+
+/************************************************************************/
+/*                         goDBFCreateZoneMap()                         */
+/*                                                                      */
+/*      Compute the statistics of every nBlockRecords records (65536    */
+/*      if 0) of psDBF, and write them to pszZoneMapFile.               */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFCreateZoneMap( DBFHandle psDBF, const char *pszZoneMapFile,
+                    int nBlockRecords )
+{
+    if( nBlockRecords <= 0 )
+        nBlockRecords = DBZ_DEFAULT_BLOCK;
+
+    DBFZoneMapHandle psZoneMap = DBFZoneMapCompute( psDBF, nBlockRecords );
+    if( psZoneMap == SHPLIB_NULLPTR )
+        return FALSE;
+
+    SAFile fp = psDBF->sHooks.FOpen( pszZoneMapFile, "wb" );
+    if( fp == SHPLIB_NULLPTR )
+    {
+        char szMessage[256];
+        snprintf( szMessage, sizeof(szMessage),
+                  "Unable to create zone map file %s.", pszZoneMapFile );
+        psDBF->sHooks.Error( szMessage );
+        goDBFCloseZoneMap( psZoneMap );
+        return FALSE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Header and field types.                                         */
+/* -------------------------------------------------------------------- */
+    unsigned char abyHeader[DBZ_HEADER_SIZE];
+    memset( abyHeader, 0, sizeof(abyHeader) );
+    memcpy( abyHeader, "DBZ", 3 );
+    abyHeader[3] = 1;
+    DBFZoneMapPutInt( abyHeader + 4, psDBF->nRecords );
+    DBFZoneMapPutInt( abyHeader + 8, psDBF->nRecordLength );
+    DBFZoneMapPutInt( abyHeader + 12, psDBF->nFields );
+    DBFZoneMapPutInt( abyHeader + 16, nBlockRecords );
+    DBFZoneMapPutInt( abyHeader + 20, psZoneMap->nBlocks );
+
+    bool bOK = psDBF->sHooks.FWrite( abyHeader, DBZ_HEADER_SIZE, 1, fp ) == 1;
+    for( int iField = 0; bOK && iField < psDBF->nFields; iField++ )
+    {
+        unsigned char abyField[4];
+        abyField[0] = STATIC_CAST(unsigned char, psDBF->pachFieldType[iField]);
+        abyField[1] = 0;
+        abyField[2] = STATIC_CAST(unsigned char, psDBF->panFieldSize[iField] & 0xff);
+        abyField[3] = STATIC_CAST(unsigned char, psDBF->panFieldSize[iField] >> 8);
+        bOK = psDBF->sHooks.FWrite( abyField, 4, 1, fp ) == 1;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Statistics.                                                     */
+/* -------------------------------------------------------------------- */
+    if( bOK && psZoneMap->nBlocks > 0 )
+        bOK = STATIC_CAST(int, psDBF->sHooks.FWrite( psZoneMap->pabyStats,
+                                                     psZoneMap->nBlockSize,
+                                                     psZoneMap->nBlocks, fp ))
+            == psZoneMap->nBlocks;
+
+    psDBF->sHooks.FClose( fp );
+    goDBFCloseZoneMap( psZoneMap );
+
+    if( !bOK )
+    {
+        psDBF->sHooks.Error( "Failure writing zone map file." );
+        psDBF->sHooks.Remove( pszZoneMapFile );
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                          goDBFOpenZoneMap()                          */
+/*                                                                      */
+/*      Load the statistics written by goDBFCreateZoneMap() for psDBF,  */
+/*      which must still have the same fields and number of records.    */
+/************************************************************************/
+
+DBFZoneMapHandle SHPAPI_CALL
+goDBFOpenZoneMap( DBFHandle psDBF, const char *pszZoneMapFile )
+{
+    SAFile fp = psDBF->sHooks.FOpen( pszZoneMapFile, "rb" );
+    if( fp == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+/* -------------------------------------------------------------------- */
+/*      Check the header and fields against the .dbf file.              */
+/* -------------------------------------------------------------------- */
+    unsigned char abyHeader[DBZ_HEADER_SIZE];
+    bool bOK = psDBF->sHooks.FRead( abyHeader, DBZ_HEADER_SIZE, 1, fp ) == 1 &&
+        memcmp( abyHeader, "DBZ", 3 ) == 0 && abyHeader[3] == 1 &&
+        DBFZoneMapGetInt( abyHeader + 4 ) == psDBF->nRecords &&
+        DBFZoneMapGetInt( abyHeader + 8 ) == psDBF->nRecordLength &&
+        DBFZoneMapGetInt( abyHeader + 12 ) == psDBF->nFields;
+
+    const int nBlockRecords = bOK ? DBFZoneMapGetInt( abyHeader + 16 ) : 0;
+    const int nBlocks = bOK ? DBFZoneMapGetInt( abyHeader + 20 ) : 0;
+    bOK = bOK && nBlockRecords > 0 &&
+        nBlocks == (psDBF->nRecords + nBlockRecords - 1) / nBlockRecords;
+
+    for( int iField = 0; bOK && iField < psDBF->nFields; iField++ )
+    {
+        unsigned char abyField[4];
+        bOK = psDBF->sHooks.FRead( abyField, 4, 1, fp ) == 1 &&
+            abyField[0] == STATIC_CAST(unsigned char, psDBF->pachFieldType[iField]) &&
+            (abyField[2] | (abyField[3] << 8)) == psDBF->panFieldSize[iField];
+    }
+
+    if( !bOK )
+    {
+        char szMessage[256];
+        snprintf( szMessage, sizeof(szMessage),
+                  "Zone map file %s does not match the DBF file.", pszZoneMapFile );
+        psDBF->sHooks.Error( szMessage );
+        psDBF->sHooks.FClose( fp );
+        return SHPLIB_NULLPTR;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Load the statistics.                                            */
+/* -------------------------------------------------------------------- */
+    DBFZoneMapHandle psZoneMap = STATIC_CAST(DBFZoneMapHandle,
+        calloc(1, sizeof(struct DBFZoneMapInfo)));
+    if( psZoneMap == SHPLIB_NULLPTR )
+    {
+        psDBF->sHooks.FClose( fp );
+        return SHPLIB_NULLPTR;
+    }
+    psZoneMap->nRecords = psDBF->nRecords;
+    psZoneMap->nFields = psDBF->nFields;
+    psZoneMap->nBlockRecords = nBlockRecords;
+    psZoneMap->nBlocks = nBlocks;
+    psZoneMap->pachFieldType = STATIC_CAST(char *, malloc(psDBF->nFields + 1));
+
+    bOK = psZoneMap->pachFieldType != SHPLIB_NULLPTR;
+    if( bOK )
+    {
+        memcpy( psZoneMap->pachFieldType, psDBF->pachFieldType, psDBF->nFields );
+        bOK = DBFZoneMapLayout( psZoneMap );
+    }
+    if( bOK )
+    {
+        psZoneMap->pabyStats = STATIC_CAST(unsigned char *,
+            malloc(STATIC_CAST(size_t, nBlocks) * psZoneMap->nBlockSize + 1));
+        bOK = psZoneMap->pabyStats != SHPLIB_NULLPTR &&
+            (nBlocks == 0 ||
+             STATIC_CAST(int, psDBF->sHooks.FRead( psZoneMap->pabyStats,
+                                                   psZoneMap->nBlockSize,
+                                                   nBlocks, fp )) == nBlocks);
+    }
+    psDBF->sHooks.FClose( fp );
+
+    if( !bOK )
+    {
+        psDBF->sHooks.Error( "Failure reading zone map file." );
+        goDBFCloseZoneMap( psZoneMap );
+        return SHPLIB_NULLPTR;
+    }
+
+    return psZoneMap;
+}
+
+/************************************************************************/
+/*                      goDBFZoneMapGetBlockRecords()                   */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFZoneMapGetBlockRecords( DBFZoneMapHandle psZoneMap )
+{
+    return psZoneMap->nBlockRecords;
+}
+
+/************************************************************************/
+/*                          DBFZoneMapStats()                           */
+/*                                                                      */
+/*      The statistics of a field in a block, or NULL if out of range.  */
+/*      *pnRecords receives the number of records of the block.         */
+/************************************************************************/
+
+static const unsigned char *DBFZoneMapStats( DBFZoneMapHandle psZoneMap,
+                                             int iBlock, int iField,
+                                             int *pnRecords )
+{
+    if( iBlock < 0 || iBlock >= psZoneMap->nBlocks ||
+        iField < 0 || iField >= psZoneMap->nFields )
+        return SHPLIB_NULLPTR;
+
+    *pnRecords = psZoneMap->nRecords - iBlock * psZoneMap->nBlockRecords;
+    if( *pnRecords > psZoneMap->nBlockRecords )
+        *pnRecords = psZoneMap->nBlockRecords;
+
+    return psZoneMap->pabyStats
+        + STATIC_CAST(size_t, iBlock) * psZoneMap->nBlockSize
+        + psZoneMap->panStatsOffset[iField];
+}
+
+/************************************************************************/
+/*                        goDBFZoneMapHasNulls()                        */
+/*                                                                      */
+/*      Whether field iField may be NULL in block iBlock.               */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFZoneMapHasNulls( DBFZoneMapHandle psZoneMap, int iBlock, int iField )
+{
+    int nRecords;
+    const unsigned char *pabyField =
+        DBFZoneMapStats( psZoneMap, iBlock, iField, &nRecords );
+
+    return pabyField == SHPLIB_NULLPTR || DBFZoneMapGetInt( pabyField ) > 0;
+}
+
+/************************************************************************/
+/*                     goDBFZoneMapMayMatchDouble()                     */
+/*                                                                      */
+/*      Whether field iField of a record of block iBlock may compare    */
+/*      to dfValue with eOp, as goDBFFilterCompareDouble() does.        */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFZoneMapMayMatchDouble( DBFZoneMapHandle psZoneMap, int iBlock, int iField,
+                            DBFCompareOp eOp, double dfValue )
+{
+    int nRecords;
+    const unsigned char *pabyField =
+        DBFZoneMapStats( psZoneMap, iBlock, iField, &nRecords );
+
+    if( pabyField == SHPLIB_NULLPTR || dfValue != dfValue ||
+        !DBFZoneMapNumeric( psZoneMap->pachFieldType[iField] ) )
+        return TRUE;
+
+    if( DBFZoneMapGetInt( pabyField + 4 ) == 0 )
+        return FALSE;
+
+    const double dfMin = DBFZoneMapGetDouble( pabyField + 8 );
+    const double dfMax = DBFZoneMapGetDouble( pabyField + 16 );
+
+    switch( eOp )
+    {
+      case DBFC_EQ: return dfMin <= dfValue && dfValue <= dfMax;
+      case DBFC_NE: return !(dfMin == dfValue && dfMax == dfValue);
+      case DBFC_LT: return dfMin < dfValue;
+      case DBFC_LE: return dfMin <= dfValue;
+      case DBFC_GT: return dfMax > dfValue;
+      case DBFC_GE: return dfMax >= dfValue;
+    }
+    return TRUE;
+}
+
+/************************************************************************/
+/*                     goDBFZoneMapMayMatchString()                     */
+/*                                                                      */
+/*      Whether field iField of a record of block iBlock may compare    */
+/*      to pszValue with eOp, as goDBFFilterCompareString() does.       */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFZoneMapMayMatchString( DBFZoneMapHandle psZoneMap, int iBlock, int iField,
+                            DBFCompareOp eOp, const char *pszValue )
+{
+    int nRecords;
+    const unsigned char *pabyField =
+        DBFZoneMapStats( psZoneMap, iBlock, iField, &nRecords );
+
+    if( pabyField == SHPLIB_NULLPTR )
+        return TRUE;
+
+    /* NULL values never compare */
+    if( DBFZoneMapGetInt( pabyField ) == nRecords )
+        return FALSE;
+
+    const char chType = psZoneMap->pachFieldType[iField];
+    if( eOp != DBFC_EQ || DBFZoneMapNumeric( chType ) || chType == 'L' )
+        return TRUE;
+
+    int anBits[DBZ_BLOOM_HASHES];
+    DBFZoneMapBloomBits( pszValue, STATIC_CAST(int, strlen(pszValue)), anBits );
+    for( int k = 0; k < DBZ_BLOOM_HASHES; k++ )
+    {
+        if( !(pabyField[4 + (anBits[k] >> 3)] & (1 << (anBits[k] & 7))) )
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/************************************************************************/
+/*                     goDBFZoneMapMayMatchLogical()                    */
+/*                                                                      */
+/*      Whether logical field iField of a record of block iBlock may    */
+/*      be bValue.                                                      */
+/************************************************************************/
+
+int SHPAPI_CALL
+goDBFZoneMapMayMatchLogical( DBFZoneMapHandle psZoneMap, int iBlock, int iField,
+                             int bValue )
+{
+    int nRecords;
+    const unsigned char *pabyField =
+        DBFZoneMapStats( psZoneMap, iBlock, iField, &nRecords );
+
+    if( pabyField == SHPLIB_NULLPTR ||
+        psZoneMap->pachFieldType[iField] != 'L' )
+        return TRUE;
+
+    const char *pszChars = bValue ? "TtYy" : "FfNn";
+    for( int i = 0; pszChars[i] != '\0'; i++ )
+    {
+        int anBits[DBZ_BLOOM_HASHES];
+        DBFZoneMapBloomBits( pszChars + i, 1, anBits );
+
+        int k = 0;
+        while( k < DBZ_BLOOM_HASHES &&
+               (pabyField[4 + (anBits[k] >> 3)] & (1 << (anBits[k] & 7))) )
+            k++;
+        if( k == DBZ_BLOOM_HASHES )
+            return TRUE;
+    }
+    return FALSE;
+}
@@ -0,0 +1,215 @@
+package shp
+
+import (
+	"fmt"
+	"time"
+)
+
+// CompareOp is the comparison of a Compare predicate.
+type CompareOp int
+
+const (
+	OpEqual CompareOp = iota
+	OpNotEqual
+	OpLess
+	OpLessEqual
+	OpGreater
+	OpGreaterEqual
+)
+
+type predicateKind int
+
+const (
+	predicateCompare predicateKind = iota
+	predicateNull
+	predicateAnd
+	predicateOr
+	predicateNot
+)
+
+// Predicate is a condition on the attributes of a record, for Select.
+type Predicate struct {
+	kind     predicateKind
+	field    string
+	op       CompareOp
+	value    interface{}
+	operands []Predicate
+}
+
+// Compare is true where field compares to value with op. value is a number
+// for numeric fields, a string for character fields, a bool for logical
+// fields and a time.Time or "YYYYMMDD" string for date fields. Strings
+// compare bytewise with the blanks around the field value removed. NULL
+// values never compare true.
+func Compare(field string, op CompareOp, value interface{}) Predicate {
+	return Predicate{kind: predicateCompare, field: field, op: op, value: value}
+}
+
+// IsNull is true where field is NULL.
+func IsNull(field string) Predicate {
+	return Predicate{kind: predicateNull, field: field}
+}
+
+// And is true where all the predicates are.
+func And(predicates ...Predicate) Predicate {
+	return Predicate{kind: predicateAnd, operands: predicates}
+}
+
+// Or is true where any of the predicates is.
+func Or(predicates ...Predicate) Predicate {
+	return Predicate{kind: predicateOr, operands: predicates}
+}
+
+// Not is true where predicate is not, NULL values included.
+func Not(predicate Predicate) Predicate {
+	return Predicate{kind: predicateNot, operands: []Predicate{predicate}}
+}
+
+// build turns the predicate into a filter of the attribute file, which the
+// caller destroys.
+func (p Predicate) build(f *ShapeFile) (DBFFilterHandle, error) {
+	switch p.kind {
+	case predicateAnd, predicateOr:
+		if len(p.operands) == 0 {
+			return nil, fmt.Errorf("empty And or Or")
+		}
+		filter, err := p.operands[0].build(f)
+		if err != nil {
+			return nil, err
+		}
+		for _, operand := range p.operands[1:] {
+			right, err := operand.build(f)
+			if err != nil {
+				goDBFFilterDestroy(filter)
+				return nil, err
+			}
+			if p.kind == predicateAnd {
+				filter = goDBFFilterAnd(filter, right)
+			} else {
+				filter = goDBFFilterOr(filter, right)
+			}
+		}
+		return filter, nil
+	case predicateNot:
+		operand, err := p.operands[0].build(f)
+		if err != nil {
+			return nil, err
+		}
+		return goDBFFilterNot(operand), nil
+	}
+
+	j := goDBFGetFieldIndex(f.hDb, p.field)
+	if j < 0 {
+		return nil, fmt.Errorf("no field %q", p.field)
+	}
+	if p.kind == predicateNull {
+		return goDBFFilterIsNull(f.hDb, j), nil
+	}
+
+	switch v := p.value.(type) {
+	case int:
+		return goDBFFilterCompareDouble(f.hDb, j, int(p.op), float64(v)), nil
+	case int64:
+		return goDBFFilterCompareDouble(f.hDb, j, int(p.op), float64(v)), nil
+	case float64:
+		return goDBFFilterCompareDouble(f.hDb, j, int(p.op), v), nil
+	case string:
+		return goDBFFilterCompareString(f.hDb, j, int(p.op), v), nil
+	case time.Time:
+		return goDBFFilterCompareString(f.hDb, j, int(p.op), v.Format("20060102")), nil
+	case bool:
+		if p.op != OpEqual && p.op != OpNotEqual {
+			return nil, fmt.Errorf("logical field %q only compares for equality", p.field)
+		}
+		return goDBFFilterCompareLogical(f.hDb, j, v == (p.op == OpEqual)), nil
+	}
+	return nil, fmt.Errorf("cannot compare field %q to %T", p.field, p.value)
+}
+
+// Select returns the indexes of the shapes among the count ones from start
+// whose attributes satisfy predicate. The predicate is evaluated on the
+// attribute records as stored, without decoding the values it does not
+// need, which is much faster than going through Shape for each record.
+// With SetZoneMap, the blocks of records that cannot match are not read.
+func (f *ShapeFile) Select(predicate Predicate, start, count int) ([]int, error) {
+	if start < 0 || start > f.ShapeCount {
+		return nil, fmt.Errorf("no record %d among %d", start, f.ShapeCount)
+	}
+	filter, err := predicate.build(f)
+	if err != nil {
+		return nil, err
+	}
+	if filter == nil {
+		return nil, fmt.Errorf("cannot build filter")
+	}
+	defer goDBFFilterDestroy(filter)
+	if count > f.ShapeCount-start {
+		count = f.ShapeCount - start
+	}
+	selected, ok := goDBFFilterSelect(f.hDb, filter, f.zoneMap, start, count)
+	if !ok {
+		return nil, fmt.Errorf("cannot select records %d to %d", start, start+count-1)
+	}
+	return selected, nil
+}
+
+// ParallelSelect is Select over all the shapes, evaluated by Scan with
+// workers goroutines. The indexes are in increasing order, as with Select.
+func (f *ShapeFile) ParallelSelect(predicate Predicate, workers int) ([]int, error) {
+	filter, err := predicate.build(f)
+	if err != nil {
+		return nil, err
+	}
+	if filter == nil {
+		return nil, fmt.Errorf("cannot build filter")
+	}
+	defer goDBFFilterDestroy(filter)
+
+	const rangeRecords = 65536
+	selected := make([][]int, (f.ShapeCount+rangeRecords-1)/rangeRecords)
+	err = f.Scan(workers, rangeRecords, func(c *Cursor, start, count int) error {
+		indexes, ok := goDBFCursorFilterSelect(c.h, filter, f.zoneMap, start, count)
+		if !ok {
+			return fmt.Errorf("cannot select records %d to %d", start, start+count-1)
+		}
+		selected[start/rangeRecords] = indexes
+		return nil
+	})
+	if err != nil {
+		return nil, err
+	}
+
+	var indexes []int
+	for _, s := range selected {
+		indexes = append(indexes, s...)
+	}
+	return indexes, nil
+}
+
+// CreateZoneMap writes to path, for instance "roads.dbz", the statistics of
+// each block of blockRecords records (65536 if 0) that let Select skip the
+// blocks that cannot match: the range of numeric and date fields, a bloom
+// filter of the other fields and their NULL counts.
+func (f *ShapeFile) CreateZoneMap(path string, blockRecords int) error {
+	if !goDBFCreateZoneMap(f.hDb, path, blockRecords) {
+		return fmt.Errorf("cannot create zone map %s", path)
+	}
+	return nil
+}
+
+// SetZoneMap makes Select use the statistics written to path by
+// CreateZoneMap, which must be recreated whenever the attributes change.
+// An empty path stops using them.
+func (f *ShapeFile) SetZoneMap(path string) error {
+	var zoneMap DBFZoneMapHandle
+	if path != "" {
+		if zoneMap = goDBFOpenZoneMap(f.hDb, path); zoneMap == nil {
+			return fmt.Errorf("cannot open zone map %s", path)
+		}
+	}
+	if f.zoneMap != nil {
+		goDBFCloseZoneMap(f.zoneMap)
+	}
+	f.zoneMap = zoneMap
+	return nil
+}
@@ -0,0 +1,71 @@
+package shp
+
+import (
+	"fmt"
+	"time"
+)
+
+// IndexKind is the structure of an attribute index.
+type IndexKind int
+
+const (
+	// IndexBTree supports range searches on numeric and date fields.
+	IndexBTree IndexKind = iota
+	// IndexHash supports equality searches on the text of any field.
+	IndexHash
+)
+
+// Index is an attribute index file opened with OpenIndex.
+type Index struct {
+	h DBFIndexHandle
+}
+
+// CreateIndex writes an index of field to path, for instance
+// "roads.ROAD_ID.dbx", for layers that no longer change: OpenIndex refuses
+// indexes of a different number of records, but not changed values.
+func (f *ShapeFile) CreateIndex(field, path string, kind IndexKind) error {
+	j := goDBFGetFieldIndex(f.hDb, field)
+	if j < 0 {
+		return fmt.Errorf("no field %q", field)
+	}
+	if !goDBFCreateIndex(f.hDb, j, path, int(kind)) {
+		return fmt.Errorf("cannot create index %s of field %q", path, field)
+	}
+	return nil
+}
+
+// OpenIndex opens an index written by CreateIndex for the attributes of f,
+// which must stay open while it is used.
+func (f *ShapeFile) OpenIndex(path string) (*Index, error) {
+	h := goDBFOpenIndex(f.hDb, path)
+	if h == nil {
+		return nil, fmt.Errorf("cannot open index %s", path)
+	}
+	return &Index{h: h}, nil
+}
+
+// Range returns the indexes of the shapes whose value is between min and max
+// included, in order of value, from a B+tree index.
+func (x *Index) Range(min, max float64) []int {
+	return goDBFIndexSearchRange(x.h, min, max)
+}
+
+// DateRange is Range for date fields.
+func (x *Index) DateRange(min, max time.Time) []int {
+	return x.Range(dateKey(min), dateKey(max))
+}
+
+// Lookup returns the indexes of the shapes whose value is key, leading and
+// trailing blanks ignored, in increasing order, from a hash index.
+func (x *Index) Lookup(key string) []int {
+	return goDBFIndexSearchString(x.h, key)
+}
+
+func (x *Index) Close() {
+	goDBFCloseIndex(x.h)
+}
+
+// dateKey is the number YYYYMMDD under which dates are indexed.
+func dateKey(t time.Time) float64 {
+	return float64(t.Year()*10000 + int(t.Month())*100 + t.Day())
+}
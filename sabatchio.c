@@ -0,0 +1,593 @@
+/******************************************************************************
+ *
+ * Project:  Shapelib
+ * Purpose:  Batched positional reads, submitted together so that the
+ *           device sees more than one outstanding request.
+ *
+ ******************************************************************************
+ *
+ * This software is available under the following "MIT Style" license,
+ * or at the option of the licensee under the LGPL (see COPYING).  This
+ * option is discussed in more detail in shapelib.html.
+ *
+ * --
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************
+ *
+ * Three strategies are tried in order:
+ *
+ *  - io_uring on Linux, when the file has a descriptor and the kernel
+ *    allows it.  Up to SAB_QUEUE_DEPTH reads are kept in flight.
+ *  - A small pool of threads issuing pread() on the descriptor.
+ *  - FSeek()/FRead() through the hooks, in file offset order, for files
+ *    without a descriptor (compressed members, custom hooks).
+ *
+ * In all cases the completion callback runs on the calling thread, so it
+ * does not need to be thread safe.
+ */
+
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include "shapefil.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+SHP_CVSID("$Id$")
+
+#ifndef FALSE
+#  define FALSE		0
+#  define TRUE		1
+#endif
+
+#ifdef __cplusplus
+#define STATIC_CAST(type,x) static_cast<type>(x)
+#define SHPLIB_NULLPTR nullptr
+#else
+#define STATIC_CAST(type,x) ((type)(x))
+#define SHPLIB_NULLPTR NULL
+#endif
+
+#ifndef SHPAPI_WINDOWS
+#  define SAB_HAVE_PREAD
+#  include <errno.h>
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#  if __has_include(<linux/io_uring.h>)
+#    define SAB_HAVE_IO_URING
+#    include <linux/io_uring.h>
+#    include <sys/mman.h>
+#    include <sys/syscall.h>
+#    include <sys/uio.h>
+#  endif
+#endif
+
+/* Number of reads kept in flight with io_uring. */
+#define SAB_QUEUE_DEPTH     64
+
+/* Maximum number of pread() threads. */
+#define SAB_MAX_THREADS     8
+
+/************************************************************************/
+/*                           SABCompareOffset()                         */
+/************************************************************************/
+
+static int SABCompareOffset( const void *pA, const void *pB ) {
+    const SABatchRequest *psA = *STATIC_CAST(const SABatchRequest * const *, pA);
+    const SABatchRequest *psB = *STATIC_CAST(const SABatchRequest * const *, pB);
+
+    if( psA->nOffset < psB->nOffset )
+        return -1;
+    if( psA->nOffset > psB->nOffset )
+        return 1;
+    return 0;
+}
+
+/************************************************************************/
+/*                            SABReadHooks()                            */
+/*                                                                      */
+/*      Fallback going through the hooks.  Requests are served in       */
+/*      offset order, which is the cheapest order for sequential        */
+/*      backends such as compressed streams.                            */
+/************************************************************************/
+
+static int SABReadHooks( SAHooks *psHooks, SAFile file,
+                         SABatchRequest *pasRequests, int nCount,
+                         SABatchDoneFunc pfnDone, void *pUserData ) {
+    SABatchRequest **papsSorted = STATIC_CAST(SABatchRequest **,
+        malloc(sizeof(SABatchRequest *) * (nCount ? nCount : 1)));
+    if( papsSorted == SHPLIB_NULLPTR )
+        return FALSE;
+
+    for( int i = 0; i < nCount; i++ )
+        papsSorted[i] = pasRequests + i;
+    qsort( papsSorted, nCount, sizeof(SABatchRequest *), SABCompareOffset );
+
+    for( int i = 0; i < nCount; i++ )
+    {
+        SABatchRequest *psRequest = papsSorted[i];
+        psRequest->nRead = 0;
+        if( psHooks->FSeek( file, psRequest->nOffset, 0 ) == 0 )
+            psRequest->nRead = psHooks->FRead( psRequest->pBuffer, 1,
+                                               psRequest->nSize, file );
+        pfnDone( pUserData, psRequest );
+    }
+
+    free( papsSorted );
+    return TRUE;
+}
+
+#ifdef SAB_HAVE_PREAD
+
+/************************************************************************/
+/*                            SABPReadFully()                           */
+/*                                                                      */
+/*      pread() the whole request, stopping early only at end of file   */
+/*      or on error.                                                    */
+/************************************************************************/
+
+static void SABPReadFully( int fd, SABatchRequest *psRequest ) {
+    unsigned char *pabyDst = STATIC_CAST(unsigned char *, psRequest->pBuffer);
+
+    while( psRequest->nRead < psRequest->nSize )
+    {
+        const ssize_t nRet = pread( fd, pabyDst + psRequest->nRead,
+                                    psRequest->nSize - psRequest->nRead,
+                                    STATIC_CAST(off_t, psRequest->nOffset +
+                                                psRequest->nRead) );
+        if( nRet < 0 && errno == EINTR )
+            continue;
+        if( nRet <= 0 )
+            break;
+        psRequest->nRead += nRet;
+    }
+}
+
+/* -------------------------------------------------------------------- */
+/*      State shared between the caller and the pread() threads.        */
+/*      Finished request indices are queued in panDone, and handed      */
+/*      to the callback by the caller.                                  */
+/* -------------------------------------------------------------------- */
+typedef struct
+{
+    int             fd;
+    SABatchRequest *pasRequests;
+    int             nCount;
+
+    pthread_mutex_t hLock;
+    pthread_cond_t  hCond;
+    int             nNext;      /* next request to issue */
+    int            *panDone;
+    int             nDone;      /* requests queued in panDone */
+} SABPool;
+
+/************************************************************************/
+/*                           SABPoolWorker()                            */
+/************************************************************************/
+
+static void *SABPoolWorker( void *pData ) {
+    SABPool *psPool = STATIC_CAST(SABPool *, pData);
+
+    pthread_mutex_lock( &(psPool->hLock) );
+    while( psPool->nNext < psPool->nCount )
+    {
+        const int iRequest = psPool->nNext++;
+        pthread_mutex_unlock( &(psPool->hLock) );
+
+        SABatchRequest *psRequest = psPool->pasRequests + iRequest;
+        psRequest->nRead = 0;
+        SABPReadFully( psPool->fd, psRequest );
+
+        pthread_mutex_lock( &(psPool->hLock) );
+        psPool->panDone[psPool->nDone++] = iRequest;
+        pthread_cond_signal( &(psPool->hCond) );
+    }
+    pthread_mutex_unlock( &(psPool->hLock) );
+
+    return SHPLIB_NULLPTR;
+}
+
+/************************************************************************/
+/*                            SABReadPool()                             */
+/************************************************************************/
+
+static int SABReadPool( int fd, SABatchRequest *pasRequests, int nCount,
+                        SABatchDoneFunc pfnDone, void *pUserData ) {
+    SABPool sPool;
+    memset( &sPool, 0, sizeof(sPool) );
+    sPool.fd = fd;
+    sPool.pasRequests = pasRequests;
+    sPool.nCount = nCount;
+    sPool.panDone = STATIC_CAST(int *, malloc(sizeof(int) * nCount));
+    if( sPool.panDone == SHPLIB_NULLPTR )
+        return FALSE;
+
+    pthread_mutex_init( &(sPool.hLock), SHPLIB_NULLPTR );
+    pthread_cond_init( &(sPool.hCond), SHPLIB_NULLPTR );
+
+    pthread_t ahThreads[SAB_MAX_THREADS];
+    int nThreads = 0;
+    while( nThreads < SAB_MAX_THREADS && nThreads < nCount &&
+           pthread_create( ahThreads + nThreads, SHPLIB_NULLPTR,
+                           SABPoolWorker, &sPool ) == 0 )
+        nThreads++;
+
+    /* Without any thread, the caller does the reads itself. */
+    if( nThreads == 0 )
+        SABPoolWorker( &sPool );
+
+/* -------------------------------------------------------------------- */
+/*      Hand out completions as they arrive.                            */
+/* -------------------------------------------------------------------- */
+    int nHandled = 0;
+    pthread_mutex_lock( &(sPool.hLock) );
+    while( nHandled < nCount )
+    {
+        while( nHandled == sPool.nDone )
+            pthread_cond_wait( &(sPool.hCond), &(sPool.hLock) );
+
+        const int iRequest = sPool.panDone[nHandled++];
+        pthread_mutex_unlock( &(sPool.hLock) );
+        pfnDone( pUserData, pasRequests + iRequest );
+        pthread_mutex_lock( &(sPool.hLock) );
+    }
+    pthread_mutex_unlock( &(sPool.hLock) );
+
+    for( int i = 0; i < nThreads; i++ )
+        pthread_join( ahThreads[i], SHPLIB_NULLPTR );
+
+    pthread_mutex_destroy( &(sPool.hLock) );
+    pthread_cond_destroy( &(sPool.hCond) );
+    free( sPool.panDone );
+
+    return TRUE;
+}
+
+#endif /* def SAB_HAVE_PREAD */
+
+#ifdef SAB_HAVE_IO_URING
+
+typedef struct
+{
+    int                  fd;            /* ring descriptor */
+    void                *pSQRing;
+    size_t               nSQRingSize;
+    void                *pCQRing;
+    size_t               nCQRingSize;
+    struct io_uring_sqe *pasSQEs;
+    size_t               nSQEsSize;
+
+    unsigned            *pnSQTail;
+    unsigned            *pnSQMask;
+    unsigned            *panSQArray;
+    unsigned            *pnCQHead;
+    unsigned            *pnCQTail;
+    unsigned            *pnCQMask;
+    struct io_uring_cqe *pasCQEs;
+} SABRing;
+
+/************************************************************************/
+/*                            SABRingClose()                            */
+/************************************************************************/
+
+static void SABRingClose( SABRing *psRing ) {
+    if( psRing->pasSQEs != SHPLIB_NULLPTR && psRing->pasSQEs != MAP_FAILED )
+        munmap( psRing->pasSQEs, psRing->nSQEsSize );
+    if( psRing->pCQRing != SHPLIB_NULLPTR && psRing->pCQRing != MAP_FAILED &&
+        psRing->pCQRing != psRing->pSQRing )
+        munmap( psRing->pCQRing, psRing->nCQRingSize );
+    if( psRing->pSQRing != SHPLIB_NULLPTR && psRing->pSQRing != MAP_FAILED )
+        munmap( psRing->pSQRing, psRing->nSQRingSize );
+    if( psRing->fd >= 0 )
+        close( psRing->fd );
+}
+
+/************************************************************************/
+/*                            SABRingOpen()                             */
+/*                                                                      */
+/*      Set up a ring with raw system calls, so that liburing is not    */
+/*      required.  Fails cleanly on kernels without io_uring, or where  */
+/*      it is disabled by policy.                                       */
+/************************************************************************/
+
+static bool SABRingOpen( SABRing *psRing, unsigned nEntries ) {
+    struct io_uring_params sParams;
+    memset( &sParams, 0, sizeof(sParams) );
+    memset( psRing, 0, sizeof(SABRing) );
+
+    psRing->fd = STATIC_CAST(int, syscall( __NR_io_uring_setup, nEntries, &sParams ));
+    if( psRing->fd < 0 )
+        return false;
+
+    psRing->nSQRingSize = sParams.sq_off.array + sParams.sq_entries * sizeof(unsigned);
+    psRing->nCQRingSize = sParams.cq_off.cqes +
+                          sParams.cq_entries * sizeof(struct io_uring_cqe);
+    const bool bSingleMmap = (sParams.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if( bSingleMmap && psRing->nCQRingSize > psRing->nSQRingSize )
+        psRing->nSQRingSize = psRing->nCQRingSize;
+
+    psRing->pSQRing = mmap( SHPLIB_NULLPTR, psRing->nSQRingSize,
+                            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            psRing->fd, IORING_OFF_SQ_RING );
+    if( psRing->pSQRing == MAP_FAILED )
+    {
+        SABRingClose( psRing );
+        return false;
+    }
+
+    if( bSingleMmap )
+    {
+        psRing->pCQRing = psRing->pSQRing;
+    }
+    else
+    {
+        psRing->pCQRing = mmap( SHPLIB_NULLPTR, psRing->nCQRingSize,
+                                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                psRing->fd, IORING_OFF_CQ_RING );
+        if( psRing->pCQRing == MAP_FAILED )
+        {
+            SABRingClose( psRing );
+            return false;
+        }
+    }
+
+    psRing->nSQEsSize = sParams.sq_entries * sizeof(struct io_uring_sqe);
+    psRing->pasSQEs = STATIC_CAST(struct io_uring_sqe *,
+        mmap( SHPLIB_NULLPTR, psRing->nSQEsSize, PROT_READ | PROT_WRITE,
+              MAP_SHARED | MAP_POPULATE, psRing->fd, IORING_OFF_SQES ));
+    if( psRing->pasSQEs == MAP_FAILED )
+    {
+        SABRingClose( psRing );
+        return false;
+    }
+
+    unsigned char *pabySQ = STATIC_CAST(unsigned char *, psRing->pSQRing);
+    unsigned char *pabyCQ = STATIC_CAST(unsigned char *, psRing->pCQRing);
+    psRing->pnSQTail = STATIC_CAST(unsigned *, STATIC_CAST(void *, pabySQ + sParams.sq_off.tail));
+    psRing->pnSQMask = STATIC_CAST(unsigned *, STATIC_CAST(void *, pabySQ + sParams.sq_off.ring_mask));
+    psRing->panSQArray = STATIC_CAST(unsigned *, STATIC_CAST(void *, pabySQ + sParams.sq_off.array));
+    psRing->pnCQHead = STATIC_CAST(unsigned *, STATIC_CAST(void *, pabyCQ + sParams.cq_off.head));
+    psRing->pnCQTail = STATIC_CAST(unsigned *, STATIC_CAST(void *, pabyCQ + sParams.cq_off.tail));
+    psRing->pnCQMask = STATIC_CAST(unsigned *, STATIC_CAST(void *, pabyCQ + sParams.cq_off.ring_mask));
+    psRing->pasCQEs = STATIC_CAST(struct io_uring_cqe *, STATIC_CAST(void *, pabyCQ + sParams.cq_off.cqes));
+
+    return true;
+}
+
+/************************************************************************/
+/*                           SABRingQueue()                             */
+/*                                                                      */
+/*      Queue a read of the unread part of a request.  The iovec must   */
+/*      stay valid until the read completes.                            */
+/************************************************************************/
+
+static void SABRingQueue( SABRing *psRing, int fd, SABatchRequest *psRequest,
+                          struct iovec *psVec, int iRequest ) {
+    const unsigned nTail = *(psRing->pnSQTail);
+    const unsigned iSlot = nTail & *(psRing->pnSQMask);
+    struct io_uring_sqe *psSQE = psRing->pasSQEs + iSlot;
+
+    psVec->iov_base = STATIC_CAST(unsigned char *, psRequest->pBuffer) + psRequest->nRead;
+    psVec->iov_len = psRequest->nSize - psRequest->nRead;
+
+    memset( psSQE, 0, sizeof(struct io_uring_sqe) );
+    psSQE->opcode = IORING_OP_READV;
+    psSQE->fd = fd;
+    psSQE->addr = STATIC_CAST(unsigned long, STATIC_CAST(size_t, psVec));
+    psSQE->len = 1;
+    psSQE->off = psRequest->nOffset + psRequest->nRead;
+    psSQE->user_data = STATIC_CAST(unsigned, iRequest);
+
+    psRing->panSQArray[iSlot] = iSlot;
+    __atomic_store_n( psRing->pnSQTail, nTail + 1, __ATOMIC_RELEASE );
+}
+
+/************************************************************************/
+/*                            SABReadRing()                             */
+/*                                                                      */
+/*      Returns FALSE without having read anything if no ring could be  */
+/*      set up.                                                         */
+/************************************************************************/
+
+static int SABReadRing( int fd, SABatchRequest *pasRequests, int nCount,
+                        SABatchDoneFunc pfnDone, void *pUserData ) {
+    SABRing sRing;
+    const unsigned nDepth = nCount < SAB_QUEUE_DEPTH ?
+        STATIC_CAST(unsigned, nCount) : SAB_QUEUE_DEPTH;
+    if( !SABRingOpen( &sRing, nDepth ) )
+        return FALSE;
+
+    struct iovec *pasVecs = STATIC_CAST(struct iovec *,
+        malloc(sizeof(struct iovec) * nCount));
+    bool *pabFinished = STATIC_CAST(bool *, calloc(nCount, sizeof(bool)));
+    if( pasVecs == SHPLIB_NULLPTR || pabFinished == SHPLIB_NULLPTR )
+    {
+        free( pasVecs );
+        free( pabFinished );
+        SABRingClose( &sRing );
+        return FALSE;
+    }
+
+    int nNext = 0;
+    int nInFlight = 0;
+    int nToSubmit = 0;
+    int nFinished = 0;
+    bool bRingFailed = false;
+
+    while( nFinished < nCount && !bRingFailed )
+    {
+/* -------------------------------------------------------------------- */
+/*      Fill the submission queue.                                      */
+/* -------------------------------------------------------------------- */
+        while( nInFlight < STATIC_CAST(int, nDepth) && nNext < nCount )
+        {
+            SABatchRequest *psRequest = pasRequests + nNext;
+            psRequest->nRead = 0;
+            if( psRequest->nSize == 0 )
+            {
+                pabFinished[nNext] = true;
+                pfnDone( pUserData, psRequest );
+                nFinished++;
+            }
+            else
+            {
+                SABRingQueue( &sRing, fd, psRequest, pasVecs + nNext, nNext );
+                nInFlight++;
+                nToSubmit++;
+            }
+            nNext++;
+        }
+
+        if( nInFlight == 0 )
+            continue;
+
+        const int nRet = STATIC_CAST(int, syscall( __NR_io_uring_enter, sRing.fd,
+                                                   nToSubmit, 1,
+                                                   IORING_ENTER_GETEVENTS,
+                                                   SHPLIB_NULLPTR, 0 ));
+        if( nRet < 0 )
+        {
+            if( errno != EINTR )
+                bRingFailed = true;
+            continue;
+        }
+        nToSubmit -= nRet < nToSubmit ? nRet : nToSubmit;
+
+/* -------------------------------------------------------------------- */
+/*      Reap completions.  Short reads are requeued for the rest, and   */
+/*      failed reads retried with pread(), which also covers kernels    */
+/*      not supporting the opcode.                                      */
+/* -------------------------------------------------------------------- */
+        unsigned nHead = *(sRing.pnCQHead);
+        while( nHead != __atomic_load_n( sRing.pnCQTail, __ATOMIC_ACQUIRE ) )
+        {
+            const struct io_uring_cqe *psCQE =
+                sRing.pasCQEs + (nHead & *(sRing.pnCQMask));
+            const int iRequest = STATIC_CAST(int, psCQE->user_data);
+            const int nRes = psCQE->res;
+            nHead++;
+            __atomic_store_n( sRing.pnCQHead, nHead, __ATOMIC_RELEASE );
+
+            SABatchRequest *psRequest = pasRequests + iRequest;
+            if( nRes > 0 )
+            {
+                psRequest->nRead += nRes;
+                if( psRequest->nRead < psRequest->nSize )
+                {
+                    SABRingQueue( &sRing, fd, psRequest, pasVecs + iRequest,
+                                  iRequest );
+                    nToSubmit++;
+                    continue;
+                }
+            }
+            else if( nRes < 0 )
+            {
+                SABPReadFully( fd, psRequest );
+            }
+
+            nInFlight--;
+            pabFinished[iRequest] = true;
+            pfnDone( pUserData, psRequest );
+            nFinished++;
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      If the ring failed midway, wait for the reads the kernel still  */
+/*      owns, then finish everything left with pread().                */
+/* -------------------------------------------------------------------- */
+    if( bRingFailed )
+    {
+        int nPending = nInFlight - nToSubmit;
+        while( nPending > 0 &&
+               syscall( __NR_io_uring_enter, sRing.fd, 0, 1,
+                        IORING_ENTER_GETEVENTS, SHPLIB_NULLPTR, 0 ) >= 0 )
+        {
+            unsigned nHead = *(sRing.pnCQHead);
+            while( nHead != __atomic_load_n( sRing.pnCQTail, __ATOMIC_ACQUIRE ) )
+            {
+                nHead++;
+                nPending--;
+            }
+            __atomic_store_n( sRing.pnCQHead, nHead, __ATOMIC_RELEASE );
+        }
+    }
+    SABRingClose( &sRing );
+
+    for( int i = 0; i < nCount && nFinished < nCount; i++ )
+    {
+        if( !pabFinished[i] )
+        {
+            pasRequests[i].nRead = 0;
+            SABPReadFully( fd, pasRequests + i );
+            pfnDone( pUserData, pasRequests + i );
+            nFinished++;
+        }
+    }
+
+    free( pasVecs );
+    free( pabFinished );
+    return TRUE;
+}
+
+#endif /* def SAB_HAVE_IO_URING */
+
+/************************************************************************/
+/*                           goSABatchRead()                            */
+/*                                                                      */
+/*      Read a set of (offset, size) ranges of a file, calling pfnDone  */
+/*      on the calling thread as each one completes, in no particular   */
+/*      order.  nRead is set to the number of bytes actually read.      */
+/*      The file position of the hooks is left undefined.               */
+/************************************************************************/
+
+int SHPAPI_CALL
+goSABatchRead( SAHooks *psHooks, SAFile file, SABatchRequest *pasRequests,
+               int nCount, SABatchDoneFunc pfnDone, void *pUserData ) {
+    if( nCount <= 0 )
+        return TRUE;
+
+#ifdef SAB_HAVE_PREAD
+    const int fd = psHooks->FFileno != SHPLIB_NULLPTR ?
+        psHooks->FFileno( file ) : -1;
+
+    if( fd >= 0 )
+    {
+        /* Make buffered writes visible to pread(). */
+        psHooks->FFlush( file );
+
+#ifdef SAB_HAVE_IO_URING
+        if( nCount > 1 &&
+            SABReadRing( fd, pasRequests, nCount, pfnDone, pUserData ) )
+            return TRUE;
+#endif
+        return SABReadPool( fd, pasRequests, nCount, pfnDone, pUserData );
+    }
+#endif
+
+    return SABReadHooks( psHooks, file, pasRequests, nCount, pfnDone, pUserData );
+}
@@ -0,0 +1,434 @@
+/******************************************************************************
+ *
+ * Project:  Shapelib
+ * Purpose:  File io hooks for bulk scans, bypassing the page cache.
+ *
+ ******************************************************************************
+ *
+ * This software is available under the following "MIT Style" license,
+ * or at the option of the licensee under the LGPL (see COPYING).  This
+ * option is discussed in more detail in shapelib.html.
+ *
+ * --
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************
+ *
+ * Files opened for reading are read with O_DIRECT in large aligned blocks,
+ * so that scanning a whole layer does not evict other data from the page
+ * cache.  Where the file system refuses O_DIRECT, the file is read through
+ * the cache and each block is dropped from it once consumed.  Files opened
+ * for writing are handled as with the default hooks.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* O_DIRECT */
+#endif
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include "shapefil.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+SHP_CVSID("$Id$")
+
+#ifdef __cplusplus
+#define STATIC_CAST(type,x) static_cast<type>(x)
+#define SHPLIB_NULLPTR nullptr
+#else
+#define STATIC_CAST(type,x) ((type)(x))
+#define SHPLIB_NULLPTR NULL
+#endif
+
+#ifndef SHPAPI_WINDOWS
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/* Size of a read, a multiple of any device block size. */
+#define SADIO_BLOCK_SIZE      (4 * 1024 * 1024)
+
+/* Alignment of buffers and offsets required by O_DIRECT. */
+#define SADIO_ALIGNMENT       4096
+
+typedef struct
+{
+    FILE           *fp;         /* files opened for writing */
+
+    int             fd;         /* files opened for reading */
+    bool            bDirect;    /* fd bypasses the page cache */
+    SAOffset        nFileSize;
+    SAOffset        nPos;
+
+    unsigned char  *pabyBlock;  /* SADIO_ALIGNMENT aligned */
+    SAOffset        nBlockStart;
+    SAOffset        nBlockLen;  /* 0 if the block holds nothing */
+} SADIOFile;
+
+/************************************************************************/
+/*                           SADIOOpenRead()                            */
+/************************************************************************/
+
+static SADIOFile *SADIOOpenRead( const char *pszFilename ) {
+    SADIOFile *psFile = STATIC_CAST(SADIOFile *, calloc(1, sizeof(SADIOFile)));
+    if( psFile == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+    void *pBlock = SHPLIB_NULLPTR;
+    if( posix_memalign( &pBlock, SADIO_ALIGNMENT, SADIO_BLOCK_SIZE ) != 0 )
+    {
+        free( psFile );
+        return SHPLIB_NULLPTR;
+    }
+    psFile->pabyBlock = STATIC_CAST(unsigned char *, pBlock);
+
+/* -------------------------------------------------------------------- */
+/*      Try to bypass the cache, and otherwise fall back to a regular   */
+/*      descriptor whose blocks are dropped after use.                  */
+/* -------------------------------------------------------------------- */
+    psFile->fd = -1;
+#if defined(O_DIRECT)
+    psFile->fd = open( pszFilename, O_RDONLY | O_DIRECT );
+    psFile->bDirect = psFile->fd >= 0;
+#endif
+    if( psFile->fd < 0 )
+    {
+        psFile->fd = open( pszFilename, O_RDONLY );
+#if defined(F_NOCACHE)
+        if( psFile->fd >= 0 )
+            psFile->bDirect = fcntl( psFile->fd, F_NOCACHE, 1 ) != -1;
+#endif
+    }
+
+    struct stat sStat;
+    if( psFile->fd < 0 || fstat( psFile->fd, &sStat ) != 0 )
+    {
+        if( psFile->fd >= 0 )
+            close( psFile->fd );
+        free( psFile->pabyBlock );
+        free( psFile );
+        return SHPLIB_NULLPTR;
+    }
+    psFile->nFileSize = STATIC_CAST(SAOffset, sStat.st_size);
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    if( !psFile->bDirect )
+        posix_fadvise( psFile->fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+
+    return psFile;
+}
+
+/************************************************************************/
+/*                           SADIOLoadBlock()                           */
+/*                                                                      */
+/*      Load the aligned block holding nPos.  Returns false on error    */
+/*      or at end of file.                                              */
+/************************************************************************/
+
+static bool SADIOLoadBlock( SADIOFile *psFile, SAOffset nPos ) {
+    if( nPos >= psFile->nFileSize )
+        return false;
+
+    const SAOffset nStart = nPos - nPos % SADIO_BLOCK_SIZE;
+
+#ifdef POSIX_FADV_DONTNEED
+    /* The previous block will not be needed again in a scan. */
+    if( !psFile->bDirect && psFile->nBlockLen > 0 )
+        posix_fadvise( psFile->fd, STATIC_CAST(off_t, psFile->nBlockStart),
+                       STATIC_CAST(off_t, psFile->nBlockLen),
+                       POSIX_FADV_DONTNEED );
+#endif
+
+    psFile->nBlockLen = 0;
+    SAOffset nLen = 0;
+    while( nLen < SADIO_BLOCK_SIZE && nStart + nLen < psFile->nFileSize )
+    {
+        const ssize_t nRet = pread( psFile->fd, psFile->pabyBlock + nLen,
+                                    SADIO_BLOCK_SIZE - nLen,
+                                    STATIC_CAST(off_t, nStart + nLen) );
+        if( nRet < 0 && errno == EINTR )
+            continue;
+
+        /* Some file systems only refuse O_DIRECT at read time. */
+        if( nRet < 0 && errno == EINVAL && psFile->bDirect )
+        {
+#if defined(O_DIRECT)
+            const int nFlags = fcntl( psFile->fd, F_GETFL );
+            if( nFlags == -1 ||
+                fcntl( psFile->fd, F_SETFL, nFlags & ~O_DIRECT ) == -1 )
+                return false;
+#endif
+            psFile->bDirect = false;
+            continue;
+        }
+
+        if( nRet <= 0 )
+            break;
+        nLen += nRet;
+    }
+
+    if( nLen == 0 )
+        return false;
+
+    psFile->nBlockStart = nStart;
+    psFile->nBlockLen = nLen;
+    return true;
+}
+
+/************************************************************************/
+/*                             SADIOFOpen()                             */
+/************************************************************************/
+
+static SAFile SADIOFOpen( const char *pszFilename, const char *pszAccess ) {
+    SADIOFile *psFile;
+
+    if( strchr( pszAccess, 'w' ) == SHPLIB_NULLPTR &&
+        strchr( pszAccess, 'a' ) == SHPLIB_NULLPTR &&
+        strchr( pszAccess, '+' ) == SHPLIB_NULLPTR )
+    {
+        psFile = SADIOOpenRead( pszFilename );
+    }
+    else
+    {
+        FILE *fp = fopen( pszFilename, pszAccess );
+        if( fp == SHPLIB_NULLPTR )
+            return SHPLIB_NULLPTR;
+
+        psFile = STATIC_CAST(SADIOFile *, calloc(1, sizeof(SADIOFile)));
+        if( psFile == SHPLIB_NULLPTR )
+        {
+            fclose( fp );
+            return SHPLIB_NULLPTR;
+        }
+        psFile->fp = fp;
+        psFile->fd = -1;
+    }
+
+    return STATIC_CAST(SAFile, STATIC_CAST(void *, psFile));
+}
+
+/************************************************************************/
+/*                             SADIOFRead()                             */
+/************************************************************************/
+
+static SAOffset SADIOFRead( void *p, SAOffset size, SAOffset nmemb,
+                          SAFile file ) {
+    SADIOFile *psFile = STATIC_CAST(SADIOFile *, STATIC_CAST(void *, file));
+
+    if( psFile->fp != SHPLIB_NULLPTR )
+        return STATIC_CAST(SAOffset, fread( p, STATIC_CAST(size_t, size),
+                                            STATIC_CAST(size_t, nmemb), psFile->fp ));
+
+    if( size == 0 || nmemb == 0 )
+        return 0;
+
+    unsigned char *pabyDst = STATIC_CAST(unsigned char *, p);
+    const SAOffset nWanted = size * nmemb;
+    SAOffset nDone = 0;
+
+    while( nDone < nWanted )
+    {
+        const SAOffset nPos = psFile->nPos + nDone;
+        if( psFile->nBlockLen == 0 || nPos < psFile->nBlockStart ||
+            nPos >= psFile->nBlockStart + psFile->nBlockLen )
+        {
+            if( !SADIOLoadBlock( psFile, nPos ) )
+                break;
+        }
+
+        const SAOffset nOffset = nPos - psFile->nBlockStart;
+        SAOffset nBytes = psFile->nBlockLen - nOffset;
+        if( nBytes > nWanted - nDone )
+            nBytes = nWanted - nDone;
+        memcpy( pabyDst + nDone, psFile->pabyBlock + nOffset, nBytes );
+        nDone += nBytes;
+    }
+
+    psFile->nPos += nDone;
+    return nDone / size;
+}
+
+/************************************************************************/
+/*                            SADIOFWrite()                             */
+/************************************************************************/
+
+static SAOffset SADIOFWrite( void *p, SAOffset size, SAOffset nmemb,
+                           SAFile file ) {
+    SADIOFile *psFile = STATIC_CAST(SADIOFile *, STATIC_CAST(void *, file));
+
+    if( psFile->fp == SHPLIB_NULLPTR )
+        return 0;
+
+    return STATIC_CAST(SAOffset, fwrite( p, STATIC_CAST(size_t, size),
+                                         STATIC_CAST(size_t, nmemb), psFile->fp ));
+}
+
+/************************************************************************/
+/*                             SADIOFSeek()                             */
+/************************************************************************/
+
+static SAOffset SADIOFSeek( SAFile file, SAOffset offset, int whence ) {
+    SADIOFile *psFile = STATIC_CAST(SADIOFile *, STATIC_CAST(void *, file));
+
+    if( psFile->fp != SHPLIB_NULLPTR )
+        return STATIC_CAST(SAOffset, fseeko( psFile->fp,
+                                             STATIC_CAST(off_t, offset), whence ));
+
+    switch( whence )
+    {
+      case SEEK_SET:
+        psFile->nPos = offset;
+        break;
+
+      case SEEK_CUR:
+        psFile->nPos += offset;
+        break;
+
+      case SEEK_END:
+        psFile->nPos = psFile->nFileSize + offset;
+        break;
+
+      default:
+        return STATIC_CAST(SAOffset, -1);
+    }
+
+    return 0;
+}
+
+/************************************************************************/
+/*                             SADIOFTell()                             */
+/************************************************************************/
+
+static SAOffset SADIOFTell( SAFile file ) {
+    SADIOFile *psFile = STATIC_CAST(SADIOFile *, STATIC_CAST(void *, file));
+
+    if( psFile->fp != SHPLIB_NULLPTR )
+        return STATIC_CAST(SAOffset, ftello( psFile->fp ));
+
+    return psFile->nPos;
+}
+
+/************************************************************************/
+/*                            SADIOFFlush()                             */
+/************************************************************************/
+
+static int SADIOFFlush( SAFile file ) {
+    SADIOFile *psFile = STATIC_CAST(SADIOFile *, STATIC_CAST(void *, file));
+
+    if( psFile->fp != SHPLIB_NULLPTR )
+        return fflush( psFile->fp );
+
+    return 0;
+}
+
+/************************************************************************/
+/*                            SADIOFClose()                             */
+/************************************************************************/
+
+static int SADIOFClose( SAFile file ) {
+    SADIOFile *psFile = STATIC_CAST(SADIOFile *, STATIC_CAST(void *, file));
+    int nRet = 0;
+
+    if( psFile->fp != SHPLIB_NULLPTR )
+    {
+        nRet = fclose( psFile->fp );
+    }
+    else
+    {
+#ifdef POSIX_FADV_DONTNEED
+        if( !psFile->bDirect && psFile->nBlockLen > 0 )
+            posix_fadvise( psFile->fd, STATIC_CAST(off_t, psFile->nBlockStart),
+                           STATIC_CAST(off_t, psFile->nBlockLen),
+                           POSIX_FADV_DONTNEED );
+#endif
+        nRet = close( psFile->fd );
+    }
+
+    free( psFile->pabyBlock );
+    free( psFile );
+
+    return nRet;
+}
+
+/************************************************************************/
+/*                            SADIOFFileno()                            */
+/*                                                                      */
+/*      Unaligned pread() calls are not allowed on O_DIRECT             */
+/*      descriptors, and would defeat the purpose of these hooks.       */
+/************************************************************************/
+
+static int SADIOFFileno( SAFile file ) {
+    SADIOFile *psFile = STATIC_CAST(SADIOFile *, STATIC_CAST(void *, file));
+
+    if( psFile->fp != SHPLIB_NULLPTR )
+        return fileno( psFile->fp );
+
+    return -1;
+}
+
+/************************************************************************/
+/*                            SADIOFAdvise()                            */
+/*                                                                      */
+/*      These hooks always behave as for a sequential scan.             */
+/************************************************************************/
+
+static int SADIOFAdvise( SAFile file, SAOffset nOffset, SAOffset nLen,
+                       int nAdvice ) {
+    (void)file;
+    (void)nOffset;
+    (void)nLen;
+    (void)nAdvice;
+    return 0;
+}
+
+#endif /* ndef SHPAPI_WINDOWS */
+
+/************************************************************************/
+/*                        goSASetupDirectHooks()                        */
+/*                                                                      */
+/*      Hooks for full layer batch jobs: files opened for reading are   */
+/*      read in large blocks without going through the page cache.     */
+/*      Random access still works, but every seek outside the current  */
+/*      block costs a full block read.                                  */
+/************************************************************************/
+
+void goSASetupDirectHooks( SAHooks *psHooks ) {
+    goSASetupDefaultHooks( psHooks );
+
+#ifndef SHPAPI_WINDOWS
+    psHooks->FOpen   = SADIOFOpen;
+    psHooks->FRead   = SADIOFRead;
+    psHooks->FWrite  = SADIOFWrite;
+    psHooks->FSeek   = SADIOFSeek;
+    psHooks->FTell   = SADIOFTell;
+    psHooks->FFlush  = SADIOFFlush;
+    psHooks->FClose  = SADIOFClose;
+    psHooks->FFileno = SADIOFFileno;
+    psHooks->FAdvise = SADIOFAdvise;
+#endif
+}
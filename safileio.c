@@ -34,6 +34,10 @@
  *
  */
 
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64 /* fseeko()/ftello() beyond 2 GB */
+#endif
+
 #include "shapefil.h"
 
 #include <assert.h>
@@ -45,6 +49,10 @@
 
 SHP_CVSID("$Id$");
 
+#ifndef SHPAPI_WINDOWS
+#   include <fcntl.h>
+#endif
+
 #ifdef SHPAPI_UTF8_HOOKS
 #   ifdef SHPAPI_WINDOWS
 #       define WIN32_LEAN_AND_MEAN
@@ -67,11 +75,19 @@ static SAOffset SADFWrite(void *p, SAOffset size, SAOffset nmemb, SAFile file) {
 }
 
 static SAOffset SADFSeek(SAFile file, SAOffset offset, int whence) {
-    return (SAOffset)fseek((FILE *) file, (long) offset, whence);
+#if defined(SHPAPI_WINDOWS)
+    return (SAOffset)_fseeki64((FILE *) file, (__int64) offset, whence);
+#else
+    return (SAOffset)fseeko((FILE *) file, (off_t) offset, whence);
+#endif
 }
 
 static SAOffset SADFTell(SAFile file) {
-    return (SAOffset)ftell((FILE *)file);
+#if defined(SHPAPI_WINDOWS)
+    return (SAOffset)_ftelli64((FILE *)file);
+#else
+    return (SAOffset)ftello((FILE *)file);
+#endif
 }
 
 static int SADFFlush(SAFile file) {
@@ -82,6 +98,33 @@ static int SADFClose(SAFile file) {
     return fclose((FILE *) file);
 }
 
+static int SADFFileno(SAFile file) {
+#ifdef SHPAPI_WINDOWS
+    (void)file;
+    return -1;
+#else
+    return fileno((FILE *) file);
+#endif
+}
+
+static int SADFAdvise(SAFile file, SAOffset offset, SAOffset len, int advice) {
+#if !defined(SHPAPI_WINDOWS) && defined(POSIX_FADV_NORMAL)
+    static const int anAdvice[] = { POSIX_FADV_NORMAL, POSIX_FADV_SEQUENTIAL,
+                                    POSIX_FADV_RANDOM, POSIX_FADV_WILLNEED,
+                                    POSIX_FADV_DONTNEED };
+    if (advice < 0 || advice >= (int)(sizeof(anAdvice) / sizeof(anAdvice[0])))
+        return -1;
+    return posix_fadvise(fileno((FILE *) file), (off_t) offset, (off_t) len,
+                         anAdvice[advice]);
+#else
+    (void)file;
+    (void)offset;
+    (void)len;
+    (void)advice;
+    return 0;
+#endif
+}
+
 static int SADRemove(const char *filename) {
     return remove(filename);
 }
@@ -98,6 +141,8 @@ void goSASetupDefaultHooks(SAHooks *psHooks) {
     psHooks->FTell   = SADFTell;
     psHooks->FFlush  = SADFFlush;
     psHooks->FClose  = SADFClose;
+    psHooks->FFileno = SADFFileno;
+    psHooks->FAdvise = SADFAdvise;
     psHooks->Remove  = SADRemove;
 
     psHooks->Error   = SADError;
@@ -165,6 +210,8 @@ void SASetupUtf8Hooks(SAHooks *psHooks) {
     psHooks->FTell   = SADFTell;
     psHooks->FFlush  = SADFFlush;
     psHooks->FClose  = SADFClose;
+    psHooks->FFileno = SADFFileno;
+    psHooks->FAdvise = SADFAdvise;
 
     psHooks->Error   = SADError;
     psHooks->Atof    = atof;
@@ -0,0 +1,1360 @@
+/******************************************************************************
+ *
+ * Project:  Shapelib
+ * Purpose:  Read-only file io hooks serving members of .zip archives and
+ *           gzip compressed files, with a random access index over the
+ *           deflated data.
+ *
+ ******************************************************************************
+ *
+ * This software is available under the following "MIT Style" license,
+ * or at the option of the licensee under the LGPL (see COPYING).  This
+ * option is discussed in more detail in shapelib.html.
+ *
+ * --
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************
+ *
+ * A file name of the form "archive.zip/member.shp" is served from the named
+ * member of the archive.  Any other name is opened as a regular file, and
+ * if that fails in read mode, "name.gz" is tried as a gzip stream.
+ *
+ * Stored members are read in place.  Deflated data is decoded in chunks
+ * by a background thread which runs ahead of the reader.  While decoding,
+ * access points (the 32 KB deflate window at a block boundary) are
+ * recorded every SAZ_SPAN bytes, so that seeking backwards only needs to
+ * restart from the nearest access point instead of from the beginning.
+ */
+
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include "shapefil.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+SHP_CVSID("$Id$")
+
+#ifdef __cplusplus
+#define STATIC_CAST(type,x) static_cast<type>(x)
+#define SHPLIB_NULLPTR nullptr
+#else
+#define STATIC_CAST(type,x) ((type)(x))
+#define SHPLIB_NULLPTR NULL
+#endif
+
+#ifdef SHP_HAVE_ZLIB
+
+#include <zlib.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+/* Size of the deflate history window. */
+#define SAZ_WINDOW_SIZE     32768
+
+/* Compressed bytes read from the archive at a time. */
+#define SAZ_INPUT_SIZE      65536
+
+/* Minimum distance in uncompressed bytes between two access points. */
+#define SAZ_SPAN            (1024 * 1024)
+
+/* Unit of decoding and caching. */
+#define SAZ_CHUNK_SIZE      (256 * 1024)
+
+/* Number of decoded chunks the background thread may keep ahead. */
+#define SAZ_READAHEAD       4
+
+#define SAZ_CHUNK_FREE      0
+#define SAZ_CHUNK_FILLING   1
+#define SAZ_CHUNK_READY     2
+
+typedef enum
+{
+    SAZPlain,
+    SAZStored,
+    SAZDeflate
+} SAZKind;
+
+typedef struct
+{
+    SAOffset        nOut;       /* uncompressed offset of the access point */
+    SAOffset        nIn;        /* compressed offset of the first full byte */
+    int             nBits;      /* bits of the byte before nIn still unused */
+    unsigned char  *pabyWindow; /* SAZ_WINDOW_SIZE bytes preceding nOut */
+} SAZAccessPoint;
+
+typedef struct
+{
+    FILE           *fp;         /* shared with the owning SAZFile */
+    SAOffset        nDataStart; /* offset of the raw deflate data in fp */
+    SAOffset        nDataEnd;   /* end of the compressed data in fp */
+
+    z_stream        sStream;
+    SAOffset        nInRead;    /* compressed bytes read from fp */
+    SAOffset        nOut;       /* uncompressed bytes produced */
+    bool            bEOF;
+
+    unsigned char   abyInput[SAZ_INPUT_SIZE];
+    unsigned char   abyWindow[SAZ_WINDOW_SIZE];
+
+    SAZAccessPoint *pasPoints;
+    int             nPoints;
+    int             nMaxPoints;
+} SAZInflater;
+
+typedef struct
+{
+    SAOffset        nChunk;
+    int             nLen;
+    int             eState;     /* SAZ_CHUNK_* */
+    unsigned char  *pabyData;
+} SAZChunk;
+
+typedef struct
+{
+    SAZKind         eKind;
+    FILE           *fp;         /* plain files and stored members */
+    SAOffset        nStart;     /* stored members: offset of the data in fp */
+    SAOffset        nSize;      /* uncompressed size, if bSizeKnown */
+    bool            bSizeKnown;
+    SAOffset        nPos;       /* current position */
+
+/* -------------------------------------------------------------------- */
+/*      Deflated members and gzip streams.  The inflater is guarded by  */
+/*      hDecodeLock, the chunk cache and worker state by hQueueLock.    */
+/*      hDecodeLock is never acquired while holding hQueueLock.         */
+/* -------------------------------------------------------------------- */
+    SAZInflater    *psInflater;
+    pthread_mutex_t hDecodeLock;
+
+    SAZChunk        asChunks[SAZ_READAHEAD];
+    pthread_mutex_t hQueueLock;
+    pthread_cond_t  hQueueCond;
+    pthread_t       hWorker;
+    bool            bWorkerTried;
+    bool            bWorkerRunning;
+    bool            bNoReadAhead; /* random access: decode on demand only */
+    bool            bStop;
+    bool            bError;
+    bool            bEndKnown;
+    SAOffset        nEndChunk;  /* first chunk past the end, if bEndKnown */
+    SAOffset        nNextChunk; /* next chunk the worker decodes */
+    int             nGeneration;/* bumped when the reader repositions */
+} SAZFile;
+
+/************************************************************************/
+/*                         Little endian helpers                        */
+/************************************************************************/
+
+static unsigned SAZGetUInt16( const unsigned char *pabyData ) {
+    return pabyData[0] | (STATIC_CAST(unsigned, pabyData[1]) << 8);
+}
+
+static unsigned SAZGetUInt32( const unsigned char *pabyData ) {
+    return pabyData[0] | (STATIC_CAST(unsigned, pabyData[1]) << 8) |
+           (STATIC_CAST(unsigned, pabyData[2]) << 16) |
+           (STATIC_CAST(unsigned, pabyData[3]) << 24);
+}
+
+static SAOffset SAZGetUInt64( const unsigned char *pabyData ) {
+    return STATIC_CAST(SAOffset, SAZGetUInt32(pabyData)) |
+           (STATIC_CAST(SAOffset, SAZGetUInt32(pabyData + 4)) << 32);
+}
+
+/************************************************************************/
+/*                        SAZSeek() / SAZTell()                         */
+/************************************************************************/
+
+static int SAZSeek( FILE *fp, SAOffset nOffset, int nWhence ) {
+    return fseeko( fp, STATIC_CAST(off_t, nOffset), nWhence );
+}
+
+static SAOffset SAZTell( FILE *fp ) {
+    return STATIC_CAST(SAOffset, ftello( fp ));
+}
+
+/************************************************************************/
+/*                         SAZInflaterCreate()                          */
+/************************************************************************/
+
+static SAZInflater *SAZInflaterCreate( FILE *fp, SAOffset nDataStart,
+                                       SAOffset nDataEnd ) {
+    SAZInflater *psInf = STATIC_CAST(SAZInflater *, calloc(1, sizeof(SAZInflater)));
+    if( psInf == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+    /* Raw deflate, so that access points can be primed with inflatePrime() */
+    if( inflateInit2( &(psInf->sStream), -15 ) != Z_OK )
+    {
+        free( psInf );
+        return SHPLIB_NULLPTR;
+    }
+
+    psInf->fp = fp;
+    psInf->nDataStart = nDataStart;
+    psInf->nDataEnd = nDataEnd;
+
+    if( SAZSeek( fp, nDataStart, SEEK_SET ) != 0 )
+    {
+        inflateEnd( &(psInf->sStream) );
+        free( psInf );
+        return SHPLIB_NULLPTR;
+    }
+
+    return psInf;
+}
+
+/************************************************************************/
+/*                         SAZInflaterDestroy()                         */
+/************************************************************************/
+
+static void SAZInflaterDestroy( SAZInflater *psInf ) {
+    if( psInf == SHPLIB_NULLPTR )
+        return;
+
+    for( int i = 0; i < psInf->nPoints; i++ )
+        free( psInf->pasPoints[i].pabyWindow );
+    free( psInf->pasPoints );
+
+    inflateEnd( &(psInf->sStream) );
+    free( psInf );
+}
+
+/************************************************************************/
+/*                        SAZInflaterAddPoint()                         */
+/*                                                                      */
+/*      Record an access point at the current position, which must be  */
+/*      a deflate block boundary.  Failure to allocate is not fatal:    */
+/*      it only makes later seeks more expensive.                       */
+/************************************************************************/
+
+static void SAZInflaterAddPoint( SAZInflater *psInf ) {
+    if( psInf->nPoints == psInf->nMaxPoints )
+    {
+        const int nNewMax = psInf->nMaxPoints * 2 + 16;
+        SAZAccessPoint *pasNew = STATIC_CAST(SAZAccessPoint *,
+            realloc( psInf->pasPoints, sizeof(SAZAccessPoint) * nNewMax ));
+        if( pasNew == SHPLIB_NULLPTR )
+            return;
+        psInf->pasPoints = pasNew;
+        psInf->nMaxPoints = nNewMax;
+    }
+
+    unsigned char *pabyWindow = STATIC_CAST(unsigned char *, malloc(SAZ_WINDOW_SIZE));
+    if( pabyWindow == SHPLIB_NULLPTR )
+        return;
+
+    /* Linearize the circular window so that it ends at nOut. */
+    const int nWinPos = STATIC_CAST(int, psInf->nOut % SAZ_WINDOW_SIZE);
+    memcpy( pabyWindow, psInf->abyWindow + nWinPos, SAZ_WINDOW_SIZE - nWinPos );
+    memcpy( pabyWindow + SAZ_WINDOW_SIZE - nWinPos, psInf->abyWindow, nWinPos );
+
+    SAZAccessPoint *psPoint = psInf->pasPoints + psInf->nPoints;
+    psPoint->nOut = psInf->nOut;
+    psPoint->nIn = psInf->nInRead - psInf->sStream.avail_in;
+    psPoint->nBits = psInf->sStream.data_type & 7;
+    psPoint->pabyWindow = pabyWindow;
+    psInf->nPoints++;
+}
+
+/************************************************************************/
+/*                       SAZInflaterRestart()                           */
+/*                                                                      */
+/*      Restart decoding at an access point, or at the beginning of     */
+/*      the stream if psPoint is NULL.                                  */
+/************************************************************************/
+
+static bool SAZInflaterRestart( SAZInflater *psInf,
+                                const SAZAccessPoint *psPoint ) {
+    inflateReset( &(psInf->sStream) );
+    psInf->sStream.avail_in = 0;
+    psInf->bEOF = false;
+
+    if( psPoint == SHPLIB_NULLPTR )
+    {
+        psInf->nInRead = 0;
+        psInf->nOut = 0;
+        return SAZSeek( psInf->fp, psInf->nDataStart, SEEK_SET ) == 0;
+    }
+
+    psInf->nInRead = psPoint->nIn - (psPoint->nBits ? 1 : 0);
+    if( SAZSeek( psInf->fp, psInf->nDataStart + psInf->nInRead, SEEK_SET ) != 0 )
+        return false;
+
+    if( psPoint->nBits )
+    {
+        const int nByte = getc( psInf->fp );
+        if( nByte == EOF )
+            return false;
+        psInf->nInRead++;
+        inflatePrime( &(psInf->sStream), psPoint->nBits,
+                      nByte >> (8 - psPoint->nBits) );
+    }
+
+    const SAOffset nDictLen = psPoint->nOut < SAZ_WINDOW_SIZE ?
+        psPoint->nOut : SAZ_WINDOW_SIZE;
+    inflateSetDictionary( &(psInf->sStream),
+                          psPoint->pabyWindow + SAZ_WINDOW_SIZE - nDictLen,
+                          STATIC_CAST(uInt, nDictLen) );
+
+    /* Restore the circular window, so later access points are correct. */
+    psInf->nOut = psPoint->nOut;
+    const int nWinPos = STATIC_CAST(int, psInf->nOut % SAZ_WINDOW_SIZE);
+    memcpy( psInf->abyWindow + nWinPos, psPoint->pabyWindow,
+            SAZ_WINDOW_SIZE - nWinPos );
+    memcpy( psInf->abyWindow, psPoint->pabyWindow + SAZ_WINDOW_SIZE - nWinPos,
+            nWinPos );
+
+    return true;
+}
+
+/************************************************************************/
+/*                          SAZInflaterRead()                           */
+/*                                                                      */
+/*      Decode up to nWanted bytes into pabyOut, or discard them if     */
+/*      pabyOut is NULL.  *pnDone receives the number of bytes          */
+/*      produced, which is short only at the end of the stream.         */
+/************************************************************************/
+
+static bool SAZInflaterRead( SAZInflater *psInf, unsigned char *pabyOut,
+                             SAOffset nWanted, SAOffset *pnDone ) {
+    SAOffset nDone = 0;
+    *pnDone = 0;
+    z_stream *psStream = &(psInf->sStream);
+
+    while( nDone < nWanted && !psInf->bEOF )
+    {
+        /* The final block may still complete without further input. */
+        const SAOffset nLeft =
+            psInf->nDataEnd - psInf->nDataStart - psInf->nInRead;
+        if( psStream->avail_in == 0 && nLeft > 0 )
+        {
+            const size_t nToRead = nLeft < SAZ_INPUT_SIZE ?
+                STATIC_CAST(size_t, nLeft) : SAZ_INPUT_SIZE;
+            const size_t nRead = fread( psInf->abyInput, 1, nToRead, psInf->fp );
+            if( nRead == 0 )
+                return false;
+            psInf->nInRead += nRead;
+            psStream->next_in = psInf->abyInput;
+            psStream->avail_in = STATIC_CAST(uInt, nRead);
+        }
+
+        const int nWinPos = STATIC_CAST(int, psInf->nOut % SAZ_WINDOW_SIZE);
+        SAOffset nAvail = SAZ_WINDOW_SIZE - nWinPos;
+        if( nAvail > nWanted - nDone )
+            nAvail = nWanted - nDone;
+        psStream->next_out = psInf->abyWindow + nWinPos;
+        psStream->avail_out = STATIC_CAST(uInt, nAvail);
+
+        const int nRet = inflate( psStream, Z_BLOCK );
+        if( nRet == Z_NEED_DICT || nRet == Z_DATA_ERROR ||
+            nRet == Z_MEM_ERROR || nRet == Z_STREAM_ERROR )
+            return false;
+
+        const SAOffset nProduced = nAvail - psStream->avail_out;
+        /* No progress possible: corrupted or truncated stream */
+        if( nRet == Z_BUF_ERROR && nProduced == 0 )
+            return false;
+
+        if( pabyOut != SHPLIB_NULLPTR && nProduced > 0 )
+            memcpy( pabyOut + nDone, psInf->abyWindow + nWinPos, nProduced );
+        nDone += nProduced;
+        *pnDone = nDone;
+        psInf->nOut += nProduced;
+
+        if( nRet == Z_STREAM_END )
+        {
+            psInf->bEOF = true;
+            break;
+        }
+
+/* -------------------------------------------------------------------- */
+/*      At the end of a block which is not the last one, record an      */
+/*      access point if we are far enough from the previous one.        */
+/* -------------------------------------------------------------------- */
+        if( (psStream->data_type & 128) && !(psStream->data_type & 64) )
+        {
+            const SAOffset nLast = psInf->nPoints == 0 ? 0 :
+                psInf->pasPoints[psInf->nPoints-1].nOut;
+            if( psInf->nOut >= nLast + SAZ_SPAN )
+                SAZInflaterAddPoint( psInf );
+        }
+    }
+
+    return true;
+}
+
+/************************************************************************/
+/*                          SAZInflaterSeek()                           */
+/*                                                                      */
+/*      Position the inflater so that the next byte produced is at      */
+/*      uncompressed offset nTarget.  Returns false if the stream ends  */
+/*      before nTarget or on error.                                     */
+/************************************************************************/
+
+static bool SAZInflaterSeek( SAZInflater *psInf, SAOffset nTarget ) {
+    if( psInf->nOut == nTarget )
+        return true;
+
+    /* Find the last access point at or before the target. */
+    const SAZAccessPoint *psBest = SHPLIB_NULLPTR;
+    int iLow = 0;
+    int iHigh = psInf->nPoints - 1;
+    while( iLow <= iHigh )
+    {
+        const int iMid = (iLow + iHigh) / 2;
+        if( psInf->pasPoints[iMid].nOut <= nTarget )
+        {
+            psBest = psInf->pasPoints + iMid;
+            iLow = iMid + 1;
+        }
+        else
+        {
+            iHigh = iMid - 1;
+        }
+    }
+
+    const SAOffset nBestOut = psBest ? psBest->nOut : 0;
+    if( psInf->nOut > nTarget || psInf->nOut < nBestOut )
+    {
+        if( !SAZInflaterRestart( psInf, psBest ) )
+            return false;
+    }
+
+    const SAOffset nSkip = nTarget - psInf->nOut;
+    SAOffset nDone = 0;
+    return SAZInflaterRead( psInf, SHPLIB_NULLPTR, nSkip, &nDone ) &&
+           nDone == nSkip;
+}
+
+/************************************************************************/
+/*                          SAZProduceChunk()                           */
+/*                                                                      */
+/*      Decode one chunk.  Must be called with hDecodeLock held.        */
+/************************************************************************/
+
+static int SAZProduceChunk( SAZFile *psFile, SAOffset nChunk,
+                            unsigned char *pabyOut ) {
+    SAZInflater *psInf = psFile->psInflater;
+    const SAOffset nStart = nChunk * SAZ_CHUNK_SIZE;
+
+    if( !SAZInflaterSeek( psInf, nStart ) )
+        return psInf->bEOF ? 0 : -1;
+
+    SAOffset nDone = 0;
+    if( !SAZInflaterRead( psInf, pabyOut, SAZ_CHUNK_SIZE, &nDone ) )
+        return -1;
+
+    return STATIC_CAST(int, nDone);
+}
+
+/************************************************************************/
+/*                            SAZWorkerMain()                           */
+/*                                                                      */
+/*      Background thread decoding chunks ahead of the reader.          */
+/************************************************************************/
+
+static void *SAZWorkerMain( void *pData ) {
+    SAZFile *psFile = STATIC_CAST(SAZFile *, pData);
+
+    pthread_mutex_lock( &(psFile->hQueueLock) );
+    while( !psFile->bStop )
+    {
+        SAZChunk *psChunk = SHPLIB_NULLPTR;
+        if( !psFile->bError &&
+            !(psFile->bEndKnown && psFile->nNextChunk >= psFile->nEndChunk) )
+        {
+            for( int i = 0; i < SAZ_READAHEAD; i++ )
+            {
+                if( psFile->asChunks[i].eState == SAZ_CHUNK_FREE )
+                {
+                    psChunk = psFile->asChunks + i;
+                    break;
+                }
+            }
+        }
+
+        if( psChunk == SHPLIB_NULLPTR )
+        {
+            pthread_cond_wait( &(psFile->hQueueCond), &(psFile->hQueueLock) );
+            continue;
+        }
+
+        const SAOffset nChunk = psFile->nNextChunk++;
+        const int nGeneration = psFile->nGeneration;
+        psChunk->eState = SAZ_CHUNK_FILLING;
+        psChunk->nChunk = nChunk;
+        pthread_mutex_unlock( &(psFile->hQueueLock) );
+
+        pthread_mutex_lock( &(psFile->hDecodeLock) );
+        const int nLen = SAZProduceChunk( psFile, nChunk, psChunk->pabyData );
+        pthread_mutex_unlock( &(psFile->hDecodeLock) );
+
+        pthread_mutex_lock( &(psFile->hQueueLock) );
+        if( nLen < 0 )
+        {
+            psChunk->eState = SAZ_CHUNK_FREE;
+            if( nGeneration == psFile->nGeneration )
+                psFile->bError = true;
+        }
+        else
+        {
+            if( nLen < SAZ_CHUNK_SIZE && !psFile->bEndKnown )
+            {
+                psFile->bEndKnown = true;
+                psFile->nEndChunk = nLen == 0 ? nChunk : nChunk + 1;
+            }
+
+            if( nGeneration == psFile->nGeneration )
+            {
+                psChunk->nLen = nLen;
+                psChunk->eState = SAZ_CHUNK_READY;
+            }
+            else
+            {
+                psChunk->eState = SAZ_CHUNK_FREE;
+            }
+        }
+        pthread_cond_broadcast( &(psFile->hQueueCond) );
+    }
+    pthread_mutex_unlock( &(psFile->hQueueLock) );
+
+    return SHPLIB_NULLPTR;
+}
+
+/************************************************************************/
+/*                          SAZReadChunkSync()                          */
+/*                                                                      */
+/*      Fallback used when the background thread could not be started: */
+/*      the first cache slot holds the last decoded chunk.              */
+/************************************************************************/
+
+static int SAZReadChunkSync( SAZFile *psFile, SAOffset nChunk, int nOffset,
+                             unsigned char *pabyDst, int nBytes ) {
+    SAZChunk *psChunk = psFile->asChunks + 0;
+
+    pthread_mutex_lock( &(psFile->hDecodeLock) );
+    if( psChunk->eState != SAZ_CHUNK_READY || psChunk->nChunk != nChunk )
+    {
+        const int nLen = SAZProduceChunk( psFile, nChunk, psChunk->pabyData );
+        if( nLen < 0 )
+        {
+            psChunk->eState = SAZ_CHUNK_FREE;
+            pthread_mutex_unlock( &(psFile->hDecodeLock) );
+            return -1;
+        }
+        psChunk->nChunk = nChunk;
+        psChunk->nLen = nLen;
+        psChunk->eState = SAZ_CHUNK_READY;
+    }
+    pthread_mutex_unlock( &(psFile->hDecodeLock) );
+
+    if( nOffset >= psChunk->nLen )
+        return 0;
+    if( nBytes > psChunk->nLen - nOffset )
+        nBytes = psChunk->nLen - nOffset;
+    memcpy( pabyDst, psChunk->pabyData + nOffset, nBytes );
+    return nBytes;
+}
+
+/************************************************************************/
+/*                            SAZReadChunk()                            */
+/*                                                                      */
+/*      Copy up to nBytes from offset nOffset of chunk nChunk.  Returns */
+/*      the number of bytes copied, 0 past the end, or -1 on error.     */
+/************************************************************************/
+
+static int SAZReadChunk( SAZFile *psFile, SAOffset nChunk, int nOffset,
+                         unsigned char *pabyDst, int nBytes ) {
+    if( !psFile->bWorkerTried && !psFile->bNoReadAhead )
+    {
+        psFile->bWorkerTried = true;
+        psFile->nNextChunk = nChunk;
+        psFile->bWorkerRunning =
+            pthread_create( &(psFile->hWorker), SHPLIB_NULLPTR,
+                            SAZWorkerMain, psFile ) == 0;
+    }
+
+    if( !psFile->bWorkerRunning )
+        return SAZReadChunkSync( psFile, nChunk, nOffset, pabyDst, nBytes );
+
+    int nRet = -1;
+    pthread_mutex_lock( &(psFile->hQueueLock) );
+    for( ;; )
+    {
+/* -------------------------------------------------------------------- */
+/*      Recycle the chunks the reader has moved past, and look for the  */
+/*      requested one.                                                  */
+/* -------------------------------------------------------------------- */
+        SAZChunk *psFound = SHPLIB_NULLPTR;
+        bool bFilling = false;
+        for( int i = 0; i < SAZ_READAHEAD; i++ )
+        {
+            SAZChunk *psChunk = psFile->asChunks + i;
+            if( psChunk->eState == SAZ_CHUNK_READY && psChunk->nChunk < nChunk )
+            {
+                psChunk->eState = SAZ_CHUNK_FREE;
+                pthread_cond_broadcast( &(psFile->hQueueCond) );
+            }
+            else if( psChunk->nChunk == nChunk )
+            {
+                if( psChunk->eState == SAZ_CHUNK_READY )
+                    psFound = psChunk;
+                else if( psChunk->eState == SAZ_CHUNK_FILLING )
+                    bFilling = true;
+            }
+        }
+
+        if( psFound != SHPLIB_NULLPTR )
+        {
+            nRet = 0;
+            if( nOffset < psFound->nLen )
+            {
+                nRet = nBytes < psFound->nLen - nOffset ?
+                    nBytes : psFound->nLen - nOffset;
+                memcpy( pabyDst, psFound->pabyData + nOffset, nRet );
+            }
+            break;
+        }
+
+        if( psFile->bEndKnown && nChunk >= psFile->nEndChunk )
+        {
+            nRet = 0;
+            break;
+        }
+
+        if( psFile->bError )
+            break;
+
+/* -------------------------------------------------------------------- */
+/*      If the worker will not reach the chunk soon, restart it there.  */
+/* -------------------------------------------------------------------- */
+        if( !bFilling &&
+            (nChunk < psFile->nNextChunk ||
+             nChunk >= psFile->nNextChunk + SAZ_READAHEAD) )
+        {
+            psFile->nGeneration++;
+            psFile->nNextChunk = nChunk;
+            for( int i = 0; i < SAZ_READAHEAD; i++ )
+            {
+                if( psFile->asChunks[i].eState == SAZ_CHUNK_READY )
+                    psFile->asChunks[i].eState = SAZ_CHUNK_FREE;
+            }
+            pthread_cond_broadcast( &(psFile->hQueueCond) );
+        }
+
+        pthread_cond_wait( &(psFile->hQueueCond), &(psFile->hQueueLock) );
+    }
+    pthread_mutex_unlock( &(psFile->hQueueLock) );
+
+    return nRet;
+}
+
+/************************************************************************/
+/*                          SAZComputeSize()                            */
+/*                                                                      */
+/*      The size of a gzip stream is only known once it was decoded to  */
+/*      the end.  This also completes the access point index.           */
+/************************************************************************/
+
+static bool SAZComputeSize( SAZFile *psFile ) {
+    if( psFile->bSizeKnown )
+        return true;
+
+    pthread_mutex_lock( &(psFile->hDecodeLock) );
+    SAZInflater *psInf = psFile->psInflater;
+    bool bOK = true;
+    while( bOK && !psInf->bEOF )
+    {
+        SAOffset nDone = 0;
+        bOK = SAZInflaterRead( psInf, SHPLIB_NULLPTR, SAZ_CHUNK_SIZE, &nDone );
+    }
+    if( bOK )
+    {
+        psFile->nSize = psInf->nOut;
+        psFile->bSizeKnown = true;
+    }
+    pthread_mutex_unlock( &(psFile->hDecodeLock) );
+
+    return bOK;
+}
+
+/************************************************************************/
+/*                          SAZFindZipMember()                          */
+/*                                                                      */
+/*      Locate a member in the central directory of a zip archive, and  */
+/*      return the offset of its data.                                  */
+/************************************************************************/
+
+static bool SAZFindZipMember( FILE *fp, const char *pszMember,
+                              SAOffset *pnDataStart, SAOffset *pnCompressedSize,
+                              SAOffset *pnUncompressedSize, int *pnMethod ) {
+/* -------------------------------------------------------------------- */
+/*      Find the end of central directory record.                       */
+/* -------------------------------------------------------------------- */
+    if( SAZSeek( fp, 0, SEEK_END ) != 0 )
+        return false;
+    const SAOffset nFileSize = SAZTell( fp );
+    if( nFileSize < 22 )
+        return false;
+
+    const SAOffset nTail = nFileSize < 22 + 65535 ? nFileSize : 22 + 65535;
+    unsigned char *pabyTail = STATIC_CAST(unsigned char *, malloc(nTail));
+    if( pabyTail == SHPLIB_NULLPTR ||
+        SAZSeek( fp, nFileSize - nTail, SEEK_SET ) != 0 ||
+        fread( pabyTail, 1, nTail, fp ) != nTail )
+    {
+        free( pabyTail );
+        return false;
+    }
+
+    int iEOCD = -1;
+    for( int i = STATIC_CAST(int, nTail) - 22; i >= 0; i-- )
+    {
+        if( SAZGetUInt32( pabyTail + i ) == 0x06054b50 )
+        {
+            iEOCD = i;
+            break;
+        }
+    }
+    if( iEOCD < 0 )
+    {
+        free( pabyTail );
+        return false;
+    }
+
+    SAOffset nEntries = SAZGetUInt16( pabyTail + iEOCD + 10 );
+    SAOffset nDirSize = SAZGetUInt32( pabyTail + iEOCD + 12 );
+    SAOffset nDirOffset = SAZGetUInt32( pabyTail + iEOCD + 16 );
+
+/* -------------------------------------------------------------------- */
+/*      Zip64 archives keep the real values in the zip64 end of         */
+/*      central directory record, found through its locator.            */
+/* -------------------------------------------------------------------- */
+    if( (nEntries == 0xFFFF || nDirSize == 0xFFFFFFFFU ||
+         nDirOffset == 0xFFFFFFFFU) && iEOCD >= 20 &&
+        SAZGetUInt32( pabyTail + iEOCD - 20 ) == 0x07064b50 )
+    {
+        unsigned char abyZip64[56];
+        const SAOffset nZip64Offset = SAZGetUInt64( pabyTail + iEOCD - 20 + 8 );
+        if( SAZSeek( fp, nZip64Offset, SEEK_SET ) != 0 ||
+            fread( abyZip64, 1, 56, fp ) != 56 ||
+            SAZGetUInt32( abyZip64 ) != 0x06064b50 )
+        {
+            free( pabyTail );
+            return false;
+        }
+        nEntries = SAZGetUInt64( abyZip64 + 32 );
+        nDirSize = SAZGetUInt64( abyZip64 + 40 );
+        nDirOffset = SAZGetUInt64( abyZip64 + 48 );
+    }
+    free( pabyTail );
+
+    if( nDirSize > nFileSize || nDirOffset > nFileSize - nDirSize )
+        return false;
+
+/* -------------------------------------------------------------------- */
+/*      Scan the central directory.                                     */
+/* -------------------------------------------------------------------- */
+    unsigned char *pabyDir = STATIC_CAST(unsigned char *, malloc(nDirSize + 1));
+    if( pabyDir == SHPLIB_NULLPTR ||
+        SAZSeek( fp, nDirOffset, SEEK_SET ) != 0 ||
+        fread( pabyDir, 1, nDirSize, fp ) != nDirSize )
+    {
+        free( pabyDir );
+        return false;
+    }
+
+    const size_t nMemberLen = strlen( pszMember );
+    SAOffset nPos = 0;
+    bool bFound = false;
+    SAOffset nLocalOffset = 0;
+    unsigned nFlags = 0;
+
+    for( SAOffset iEntry = 0; iEntry < nEntries && nPos + 46 <= nDirSize; iEntry++ )
+    {
+        const unsigned char *pabyEntry = pabyDir + nPos;
+        if( SAZGetUInt32( pabyEntry ) != 0x02014b50 )
+            break;
+
+        const unsigned nNameLen = SAZGetUInt16( pabyEntry + 28 );
+        const unsigned nExtraLen = SAZGetUInt16( pabyEntry + 30 );
+        const unsigned nCommentLen = SAZGetUInt16( pabyEntry + 32 );
+        if( nPos + 46 + nNameLen + nExtraLen > nDirSize )
+            break;
+
+        if( nNameLen == nMemberLen &&
+            memcmp( pabyEntry + 46, pszMember, nMemberLen ) == 0 )
+        {
+            nFlags = SAZGetUInt16( pabyEntry + 8 );
+            *pnMethod = STATIC_CAST(int, SAZGetUInt16( pabyEntry + 10 ));
+            *pnCompressedSize = SAZGetUInt32( pabyEntry + 20 );
+            *pnUncompressedSize = SAZGetUInt32( pabyEntry + 24 );
+            nLocalOffset = SAZGetUInt32( pabyEntry + 42 );
+
+            /* Zip64 extended information extra field */
+            const unsigned char *pabyExtra = pabyEntry + 46 + nNameLen;
+            unsigned iExtra = 0;
+            while( iExtra + 4 <= nExtraLen )
+            {
+                const unsigned nId = SAZGetUInt16( pabyExtra + iExtra );
+                const unsigned nLen = SAZGetUInt16( pabyExtra + iExtra + 2 );
+                if( iExtra + 4 + nLen > nExtraLen )
+                    break;
+                if( nId == 0x0001 )
+                {
+                    const unsigned char *pabyField = pabyExtra + iExtra + 4;
+                    const unsigned char *pabyFieldEnd = pabyField + nLen;
+                    if( *pnUncompressedSize == 0xFFFFFFFFU && pabyField + 8 <= pabyFieldEnd )
+                    {
+                        *pnUncompressedSize = SAZGetUInt64( pabyField );
+                        pabyField += 8;
+                    }
+                    if( *pnCompressedSize == 0xFFFFFFFFU && pabyField + 8 <= pabyFieldEnd )
+                    {
+                        *pnCompressedSize = SAZGetUInt64( pabyField );
+                        pabyField += 8;
+                    }
+                    if( nLocalOffset == 0xFFFFFFFFU && pabyField + 8 <= pabyFieldEnd )
+                        nLocalOffset = SAZGetUInt64( pabyField );
+                }
+                iExtra += 4 + nLen;
+            }
+
+            bFound = true;
+            break;
+        }
+
+        nPos += 46 + nNameLen + nExtraLen + nCommentLen;
+    }
+    free( pabyDir );
+
+    /* Encrypted members are not supported */
+    if( !bFound || (nFlags & 1) )
+        return false;
+
+/* -------------------------------------------------------------------- */
+/*      The data follows the local header, whose variable length parts  */
+/*      may differ from the central directory ones.                     */
+/* -------------------------------------------------------------------- */
+    unsigned char abyLocal[30];
+    if( SAZSeek( fp, nLocalOffset, SEEK_SET ) != 0 ||
+        fread( abyLocal, 1, 30, fp ) != 30 ||
+        SAZGetUInt32( abyLocal ) != 0x04034b50 )
+        return false;
+
+    *pnDataStart = nLocalOffset + 30 + SAZGetUInt16( abyLocal + 26 ) +
+                   SAZGetUInt16( abyLocal + 28 );
+
+    return *pnDataStart <= nFileSize &&
+           *pnCompressedSize <= nFileSize - *pnDataStart;
+}
+
+/************************************************************************/
+/*                         SAZSkipGZipHeader()                          */
+/*                                                                      */
+/*      Read the gzip member header, leaving fp at the deflate data.    */
+/************************************************************************/
+
+static bool SAZSkipGZipHeader( FILE *fp ) {
+    unsigned char abyHeader[10];
+    if( fread( abyHeader, 1, 10, fp ) != 10 ||
+        abyHeader[0] != 0x1f || abyHeader[1] != 0x8b || abyHeader[2] != 8 )
+        return false;
+
+    const int nFlags = abyHeader[3];
+
+    if( nFlags & 4 ) /* FEXTRA */
+    {
+        unsigned char abyLen[2];
+        if( fread( abyLen, 1, 2, fp ) != 2 ||
+            SAZSeek( fp, SAZGetUInt16( abyLen ), SEEK_CUR ) != 0 )
+            return false;
+    }
+
+    for( int nMask = 8; nMask <= 16; nMask *= 2 ) /* FNAME, FCOMMENT */
+    {
+        if( nFlags & nMask )
+        {
+            int ch;
+            while( (ch = getc( fp )) != 0 )
+            {
+                if( ch == EOF )
+                    return false;
+            }
+        }
+    }
+
+    if( nFlags & 2 ) /* FHCRC */
+        return SAZSeek( fp, 2, SEEK_CUR ) == 0;
+
+    return true;
+}
+
+/************************************************************************/
+/*                          SAZIsReadOnly()                             */
+/************************************************************************/
+
+static bool SAZIsReadOnly( const char *pszAccess ) {
+    return strchr( pszAccess, 'w' ) == SHPLIB_NULLPTR &&
+           strchr( pszAccess, 'a' ) == SHPLIB_NULLPTR &&
+           strchr( pszAccess, '+' ) == SHPLIB_NULLPTR;
+}
+
+/************************************************************************/
+/*                            SAZFileCreate()                           */
+/************************************************************************/
+
+static SAZFile *SAZFileCreate( SAZKind eKind, FILE *fp ) {
+    SAZFile *psFile = STATIC_CAST(SAZFile *, calloc(1, sizeof(SAZFile)));
+    if( psFile == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+    psFile->eKind = eKind;
+    psFile->fp = fp;
+    psFile->bSizeKnown = true;
+
+    return psFile;
+}
+
+/************************************************************************/
+/*                          SAZFileSetInflater()                        */
+/************************************************************************/
+
+static bool SAZFileSetInflater( SAZFile *psFile, SAOffset nDataStart,
+                                SAOffset nDataEnd ) {
+    for( int i = 0; i < SAZ_READAHEAD; i++ )
+    {
+        psFile->asChunks[i].pabyData =
+            STATIC_CAST(unsigned char *, malloc(SAZ_CHUNK_SIZE));
+        if( psFile->asChunks[i].pabyData == SHPLIB_NULLPTR )
+            return false;
+    }
+
+    psFile->psInflater = SAZInflaterCreate( psFile->fp, nDataStart, nDataEnd );
+    if( psFile->psInflater == SHPLIB_NULLPTR )
+        return false;
+
+    pthread_mutex_init( &(psFile->hDecodeLock), SHPLIB_NULLPTR );
+    pthread_mutex_init( &(psFile->hQueueLock), SHPLIB_NULLPTR );
+    pthread_cond_init( &(psFile->hQueueCond), SHPLIB_NULLPTR );
+
+    return true;
+}
+
+/************************************************************************/
+/*                             SAZFClose()                              */
+/************************************************************************/
+
+static int SAZFClose( SAFile file ) {
+    SAZFile *psFile = STATIC_CAST(SAZFile *, STATIC_CAST(void *, file));
+    if( psFile == SHPLIB_NULLPTR )
+        return 0;
+
+    if( psFile->psInflater != SHPLIB_NULLPTR )
+    {
+        if( psFile->bWorkerRunning )
+        {
+            pthread_mutex_lock( &(psFile->hQueueLock) );
+            psFile->bStop = true;
+            pthread_cond_broadcast( &(psFile->hQueueCond) );
+            pthread_mutex_unlock( &(psFile->hQueueLock) );
+            pthread_join( psFile->hWorker, SHPLIB_NULLPTR );
+        }
+
+        SAZInflaterDestroy( psFile->psInflater );
+        pthread_mutex_destroy( &(psFile->hDecodeLock) );
+        pthread_mutex_destroy( &(psFile->hQueueLock) );
+        pthread_cond_destroy( &(psFile->hQueueCond) );
+    }
+
+    for( int i = 0; i < SAZ_READAHEAD; i++ )
+        free( psFile->asChunks[i].pabyData );
+
+    const int nRet = psFile->fp ? fclose( psFile->fp ) : 0;
+    free( psFile );
+
+    return nRet;
+}
+
+/************************************************************************/
+/*                           SAZOpenZipMember()                         */
+/************************************************************************/
+
+static SAZFile *SAZOpenZipMember( const char *pszArchive,
+                                  const char *pszMember ) {
+    FILE *fp = fopen( pszArchive, "rb" );
+    if( fp == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+    SAOffset nDataStart = 0;
+    SAOffset nCompressedSize = 0;
+    SAOffset nUncompressedSize = 0;
+    int nMethod = -1;
+    if( !SAZFindZipMember( fp, pszMember, &nDataStart, &nCompressedSize,
+                           &nUncompressedSize, &nMethod ) ||
+        (nMethod != 0 && nMethod != 8) )
+    {
+        fclose( fp );
+        return SHPLIB_NULLPTR;
+    }
+
+    SAZFile *psFile = SAZFileCreate( nMethod == 0 ? SAZStored : SAZDeflate, fp );
+    if( psFile == SHPLIB_NULLPTR )
+    {
+        fclose( fp );
+        return SHPLIB_NULLPTR;
+    }
+
+    if( nMethod == 0 )
+    {
+        psFile->nStart = nDataStart;
+        psFile->nSize = nCompressedSize;
+    }
+    else
+    {
+        psFile->nSize = nUncompressedSize;
+        if( !SAZFileSetInflater( psFile, nDataStart,
+                                 nDataStart + nCompressedSize ) )
+        {
+            SAZFClose( STATIC_CAST(SAFile, STATIC_CAST(void *, psFile)) );
+            return SHPLIB_NULLPTR;
+        }
+    }
+
+    return psFile;
+}
+
+/************************************************************************/
+/*                            SAZOpenGZip()                             */
+/************************************************************************/
+
+static SAZFile *SAZOpenGZip( const char *pszFilename ) {
+    FILE *fp = fopen( pszFilename, "rb" );
+    if( fp == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+
+    if( SAZSeek( fp, 0, SEEK_END ) != 0 )
+    {
+        fclose( fp );
+        return SHPLIB_NULLPTR;
+    }
+    const SAOffset nFileSize = SAZTell( fp );
+
+    if( SAZSeek( fp, 0, SEEK_SET ) != 0 || !SAZSkipGZipHeader( fp ) )
+    {
+        fclose( fp );
+        return SHPLIB_NULLPTR;
+    }
+    const SAOffset nDataStart = SAZTell( fp );
+
+    SAZFile *psFile = SAZFileCreate( SAZDeflate, fp );
+    if( psFile == SHPLIB_NULLPTR )
+    {
+        fclose( fp );
+        return SHPLIB_NULLPTR;
+    }
+
+    psFile->bSizeKnown = false;
+    if( !SAZFileSetInflater( psFile, nDataStart, nFileSize ) )
+    {
+        SAZFClose( STATIC_CAST(SAFile, STATIC_CAST(void *, psFile)) );
+        return SHPLIB_NULLPTR;
+    }
+
+    return psFile;
+}
+
+/************************************************************************/
+/*                              SAZFOpen()                              */
+/************************************************************************/
+
+static SAFile SAZFOpen( const char *pszFilename, const char *pszAccess ) {
+    SAZFile *psFile = SHPLIB_NULLPTR;
+
+/* -------------------------------------------------------------------- */
+/*      Is this a member of a .zip archive?  A component that is not a  */
+/*      readable archive, such as a directory named "data.zip", is an   */
+/*      ordinary part of the path.                                      */
+/* -------------------------------------------------------------------- */
+    const size_t nLen = strlen( pszFilename );
+    for( size_t i = 0; i + 5 < nLen && SAZIsReadOnly( pszAccess ); i++ )
+    {
+        if( pszFilename[i] == '.' &&
+            (pszFilename[i+1] == 'z' || pszFilename[i+1] == 'Z') &&
+            (pszFilename[i+2] == 'i' || pszFilename[i+2] == 'I') &&
+            (pszFilename[i+3] == 'p' || pszFilename[i+3] == 'P') &&
+            (pszFilename[i+4] == '/' || pszFilename[i+4] == '\\') )
+        {
+            char *pszArchive = STATIC_CAST(char *, malloc(nLen + 1));
+            if( pszArchive == SHPLIB_NULLPTR )
+                return SHPLIB_NULLPTR;
+            memcpy( pszArchive, pszFilename, nLen + 1 );
+            pszArchive[i+4] = '\0';
+
+            /* Member names always use forward slashes */
+            char *pszMember = pszArchive + i + 5;
+            for( char *pszIter = pszMember; *pszIter != '\0'; pszIter++ )
+            {
+                if( *pszIter == '\\' )
+                    *pszIter = '/';
+            }
+
+            psFile = SAZOpenZipMember( pszArchive, pszMember );
+            free( pszArchive );
+            if( psFile != SHPLIB_NULLPTR )
+                return STATIC_CAST(SAFile, STATIC_CAST(void *, psFile));
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Otherwise a regular file, or a gzip stream next to its name.    */
+/* -------------------------------------------------------------------- */
+    FILE *fp = fopen( pszFilename, pszAccess );
+    if( fp != SHPLIB_NULLPTR )
+    {
+        psFile = SAZFileCreate( SAZPlain, fp );
+        if( psFile == SHPLIB_NULLPTR )
+            fclose( fp );
+        return STATIC_CAST(SAFile, STATIC_CAST(void *, psFile));
+    }
+
+    if( !SAZIsReadOnly( pszAccess ) )
+        return SHPLIB_NULLPTR;
+
+    char *pszGZip = STATIC_CAST(char *, malloc(nLen + 4));
+    if( pszGZip == SHPLIB_NULLPTR )
+        return SHPLIB_NULLPTR;
+    memcpy( pszGZip, pszFilename, nLen );
+    memcpy( pszGZip + nLen, ".gz", 4 );
+    psFile = SAZOpenGZip( pszGZip );
+    free( pszGZip );
+
+    return STATIC_CAST(SAFile, STATIC_CAST(void *, psFile));
+}
+
+/************************************************************************/
+/*                              SAZFRead()                              */
+/************************************************************************/
+
+static SAOffset SAZFRead( void *p, SAOffset size, SAOffset nmemb,
+                          SAFile file ) {
+    SAZFile *psFile = STATIC_CAST(SAZFile *, STATIC_CAST(void *, file));
+
+    if( psFile->eKind == SAZPlain )
+        return STATIC_CAST(SAOffset, fread( p, STATIC_CAST(size_t, size),
+                                            STATIC_CAST(size_t, nmemb), psFile->fp ));
+
+    if( size == 0 || nmemb == 0 )
+        return 0;
+
+    SAOffset nWanted = size * nmemb;
+    if( psFile->bSizeKnown )
+    {
+        if( psFile->nPos >= psFile->nSize )
+            return 0;
+        if( nWanted > psFile->nSize - psFile->nPos )
+            nWanted = psFile->nSize - psFile->nPos;
+    }
+
+    unsigned char *pabyDst = STATIC_CAST(unsigned char *, p);
+    SAOffset nDone = 0;
+
+    if( psFile->eKind == SAZStored )
+    {
+        if( SAZSeek( psFile->fp, psFile->nStart + psFile->nPos, SEEK_SET ) == 0 )
+            nDone = fread( pabyDst, 1, STATIC_CAST(size_t, nWanted), psFile->fp );
+    }
+    else
+    {
+        while( nDone < nWanted )
+        {
+            const SAOffset nPos = psFile->nPos + nDone;
+            const SAOffset nChunk = nPos / SAZ_CHUNK_SIZE;
+            const int nOffset = STATIC_CAST(int, nPos % SAZ_CHUNK_SIZE);
+            SAOffset nBytes = SAZ_CHUNK_SIZE - nOffset;
+            if( nBytes > nWanted - nDone )
+                nBytes = nWanted - nDone;
+
+            const int nCopied = SAZReadChunk( psFile, nChunk, nOffset,
+                                              pabyDst + nDone,
+                                              STATIC_CAST(int, nBytes) );
+            if( nCopied <= 0 )
+                break;
+            nDone += nCopied;
+        }
+    }
+
+    psFile->nPos += nDone;
+    return nDone / size;
+}
+
+/************************************************************************/
+/*                             SAZFWrite()                              */
+/************************************************************************/
+
+static SAOffset SAZFWrite( void *p, SAOffset size, SAOffset nmemb,
+                           SAFile file ) {
+    SAZFile *psFile = STATIC_CAST(SAZFile *, STATIC_CAST(void *, file));
+
+    if( psFile->eKind != SAZPlain )
+        return 0;
+
+    return STATIC_CAST(SAOffset, fwrite( p, STATIC_CAST(size_t, size),
+                                         STATIC_CAST(size_t, nmemb), psFile->fp ));
+}
+
+/************************************************************************/
+/*                              SAZFSeek()                              */
+/************************************************************************/
+
+static SAOffset SAZFSeek( SAFile file, SAOffset offset, int whence ) {
+    SAZFile *psFile = STATIC_CAST(SAZFile *, STATIC_CAST(void *, file));
+
+    if( psFile->eKind == SAZPlain )
+        return STATIC_CAST(SAOffset, SAZSeek( psFile->fp, offset, whence ));
+
+    switch( whence )
+    {
+      case SEEK_SET:
+        psFile->nPos = offset;
+        break;
+
+      case SEEK_CUR:
+        psFile->nPos += offset;
+        break;
+
+      case SEEK_END:
+        if( !SAZComputeSize( psFile ) )
+            return STATIC_CAST(SAOffset, -1);
+        psFile->nPos = psFile->nSize + offset;
+        break;
+
+      default:
+        return STATIC_CAST(SAOffset, -1);
+    }
+
+    return 0;
+}
+
+/************************************************************************/
+/*                              SAZFTell()                              */
+/************************************************************************/
+
+static SAOffset SAZFTell( SAFile file ) {
+    SAZFile *psFile = STATIC_CAST(SAZFile *, STATIC_CAST(void *, file));
+
+    if( psFile->eKind == SAZPlain )
+        return SAZTell( psFile->fp );
+
+    return psFile->nPos;
+}
+
+/************************************************************************/
+/*                             SAZFFlush()                              */
+/************************************************************************/
+
+static int SAZFFlush( SAFile file ) {
+    SAZFile *psFile = STATIC_CAST(SAZFile *, STATIC_CAST(void *, file));
+
+    if( psFile->eKind == SAZPlain )
+        return fflush( psFile->fp );
+
+    return 0;
+}
+
+/************************************************************************/
+/*                             SAZFFileno()                             */
+/*                                                                      */
+/*      Only regular files can be read with pread().                    */
+/************************************************************************/
+
+static int SAZFFileno( SAFile file ) {
+    SAZFile *psFile = STATIC_CAST(SAZFile *, STATIC_CAST(void *, file));
+
+    if( psFile->eKind == SAZPlain )
+        return fileno( psFile->fp );
+
+    return -1;
+}
+
+/************************************************************************/
+/*                             SAZFAdvise()                             */
+/*                                                                      */
+/*      For compressed data, random access only stops the background    */
+/*      decoding, which would mostly produce chunks never read.         */
+/************************************************************************/
+
+static int SAZFAdvise( SAFile file, SAOffset nOffset, SAOffset nLen,
+                       int nAdvice ) {
+    SAZFile *psFile = STATIC_CAST(SAZFile *, STATIC_CAST(void *, file));
+
+    if( psFile->eKind == SAZStored || psFile->eKind == SAZPlain )
+    {
+        SAHooks sDefault;
+        goSASetupDefaultHooks( &sDefault );
+        if( psFile->eKind == SAZStored )
+        {
+            nOffset += psFile->nStart;
+            if( nLen == 0 )
+                nLen = psFile->nSize;
+        }
+        return sDefault.FAdvise( STATIC_CAST(SAFile, STATIC_CAST(void *, psFile->fp)),
+                                 nOffset, nLen, nAdvice );
+    }
+
+    if( nAdvice == SA_ADVICE_RANDOM )
+        psFile->bNoReadAhead = true;
+    else if( nAdvice == SA_ADVICE_NORMAL || nAdvice == SA_ADVICE_SEQUENTIAL )
+        psFile->bNoReadAhead = false;
+
+    return 0;
+}
+
+#endif /* def SHP_HAVE_ZLIB */
+
+/************************************************************************/
+/*                         goSASetupZipHooks()                          */
+/*                                                                      */
+/*      Hooks reading "archive.zip/member" names from inside the        */
+/*      archive and falling back to "name.gz" when "name" does not      */
+/*      exist.  Other files are accessed as with the default hooks.     */
+/*      Without zlib support this is the same as the default hooks.     */
+/************************************************************************/
+
+void goSASetupZipHooks( SAHooks *psHooks ) {
+    goSASetupDefaultHooks( psHooks );
+
+#ifdef SHP_HAVE_ZLIB
+    psHooks->FOpen   = SAZFOpen;
+    psHooks->FRead   = SAZFRead;
+    psHooks->FWrite  = SAZFWrite;
+    psHooks->FSeek   = SAZFSeek;
+    psHooks->FTell   = SAZFTell;
+    psHooks->FFlush  = SAZFFlush;
+    psHooks->FClose  = SAZFClose;
+    psHooks->FFileno = SAZFFileno;
+    psHooks->FAdvise = SAZFAdvise;
+#endif
+}
@@ -0,0 +1,120 @@
+package shp
+
+import (
+	"fmt"
+	"strings"
+)
+
+// SchemaEdit collects changes to the fields of an attribute table, which
+// Commit applies in a single pass over the records: dropping ten fields and
+// widening three costs one rewrite rather than thirteen.
+type SchemaEdit struct {
+	path  string
+	h     DBFHandle
+	e     DBFSchemaEditHandle
+	names []string // fields of the edited schema
+}
+
+// EditSchema starts changing the fields of the attribute table path, for
+// instance "roads.dbf", which must not be open otherwise until Commit or
+// Discard.
+func EditSchema(path string) (*SchemaEdit, error) {
+	h := goDBFOpen(path, "rb+")
+	if h == nil {
+		return nil, fmt.Errorf("cannot open %s", path)
+	}
+	e := goDBFCreateSchemaEdit(h)
+	if e == nil {
+		goDBFClose(h)
+		return nil, fmt.Errorf("cannot edit %s", path)
+	}
+	names := make([]string, goDBFGetFieldCount(h))
+	for j := range names {
+		names[j], _, _, _ = goDBFGetFieldInfo(h, j)
+	}
+	return &SchemaEdit{path: path, h: h, e: e, names: names}, nil
+}
+
+// field finds a field of the edited schema, ignoring case like
+// goDBFGetFieldIndex.
+func (s *SchemaEdit) field(name string) (int, error) {
+	for j, n := range s.names {
+		if strings.EqualFold(n, name) {
+			return j, nil
+		}
+	}
+	return -1, fmt.Errorf("no field %q", name)
+}
+
+func nativeType(t FieldType) (byte, error) {
+	switch t {
+	case String:
+		return 'C', nil
+	case Integer, Double:
+		return 'N', nil
+	case Logical:
+		return 'L', nil
+	}
+	return 0, fmt.Errorf("invalid field type %d", t)
+}
+
+// AddField appends a field, NULL in every record.
+func (s *SchemaEdit) AddField(field Field) error {
+	t, err := nativeType(field.Type)
+	if err != nil {
+		return err
+	}
+	if goDBFSchemaAddField(s.e, field.Name, t, field.Width, field.Decimals) < 0 {
+		return fmt.Errorf("cannot add field %q", field.Name)
+	}
+	s.names = append(s.names, field.Name)
+	return nil
+}
+
+// DeleteField removes a field.
+func (s *SchemaEdit) DeleteField(name string) error {
+	j, err := s.field(name)
+	if err != nil {
+		return err
+	}
+	goDBFSchemaDeleteField(s.e, j)
+	s.names = append(s.names[:j], s.names[j+1:]...)
+	return nil
+}
+
+// AlterField renames, retypes or resizes a field. Values are converted once,
+// from the field as it is in the table to its final definition: numbers
+// keep their right alignment, text is cut or padded on the right, and NULL
+// values stay NULL.
+func (s *SchemaEdit) AlterField(name string, field Field) error {
+	j, err := s.field(name)
+	if err != nil {
+		return err
+	}
+	t, err := nativeType(field.Type)
+	if err != nil {
+		return err
+	}
+	if !goDBFSchemaAlterField(s.e, j, field.Name, t, field.Width, field.Decimals) {
+		return fmt.Errorf("cannot change field %q", name)
+	}
+	s.names[j] = field.Name
+	return nil
+}
+
+// Commit writes the table with its new fields next to the old one, then
+// replaces the old one with it, so that readers never see it half written.
+func (s *SchemaEdit) Commit() error {
+	ok := goDBFCommitSchemaEdit(s.e, s.path)
+	goDBFClose(s.h)
+	if !ok {
+		return fmt.Errorf("cannot rewrite %s", s.path)
+	}
+	return nil
+}
+
+// Discard drops the changes.
+func (s *SchemaEdit) Discard() {
+	goDBFDestroySchemaEdit(s.e)
+	goDBFClose(s.h)
+}
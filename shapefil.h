@@ -38,6 +38,7 @@
  *
  */
 
+#include <limits.h>
 #include <stdio.h>
 
 #ifdef USE_DBMALLOC
@@ -146,7 +147,12 @@ static const char *cvsid_aw() { return( cvsid_aw() ? NULL : cpl_cvsid ); }
 typedef int *SAFile;
 
 #ifndef SAOffset
+/* a 32 bit unsigned long (Windows, 32 bit Unix) would cap .shp at 4 GB */
+#  if defined(SHPAPI_WINDOWS) || ULONG_MAX == 0xffffffffUL
+typedef unsigned long long SAOffset;
+#  else
 typedef unsigned long SAOffset;
+#  endif
 #endif
 
 typedef struct {
@@ -161,9 +167,42 @@ typedef struct {
 
     void       (*Error) ( const char *message );
     double     (*Atof)  ( const char *str );
+
+    /* Optional: OS file descriptor usable with pread(), or -1 */
+    int        (*FFileno)( SAFile file );
+
+    /* Optional: access pattern hint for a range (nLen 0 = to end of file) */
+    int        (*FAdvise)( SAFile file, SAOffset nOffset, SAOffset nLen,
+                           int nAdvice );
 } SAHooks;
 
+/* nAdvice values of FAdvise(), the first three also being access patterns */
+#define SA_ADVICE_NORMAL        0
+#define SA_ADVICE_SEQUENTIAL    1
+#define SA_ADVICE_RANDOM        2
+#define SA_ADVICE_WILLNEED      3
+#define SA_ADVICE_DONTNEED      4
+
 void SHPAPI_CALL goSASetupDefaultHooks( SAHooks *psHooks );
+void SHPAPI_CALL goSASetupZipHooks( SAHooks *psHooks );
+void SHPAPI_CALL goSASetupDirectHooks( SAHooks *psHooks );
+
+/* -------------------------------------------------------------------- */
+/*      Batched positional reads.                                       */
+/* -------------------------------------------------------------------- */
+typedef struct {
+    SAOffset    nOffset;
+    SAOffset    nSize;
+    void       *pBuffer;
+    SAOffset    nRead;      /* set on completion */
+    int         nUserId;    /* free for the caller's use */
+} SABatchRequest;
+
+typedef void (*SABatchDoneFunc)( void *pUserData, SABatchRequest *psRequest );
+
+int SHPAPI_CALL
+      goSABatchRead( SAHooks *psHooks, SAFile file, SABatchRequest *pasRequests,
+                     int nCount, SABatchDoneFunc pfnDone, void *pUserData );
 #ifdef SHPAPI_UTF8_HOOKS
 void SHPAPI_CALL SASetupUtf8Hooks( SAHooks *psHooks );
 #endif
@@ -201,6 +240,12 @@ typedef struct
     unsigned char *pabyObjectBuf;
     int            nObjectBufSize;
     SHPObject*     psCachedObject;
+
+    int            nAccessPattern; /* SA_ADVICE_NORMAL/SEQUENTIAL/RANDOM */
+
+    /* Only set in read mode for .shp files larger than 4 GB, where the */
+    /* 32 bit panRecOffset values have wrapped around. */
+    SAOffset      *panRecOffset64;
 } SHPInfo;
 
 typedef SHPInfo * SHPHandle;
@@ -293,6 +338,9 @@ int SHPAPI_CALL
 /* The SHPObject padfZ and padfM members may be NULL depending on the geometry */
 /* type. It is illegal to free at hand any of the pointer members of the SHPObject structure */
 void SHPAPI_CALL goSHPSetFastModeReadObject( SHPHandle hSHP, int bFastMode );
+void SHPAPI_CALL goSHPSetAccessPattern( SHPHandle hSHP, int nAccessPattern );
+void SHPAPI_CALL
+      goSHPPrefetchShapes( SHPHandle hSHP, const int *panShapeIds, int nCount );
 
 SHPHandle SHPAPI_CALL
       goSHPCreate( const char * pszShapeFile, int nShapeType );
@@ -305,6 +353,10 @@ void SHPAPI_CALL
 
 SHPObject SHPAPI_CALL1(*)
       goSHPReadObject( SHPHandle hSHP, int iShape );
+SHPObject SHPAPI_CALL1(**)
+      goSHPReadObjects( SHPHandle hSHP, const int *panShapeIds, int nCount );
+void SHPAPI_CALL
+      goSHPDestroyObjects( SHPObject **papsObjects, int nCount );
 int SHPAPI_CALL
       goSHPWriteObject( SHPHandle hSHP, int iShape, SHPObject * psObject );
 
@@ -494,6 +546,40 @@ typedef struct
     int         bWriteEndOfFileChar; /* defaults to TRUE */
 
     int         bRequireNextWriteSeek;
+
+    int         nAccessPattern; /* SA_ADVICE_NORMAL/SEQUENTIAL/RANDOM */
+
+    /* Read-ahead window of whole records, see goDBFSetReadAhead() */
+    char        *pabyReadAhead;
+    int         nReadAheadSize;  /* bytes, 0 if disabled */
+    int         bReadAheadReverse;
+    int         nReadAheadFirst;
+    int         nReadAheadCount; /* records currently in the window */
+
+    /* Projection, see goDBFSetProjection() */
+    int         *panProjection;
+    int         nProjectionCount;
+    int         nProjectionStart;  /* byte span read for projected */
+    int         nProjectionLength; /* fields, 0 for whole records */
+    int         bCurrentRecordPartial;
+
+    /* Read-only mapping of the whole file when opened with 'm' */
+    const char  *pabyMap;
+    SAOffset    nMapSize;
+
+    /* Upper-cased field names and their hash, see goDBFGetFieldIndex() */
+    char        *pachFieldNames;  /* XBASE_FLDNAME_LEN_READ+1 per field */
+    int         *panFieldHash;    /* field per slot, -1 if empty */
+    int         nFieldHashMask;   /* slot count - 1 */
+
+    /* Deleted and NULL bitmaps of a range, see goDBFLoadBitmaps() */
+    unsigned char *pabyDeletedBitmap; /* bit i for record nBitmapStart+i */
+    unsigned char *pabyNullBitmaps;   /* one such bitmap per field */
+    int         nBitmapStart;
+    int         nBitmapCount;
+
+    /* Code page strings are recoded from, see goDBFSetRecodeToUTF8() */
+    int         nRecodeCodePage;  /* 0 to return them raw */
 } DBFInfo;
 
 typedef DBFInfo * DBFHandle;
@@ -550,6 +636,27 @@ int SHPAPI_CALL
       goDBFAlterFieldDefn( DBFHandle psDBF, int iField, const char * pszFieldName,
                          char chType, int nWidth, int nDecimals );
 
+/* -------------------------------------------------------------------- */
+/*      Schema edits, several field changes applied in one pass.        */
+/* -------------------------------------------------------------------- */
+typedef struct DBFSchemaEditInfo *DBFSchemaEditHandle;
+
+DBFSchemaEditHandle SHPAPI_CALL goDBFCreateSchemaEdit( DBFHandle psDBF );
+void SHPAPI_CALL goDBFDestroySchemaEdit( DBFSchemaEditHandle psEdit );
+int SHPAPI_CALL
+      goDBFSchemaAddField( DBFSchemaEditHandle psEdit, const char *pszFieldName,
+                           char chType, int nWidth, int nDecimals );
+int SHPAPI_CALL
+      goDBFSchemaDeleteField( DBFSchemaEditHandle psEdit, int iField );
+int SHPAPI_CALL
+      goDBFSchemaAlterField( DBFSchemaEditHandle psEdit, int iField,
+                             const char *pszFieldName, char chType,
+                             int nWidth, int nDecimals );
+int SHPAPI_CALL
+      goDBFSchemaReorderFields( DBFSchemaEditHandle psEdit, const int *panMap );
+int SHPAPI_CALL
+      goDBFCommitSchemaEdit( DBFSchemaEditHandle psEdit, const char *pszFilename );
+
 DBFFieldType SHPAPI_CALL
       goDBFGetFieldInfo( DBFHandle psDBF, int iField,
                        char * pszFieldName, int * pnWidth, int * pnDecimals );
@@ -567,6 +674,75 @@ const char SHPAPI_CALL1(*)
       goDBFReadLogicalAttribute( DBFHandle hDBF, int iShape, int iField );
 int SHPAPI_CALL
       goDBFIsAttributeNULL( DBFHandle hDBF, int iShape, int iField );
+int SHPAPI_CALL
+      goDBFIsRawValueNULL( char chType, const char *pachField, int nWidth );
+
+int SHPAPI_CALL
+      goDBFParseInteger( const char *pachField, int nWidth, int *pnValue );
+int SHPAPI_CALL
+      goDBFParseDouble( const char *pachField, int nWidth, double *pdfValue );
+int SHPAPI_CALL
+      goDBFParseDate( const char *pachField, int nWidth, int *pnDays );
+int SHPAPI_CALL
+      goDBFFormatDouble( double dfValue, int nWidth, int nDecimals,
+                         char *pachField );
+
+const char SHPAPI_CALL1(*)
+      goDBFReadRecords( DBFHandle psDBF, int iStart, int nCount, void *pBuffer );
+int SHPAPI_CALL
+      goDBFReadIntegerColumn( DBFHandle hDBF, int iField, int iStart, int nCount,
+                              int *panValues, unsigned char *pabyNull );
+int SHPAPI_CALL
+      goDBFReadDoubleColumn( DBFHandle hDBF, int iField, int iStart, int nCount,
+                             double *padfValues, unsigned char *pabyNull );
+int SHPAPI_CALL
+      goDBFReadStringColumn( DBFHandle hDBF, int iField, int iStart, int nCount,
+                             char *pszValues, int nStride,
+                             unsigned char *pabyNull );
+int SHPAPI_CALL
+      goDBFReadDateColumn( DBFHandle hDBF, int iField, int iStart, int nCount,
+                           int *panDays, unsigned char *pabyNull );
+int SHPAPI_CALL
+      goDBFReadLogicalColumn( DBFHandle hDBF, int iField, int iStart, int nCount,
+                              signed char *pachValues, unsigned char *pabyNull );
+
+typedef struct DBFDictionaryInfo *DBFDictionaryHandle;
+
+DBFDictionaryHandle SHPAPI_CALL
+      goDBFReadDictionaryColumn( DBFHandle hDBF, int iField, int iStart,
+                                 int nCount, int *panCodes );
+int SHPAPI_CALL goDBFGetDictionarySize( DBFDictionaryHandle psDict );
+const char SHPAPI_CALL1(*)
+      goDBFGetDictionaryValue( DBFDictionaryHandle psDict, int iCode,
+                               int *pnLength );
+void SHPAPI_CALL goDBFDestroyDictionary( DBFDictionaryHandle psDict );
+
+typedef struct DBFAggregateInfo *DBFAggregateHandle;
+
+DBFAggregateHandle SHPAPI_CALL
+      goDBFCreateAggregate( DBFHandle hDBF, int iGroupField,
+                            const int *panFields, int nFields );
+int SHPAPI_CALL
+      goDBFAggregateRange( DBFAggregateHandle psAgg, int iStart, int nCount );
+int SHPAPI_CALL
+      goDBFAggregateSelection( DBFAggregateHandle psAgg, const int *panSelected,
+                               int nSelected );
+int SHPAPI_CALL goDBFAggregateGetGroupCount( DBFAggregateHandle psAgg );
+int SHPAPI_CALL
+      goDBFAggregateGetKey( DBFAggregateHandle psAgg, int iGroup, char *pszKey,
+                            int nKeySize );
+int SHPAPI_CALL
+      goDBFAggregateGetRecordCount( DBFAggregateHandle psAgg, int iGroup );
+int SHPAPI_CALL
+      goDBFAggregateGetStats( DBFAggregateHandle psAgg, int iGroup, int iValue,
+                              double *pdfSum, double *pdfMin, double *pdfMax );
+void SHPAPI_CALL goDBFDestroyAggregate( DBFAggregateHandle psAgg );
+int SHPAPI_CALL
+      goDBFLoadBitmaps( DBFHandle hDBF, int iStart, int nCount );
+const unsigned char SHPAPI_CALL1(*)
+      goDBFGetDeletedBitmap( DBFHandle hDBF, int *piStart, int *pnCount );
+const unsigned char SHPAPI_CALL1(*)
+      goDBFGetNullBitmap( DBFHandle hDBF, int iField );
 
 int SHPAPI_CALL
       goDBFWriteIntegerAttribute( DBFHandle hDBF, int iShape, int iField,
@@ -588,6 +764,12 @@ int SHPAPI_CALL
                                void * pValue );
 const char SHPAPI_CALL1(*)
       goDBFReadTuple(DBFHandle psDBF, int hEntity );
+const char SHPAPI_CALL1(*)
+      goDBFReadFieldBytes( DBFHandle psDBF, int hEntity, int iField,
+                           int *pnWidth );
+const char SHPAPI_CALL1(*)
+      goDBFReadStringView( DBFHandle psDBF, int hEntity, int iField,
+                           int *pnLength );
 int SHPAPI_CALL
       goDBFWriteTuple(DBFHandle psDBF, int hEntity, void * pRawTuple );
 
@@ -607,12 +789,174 @@ char SHPAPI_CALL
 
 const char SHPAPI_CALL1(*)
       goDBFGetCodePage(DBFHandle psDBF );
+int SHPAPI_CALL
+      goDBFSetRecodeToUTF8( DBFHandle psDBF, const char *pszCodePage );
+
+/* dbfcodepage.c */
+int SHPAPI_CALL
+      goDBFCodePageID( const char *pszCodePage );
+int SHPAPI_CALL
+      goDBFRecodeToUTF8( int nCodePageID, const char *pachSrc, int nSrcLength,
+                         char *pszDst, int nDstSize );
 
 void SHPAPI_CALL
     goDBFSetLastModifiedDate( DBFHandle psDBF, int nYYSince1900, int nMM, int nDD );
 
 void SHPAPI_CALL goDBFSetWriteEndOfFileChar( DBFHandle psDBF, int bWriteFlag );
 
+void SHPAPI_CALL goDBFSetAccessPattern( DBFHandle psDBF, int nAccessPattern );
+void SHPAPI_CALL goDBFSetReadAhead( DBFHandle psDBF, int nBytes, int bReverse );
+int SHPAPI_CALL goDBFSetProjection( DBFHandle psDBF, const int *panFields,
+                                    int nCount );
+int SHPAPI_CALL goDBFReadProjectedTuple( DBFHandle psDBF, int hEntity,
+                                         void *pDst );
+
+typedef struct DBFCursorInfo *DBFCursorHandle;
+
+DBFCursorHandle SHPAPI_CALL goDBFCreateCursor( DBFHandle psDBF );
+void SHPAPI_CALL goDBFDestroyCursor( DBFCursorHandle psCursor );
+int SHPAPI_CALL
+      goDBFCursorReadIntegerAttribute( DBFCursorHandle psCursor, int iRecord,
+                                       int iField );
+double SHPAPI_CALL
+      goDBFCursorReadDoubleAttribute( DBFCursorHandle psCursor, int iRecord,
+                                      int iField );
+const char SHPAPI_CALL1(*)
+      goDBFCursorReadStringAttribute( DBFCursorHandle psCursor, int iRecord,
+                                      int iField );
+const char SHPAPI_CALL1(*)
+      goDBFCursorReadStringView( DBFCursorHandle psCursor, int iRecord,
+                                 int iField, int *pnLength );
+int SHPAPI_CALL
+      goDBFCursorIsAttributeNULL( DBFCursorHandle psCursor, int iRecord,
+                                  int iField );
+const char SHPAPI_CALL1(*)
+      goDBFCursorReadRecords( DBFCursorHandle psCursor, int iStart, int nCount,
+                              void *pBuffer );
+DBFHandle SHPAPI_CALL goDBFCursorGetDBF( DBFCursorHandle psCursor );
+int SHPAPI_CALL
+      goDBFCursorReadIntegerColumn( DBFCursorHandle psCursor, int iField,
+                                    int iStart, int nCount, int *panValues,
+                                    unsigned char *pabyNull );
+int SHPAPI_CALL
+      goDBFCursorReadDoubleColumn( DBFCursorHandle psCursor, int iField,
+                                   int iStart, int nCount, double *padfValues,
+                                   unsigned char *pabyNull );
+int SHPAPI_CALL
+      goDBFCursorReadStringColumn( DBFCursorHandle psCursor, int iField,
+                                   int iStart, int nCount, char *pszValues,
+                                   int nStride, unsigned char *pabyNull );
+
+typedef struct DBFWriterInfo *DBFWriterHandle;
+
+DBFWriterHandle SHPAPI_CALL goDBFCreateWriter( DBFHandle psDBF, int nBytes );
+int SHPAPI_CALL goDBFWriterSetDouble( DBFWriterHandle psWriter, int iField,
+                                      double dValue );
+int SHPAPI_CALL goDBFWriterSetInteger( DBFWriterHandle psWriter, int iField,
+                                       int nValue );
+int SHPAPI_CALL goDBFWriterSetString( DBFWriterHandle psWriter, int iField,
+                                      const char *pszValue );
+int SHPAPI_CALL goDBFWriterSetLogical( DBFWriterHandle psWriter, int iField,
+                                       char lValue );
+int SHPAPI_CALL goDBFWriterSetNULL( DBFWriterHandle psWriter, int iField );
+int SHPAPI_CALL goDBFWriterEndRow( DBFWriterHandle psWriter );
+int SHPAPI_CALL goDBFCloseWriter( DBFWriterHandle psWriter );
+
+/* -------------------------------------------------------------------- */
+/*      Attribute filters evaluated on the raw records (dbffilter.c)    */
+/* -------------------------------------------------------------------- */
+typedef enum {
+  DBFC_EQ,
+  DBFC_NE,
+  DBFC_LT,
+  DBFC_LE,
+  DBFC_GT,
+  DBFC_GE
+} DBFCompareOp;
+
+typedef struct DBFFilterInfo *DBFFilterHandle;
+
+DBFFilterHandle SHPAPI_CALL
+      goDBFFilterCompareDouble( DBFHandle psDBF, int iField, DBFCompareOp eOp,
+                                double dfValue );
+DBFFilterHandle SHPAPI_CALL
+      goDBFFilterCompareString( DBFHandle psDBF, int iField, DBFCompareOp eOp,
+                                const char *pszValue );
+DBFFilterHandle SHPAPI_CALL
+      goDBFFilterCompareLogical( DBFHandle psDBF, int iField, int bValue );
+DBFFilterHandle SHPAPI_CALL
+      goDBFFilterIsNull( DBFHandle psDBF, int iField );
+DBFFilterHandle SHPAPI_CALL
+      goDBFFilterAnd( DBFFilterHandle psLeft, DBFFilterHandle psRight );
+DBFFilterHandle SHPAPI_CALL
+      goDBFFilterOr( DBFFilterHandle psLeft, DBFFilterHandle psRight );
+DBFFilterHandle SHPAPI_CALL
+      goDBFFilterNot( DBFFilterHandle psOperand );
+void SHPAPI_CALL
+      goDBFFilterDestroy( DBFFilterHandle psFilter );
+int SHPAPI_CALL
+      goDBFFilterSelect( DBFHandle psDBF, DBFFilterHandle psFilter,
+                         int iStart, int nCount, int *panSelected );
+
+/* -------------------------------------------------------------------- */
+/*      Persistent single field indexes (dbfindex.c)                    */
+/* -------------------------------------------------------------------- */
+typedef enum {
+  DBFIDX_BTREE,
+  DBFIDX_HASH
+} DBFIndexKind;
+
+typedef struct DBFIndexInfo *DBFIndexHandle;
+
+int SHPAPI_CALL
+      goDBFCreateIndex( DBFHandle psDBF, int iField, const char *pszIndexFile,
+                        DBFIndexKind eKind );
+DBFIndexHandle SHPAPI_CALL
+      goDBFOpenIndex( DBFHandle psDBF, const char *pszIndexFile );
+void SHPAPI_CALL
+      goDBFCloseIndex( DBFIndexHandle psIndex );
+int SHPAPI_CALL1(*)
+      goDBFIndexSearchRange( DBFIndexHandle psIndex, double dfMin, double dfMax,
+                             int *pnCount );
+int SHPAPI_CALL1(*)
+      goDBFIndexSearchString( DBFIndexHandle psIndex, const char *pszKey,
+                              int *pnCount );
+
+/* -------------------------------------------------------------------- */
+/*      Per block statistics for skipping records (dbfzonemap.c)        */
+/* -------------------------------------------------------------------- */
+typedef struct DBFZoneMapInfo *DBFZoneMapHandle;
+
+int SHPAPI_CALL
+      goDBFCreateZoneMap( DBFHandle psDBF, const char *pszZoneMapFile,
+                          int nBlockRecords );
+DBFZoneMapHandle SHPAPI_CALL
+      goDBFOpenZoneMap( DBFHandle psDBF, const char *pszZoneMapFile );
+void SHPAPI_CALL
+      goDBFCloseZoneMap( DBFZoneMapHandle psZoneMap );
+int SHPAPI_CALL
+      goDBFZoneMapGetBlockRecords( DBFZoneMapHandle psZoneMap );
+int SHPAPI_CALL
+      goDBFZoneMapHasNulls( DBFZoneMapHandle psZoneMap, int iBlock, int iField );
+int SHPAPI_CALL
+      goDBFZoneMapMayMatchDouble( DBFZoneMapHandle psZoneMap, int iBlock,
+                                  int iField, DBFCompareOp eOp, double dfValue );
+int SHPAPI_CALL
+      goDBFZoneMapMayMatchString( DBFZoneMapHandle psZoneMap, int iBlock,
+                                  int iField, DBFCompareOp eOp,
+                                  const char *pszValue );
+int SHPAPI_CALL
+      goDBFZoneMapMayMatchLogical( DBFZoneMapHandle psZoneMap, int iBlock,
+                                   int iField, int bValue );
+int SHPAPI_CALL
+      goDBFFilterSelectEx( DBFHandle psDBF, DBFFilterHandle psFilter,
+                           DBFZoneMapHandle psZoneMap,
+                           int iStart, int nCount, int *panSelected );
+int SHPAPI_CALL
+      goDBFCursorFilterSelect( DBFCursorHandle psCursor, DBFFilterHandle psFilter,
+                               DBFZoneMapHandle psZoneMap,
+                               int iStart, int nCount, int *panSelected );
+
 #ifdef __cplusplus
 }
 #endif
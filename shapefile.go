@@ -46,6 +46,16 @@ const (
 	Invalid
 )
 
+// AccessPattern tells how a shapefile is going to be read, so that the
+// operating system can tune read-ahead.
+type AccessPattern int
+
+const (
+	AccessNormal     AccessPattern = 0
+	AccessSequential AccessPattern = 1 // full scans
+	AccessRandom     AccessPattern = 2 // index driven reads
+)
+
 type Part struct {
 	Type     PartType
 	Vertices []Point
@@ -75,6 +85,10 @@ type ShapeFile struct {
 
 	hDb        DBFHandle
 	FieldCount int
+
+	projection []int            // fields of Shape.Attrs, nil for all
+	zoneMap    DBFZoneMapHandle // statistics used by Select, if any
+	utf8       bool             // strings are recoded, see RecodeToUTF8
 }
 
 type Point struct {
@@ -86,13 +100,38 @@ type BoundingBox struct {
 	Max Point
 }
 
+// Open opens a shapefile for reading. Besides regular files, file may name a
+// member of a zip archive ("data.zip/roads.shp"), and gzip compressed
+// components ("roads.shp.gz", "roads.dbf.gz") are used when the uncompressed
+// ones are missing.
 func Open(file string) *ShapeFile {
-	hShape := goSHPOpen(file, "rb")
+	return open(file, "rb", zipHooks)
+}
+
+// OpenMapped opens a shapefile for reading with its attribute table mapped
+// into memory, so that attributes are decoded in place instead of being
+// copied out of the file record by record. The file must not be modified
+// while it is open. Where mapping is not possible, such as in compressed
+// files, it is read as with Open.
+func OpenMapped(file string) *ShapeFile {
+	return open(file, "rbm", zipHooks)
+}
+
+// OpenBulk opens a shapefile for a one-off full scan, such as a re-export.
+// The files are read sequentially in large blocks bypassing the page cache
+// (O_DIRECT where the file system supports it), so that the scan does not
+// evict data other processes rely on. Random access works but is slow.
+func OpenBulk(file string) *ShapeFile {
+	return open(file, "rbs", directHooks)
+}
+
+func open(file, mode string, hooks ioHooks) *ShapeFile {
+	hShape := goSHPOpenLL(file, mode, hooks)
 	if hShape == nil {
 		panic("Cannot open shape file " + file)
 	}
 
-	hDb := goDBFOpen(file, "rb")
+	hDb := goDBFOpenLL(file, mode, hooks)
 	if hDb == nil {
 		panic("Cannot open db file " + file)
 	}
@@ -119,10 +158,45 @@ func Open(file string) *ShapeFile {
 		panic("Shape count and db record count does not match.")
 	}
 	return &ShapeFile{hShape, ShapeType(shapeType), nEntries, box,
-		hDb, fieldCount}
+		hDb, fieldCount, nil, nil, false}
+}
+
+// SetAccessPattern declares how the shapes and their attributes will be
+// read from now on.
+func (f *ShapeFile) SetAccessPattern(pattern AccessPattern) {
+	goSHPSetAccessPattern(f.hShape, int(pattern))
+	goDBFSetAccessPattern(f.hDb, int(pattern))
+}
+
+// SetReadAhead makes attribute reads load records bytes at a time, which
+// speeds up scans over all shapes; AccessSequential enables it with 1 MB.
+// With reverse set, the records before the one requested are loaded, for
+// scans from the last shape down. A size of 0 disables read-ahead.
+func (f *ShapeFile) SetReadAhead(bytes int, reverse bool) {
+	goDBFSetReadAhead(f.hDb, bytes, reverse)
+}
+
+// SetProjection restricts the Attrs of the shapes read from now on to the
+// named fields, and only their part of each attribute record is read when
+// they are close together in it. No fields means all of them.
+func (f *ShapeFile) SetProjection(fields ...string) error {
+	var projection []int
+	for _, field := range fields {
+		j := goDBFGetFieldIndex(f.hDb, field)
+		if j < 0 {
+			return fmt.Errorf("no field %q", field)
+		}
+		projection = append(projection, j)
+	}
+	goDBFSetProjection(f.hDb, projection)
+	f.projection = projection
+	return nil
 }
 
 func (f *ShapeFile) Close() {
+	if f.zoneMap != nil {
+		goDBFCloseZoneMap(f.zoneMap)
+	}
 	goSHPClose(f.hShape)
 	goDBFClose(f.hDb)
 }
@@ -134,6 +208,27 @@ func (f *ShapeFile) Shape(shapeIndex int) *Shape {
 	s := goSHPReadObject(f.hShape, shapeIndex)
 	defer goSHPDestroyObject(s)
 
+	return f.toShape(s, shapeIndex)
+}
+
+// Shapes reads several shapes at once, such as the hits of a spatial index
+// query. The record reads are issued together rather than one by one, which
+// is much faster on storage serving concurrent requests. The result follows
+// the order of shapeIndexes, with nil for shapes that could not be read.
+func (f *ShapeFile) Shapes(shapeIndexes []int) []*Shape {
+	objects := goSHPReadObjects(f.hShape, shapeIndexes)
+	defer goSHPDestroyObjects(objects)
+
+	shapes := make([]*Shape, len(shapeIndexes))
+	for i, s := range objects {
+		if s != nil {
+			shapes[i] = f.toShape(s, shapeIndexes[i])
+		}
+	}
+	return shapes
+}
+
+func (f *ShapeFile) toShape(s *SHPObject, shapeIndex int) *Shape {
 	return &Shape{
 		Type: ShapeType(s.ShapeType),
 		Id:   int(s.ShapeId),
@@ -185,11 +280,18 @@ func (f *ShapeFile) Shape(shapeIndex int) *Shape {
 		}(),
 		Attrs: func() map[string]interface{} {
 			attrs := map[string]interface{}{}
-			for j := 0; j < f.FieldCount; j++ {
+			fields := f.projection
+			if fields == nil {
+				fields = make([]int, f.FieldCount)
+				for j := range fields {
+					fields[j] = j
+				}
+			}
+			for _, j := range fields {
 				name, type_, _, _ := goDBFGetFieldInfo(f.hDb, j)
 				switch FieldType(type_) {
 				case String:
-					attrs[name] = string(goDBFReadStringAttribute(f.hDb, shapeIndex, j))
+					attrs[name] = goDBFReadStringView(f.hDb, shapeIndex, j)
 				case Integer, Logical:
 					attrs[name] = goDBFReadIntegerAttribute(f.hDb, shapeIndex, j)
 				case Double:
@@ -203,6 +305,112 @@ func (f *ShapeFile) Shape(shapeIndex int) *Shape {
 	}
 }
 
+// IntColumn reads an attribute of count records starting at start in one
+// go, which is much faster than going through Shape for each record when
+// only a few columns are needed. null[i] tells whether the value of record
+// start+i is NULL. The result is shorter than count at the end of the file,
+// and nil if field does not exist.
+func (f *ShapeFile) IntColumn(field string, start, count int) (values []int, null []bool) {
+	j := goDBFGetFieldIndex(f.hDb, field)
+	if j < 0 {
+		return nil, nil
+	}
+	return goDBFReadIntegerColumn(f.hDb, j, start, count)
+}
+
+// FloatColumn is the float64 variant of IntColumn.
+func (f *ShapeFile) FloatColumn(field string, start, count int) (values []float64, null []bool) {
+	j := goDBFGetFieldIndex(f.hDb, field)
+	if j < 0 {
+		return nil, nil
+	}
+	return goDBFReadDoubleColumn(f.hDb, j, start, count)
+}
+
+// StringColumn is the string variant of IntColumn.
+func (f *ShapeFile) StringColumn(field string, start, count int) (values []string, null []bool) {
+	j := goDBFGetFieldIndex(f.hDb, field)
+	if j < 0 {
+		return nil, nil
+	}
+	_, _, width, _ := goDBFGetFieldInfo(f.hDb, j)
+	if f.utf8 {
+		width *= 3
+	}
+	return goDBFReadStringColumn(f.hDb, j, start, count, width)
+}
+
+// DictionaryColumn reads a string attribute like StringColumn, but returns
+// each distinct value once, in values, and for record start+i the index
+// codes[i] of its value, or -1 if it is NULL. Fields with few distinct
+// values take a fraction of the memory of one string per record.
+func (f *ShapeFile) DictionaryColumn(field string, start, count int) (values []string, codes []int32) {
+	j := goDBFGetFieldIndex(f.hDb, field)
+	if j < 0 {
+		return nil, nil
+	}
+	return goDBFReadDictionaryColumn(f.hDb, j, start, count)
+}
+
+// DateColumn is the variant of IntColumn for YYYYMMDD date fields, which
+// it decodes to days since 1970-01-01. Values that are not valid dates are
+// NULL.
+func (f *ShapeFile) DateColumn(field string, start, count int) (days []int32, null []bool) {
+	j := goDBFGetFieldIndex(f.hDb, field)
+	if j < 0 {
+		return nil, nil
+	}
+	return goDBFReadDateColumn(f.hDb, j, start, count)
+}
+
+// LogicalColumn is the variant of IntColumn for logical fields. Values other
+// than T, Y, F and N, in either case, are NULL.
+func (f *ShapeFile) LogicalColumn(field string, start, count int) (values []bool, null []bool) {
+	j := goDBFGetFieldIndex(f.hDb, field)
+	if j < 0 {
+		return nil, nil
+	}
+	return goDBFReadLogicalColumn(f.hDb, j, start, count)
+}
+
+// RecodeToUTF8 makes the string attributes read from the file UTF-8,
+// recoded from codePage, or from the code page the file declares if
+// codePage is empty. Supported code pages are 1252, 437, 850, ISO-8859-1
+// to ISO-8859-16, GBK and UTF-8 itself, in their usual spellings.
+func (f *ShapeFile) RecodeToUTF8(codePage string) error {
+	if codePage == "" {
+		codePage = goDBFGetCodePage(f.hDb)
+	}
+	if !goDBFSetRecodeToUTF8(f.hDb, codePage) {
+		return fmt.Errorf("cannot recode code page %q", codePage)
+	}
+	f.utf8 = true
+	return nil
+}
+
+// LoadBitmaps finds in one pass over count records from start which are
+// deleted and which of their attributes are NULL, so that Deleted and IsNull
+// answer for them without reading the records again. The bitmaps replace
+// those of any previous call, and are dropped when the attributes change.
+func (f *ShapeFile) LoadBitmaps(start, count int) error {
+	if goDBFLoadBitmaps(f.hDb, start, count) < 0 {
+		return fmt.Errorf("cannot load bitmaps of records %d to %d", start, start+count-1)
+	}
+	return nil
+}
+
+// Deleted tells whether the attribute record of shape shapeIndex is marked
+// deleted.
+func (f *ShapeFile) Deleted(shapeIndex int) bool {
+	return goDBFIsRecordDeleted(f.hDb, shapeIndex)
+}
+
+// IsNull tells whether attribute field of shape shapeIndex is NULL, which
+// it is for fields that do not exist.
+func (f *ShapeFile) IsNull(shapeIndex int, field string) bool {
+	return goDBFIsAttributeNULL(f.hDb, shapeIndex, goDBFGetFieldIndex(f.hDb, field))
+}
+
 func (f *ShapeFile) Feature(shapeIndex int) *geom.Feature {
 	defer func() {
 		if p := recover(); p != nil {
@@ -1,6 +1,20 @@
 package shp
 
-import "testing"
+import (
+	"archive/zip"
+	"bytes"
+	"compress/gzip"
+	"encoding/binary"
+	"fmt"
+	"math"
+	"os"
+	"path/filepath"
+	"strings"
+	"sync"
+	"syscall"
+	"testing"
+	"time"
+)
 
 func TestReadPoint(t *testing.T) {
 	shp := Open("./test_files/point.shp")
@@ -136,3 +150,1364 @@ func TestReadPolygonZ(t *testing.T) {
 	}
 
 }
+
+func writePointShapefile(t *testing.T, base string, n int) {
+	header := func(fileLen int) []byte {
+		h := make([]byte, 100)
+		binary.BigEndian.PutUint32(h[0:], 9994)
+		binary.BigEndian.PutUint32(h[24:], uint32(fileLen/2))
+		binary.LittleEndian.PutUint32(h[28:], 1000)
+		binary.LittleEndian.PutUint32(h[32:], uint32(ShapePoint))
+		binary.LittleEndian.PutUint64(h[52:], math.Float64bits(float64(n-1)))
+		binary.LittleEndian.PutUint64(h[60:], math.Float64bits(float64(n-1)/2))
+		return h
+	}
+
+	shp := header(100 + n*28)
+	shx := header(100 + n*8)
+	dbf := []byte{3, 120, 1, 1, 0, 0, 0, 0, 65, 0, 11, 0}
+	binary.LittleEndian.PutUint32(dbf[4:], uint32(n))
+	dbf = append(dbf, make([]byte, 20)...)
+	field := make([]byte, 32)
+	copy(field, "ID")
+	field[11], field[16] = 'N', 10
+	dbf = append(append(dbf, field...), 0x0d)
+	for i := 0; i < n; i++ {
+		rec := make([]byte, 28)
+		binary.BigEndian.PutUint32(rec[0:], uint32(i+1))
+		binary.BigEndian.PutUint32(rec[4:], 10)
+		binary.LittleEndian.PutUint32(rec[8:], uint32(ShapePoint))
+		binary.LittleEndian.PutUint64(rec[12:], math.Float64bits(float64(i)))
+		binary.LittleEndian.PutUint64(rec[20:], math.Float64bits(float64(i)/2))
+		idx := make([]byte, 8)
+		binary.BigEndian.PutUint32(idx[0:], uint32((100+i*28)/2))
+		binary.BigEndian.PutUint32(idx[4:], 10)
+		shp, shx = append(shp, rec...), append(shx, idx...)
+		dbf = append(dbf, fmt.Sprintf(" %10d", i)...)
+	}
+	dbf = append(dbf, 0x1a)
+
+	for ext, data := range map[string][]byte{".shp": shp, ".shx": shx, ".dbf": dbf} {
+		if err := os.WriteFile(base+ext, data, 0644); err != nil {
+			t.Fatal(err)
+		}
+	}
+}
+
+func compressShapefile(t *testing.T, src, dir, name string) {
+	zf, err := os.Create(filepath.Join(dir, name+".zip"))
+	if err != nil {
+		t.Fatal(err)
+	}
+	zw := zip.NewWriter(zf)
+	for i, ext := range []string{".shp", ".shx", ".dbf"} {
+		data, err := os.ReadFile(src + ext)
+		if err != nil {
+			t.Fatal(err)
+		}
+
+		method := zip.Deflate
+		if i == 1 {
+			method = zip.Store
+		}
+		w, err := zw.CreateHeader(&zip.FileHeader{Name: "dir/" + name + ext, Method: method})
+		if err != nil {
+			t.Fatal(err)
+		}
+		w.Write(data)
+
+		gf, err := os.Create(filepath.Join(dir, name+ext+".gz"))
+		if err != nil {
+			t.Fatal(err)
+		}
+		gw := gzip.NewWriter(gf)
+		gw.Name = name + ext
+		gw.Write(data)
+		gw.Close()
+		gf.Close()
+	}
+	if err := zw.Close(); err != nil {
+		t.Fatal(err)
+	}
+	zf.Close()
+}
+
+func TestReadCompressed(t *testing.T) {
+	dir := t.TempDir()
+	writePointShapefile(t, filepath.Join(dir, "big"), 200000)
+
+	names := []string{"big", "point", "polyline", "polygonz", "multipatch"}
+	for _, name := range names {
+		src := filepath.Join("test_files", name)
+		if name == "big" {
+			src = filepath.Join(dir, name)
+		}
+		compressShapefile(t, src, dir, name)
+
+		plain := Open(src + ".shp")
+		for _, path := range []string{
+			filepath.Join(dir, name+".zip", "dir", name+".shp"),
+			filepath.Join(dir, name+".shp"),
+		} {
+			f := Open(path)
+			if f.ShapeCount != plain.ShapeCount || f.Box != plain.Box {
+				t.Fatalf("%s: header mismatch", path)
+			}
+			// Forward, then backwards and strided to exercise seeking.
+			ids := []int{}
+			for i := 0; i < f.ShapeCount; i += 1 + f.ShapeCount/1000 {
+				ids = append(ids, i)
+			}
+			for i := f.ShapeCount - 1; i >= 0; i -= 1 + f.ShapeCount/700 {
+				ids = append(ids, i)
+			}
+			for _, i := range ids {
+				want, got := plain.Shape(i), f.Shape(i)
+				if fmt.Sprint(want) != fmt.Sprint(got) {
+					t.Fatalf("%s: shape %d is %v, want %v", path, i, got, want)
+				}
+			}
+			f.Close()
+		}
+		plain.Close()
+	}
+}
+
+func TestReadShapes(t *testing.T) {
+	dir := t.TempDir()
+	writePointShapefile(t, filepath.Join(dir, "big"), 50000)
+	compressShapefile(t, filepath.Join(dir, "big"), dir, "big")
+
+	ids := []int{-1, 49999, 7, 7, 50000}
+	for i := 0; i < 5000; i++ {
+		ids = append(ids, (i*7919)%50000)
+	}
+
+	plain := Open(filepath.Join(dir, "big.shp"))
+	defer plain.Close()
+	for _, path := range []string{
+		filepath.Join(dir, "big.shp"),
+		filepath.Join(dir, "big.zip", "dir", "big.shp"),
+	} {
+		f := Open(path)
+		shapes := f.Shapes(ids)
+		if len(shapes) != len(ids) {
+			t.Fatalf("%s: got %d shapes, want %d", path, len(shapes), len(ids))
+		}
+		for i, id := range ids {
+			if id < 0 || id >= f.ShapeCount {
+				if shapes[i] != nil {
+					t.Fatalf("%s: shape %d should be nil", path, id)
+				}
+				continue
+			}
+			if want := plain.Shape(id); fmt.Sprint(want) != fmt.Sprint(shapes[i]) {
+				t.Fatalf("%s: shape %d is %v, want %v", path, id, shapes[i], want)
+			}
+		}
+		f.Close()
+	}
+
+	polygons := Open("./test_files/polygonz.shp")
+	defer polygons.Close()
+	for i, s := range polygons.Shapes([]int{0, 0}) {
+		if want := polygons.Shape(0); fmt.Sprint(want) != fmt.Sprint(s) {
+			t.Fatalf("polygonz: shape %d is %v, want %v", i, s, want)
+		}
+	}
+}
+
+func TestAccessPattern(t *testing.T) {
+	dir := t.TempDir()
+	writePointShapefile(t, filepath.Join(dir, "big"), 20000)
+	compressShapefile(t, filepath.Join(dir, "big"), dir, "big")
+
+	for _, path := range []string{
+		filepath.Join(dir, "big.shp"),
+		filepath.Join(dir, "big.zip", "dir", "big.shp"),
+	} {
+		f := Open(path)
+		f.SetAccessPattern(AccessRandom)
+		for i := f.ShapeCount - 1; i >= 0; i -= 997 {
+			if s := f.Shape(i); s == nil || s.Id != i || fmt.Sprint(s.Attrs["ID"]) != fmt.Sprint(i) {
+				t.Fatalf("%s: bad shape %d: %v", path, i, s)
+			}
+		}
+		f.SetAccessPattern(AccessSequential)
+		for i := 0; i < f.ShapeCount; i++ {
+			if s := f.Shape(i); s == nil || s.Id != i || fmt.Sprint(s.Attrs["ID"]) != fmt.Sprint(i) {
+				t.Fatalf("%s: bad shape %d: %v", path, i, s)
+			}
+		}
+		f.Close()
+	}
+}
+
+func TestOpenBulk(t *testing.T) {
+	dir := t.TempDir()
+	writePointShapefile(t, filepath.Join(dir, "big"), 300000)
+
+	plain := Open(filepath.Join(dir, "big.shp"))
+	defer plain.Close()
+	f := OpenBulk(filepath.Join(dir, "big.shp"))
+	defer f.Close()
+	if f.ShapeCount != plain.ShapeCount || f.Box != plain.Box {
+		t.Fatal("header mismatch")
+	}
+	for i := 0; i < f.ShapeCount; i += 37 {
+		if want, got := plain.Shape(i), f.Shape(i); fmt.Sprint(want) != fmt.Sprint(got) {
+			t.Fatalf("shape %d is %v, want %v", i, got, want)
+		}
+	}
+	if s := f.Shape(3); fmt.Sprint(s) != fmt.Sprint(plain.Shape(3)) {
+		t.Fatalf("shape 3 after rewind is %v", s)
+	}
+}
+
+func TestReadColumns(t *testing.T) {
+	base := filepath.Join(t.TempDir(), "points")
+	writePointShapefile(t, base, 1000)
+
+	// blank out the ID of record 5, which makes it NULL
+	dbf, err := os.OpenFile(base+".dbf", os.O_WRONLY, 0)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, err := dbf.WriteAt([]byte("          "), 65+5*11+1); err != nil {
+		t.Fatal(err)
+	}
+	dbf.Close()
+
+	shp := Open(base + ".shp")
+	defer shp.Close()
+
+	ints, null := shp.IntColumn("ID", 990, 20)
+	if len(ints) != 10 || len(null) != 10 || ints[3] != 993 || null[3] {
+		t.Fatalf("IntColumn = %v %v", ints, null)
+	}
+	floats, null := shp.FloatColumn("ID", 0, 10)
+	if len(floats) != 10 || floats[4] != 4 || !null[5] || floats[5] != 0 || null[6] {
+		t.Fatalf("FloatColumn = %v %v", floats, null)
+	}
+	strs, null := shp.StringColumn("ID", 4, 3)
+	if len(strs) != 3 || strs[0] != "4" || strs[1] != "" || !null[1] || strs[2] != "6" {
+		t.Fatalf("StringColumn = %q %v", strs, null)
+	}
+	if ints, _ := shp.IntColumn("NOPE", 0, 10); ints != nil {
+		t.Fatalf("IntColumn of a missing field = %v", ints)
+	}
+
+	// the column readers must not disturb record at a time access
+	if s := shp.Shape(7); fmt.Sprint(s.Attrs["ID"]) != "7" {
+		t.Fatalf("Shape(7).Attrs = %v", s.Attrs)
+	}
+
+	// integers of character fields clamp like those of numeric fields
+	base = filepath.Join(filepath.Dir(base), "text")
+	writePointShapefile(t, base, 3)
+	w, err := CreateTable(base+".dbf", []Field{{Name: "TEXT", Type: String, Width: 12}})
+	if err != nil {
+		t.Fatal(err)
+	}
+	for _, text := range []string{"99999999999", " -12", "x"} {
+		if err := w.Append(text); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if err := w.Close(); err != nil {
+		t.Fatal(err)
+	}
+	text := Open(base + ".shp")
+	defer text.Close()
+	if ints, _ := text.IntColumn("TEXT", 0, 3); fmt.Sprint(ints) != "[2147483647 -12 0]" {
+		t.Fatalf("IntColumn of TEXT = %v", ints)
+	}
+}
+
+func TestReadAhead(t *testing.T) {
+	base := filepath.Join(t.TempDir(), "points")
+	writePointShapefile(t, base, 500)
+
+	shp := Open(base + ".shp")
+	defer shp.Close()
+
+	// small windows, so that the scans cross many refills
+	for _, reverse := range []bool{false, true} {
+		shp.SetReadAhead(100, reverse)
+		for k := 0; k < shp.ShapeCount; k++ {
+			i := k
+			if reverse {
+				i = shp.ShapeCount - 1 - k
+			}
+			if s := shp.Shape(i); fmt.Sprint(s.Attrs["ID"]) != fmt.Sprint(i) {
+				t.Fatalf("reverse=%v: Shape(%d).Attrs = %v", reverse, i, s.Attrs)
+			}
+		}
+	}
+}
+
+func TestOpenMapped(t *testing.T) {
+	base := filepath.Join(t.TempDir(), "points")
+	writePointShapefile(t, base, 300)
+
+	shp := OpenMapped(base + ".shp")
+	defer shp.Close()
+
+	for _, i := range []int{0, 299, 150} {
+		if s := shp.Shape(i); fmt.Sprint(s.Attrs["ID"]) != fmt.Sprint(i) {
+			t.Fatalf("Shape(%d).Attrs = %v", i, s.Attrs)
+		}
+	}
+	if ints, null := shp.IntColumn("ID", 295, 10); len(ints) != 5 || ints[4] != 299 || null[4] {
+		t.Fatalf("IntColumn = %v %v", ints, null)
+	}
+}
+
+// writeDBF replaces the .dbf of base with one having a numeric ID, a wide
+// NAME and a numeric CODE field.
+func writeDBF(t *testing.T, base string, n int) {
+	dbf := []byte{3, 120, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0}
+	binary.LittleEndian.PutUint32(dbf[4:], uint32(n))
+	binary.LittleEndian.PutUint16(dbf[8:], 32+3*32+1)
+	binary.LittleEndian.PutUint16(dbf[10:], 1+10+100+5)
+	dbf = append(dbf, make([]byte, 20)...)
+	for _, f := range []struct {
+		name  string
+		typ   byte
+		width byte
+	}{{"ID", 'N', 10}, {"NAME", 'C', 100}, {"CODE", 'N', 5}} {
+		field := make([]byte, 32)
+		copy(field, f.name)
+		field[11], field[16] = f.typ, f.width
+		dbf = append(dbf, field...)
+	}
+	dbf = append(dbf, 0x0d)
+	for i := 0; i < n; i++ {
+		dbf = append(dbf, fmt.Sprintf(" %10d%-100s%5d", i, fmt.Sprint("name ", i), i%7)...)
+	}
+	dbf = append(dbf, 0x1a)
+	if err := os.WriteFile(base+".dbf", dbf, 0644); err != nil {
+		t.Fatal(err)
+	}
+}
+
+func TestZipSuffixedDirectory(t *testing.T) {
+	dir := filepath.Join(t.TempDir(), "data.zip")
+	os.Mkdir(dir, 0755)
+	base := filepath.Join(dir, "points")
+	writePointShapefile(t, base, 20)
+
+	f := Open(base + ".shp")
+	if f == nil || f.ShapeCount != 20 {
+		t.Fatal("cannot open a shapefile in a directory named data.zip")
+	}
+	defer f.Close()
+	if s := f.Shape(7); s == nil || s.Box.Min.X != 7 {
+		t.Errorf("Shape(7) = %v", s)
+	}
+}
+
+func TestProjection(t *testing.T) {
+	base := filepath.Join(t.TempDir(), "points")
+	writePointShapefile(t, base, 50)
+	writeDBF(t, base, 50)
+
+	shp := Open(base + ".shp")
+	defer shp.Close()
+
+	if err := shp.SetProjection("ID", "NOPE"); err == nil {
+		t.Fatal("SetProjection accepted a missing field")
+	}
+	// CODE alone is clustered and read partially, ID and CODE span the record
+	for _, fields := range [][]string{{"CODE"}, {"CODE", "ID"}} {
+		if err := shp.SetProjection(fields...); err != nil {
+			t.Fatal(err)
+		}
+		for _, i := range []int{3, 4, 4, 49} {
+			s := shp.Shape(i)
+			if len(s.Attrs) != len(fields) || fmt.Sprint(s.Attrs["CODE"]) != fmt.Sprint(i%7) {
+				t.Fatalf("%v: Shape(%d).Attrs = %v", fields, i, s.Attrs)
+			}
+		}
+	}
+	// switching between disjoint clustered projections rereads the record
+	for _, field := range []string{"ID", "CODE", "ID"} {
+		if err := shp.SetProjection(field); err != nil {
+			t.Fatal(err)
+		}
+		want := map[string]int{"ID": 9, "CODE": 2}[field]
+		if s := shp.Shape(9); fmt.Sprint(s.Attrs[field]) != fmt.Sprint(want) {
+			t.Fatalf("%s: Shape(9).Attrs = %v", field, s.Attrs)
+		}
+	}
+	// fields outside the projection still read correctly
+	if names, _ := shp.StringColumn("NAME", 4, 1); len(names) != 1 || names[0] != "name 4" {
+		t.Fatalf("NAME = %q", names)
+	}
+	shp.SetProjection()
+	if s := shp.Shape(5); len(s.Attrs) != 3 || s.Attrs["NAME"] != "name 5" {
+		t.Fatalf("Shape(5).Attrs = %v", s.Attrs)
+	}
+}
+
+func TestSelect(t *testing.T) {
+	base := filepath.Join(t.TempDir(), "points")
+	writePointShapefile(t, base, 50)
+	writeDBF(t, base, 50)
+
+	shp := Open(base + ".shp")
+	defer shp.Close()
+
+	for _, c := range []struct {
+		predicate Predicate
+		want      string
+	}{
+		{Compare("CODE", OpEqual, 3), "[3 10 17 24 31 38 45]"},
+		{And(Compare("CODE", OpEqual, 3), Compare("ID", OpGreater, 20.5)), "[24 31 38 45]"},
+		{Or(Compare("ID", OpLess, 2), Compare("NAME", OpEqual, "name 47")), "[0 1 47]"},
+		{And(Compare("NAME", OpGreaterEqual, "name 48"), Compare("NAME", OpLess, "name 5"),
+			Not(Compare("CODE", OpEqual, 6))), "[49]"},
+		{IsNull("NAME"), "[]"},
+	} {
+		selected, err := shp.Select(c.predicate, 0, 100)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if fmt.Sprint(selected) != c.want {
+			t.Errorf("Select(%v) = %v, want %s", c.predicate, selected, c.want)
+		}
+	}
+	if selected, _ := shp.Select(Compare("CODE", OpEqual, 3), 20, 10); fmt.Sprint(selected) != "[24]" {
+		t.Errorf("Select from 20 = %v", selected)
+	}
+	if _, err := shp.Select(Compare("NOPE", OpEqual, 1), 0, 50); err == nil {
+		t.Error("Select accepted a missing field")
+	}
+	for _, start := range []int{-1, 51} {
+		if _, err := shp.Select(Compare("CODE", OpEqual, 3), start, 10); err == nil {
+			t.Errorf("Select accepted start %d", start)
+		}
+	}
+	if selected, err := shp.Select(Compare("CODE", OpEqual, 3), 50, 10); err != nil || len(selected) != 0 {
+		t.Errorf("Select from the end = %v, %v", selected, err)
+	}
+}
+
+func TestIndex(t *testing.T) {
+	base := filepath.Join(t.TempDir(), "points")
+	writePointShapefile(t, base, 1000)
+	writeDBF(t, base, 1000)
+
+	shp := Open(base + ".shp")
+	defer shp.Close()
+
+	if err := shp.CreateIndex("NAME", base+".NAME.dbx", IndexBTree); err == nil {
+		t.Fatal("CreateIndex built a B+tree on a character field")
+	}
+	for field, kind := range map[string]IndexKind{"ID": IndexBTree, "CODE": IndexBTree, "NAME": IndexHash} {
+		if err := shp.CreateIndex(field, base+"."+field+".dbx", kind); err != nil {
+			t.Fatal(err)
+		}
+	}
+
+	ids, err := shp.OpenIndex(base + ".ID.dbx")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer ids.Close()
+	if got := ids.Range(340.5, 345); fmt.Sprint(got) != "[341 342 343 344 345]" {
+		t.Errorf("ID in [340.5, 345] = %v", got)
+	}
+	if got := ids.Range(-5, 0); fmt.Sprint(got) != "[0]" {
+		t.Errorf("ID in [-5, 0] = %v", got)
+	}
+	if got := ids.Lookup("12"); got != nil {
+		t.Errorf("Lookup on a B+tree = %v", got)
+	}
+
+	codes, err := shp.OpenIndex(base + ".CODE.dbx")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer codes.Close()
+	// equal keys spill over many leaves and come back by increasing id
+	if got := codes.Range(5, 5); len(got) != 143 || got[0] != 5 || got[142] != 999 {
+		t.Errorf("CODE = 5: %d ids from %v", len(got), got[:1])
+	}
+
+	names, err := shp.OpenIndex(base + ".NAME.dbx")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer names.Close()
+	for key, want := range map[string]string{"name 777": "[777]", " name 3 ": "[3]", "name": "[]", "name 1000": "[]"} {
+		if got := names.Lookup(key); fmt.Sprint(got) != want {
+			t.Errorf("Lookup(%q) = %v, want %s", key, got, want)
+		}
+	}
+
+	other := filepath.Join(t.TempDir(), "other")
+	writePointShapefile(t, other, 10)
+	writeDBF(t, other, 10)
+	shp2 := Open(other + ".shp")
+	defer shp2.Close()
+	if _, err := shp2.OpenIndex(base + ".ID.dbx"); err == nil {
+		t.Error("OpenIndex accepted the index of another file")
+	}
+
+	// entry counts and bucket ranges that do not agree
+	for _, c := range []struct {
+		field  string
+		offset int
+		value  int32
+	}{{"ID", 36, 1000 - 400}, {"ID", 40, 2}, {"NAME", 64 + 4, -5}, {"NAME", 36, 999}} {
+		data, _ := os.ReadFile(base + "." + c.field + ".dbx")
+		binary.LittleEndian.PutUint32(data[c.offset:], uint32(c.value))
+		bad := filepath.Join(t.TempDir(), "bad.dbx")
+		os.WriteFile(bad, data, 0644)
+		if index, err := shp.OpenIndex(bad); err == nil {
+			index.Close()
+			t.Errorf("OpenIndex accepted %s with %d at %d", c.field, c.value, c.offset)
+		}
+	}
+}
+
+func TestZoneMap(t *testing.T) {
+	base := filepath.Join(t.TempDir(), "points")
+	writePointShapefile(t, base, 1000)
+	writeDBF(t, base, 1000)
+
+	shp := Open(base + ".shp")
+	defer shp.Close()
+
+	if err := shp.CreateZoneMap(base+".dbz", 100); err != nil {
+		t.Fatal(err)
+	}
+	predicates := []Predicate{
+		Compare("ID", OpLess, 150),
+		And(Compare("ID", OpGreaterEqual, 420), Compare("ID", OpLessEqual, 430.5)),
+		Or(Compare("NAME", OpEqual, "name 777"), Compare("ID", OpEqual, 5)),
+		Compare("NAME", OpEqual, "nothing"),
+		Not(Compare("CODE", OpEqual, 2)),
+		IsNull("ID"),
+	}
+	var want []string
+	for _, p := range predicates {
+		selected, _ := shp.Select(p, 0, 1000)
+		want = append(want, fmt.Sprint(selected))
+	}
+	if err := shp.SetZoneMap(base + ".dbz"); err != nil {
+		t.Fatal(err)
+	}
+	for i, p := range predicates {
+		if selected, _ := shp.Select(p, 0, 1000); fmt.Sprint(selected) != want[i] {
+			t.Errorf("Select(%v) = %v, want %s", p, selected, want[i])
+		}
+	}
+
+	// from the middle of a block
+	if selected, _ := shp.Select(Compare("ID", OpLess, 150), 145, 1000); fmt.Sprint(selected) != "[145 146 147 148 149]" {
+		t.Errorf("Select from 145 = %v", selected)
+	}
+
+	other := filepath.Join(t.TempDir(), "other")
+	writePointShapefile(t, other, 10)
+	writeDBF(t, other, 10)
+	shp2 := Open(other + ".shp")
+	defer shp2.Close()
+	if err := shp2.SetZoneMap(base + ".dbz"); err == nil {
+		t.Error("SetZoneMap accepted the zone map of another file")
+	}
+}
+
+func TestCursors(t *testing.T) {
+	dir := t.TempDir()
+	src := filepath.Join(dir, "src", "points")
+	os.Mkdir(filepath.Dir(src), 0755)
+	writePointShapefile(t, src, 500)
+	writeDBF(t, src, 500)
+	compressShapefile(t, src, dir, "points")
+
+	// descriptors read with pread, mapped files and compressed ones
+	for _, shp := range []*ShapeFile{Open(src + ".shp"), OpenMapped(src + ".shp"), Open(filepath.Join(dir, "points.shp"))} {
+		var wg sync.WaitGroup
+		errs := make(chan string, 8)
+		for g := 0; g < 8; g++ {
+			wg.Add(1)
+			go func(g int) {
+				defer wg.Done()
+				c := shp.NewCursor()
+				defer c.Close()
+				for k := 0; k < 500; k++ {
+					i := (k*37 + g*61) % 500
+					attrs := c.Attrs(i)
+					if attrs["ID"] != float64(i) || attrs["NAME"] != fmt.Sprint("name ", i) || attrs["CODE"] != i%7 {
+						errs <- fmt.Sprintf("Attrs(%d) = %v", i, attrs)
+						return
+					}
+				}
+			}(g)
+		}
+		wg.Wait()
+		close(errs)
+		for err := range errs {
+			t.Error(err)
+		}
+		shp.Close()
+	}
+}
+
+func TestReadBeyond4GB(t *testing.T) {
+	base := filepath.Join(t.TempDir(), "large")
+	const filler = 1431655724 // three records fill the file up to 4 GiB
+	const last = int64(1) << 32
+
+	shp, err := os.Create(base + ".shp")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer shp.Close()
+	if err := shp.Truncate(last + 28); err != nil {
+		t.Skip(err)
+	}
+	header := make([]byte, 100)
+	binary.BigEndian.PutUint32(header[0:], 9994)
+	binary.BigEndian.PutUint32(header[24:], math.MaxUint32)
+	binary.LittleEndian.PutUint32(header[28:], 1000)
+	binary.LittleEndian.PutUint32(header[32:], uint32(ShapePoint))
+	shx := append([]byte(nil), header...)
+	binary.BigEndian.PutUint32(shx[24:], (100+4*8)/2)
+
+	// sparse records of null shapes, then a point starting exactly at 4 GiB
+	offset := int64(100)
+	for i := 0; i < 4; i++ {
+		rec := make([]byte, 8)
+		binary.BigEndian.PutUint32(rec[0:], uint32(i+1))
+		length := filler
+		if i == 3 {
+			length = 20
+			rec = append(rec, make([]byte, 20)...)
+			binary.LittleEndian.PutUint32(rec[8:], uint32(ShapePoint))
+			binary.LittleEndian.PutUint64(rec[12:], math.Float64bits(3))
+			binary.LittleEndian.PutUint64(rec[20:], math.Float64bits(4))
+		}
+		binary.BigEndian.PutUint32(rec[4:], uint32(length/2))
+		if _, err := shp.WriteAt(rec, offset); err != nil {
+			t.Fatal(err)
+		}
+		idx := make([]byte, 8)
+		binary.BigEndian.PutUint32(idx[0:], uint32(offset/2))
+		binary.BigEndian.PutUint32(idx[4:], uint32(length/2))
+		shx = append(shx, idx...)
+		offset += 8 + int64(length)
+	}
+	if offset-28 != last {
+		t.Fatalf("last record at %d", offset-28)
+	}
+	if _, err := shp.WriteAt(header, 0); err != nil {
+		t.Fatal(err)
+	}
+	if err := os.WriteFile(base+".shx", shx, 0644); err != nil {
+		t.Fatal(err)
+	}
+	writeDBF(t, base, 4)
+
+	f := Open(base + ".shp")
+	defer f.Close()
+	if s := f.Shape(3); s == nil || s.Type != ShapePoint || s.Box.Min.X != 3 || s.Box.Min.Y != 4 {
+		t.Errorf("Shape(3) = %v", s)
+	}
+	if s := f.Shapes([]int{3}); s[0] == nil || s[0].Box.Min.X != 3 {
+		t.Errorf("Shapes([3]) = %v", s[0])
+	}
+}
+
+func TestTableWriter(t *testing.T) {
+	dir := t.TempDir()
+	want, got := filepath.Join(dir, "want"), filepath.Join(dir, "got")
+	const n = 12000 // more than one buffer of rows
+	writeDBF(t, want, n)
+
+	w, err := CreateTable(got+".dbf", []Field{
+		{Name: "ID", Type: Integer, Width: 10},
+		{Name: "NAME", Type: String, Width: 100},
+		{Name: "CODE", Type: Integer, Width: 5},
+	})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := w.Append(1, "one"); err == nil {
+		t.Error("Append accepted a missing value")
+	}
+	for i := 0; i < n; i++ {
+		if err := w.Append(i, fmt.Sprint("name ", i), i%7); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if err := w.Append(nil, strings.Repeat("x", 101), nil); err == nil {
+		t.Error("Append did not report a truncated value")
+	}
+	if err := w.Close(); err != nil {
+		t.Fatal(err)
+	}
+
+	wantBytes, _ := os.ReadFile(want + ".dbf")
+	gotBytes, _ := os.ReadFile(got + ".dbf")
+	if count := binary.LittleEndian.Uint32(gotBytes[4:]); count != n+1 {
+		t.Fatalf("record count %d, want %d", count, n+1)
+	}
+	header := int(binary.LittleEndian.Uint16(gotBytes[8:]))
+	records := gotBytes[header : len(gotBytes)-1]
+	if !bytes.Equal(records[:n*116], wantBytes[len(wantBytes)-1-n*116:len(wantBytes)-1]) {
+		t.Error("records differ from the reference file")
+	}
+	if last := string(records[n*116:]); last != " "+strings.Repeat("*", 10)+strings.Repeat("x", 100)+strings.Repeat("*", 5) {
+		t.Errorf("last record %q", last)
+	}
+	if gotBytes[len(gotBytes)-1] != 0x1a {
+		t.Error("missing end of file character")
+	}
+}
+
+func TestTableWriterFailure(t *testing.T) {
+	dir := t.TempDir()
+	fields := []Field{{Name: "ID", Type: Integer, Width: 10}, {Name: "NAME", Type: String, Width: 100}}
+
+	// rows with a value of an unsupported type are not written
+	types := filepath.Join(dir, "types")
+	writePointShapefile(t, types, 1)
+	w, err := CreateTable(types+".dbf", fields)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := w.Append(1, []byte("one")); err == nil {
+		t.Error("Append accepted a []byte")
+	}
+	if err := w.Append(2, "two"); err != nil {
+		t.Fatal(err)
+	}
+	if err := w.Close(); err != nil {
+		t.Fatal(err)
+	}
+	shp := Open(types + ".shp")
+	if ids, _ := shp.IntColumn("ID", 0, 10); len(ids) != 1 || ids[0] != 2 {
+		t.Errorf("rows %v, want [2]", ids)
+	}
+	shp.Close()
+
+	// rows past a failed write are rejected, not buffered
+	var limit syscall.Rlimit
+	if err := syscall.Getrlimit(syscall.RLIMIT_FSIZE, &limit); err != nil {
+		t.Skip(err)
+	}
+	small := limit
+	small.Cur = 64 * 1024
+	if err := syscall.Setrlimit(syscall.RLIMIT_FSIZE, &small); err != nil {
+		t.Skip(err)
+	}
+	defer syscall.Setrlimit(syscall.RLIMIT_FSIZE, &limit)
+
+	w, err = CreateTable(filepath.Join(dir, "full.dbf"), fields)
+	if err != nil {
+		t.Fatal(err)
+	}
+	failed := -1
+	for i := 0; i < 30000; i++ {
+		if err := w.Append(i, fmt.Sprint("name ", i)); err != nil {
+			if failed < 0 {
+				failed = i
+			}
+		} else if failed >= 0 {
+			t.Fatalf("row %d accepted after row %d failed", i, failed)
+		}
+	}
+	if failed < 0 {
+		t.Error("no row failed past the file size limit")
+	}
+	if err := w.Close(); err == nil {
+		t.Error("Close did not report the failed rows")
+	}
+}
+
+func TestFormatNumbers(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "numbers.dbf")
+	w, err := CreateTable(path, []Field{
+		{Name: "INT", Type: Integer, Width: 12},
+		{Name: "FIX", Type: Double, Width: 24, Decimals: 3},
+		{Name: "FINE", Type: Double, Width: 32, Decimals: 11},
+	})
+	if err != nil {
+		t.Fatal(err)
+	}
+	// exact ties, values next to ties and ones too large for the fast path
+	values := []float64{0, math.Copysign(0, -1), 0.5, 2.5, -0.0005, 0.0015, 1.0005, 1e15 + 0.5, 1e17, 123456.7895, 1e-12}
+	for i := 0; i < 2000; i++ {
+		values = append(values, float64(i*i-1000000)/float64(1+i%997), math.Pow(1.37, float64(i%60))*float64(i%3-1))
+	}
+	for i, v := range values {
+		if err := w.Append(i*i*(i%3-1), v, v); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if err := w.Close(); err != nil {
+		t.Fatal(err)
+	}
+
+	data, _ := os.ReadFile(path)
+	records := data[int(binary.LittleEndian.Uint16(data[8:])):]
+	for i, v := range values {
+		want := fmt.Sprintf(" %12d%24.3f%32.11f", i*i*(i%3-1), v, v)
+		if got := string(records[i*69 : (i+1)*69]); got != want {
+			t.Errorf("%v written as %q, want %q", v, got, want)
+		}
+	}
+}
+
+func TestSchemaEdit(t *testing.T) {
+	base := filepath.Join(t.TempDir(), "points")
+	writePointShapefile(t, base, 300)
+	writeDBF(t, base, 300)
+
+	edit, err := EditSchema(base + ".dbf")
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := edit.DeleteField("NOPE"); err == nil {
+		t.Error("DeleteField accepted a missing field")
+	}
+	for _, err := range []error{
+		edit.DeleteField("name"),
+		edit.AlterField("Id", Field{Name: "IDENT", Type: Double, Width: 14, Decimals: 0}),
+		edit.AlterField("CODE", Field{Name: "CODE", Type: Integer, Width: 3}),
+		edit.AddField(Field{Name: "LABEL", Type: String, Width: 4}),
+	} {
+		if err != nil {
+			t.Fatal(err)
+		}
+	}
+	if err := edit.Commit(); err != nil {
+		t.Fatal(err)
+	}
+	if _, err := os.Stat(base + ".dbf.tmp"); !os.IsNotExist(err) {
+		t.Error("temporary file left behind")
+	}
+
+	shp := Open(base + ".shp")
+	defer shp.Close()
+	if shp.FieldCount != 3 {
+		t.Fatalf("%d fields", shp.FieldCount)
+	}
+	for _, i := range []int{0, 7, 299} {
+		s := shp.Shape(i)
+		if s.Attrs["IDENT"] != float64(i) || s.Attrs["CODE"] != i%7 || s.Attrs["LABEL"] != "" {
+			t.Errorf("Shape(%d).Attrs = %v", i, s.Attrs)
+		}
+	}
+}
+
+func TestFieldIndex(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "wide.dbf")
+	fields := make([]Field, 40)
+	for j := range fields {
+		fields[j] = Field{Name: fmt.Sprintf("Field_%d", j), Type: Integer, Width: 4}
+	}
+	fields = append(fields, Field{Name: "FIELD_5", Type: Integer, Width: 4})
+	w, err := CreateTable(path, fields)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := w.Close(); err != nil {
+		t.Fatal(err)
+	}
+
+	h := goDBFOpen(path, "rb+")
+	if h == nil {
+		t.Fatal("cannot open")
+	}
+	defer goDBFClose(h)
+	for name, want := range map[string]int{
+		"Field_0": 0, "field_17": 17, "FIELD_39": 39, "field_5": 5,
+		"Field_40": -1, "Field_17 ": -1, "Field_17_long": -1, "": -1,
+	} {
+		if j := goDBFGetFieldIndex(h, name); j != want {
+			t.Errorf("goDBFGetFieldIndex(%q) = %d, want %d", name, j, want)
+		}
+	}
+
+	if goDBFAddField(h, "extra", int(String), 8, 0) != 41 {
+		t.Fatal("cannot add field")
+	}
+	if j := goDBFGetFieldIndex(h, "EXTRA"); j != 41 {
+		t.Errorf("goDBFGetFieldIndex(EXTRA) = %d after goDBFAddField", j)
+	}
+}
+
+func TestBitmaps(t *testing.T) {
+	base := filepath.Join(t.TempDir(), "points")
+	writePointShapefile(t, base, 100)
+	w, err := CreateTable(base+".dbf", []Field{
+		{Name: "N", Type: Integer, Width: 12},
+		{Name: "X", Type: Double, Width: 19, Decimals: 3},
+		{Name: "S", Type: String, Width: 20},
+		{Name: "B", Type: Logical, Width: 1},
+	})
+	if err != nil {
+		t.Fatal(err)
+	}
+	for i := 0; i < 100; i++ {
+		values := []interface{}{i, float64(i) / 4, fmt.Sprint("s", i), i%2 == 0}
+		for j := range values {
+			if (i+j)%(j+2) == 0 {
+				values[j] = nil
+			}
+		}
+		if err := w.Append(values...); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if err := w.Close(); err != nil {
+		t.Fatal(err)
+	}
+
+	dbf, err := os.ReadFile(base + ".dbf")
+	if err != nil {
+		t.Fatal(err)
+	}
+	header := int(binary.LittleEndian.Uint16(dbf[8:]))
+	length := int(binary.LittleEndian.Uint16(dbf[10:]))
+	for i := 0; i < 100; i += 3 {
+		dbf[header+i*length] = '*'
+	}
+	if err := os.WriteFile(base+".dbf", dbf, 0644); err != nil {
+		t.Fatal(err)
+	}
+
+	shp := Open(base + ".shp")
+	defer shp.Close()
+	fields := []string{"N", "X", "S", "B", "NOPE"}
+	type row struct {
+		deleted bool
+		null    [5]bool
+	}
+	read := func() []row {
+		rows := make([]row, 100)
+		for i := range rows {
+			rows[i].deleted = shp.Deleted(i)
+			for j, field := range fields {
+				rows[i].null[j] = shp.IsNull(i, field)
+			}
+		}
+		return rows
+	}
+
+	want := read()
+	for i, r := range want {
+		if r.deleted != (i%3 == 0) || r.null[0] != (i%2 == 0) || !r.null[4] {
+			t.Fatalf("record %d: %+v", i, r)
+		}
+	}
+	if err := shp.LoadBitmaps(10, 80); err != nil {
+		t.Fatal(err)
+	}
+	for i, r := range read() {
+		if r != want[i] {
+			t.Errorf("record %d: %+v from the bitmaps, %+v from the record", i, r, want[i])
+		}
+	}
+}
+
+func TestRecodeToUTF8(t *testing.T) {
+	base := filepath.Join(t.TempDir(), "points")
+	writePointShapefile(t, base, 3)
+	w, err := CreateTable(base+".dbf", []Field{{Name: "NAME", Type: String, Width: 6}})
+	if err != nil {
+		t.Fatal(err)
+	}
+	// café and Straße in CP1252, 中文 in GBK
+	for _, name := range []string{"caf\xe9", "Stra\xdfe", "\xd6\xd0\xce\xc4"} {
+		if err := w.Append(name); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if err := w.Close(); err != nil {
+		t.Fatal(err)
+	}
+	if err := os.WriteFile(base+".cpg", []byte("1252\n"), 0644); err != nil {
+		t.Fatal(err)
+	}
+
+	shp := Open(base + ".shp")
+	defer shp.Close()
+	if err := shp.RecodeToUTF8("EBCDIC"); err == nil {
+		t.Error("RecodeToUTF8 accepted an unsupported code page")
+	}
+	if err := shp.RecodeToUTF8(""); err != nil {
+		t.Fatal(err)
+	}
+	want := []string{"café", "Straße", "ÖÐÎÄ"}
+	values, _ := shp.StringColumn("NAME", 0, 3)
+	c := shp.NewCursor()
+	defer c.Close()
+	for i := range want {
+		if shp.Shape(i).Attrs["NAME"] != want[i] || values[i] != want[i] || c.Attrs(i)["NAME"] != want[i] {
+			t.Errorf("record %d: %q, %q, %q", i, shp.Shape(i).Attrs["NAME"], values[i], c.Attrs(i)["NAME"])
+		}
+	}
+
+	if err := shp.RecodeToUTF8("cp936"); err != nil {
+		t.Fatal(err)
+	}
+	if name := shp.Shape(2).Attrs["NAME"]; name != "中文" {
+		t.Errorf("GBK record: %q", name)
+	}
+}
+
+func TestStringView(t *testing.T) {
+	base := filepath.Join(t.TempDir(), "points")
+	writePointShapefile(t, base, 3)
+	w, err := CreateTable(base+".dbf", []Field{{Name: "NAME", Type: String, Width: 40}})
+	if err != nil {
+		t.Fatal(err)
+	}
+	for _, name := range []string{"   two  words   ", strings.Repeat(" ", 40), "cut\x00off"} {
+		if err := w.Append(name); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if err := w.Close(); err != nil {
+		t.Fatal(err)
+	}
+
+	shp := Open(base + ".shp")
+	defer shp.Close()
+	c := shp.NewCursor()
+	defer c.Close()
+	for i, want := range []string{"two  words", "", "cut"} {
+		if got := shp.Shape(i).Attrs["NAME"]; got != want {
+			t.Errorf("Shape(%d) NAME = %q, want %q", i, got, want)
+		}
+		if got := c.Attrs(i)["NAME"]; got != want {
+			t.Errorf("cursor record %d NAME = %q, want %q", i, got, want)
+		}
+	}
+}
+
+func TestDateLogicalColumns(t *testing.T) {
+	dates := []string{"19700101", "20000229", "19000229", "        ", "20241231", "19691231", "2024011 ", "00000000", "16000301"}
+	logicals := []string{"T", "f", "?", " ", "Y", "n", "x", "F", "t"}
+
+	base := filepath.Join(t.TempDir(), "points")
+	writePointShapefile(t, base, len(dates))
+	dbf := []byte{3, 124, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0}
+	binary.LittleEndian.PutUint32(dbf[4:], uint32(len(dates)))
+	binary.LittleEndian.PutUint16(dbf[8:], 32+2*32+1)
+	binary.LittleEndian.PutUint16(dbf[10:], 1+8+1)
+	dbf = append(dbf, make([]byte, 20)...)
+	for _, f := range []struct {
+		name  string
+		typ   byte
+		width byte
+	}{{"DAY", 'D', 8}, {"OK", 'L', 1}} {
+		field := make([]byte, 32)
+		copy(field, f.name)
+		field[11], field[16] = f.typ, f.width
+		dbf = append(dbf, field...)
+	}
+	dbf = append(dbf, 0x0d)
+	for i := range dates {
+		dbf = append(dbf, " "+dates[i]+logicals[i]...)
+	}
+	dbf = append(dbf, 0x1a)
+	if err := os.WriteFile(base+".dbf", dbf, 0644); err != nil {
+		t.Fatal(err)
+	}
+
+	shp := Open(base + ".shp")
+	defer shp.Close()
+	days, null := shp.DateColumn("DAY", 0, len(dates))
+	if len(days) != len(dates) {
+		t.Fatalf("%d dates", len(days))
+	}
+	for i, date := range dates {
+		want, err := time.Parse("20060102", date)
+		valid := err == nil && date != "00000000"
+		if null[i] != !valid || (valid && time.Unix(int64(days[i])*86400, 0).UTC() != want) {
+			t.Errorf("date %q: %d, null %v", date, days[i], null[i])
+		}
+	}
+
+	values, null := shp.LogicalColumn("OK", 0, len(logicals))
+	for i, want := range []int{1, 0, -1, -1, 1, 0, -1, 0, 1} {
+		if null[i] != (want < 0) || values[i] != (want == 1) {
+			t.Errorf("logical %q: %v, null %v", logicals[i], values[i], null[i])
+		}
+	}
+}
+
+func TestDictionaryColumn(t *testing.T) {
+	base := filepath.Join(t.TempDir(), "points")
+	writePointShapefile(t, base, 5000)
+	w, err := CreateTable(base+".dbf", []Field{{Name: "CLASS", Type: String, Width: 12}})
+	if err != nil {
+		t.Fatal(err)
+	}
+	for i := 0; i < 5000; i++ {
+		var class interface{}
+		if i%10 != 0 {
+			class = fmt.Sprint("class ", i*i%301)
+		}
+		if err := w.Append(class); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if err := w.Close(); err != nil {
+		t.Fatal(err)
+	}
+
+	shp := Open(base + ".shp")
+	defer shp.Close()
+	strs, _ := shp.StringColumn("CLASS", 100, 10000)
+	values, codes := shp.DictionaryColumn("CLASS", 100, 10000)
+	if len(codes) != 4900 || len(strs) != 4900 {
+		t.Fatalf("%d codes, %d strings", len(codes), len(strs))
+	}
+	seen := map[string]bool{}
+	for _, v := range values {
+		if seen[v] {
+			t.Errorf("value %q twice", v)
+		}
+		seen[v] = true
+	}
+	for i, code := range codes {
+		if (code < 0) != (strs[i] == "") || (code >= 0 && values[code] != strs[i]) {
+			t.Fatalf("record %d: code %d, want %q", 100+i, code, strs[i])
+		}
+	}
+}
+
+func TestParallelScan(t *testing.T) {
+	dir := t.TempDir()
+	src := filepath.Join(dir, "src", "points")
+	os.Mkdir(filepath.Dir(src), 0755)
+	writePointShapefile(t, src, 500)
+	writeDBF(t, src, 500)
+	compressShapefile(t, src, dir, "points")
+
+	for _, shp := range []*ShapeFile{Open(src + ".shp"), OpenMapped(src + ".shp"), Open(filepath.Join(dir, "points.shp"))} {
+		wantIDs, _ := shp.FloatColumn("ID", 0, 500)
+		wantNames, _ := shp.StringColumn("NAME", 0, 500)
+
+		// columns and a sum gathered by range, merged in range order
+		const rangeRecords = 64
+		ids := make([][]float64, (500+rangeRecords-1)/rangeRecords)
+		names := make([][]string, len(ids))
+		sums := make([]int, len(ids))
+		err := shp.Scan(4, rangeRecords, func(c *Cursor, start, count int) error {
+			ids[start/rangeRecords], _ = c.FloatColumn("ID", start, count)
+			names[start/rangeRecords], _ = c.StringColumn("NAME", start, count)
+			codes, _ := c.IntColumn("CODE", start, count)
+			for _, code := range codes {
+				sums[start/rangeRecords] += code
+			}
+			return nil
+		})
+		if err != nil {
+			t.Fatal(err)
+		}
+		var gotIDs []float64
+		var gotNames []string
+		sum, wantSum := 0, 0
+		for r := range ids {
+			gotIDs = append(gotIDs, ids[r]...)
+			gotNames = append(gotNames, names[r]...)
+			sum += sums[r]
+		}
+		for i := 0; i < 500; i++ {
+			wantSum += i % 7
+		}
+		if len(gotIDs) != 500 || len(gotNames) != 500 || sum != wantSum {
+			t.Fatalf("Scan read %d IDs, %d names, sum %d", len(gotIDs), len(gotNames), sum)
+		}
+		for i := range wantIDs {
+			if gotIDs[i] != wantIDs[i] || gotNames[i] != wantNames[i] {
+				t.Errorf("record %d = %v %q, want %v %q", i, gotIDs[i], gotNames[i], wantIDs[i], wantNames[i])
+			}
+		}
+
+		predicate := Or(Compare("CODE", OpEqual, 3), Compare("ID", OpGreaterEqual, 480))
+		want, _ := shp.Select(predicate, 0, 500)
+		got, err := shp.ParallelSelect(predicate, 4)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if len(got) != len(want) {
+			t.Fatalf("ParallelSelect = %d records, want %d", len(got), len(want))
+		}
+		for i := range want {
+			if got[i] != want[i] {
+				t.Errorf("ParallelSelect[%d] = %d, want %d", i, got[i], want[i])
+			}
+		}
+
+		// the first failing range, in record order, wins
+		err = shp.Scan(4, rangeRecords, func(c *Cursor, start, count int) error {
+			if start >= 128 {
+				return fmt.Errorf("range %d", start)
+			}
+			return nil
+		})
+		if err == nil || err.Error() != "range 128" {
+			t.Errorf("Scan error = %v", err)
+		}
+		shp.Close()
+	}
+}
+
+func TestGroupBy(t *testing.T) {
+	base := filepath.Join(t.TempDir(), "points")
+	const n = 3000
+	writePointShapefile(t, base, n)
+	w, err := CreateTable(base+".dbf", []Field{
+		{Name: "DISTRICT", Type: String, Width: 12},
+		{Name: "CODE", Type: Integer, Width: 5},
+		{Name: "POP", Type: Integer, Width: 8},
+		{Name: "AREA", Type: Double, Width: 12, Decimals: 2},
+	})
+	if err != nil {
+		t.Fatal(err)
+	}
+	district := func(i int) interface{} {
+		if i%11 == 0 {
+			return nil
+		}
+		return fmt.Sprint("district ", i/200) // runs of equal keys
+	}
+	for i := 0; i < n; i++ {
+		var area interface{} = float64(i%37) + 0.25
+		if i%5 == 0 {
+			area = nil
+		}
+		if err := w.Append(district(i), i%7, i, area); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if err := w.Close(); err != nil {
+		t.Fatal(err)
+	}
+
+	// reference statistics of the records of indexes, keyed by key(i)
+	reference := func(indexes []int, key func(int) interface{}) map[interface{}][2]Stats {
+		want := make(map[interface{}][2]Stats)
+		for _, i := range indexes {
+			s := want[key(i)]
+			values := []float64{float64(i), float64(i%37) + 0.25}
+			for j, v := range values {
+				if j == 1 && i%5 == 0 {
+					continue
+				}
+				if s[j].Count == 0 || v < s[j].Min {
+					s[j].Min = v
+				}
+				if s[j].Count == 0 || v > s[j].Max {
+					s[j].Max = v
+				}
+				s[j].Count++
+				s[j].Sum += v
+			}
+			want[key(i)] = s
+		}
+		return want
+	}
+	check := func(name string, groups []Group, err error, indexes []int, key func(int) interface{}) {
+		if err != nil {
+			t.Fatalf("%s: %v", name, err)
+		}
+		want := reference(indexes, key)
+		if len(groups) != len(want) {
+			t.Fatalf("%s: %d groups, want %d", name, len(groups), len(want))
+		}
+		records := 0
+		for _, g := range groups {
+			records += g.Records
+			s, ok := want[g.Key]
+			if !ok || g.Stats[0] != s[0] || math.Abs(g.Stats[1].Sum-s[1].Sum) > 1e-6 ||
+				g.Stats[1].Count != s[1].Count || g.Stats[1].Min != s[1].Min || g.Stats[1].Max != s[1].Max {
+				t.Errorf("%s: group %v = %+v, want %+v", name, g.Key, g.Stats, s)
+			}
+		}
+		if records != len(indexes) {
+			t.Errorf("%s: %d records, want %d", name, records, len(indexes))
+		}
+	}
+
+	all := make([]int, n)
+	for i := range all {
+		all[i] = i
+	}
+	for _, shp := range []*ShapeFile{Open(base + ".shp"), OpenMapped(base + ".shp")} {
+		fields := []string{"POP", "AREA"}
+		groups, err := shp.GroupBy("DISTRICT", fields, 0, n)
+		check("DISTRICT", groups, err, all, district)
+		if groups[0].Key != nil || groups[1].Key != "district 0" {
+			t.Errorf("groups out of order: %v, %v", groups[0].Key, groups[1].Key)
+		}
+
+		groups, err = shp.GroupBy("CODE", fields, 100, 500)
+		check("CODE", groups, err, all[100:600], func(i int) interface{} { return i % 7 })
+
+		groups, err = shp.GroupBy("", fields, 0, n)
+		check("all", groups, err, all, func(int) interface{} { return nil })
+		if mean := groups[0].Stats[0].Mean(); mean != float64(n-1)/2 {
+			t.Errorf("mean %v", mean)
+		}
+
+		selected, _ := shp.Select(Compare("CODE", OpEqual, 3), 0, n)
+		groups, err = shp.GroupBySelection("DISTRICT", fields, selected)
+		check("selection", groups, err, selected, district)
+
+		if _, err := shp.GroupBy("AREA", fields, 0, n); err == nil {
+			t.Error("GroupBy accepted a field with decimals")
+		}
+		if _, err := shp.GroupBy("CODE", []string{"DISTRICT"}, 0, n); err == nil {
+			t.Error("GroupBy aggregated a string field")
+		}
+		if _, err := shp.GroupBySelection("CODE", fields, []int{5, 3}); err == nil {
+			t.Error("GroupBySelection accepted a decreasing selection")
+		}
+		shp.Close()
+	}
+}
+
+func TestGroupByWideKey(t *testing.T) {
+	base := filepath.Join(t.TempDir(), "points")
+	const n, keys = 1000, 100
+	writePointShapefile(t, base, n)
+	w, err := CreateTable(base+".dbf", []Field{{Name: "ID", Type: Integer, Width: 12}})
+	if err != nil {
+		t.Fatal(err)
+	}
+	for i := 0; i < n; i++ {
+		if err := w.Append(int64(10000000000) + int64(i%keys)); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if err := w.Close(); err != nil {
+		t.Fatal(err)
+	}
+
+	// counts only, over more groups than are first allocated
+	shp := Open(base + ".shp")
+	defer shp.Close()
+	groups, err := shp.GroupBy("ID", nil, 0, n)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(groups) != keys {
+		t.Fatalf("%d groups, want %d", len(groups), keys)
+	}
+	for i, g := range groups {
+		if g.Key != 10000000000+i || g.Records != n/keys || len(g.Stats) != 0 {
+			t.Errorf("group %d = %v with %d records", i, g.Key, g.Records)
+		}
+	}
+}
@@ -1,9 +1,11 @@
 package shp
 
 /*
-#cgo linux LDFLAGS: -L ./  -Wl,--start-group  -lm -Wl,--end-group
-#cgo darwin LDFLAGS: -L /  -lm
-#cgo darwin,arm LDFLAGS: -L / -lm
+#cgo linux CFLAGS: -DSHP_HAVE_ZLIB
+#cgo darwin CFLAGS: -DSHP_HAVE_ZLIB
+#cgo linux LDFLAGS: -L ./  -Wl,--start-group  -lm -lz -lpthread -Wl,--end-group
+#cgo darwin LDFLAGS: -L /  -lm -lz
+#cgo darwin,arm LDFLAGS: -L / -lm -lz
 #cgo windows LDFLAGS: -L ./  -lm -fPIC
 #include <shapefil.h>
 #include <string.h>
@@ -47,6 +49,36 @@ func goSHPOpen(filename, mode string) SHPHandle {
 	return SHPHandle(C.goSHPOpen(filename_, mode_))
 }
 
+// ioHooks selects the file io hooks used to open a shapefile.
+type ioHooks int
+
+const (
+	zipHooks    ioHooks = iota // regular, zip member and gzip files
+	directHooks                // page cache bypass for bulk scans
+)
+
+func goSASetupHooks(kind ioHooks) (hooks C.SAHooks) {
+	switch kind {
+	case directHooks:
+		C.goSASetupDirectHooks(&hooks)
+	default:
+		C.goSASetupZipHooks(&hooks)
+	}
+	return
+}
+
+func goSHPOpenLL(filename, mode string, kind ioHooks) SHPHandle {
+	filename_, mode_ := C.CString(filename), C.CString(mode)
+	defer C.free(unsafe.Pointer(filename_))
+	defer C.free(unsafe.Pointer(mode_))
+	hooks := goSASetupHooks(kind)
+	return SHPHandle(C.goSHPOpenLL(filename_, mode_, &hooks))
+}
+
+func goSHPSetAccessPattern(h SHPHandle, pattern int) {
+	C.goSHPSetAccessPattern(h, C.int(pattern))
+}
+
 func goSHPClose(h SHPHandle) {
 	C.goSHPClose(h)
 }
@@ -70,6 +102,28 @@ func goSHPDestroyObject(o *SHPObject) {
 	C.goSHPDestroyObject((*C.SHPObject)(unsafe.Pointer(o)))
 }
 
+func goSHPReadObjects(hSHP SHPHandle, shapeIds []int) []*SHPObject {
+	if len(shapeIds) == 0 {
+		return nil
+	}
+	ids := make([]C.int, len(shapeIds))
+	for i, id := range shapeIds {
+		ids[i] = C.int(id)
+	}
+	objects := C.goSHPReadObjects(hSHP, &ids[0], C.int(len(ids)))
+	if objects == nil {
+		return nil
+	}
+	return (*[1 << 28]*SHPObject)(unsafe.Pointer(objects))[:len(ids):len(ids)]
+}
+
+func goSHPDestroyObjects(objects []*SHPObject) {
+	if len(objects) == 0 {
+		return
+	}
+	C.goSHPDestroyObjects((**C.SHPObject)(unsafe.Pointer(&objects[0])), C.int(len(objects)))
+}
+
 func goDBFOpen(filename, mode string) DBFHandle {
 	filename_, mode_ := C.CString(filename), C.CString(mode)
 	defer C.free(unsafe.Pointer(filename_))
@@ -77,6 +131,38 @@ func goDBFOpen(filename, mode string) DBFHandle {
 	return DBFHandle(C.goDBFOpen(filename_, mode_))
 }
 
+func goDBFOpenLL(filename, mode string, kind ioHooks) DBFHandle {
+	filename_, mode_ := C.CString(filename), C.CString(mode)
+	defer C.free(unsafe.Pointer(filename_))
+	defer C.free(unsafe.Pointer(mode_))
+	hooks := goSASetupHooks(kind)
+	return DBFHandle(C.goDBFOpenLL(filename_, mode_, &hooks))
+}
+
+func goDBFSetAccessPattern(h DBFHandle, pattern int) {
+	C.goDBFSetAccessPattern(h, C.int(pattern))
+}
+
+func goDBFSetReadAhead(h DBFHandle, nBytes int, reverse bool) {
+	bReverse := C.int(0)
+	if reverse {
+		bReverse = 1
+	}
+	C.goDBFSetReadAhead(h, C.int(nBytes), bReverse)
+}
+
+func goDBFSetProjection(h DBFHandle, fields []int) {
+	if len(fields) == 0 {
+		C.goDBFSetProjection(h, nil, 0)
+		return
+	}
+	fields_ := make([]C.int, len(fields))
+	for i, j := range fields {
+		fields_[i] = C.int(j)
+	}
+	C.goDBFSetProjection(h, &fields_[0], C.int(len(fields_)))
+}
+
 func goDBFClose(h DBFHandle) {
 	C.goDBFClose(h)
 }
@@ -105,6 +191,28 @@ func goDBFGetFieldInfo(h DBFHandle, fieldIndex int) (fieldName string, fieldType
 	return
 }
 
+func goDBFGetCodePage(h DBFHandle) string {
+	return C.GoString(C.goDBFGetCodePage(h))
+}
+
+func goDBFSetRecodeToUTF8(h DBFHandle, codePage string) bool {
+	codePage_ := C.CString(codePage)
+	defer C.free(unsafe.Pointer(codePage_))
+	return C.goDBFSetRecodeToUTF8(h, codePage_) != 0
+}
+
+func goDBFIsRecordDeleted(h DBFHandle, shapeIndex int) bool {
+	return C.goDBFIsRecordDeleted(h, C.int(shapeIndex)) != 0
+}
+
+func goDBFIsAttributeNULL(h DBFHandle, shapeIndex, fieldIndex int) bool {
+	return C.goDBFIsAttributeNULL(h, C.int(shapeIndex), C.int(fieldIndex)) != 0
+}
+
+func goDBFLoadBitmaps(h DBFHandle, start, count int) int {
+	return int(C.goDBFLoadBitmaps(h, C.int(start), C.int(count)))
+}
+
 func goDBFReadIntegerAttribute(h DBFHandle, shapeIndex, fieldIndex int) int {
 	return int(C.goDBFReadIntegerAttribute(h, C.int(shapeIndex), C.int(fieldIndex)))
 }
@@ -113,12 +221,485 @@ func goDBFReadDoubleAttribute(h DBFHandle, shapeIndex, fieldIndex int) float64 {
 	return float64(C.goDBFReadDoubleAttribute(h, C.int(shapeIndex), C.int(fieldIndex)))
 }
 
-func goDBFReadStringAttribute(h DBFHandle, shapeIndex, fieldIndex int) []byte {
-	cstr := C.goDBFReadStringAttribute(h, C.int(shapeIndex), C.int(fieldIndex))
-	slen := int(C.strlen(cstr))
-	bytes := make([]byte, slen)
-	if slen > 0 {
-		C.memcpy(unsafe.Pointer(&bytes[0]), unsafe.Pointer(cstr), C.size_t(slen))
+// columnNulls expands the null bitmap filled by the column readers.
+func columnNulls(bitmap []byte, n int) []bool {
+	nulls := make([]bool, n)
+	for i := range nulls {
+		nulls[i] = bitmap[i>>3]&(1<<uint(i&7)) != 0
+	}
+	return nulls
+}
+
+// columnStrings splits the n zero terminated values of stride bytes of buf.
+func columnStrings(buf []byte, stride, n int) []string {
+	values := make([]string, n)
+	for i := range values {
+		value := buf[i*stride : (i+1)*stride]
+		for j, c := range value {
+			if c == 0 {
+				value = value[:j]
+				break
+			}
+		}
+		values[i] = string(value)
+	}
+	return values
+}
+
+func goDBFReadIntegerColumn(h DBFHandle, fieldIndex, start, count int) ([]int, []bool) {
+	if count <= 0 {
+		return nil, nil
+	}
+	values_ := make([]C.int, count)
+	bitmap := make([]byte, (count+7)/8)
+	n := int(C.goDBFReadIntegerColumn(h, C.int(fieldIndex), C.int(start), C.int(count),
+		&values_[0], (*C.uchar)(unsafe.Pointer(&bitmap[0]))))
+	if n < 0 {
+		return nil, nil
+	}
+	values := make([]int, n)
+	for i := range values {
+		values[i] = int(values_[i])
+	}
+	return values, columnNulls(bitmap, n)
+}
+
+func goDBFReadDoubleColumn(h DBFHandle, fieldIndex, start, count int) ([]float64, []bool) {
+	if count <= 0 {
+		return nil, nil
 	}
-	return bytes
+	values := make([]float64, count)
+	bitmap := make([]byte, (count+7)/8)
+	n := int(C.goDBFReadDoubleColumn(h, C.int(fieldIndex), C.int(start), C.int(count),
+		(*C.double)(unsafe.Pointer(&values[0])), (*C.uchar)(unsafe.Pointer(&bitmap[0]))))
+	if n < 0 {
+		return nil, nil
+	}
+	return values[:n], columnNulls(bitmap, n)
+}
+
+func goDBFReadDateColumn(h DBFHandle, fieldIndex, start, count int) ([]int32, []bool) {
+	if count <= 0 {
+		return nil, nil
+	}
+	days := make([]int32, count)
+	bitmap := make([]byte, (count+7)/8)
+	n := int(C.goDBFReadDateColumn(h, C.int(fieldIndex), C.int(start), C.int(count),
+		(*C.int)(unsafe.Pointer(&days[0])), (*C.uchar)(unsafe.Pointer(&bitmap[0]))))
+	if n < 0 {
+		return nil, nil
+	}
+	return days[:n], columnNulls(bitmap, n)
+}
+
+func goDBFReadLogicalColumn(h DBFHandle, fieldIndex, start, count int) ([]bool, []bool) {
+	if count <= 0 {
+		return nil, nil
+	}
+	values_ := make([]C.schar, count)
+	bitmap := make([]byte, (count+7)/8)
+	n := int(C.goDBFReadLogicalColumn(h, C.int(fieldIndex), C.int(start), C.int(count),
+		&values_[0], (*C.uchar)(unsafe.Pointer(&bitmap[0]))))
+	if n < 0 {
+		return nil, nil
+	}
+	values := make([]bool, n)
+	for i := range values {
+		values[i] = values_[i] == 1
+	}
+	return values, columnNulls(bitmap, n)
+}
+
+func goDBFReadDictionaryColumn(h DBFHandle, fieldIndex, start, count int) ([]string, []int32) {
+	if n := goDBFGetRecordCount(h) - start; count > n {
+		count = n
+	}
+	if start < 0 || count <= 0 {
+		return nil, nil
+	}
+	codes := make([]int32, count)
+	dict := C.goDBFReadDictionaryColumn(h, C.int(fieldIndex), C.int(start), C.int(count),
+		(*C.int)(unsafe.Pointer(&codes[0])))
+	if dict == nil {
+		return nil, nil
+	}
+	defer C.goDBFDestroyDictionary(dict)
+	values := make([]string, int(C.goDBFGetDictionarySize(dict)))
+	for i := range values {
+		var n C.int
+		value := C.goDBFGetDictionaryValue(dict, C.int(i), &n)
+		values[i] = C.GoStringN(value, n)
+	}
+	return values, codes
+}
+
+func goDBFReadStringColumn(h DBFHandle, fieldIndex, start, count, width int) ([]string, []bool) {
+	if count <= 0 {
+		return nil, nil
+	}
+	stride := width + 1
+	buf := make([]byte, count*stride)
+	bitmap := make([]byte, (count+7)/8)
+	n := int(C.goDBFReadStringColumn(h, C.int(fieldIndex), C.int(start), C.int(count),
+		(*C.char)(unsafe.Pointer(&buf[0])), C.int(stride), (*C.uchar)(unsafe.Pointer(&bitmap[0]))))
+	if n < 0 {
+		return nil, nil
+	}
+	return columnStrings(buf, stride, n), columnNulls(bitmap, n)
+}
+
+type DBFAggregateHandle C.DBFAggregateHandle
+
+func goDBFCreateAggregate(h DBFHandle, groupIndex int, fieldIndexes []int) DBFAggregateHandle {
+	fields := make([]C.int, len(fieldIndexes)+1)
+	for i, j := range fieldIndexes {
+		fields[i] = C.int(j)
+	}
+	return DBFAggregateHandle(C.goDBFCreateAggregate(h, C.int(groupIndex), &fields[0], C.int(len(fieldIndexes))))
+}
+
+func goDBFAggregateRange(agg DBFAggregateHandle, start, count int) bool {
+	return C.goDBFAggregateRange(agg, C.int(start), C.int(count)) != 0
+}
+
+func goDBFAggregateSelection(agg DBFAggregateHandle, selected []int) bool {
+	if len(selected) == 0 {
+		return true
+	}
+	selected_ := make([]C.int, len(selected))
+	for i, s := range selected {
+		selected_[i] = C.int(s)
+	}
+	return C.goDBFAggregateSelection(agg, &selected_[0], C.int(len(selected))) != 0
+}
+
+func goDBFAggregateGetGroupCount(agg DBFAggregateHandle) int {
+	return int(C.goDBFAggregateGetGroupCount(agg))
+}
+
+func goDBFAggregateGetKey(agg DBFAggregateHandle, group int) string {
+	var key [3*C.XBASE_FLD_MAX_WIDTH + 1]C.char
+	n := C.goDBFAggregateGetKey(agg, C.int(group), &key[0], C.int(len(key)))
+	if n <= 0 {
+		return ""
+	}
+	return C.GoStringN(&key[0], n)
+}
+
+func goDBFAggregateGetRecordCount(agg DBFAggregateHandle, group int) int {
+	return int(C.goDBFAggregateGetRecordCount(agg, C.int(group)))
+}
+
+func goDBFAggregateGetStats(agg DBFAggregateHandle, group, field int) (count int, sum, min, max float64) {
+	var sum_, min_, max_ C.double
+	count = int(C.goDBFAggregateGetStats(agg, C.int(group), C.int(field), &sum_, &min_, &max_))
+	return count, float64(sum_), float64(min_), float64(max_)
+}
+
+func goDBFDestroyAggregate(agg DBFAggregateHandle) {
+	C.goDBFDestroyAggregate(agg)
+}
+
+type DBFFilterHandle C.DBFFilterHandle
+
+func goDBFFilterCompareDouble(h DBFHandle, fieldIndex, op int, value float64) DBFFilterHandle {
+	return DBFFilterHandle(C.goDBFFilterCompareDouble(h, C.int(fieldIndex), C.DBFCompareOp(op), C.double(value)))
+}
+
+func goDBFFilterCompareString(h DBFHandle, fieldIndex, op int, value string) DBFFilterHandle {
+	value_ := C.CString(value)
+	defer C.free(unsafe.Pointer(value_))
+	return DBFFilterHandle(C.goDBFFilterCompareString(h, C.int(fieldIndex), C.DBFCompareOp(op), value_))
+}
+
+func goDBFFilterCompareLogical(h DBFHandle, fieldIndex int, value bool) DBFFilterHandle {
+	bValue := C.int(0)
+	if value {
+		bValue = 1
+	}
+	return DBFFilterHandle(C.goDBFFilterCompareLogical(h, C.int(fieldIndex), bValue))
+}
+
+func goDBFFilterIsNull(h DBFHandle, fieldIndex int) DBFFilterHandle {
+	return DBFFilterHandle(C.goDBFFilterIsNull(h, C.int(fieldIndex)))
+}
+
+func goDBFFilterAnd(left, right DBFFilterHandle) DBFFilterHandle {
+	return DBFFilterHandle(C.goDBFFilterAnd(left, right))
+}
+
+func goDBFFilterOr(left, right DBFFilterHandle) DBFFilterHandle {
+	return DBFFilterHandle(C.goDBFFilterOr(left, right))
+}
+
+func goDBFFilterNot(operand DBFFilterHandle) DBFFilterHandle {
+	return DBFFilterHandle(C.goDBFFilterNot(operand))
+}
+
+func goDBFFilterDestroy(filter DBFFilterHandle) {
+	C.goDBFFilterDestroy(filter)
+}
+
+func goDBFFilterSelect(h DBFHandle, filter DBFFilterHandle, zoneMap DBFZoneMapHandle, start, count int) ([]int, bool) {
+	if count <= 0 {
+		return nil, true
+	}
+	selected_ := make([]C.int, count)
+	n := int(C.goDBFFilterSelectEx(h, filter, zoneMap, C.int(start), C.int(count), &selected_[0]))
+	if n < 0 {
+		return nil, false
+	}
+	selected := make([]int, n)
+	for i := range selected {
+		selected[i] = int(selected_[i])
+	}
+	return selected, true
+}
+
+type DBFIndexHandle C.DBFIndexHandle
+
+func goDBFCreateIndex(h DBFHandle, fieldIndex int, filename string, kind int) bool {
+	filename_ := C.CString(filename)
+	defer C.free(unsafe.Pointer(filename_))
+	return C.goDBFCreateIndex(h, C.int(fieldIndex), filename_, C.DBFIndexKind(kind)) != 0
+}
+
+func goDBFOpenIndex(h DBFHandle, filename string) DBFIndexHandle {
+	filename_ := C.CString(filename)
+	defer C.free(unsafe.Pointer(filename_))
+	return DBFIndexHandle(C.goDBFOpenIndex(h, filename_))
+}
+
+func goDBFCloseIndex(index DBFIndexHandle) {
+	C.goDBFCloseIndex(index)
+}
+
+// indexResult copies and frees the ids returned by an index search.
+func indexResult(ids *C.int, count C.int) []int {
+	if ids == nil {
+		return nil
+	}
+	defer C.free(unsafe.Pointer(ids))
+	result := make([]int, int(count))
+	for i := range result {
+		result[i] = GetInt(ids, i)
+	}
+	return result
+}
+
+func goDBFIndexSearchRange(index DBFIndexHandle, min, max float64) []int {
+	var count C.int
+	return indexResult(C.goDBFIndexSearchRange(index, C.double(min), C.double(max), &count), count)
+}
+
+func goDBFIndexSearchString(index DBFIndexHandle, key string) []int {
+	key_ := C.CString(key)
+	defer C.free(unsafe.Pointer(key_))
+	var count C.int
+	return indexResult(C.goDBFIndexSearchString(index, key_, &count), count)
+}
+
+type DBFZoneMapHandle C.DBFZoneMapHandle
+
+func goDBFCreateZoneMap(h DBFHandle, filename string, blockRecords int) bool {
+	filename_ := C.CString(filename)
+	defer C.free(unsafe.Pointer(filename_))
+	return C.goDBFCreateZoneMap(h, filename_, C.int(blockRecords)) != 0
+}
+
+func goDBFOpenZoneMap(h DBFHandle, filename string) DBFZoneMapHandle {
+	filename_ := C.CString(filename)
+	defer C.free(unsafe.Pointer(filename_))
+	return DBFZoneMapHandle(C.goDBFOpenZoneMap(h, filename_))
+}
+
+func goDBFCloseZoneMap(zoneMap DBFZoneMapHandle) {
+	C.goDBFCloseZoneMap(zoneMap)
+}
+
+type DBFCursorHandle C.DBFCursorHandle
+
+func goDBFCreateCursor(h DBFHandle) DBFCursorHandle {
+	return DBFCursorHandle(C.goDBFCreateCursor(h))
+}
+
+func goDBFDestroyCursor(c DBFCursorHandle) {
+	C.goDBFDestroyCursor(c)
+}
+
+func goDBFCursorReadIntegerAttribute(c DBFCursorHandle, shapeIndex, fieldIndex int) int {
+	return int(C.goDBFCursorReadIntegerAttribute(c, C.int(shapeIndex), C.int(fieldIndex)))
+}
+
+func goDBFCursorReadDoubleAttribute(c DBFCursorHandle, shapeIndex, fieldIndex int) float64 {
+	return float64(C.goDBFCursorReadDoubleAttribute(c, C.int(shapeIndex), C.int(fieldIndex)))
+}
+
+func goDBFCursorReadStringView(c DBFCursorHandle, shapeIndex, fieldIndex int) string {
+	var n C.int
+	view := C.goDBFCursorReadStringView(c, C.int(shapeIndex), C.int(fieldIndex), &n)
+	if view == nil {
+		return ""
+	}
+	return C.GoStringN(view, n)
+}
+
+func goDBFCursorIsAttributeNULL(c DBFCursorHandle, shapeIndex, fieldIndex int) bool {
+	return C.goDBFCursorIsAttributeNULL(c, C.int(shapeIndex), C.int(fieldIndex)) != 0
+}
+
+func goDBFCursorReadIntegerColumn(c DBFCursorHandle, fieldIndex, start, count int) ([]int, []bool) {
+	if count <= 0 {
+		return nil, nil
+	}
+	values_ := make([]C.int, count)
+	bitmap := make([]byte, (count+7)/8)
+	n := int(C.goDBFCursorReadIntegerColumn(c, C.int(fieldIndex), C.int(start), C.int(count),
+		&values_[0], (*C.uchar)(unsafe.Pointer(&bitmap[0]))))
+	if n < 0 {
+		return nil, nil
+	}
+	values := make([]int, n)
+	for i := range values {
+		values[i] = int(values_[i])
+	}
+	return values, columnNulls(bitmap, n)
+}
+
+func goDBFCursorReadDoubleColumn(c DBFCursorHandle, fieldIndex, start, count int) ([]float64, []bool) {
+	if count <= 0 {
+		return nil, nil
+	}
+	values := make([]float64, count)
+	bitmap := make([]byte, (count+7)/8)
+	n := int(C.goDBFCursorReadDoubleColumn(c, C.int(fieldIndex), C.int(start), C.int(count),
+		(*C.double)(unsafe.Pointer(&values[0])), (*C.uchar)(unsafe.Pointer(&bitmap[0]))))
+	if n < 0 {
+		return nil, nil
+	}
+	return values[:n], columnNulls(bitmap, n)
+}
+
+func goDBFCursorReadStringColumn(c DBFCursorHandle, fieldIndex, start, count, width int) ([]string, []bool) {
+	if count <= 0 {
+		return nil, nil
+	}
+	stride := width + 1
+	buf := make([]byte, count*stride)
+	bitmap := make([]byte, (count+7)/8)
+	n := int(C.goDBFCursorReadStringColumn(c, C.int(fieldIndex), C.int(start), C.int(count),
+		(*C.char)(unsafe.Pointer(&buf[0])), C.int(stride), (*C.uchar)(unsafe.Pointer(&bitmap[0]))))
+	if n < 0 {
+		return nil, nil
+	}
+	return columnStrings(buf, stride, n), columnNulls(bitmap, n)
+}
+
+func goDBFCursorFilterSelect(c DBFCursorHandle, filter DBFFilterHandle, zoneMap DBFZoneMapHandle, start, count int) ([]int, bool) {
+	if count <= 0 {
+		return nil, true
+	}
+	selected_ := make([]C.int, count)
+	n := int(C.goDBFCursorFilterSelect(c, filter, zoneMap, C.int(start), C.int(count), &selected_[0]))
+	if n < 0 {
+		return nil, false
+	}
+	selected := make([]int, n)
+	for i := range selected {
+		selected[i] = int(selected_[i])
+	}
+	return selected, true
+}
+
+func goDBFReadStringView(h DBFHandle, shapeIndex, fieldIndex int) string {
+	var n C.int
+	view := C.goDBFReadStringView(h, C.int(shapeIndex), C.int(fieldIndex), &n)
+	if view == nil {
+		return ""
+	}
+	return C.GoStringN(view, n)
+}
+
+func goDBFCreate(filename string) DBFHandle {
+	filename_ := C.CString(filename)
+	defer C.free(unsafe.Pointer(filename_))
+	return DBFHandle(C.goDBFCreate(filename_))
+}
+
+func goDBFAddField(h DBFHandle, fieldName string, fieldType, nWidth, nDecimals int) int {
+	fieldName_ := C.CString(fieldName)
+	defer C.free(unsafe.Pointer(fieldName_))
+	return int(C.goDBFAddField(h, fieldName_, C.DBFFieldType(fieldType), C.int(nWidth), C.int(nDecimals)))
+}
+
+type DBFWriterHandle C.DBFWriterHandle
+
+func goDBFCreateWriter(h DBFHandle, nBytes int) DBFWriterHandle {
+	return DBFWriterHandle(C.goDBFCreateWriter(h, C.int(nBytes)))
+}
+
+func goDBFWriterSetDouble(w DBFWriterHandle, fieldIndex int, value float64) bool {
+	return C.goDBFWriterSetDouble(w, C.int(fieldIndex), C.double(value)) != 0
+}
+
+func goDBFWriterSetInteger(w DBFWriterHandle, fieldIndex int, value int) bool {
+	return C.goDBFWriterSetInteger(w, C.int(fieldIndex), C.int(value)) != 0
+}
+
+func goDBFWriterSetString(w DBFWriterHandle, fieldIndex int, value string) bool {
+	value_ := C.CString(value)
+	defer C.free(unsafe.Pointer(value_))
+	return C.goDBFWriterSetString(w, C.int(fieldIndex), value_) != 0
+}
+
+func goDBFWriterSetLogical(w DBFWriterHandle, fieldIndex int, value bool) bool {
+	lValue := C.char('F')
+	if value {
+		lValue = 'T'
+	}
+	return C.goDBFWriterSetLogical(w, C.int(fieldIndex), lValue) != 0
+}
+
+func goDBFWriterSetNULL(w DBFWriterHandle, fieldIndex int) bool {
+	return C.goDBFWriterSetNULL(w, C.int(fieldIndex)) != 0
+}
+
+func goDBFWriterEndRow(w DBFWriterHandle) bool {
+	return C.goDBFWriterEndRow(w) != 0
+}
+
+func goDBFCloseWriter(w DBFWriterHandle) bool {
+	return C.goDBFCloseWriter(w) != 0
+}
+
+type DBFSchemaEditHandle C.DBFSchemaEditHandle
+
+func goDBFCreateSchemaEdit(h DBFHandle) DBFSchemaEditHandle {
+	return DBFSchemaEditHandle(C.goDBFCreateSchemaEdit(h))
+}
+
+func goDBFDestroySchemaEdit(e DBFSchemaEditHandle) {
+	C.goDBFDestroySchemaEdit(e)
+}
+
+func goDBFSchemaAddField(e DBFSchemaEditHandle, fieldName string, nativeType byte, nWidth, nDecimals int) int {
+	fieldName_ := C.CString(fieldName)
+	defer C.free(unsafe.Pointer(fieldName_))
+	return int(C.goDBFSchemaAddField(e, fieldName_, C.char(nativeType), C.int(nWidth), C.int(nDecimals)))
+}
+
+func goDBFSchemaDeleteField(e DBFSchemaEditHandle, fieldIndex int) bool {
+	return C.goDBFSchemaDeleteField(e, C.int(fieldIndex)) != 0
+}
+
+func goDBFSchemaAlterField(e DBFSchemaEditHandle, fieldIndex int, fieldName string, nativeType byte, nWidth, nDecimals int) bool {
+	fieldName_ := C.CString(fieldName)
+	defer C.free(unsafe.Pointer(fieldName_))
+	return C.goDBFSchemaAlterField(e, C.int(fieldIndex), fieldName_, C.char(nativeType), C.int(nWidth), C.int(nDecimals)) != 0
+}
+
+func goDBFCommitSchemaEdit(e DBFSchemaEditHandle, filename string) bool {
+	filename_ := C.CString(filename)
+	defer C.free(unsafe.Pointer(filename_))
+	return C.goDBFCommitSchemaEdit(e, filename_) != 0
 }
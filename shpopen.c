@@ -287,6 +287,142 @@ static int SHPGetLenWithoutExtension(const char* pszBasename)
     return nLen;
 }
 
+/************************************************************************/
+/*                        SHPReadRecordHeader()                         */
+/*                                                                      */
+/*      Read the content length in bytes of the .shp record header      */
+/*      at nOffset.                                                     */
+/************************************************************************/
+
+static bool SHPReadRecordHeader( SHPHandle psSHP, SAOffset nOffset,
+                                 unsigned int *pnLength )
+{
+    uchar abyHeader[8];
+
+    if( psSHP->sHooks.FSeek( psSHP->fpSHP, nOffset, 0 ) != 0 ||
+        psSHP->sHooks.FRead( abyHeader, 8, 1, psSHP->fpSHP ) != 1 )
+        return false;
+
+    unsigned int nLength;
+    memcpy( &nLength, abyHeader + 4, 4 );
+    if( !bBigEndian ) SwapWord( 4, &nLength );
+    if( nLength > STATIC_CAST(unsigned int, INT_MAX / 2 - 4) )
+        return false;
+
+    *pnLength = nLength * 2;
+    return true;
+}
+
+/************************************************************************/
+/*                       SHPReadRecordOffsets64()                       */
+/*                                                                      */
+/*      Recover the true offsets of a .shp file beyond 4 GB.  The       */
+/*      .shx only holds 32 bit word offsets, which writers let wrap     */
+/*      around every 8 GB or clamp.  Records are normally written back  */
+/*      to back, so each offset is unwrapped to the candidate closest   */
+/*      to the end of the previous record.  If that does not match the  */
+/*      file, the record headers of the .shp are walked instead.        */
+/************************************************************************/
+
+#define SHP_OFFSET_WRAP (STATIC_CAST(SAOffset, 1) << 33)
+
+static bool SHPReadRecordOffsets64( SHPHandle psSHP, const uchar *pabyBuf )
+{
+    char szErrorMsg[200];
+
+    psSHP->panRecOffset64 = STATIC_CAST(SAOffset *,
+        malloc(sizeof(SAOffset) * MAX(1,psSHP->nMaxRecords) ));
+    if( psSHP->panRecOffset64 == SHPLIB_NULLPTR ||
+        psSHP->sHooks.FSeek( psSHP->fpSHP, 0, 2 ) != 0 )
+    {
+        psSHP->sHooks.Error( "Cannot index .shp file larger than 4 GB." );
+        return false;
+    }
+    const SAOffset nFileSize = psSHP->sHooks.FTell( psSHP->fpSHP );
+
+/* -------------------------------------------------------------------- */
+/*      Unwrap the .shx offsets.                                        */
+/* -------------------------------------------------------------------- */
+    SAOffset nExpected = 100;
+    bool bValid = true;
+    for( int i = 0; i < psSHP->nRecords; i++ )
+    {
+        unsigned int nOffset;
+        memcpy( &nOffset, pabyBuf + i * 8, 4 );
+        if( !bBigEndian ) SwapWord( 4, &nOffset );
+
+        unsigned int nLength;
+        memcpy( &nLength, pabyBuf + i * 8 + 4, 4 );
+        if( !bBigEndian ) SwapWord( 4, &nLength );
+
+        SAOffset nRecOffset = STATIC_CAST(SAOffset, nOffset) * 2;
+        if( nExpected > nRecOffset )
+            nRecOffset += (nExpected - nRecOffset + SHP_OFFSET_WRAP / 2)
+                          / SHP_OFFSET_WRAP * SHP_OFFSET_WRAP;
+
+        if( nLength > STATIC_CAST(unsigned int, INT_MAX / 2 - 4) ||
+            nRecOffset < 100 ||
+            nRecOffset + 8 + nLength * 2 > nFileSize )
+        {
+            bValid = false;
+            break;
+        }
+
+        psSHP->panRecOffset64[i] = nRecOffset;
+        psSHP->panRecOffset[i] = STATIC_CAST(unsigned int, nRecOffset);
+        psSHP->panRecSize[i] = nLength * 2;
+        nExpected = nRecOffset + 8 + nLength * 2;
+    }
+
+    /* Spot check the last record, a wrong unwrap shows there first */
+    unsigned int nLength;
+    if( bValid && psSHP->nRecords > 0 &&
+        (!SHPReadRecordHeader( psSHP,
+                psSHP->panRecOffset64[psSHP->nRecords - 1], &nLength ) ||
+         nLength != psSHP->panRecSize[psSHP->nRecords - 1]) )
+        bValid = false;
+
+    if( bValid )
+        return true;
+
+/* -------------------------------------------------------------------- */
+/*      Otherwise walk the record headers from the start of the file.   */
+/* -------------------------------------------------------------------- */
+    SAOffset nRecOffset = 100;
+    for( int i = 0; i < psSHP->nRecords; i++ )
+    {
+        if( nRecOffset + 8 > nFileSize ||
+            !SHPReadRecordHeader( psSHP, nRecOffset, &nLength ) ||
+            nRecOffset + 8 + nLength > nFileSize )
+        {
+            snprintf( szErrorMsg, sizeof(szErrorMsg),
+                      "Cannot locate record %d of .shp file larger than 4 GB.",
+                      i );
+            szErrorMsg[sizeof(szErrorMsg)-1] = '\0';
+            psSHP->sHooks.Error( szErrorMsg );
+            return false;
+        }
+
+        psSHP->panRecOffset64[i] = nRecOffset;
+        psSHP->panRecOffset[i] = STATIC_CAST(unsigned int, nRecOffset);
+        psSHP->panRecSize[i] = nLength;
+        nRecOffset += 8 + nLength;
+    }
+
+    return true;
+}
+
+/************************************************************************/
+/*                          SHPRecordOffset()                           */
+/************************************************************************/
+
+static SAOffset SHPRecordOffset( SHPHandle psSHP, int hEntity )
+{
+    if( psSHP->panRecOffset64 != SHPLIB_NULLPTR )
+        return psSHP->panRecOffset64[hEntity];
+    return psSHP->panRecOffset[hEntity];
+}
+
 /************************************************************************/
 /*                              goSHPOpen()                               */
 /*                                                                      */
@@ -302,11 +438,17 @@ goSHPOpenLL( const char * pszLayer, const char * pszAccess, SAHooks *psHooks ) {
 /*      problems on Windows.                                            */
 /* -------------------------------------------------------------------- */
     bool bLazySHXLoading = false;
+    int nAccessPattern = SA_ADVICE_NORMAL;
     if( strcmp(pszAccess,"rb+") == 0 || strcmp(pszAccess,"r+b") == 0
         || strcmp(pszAccess,"r+") == 0 ) {
         pszAccess = "r+b";
     } else {
+        /* 's' declares a full scan, 'i' index driven reads */
         bLazySHXLoading = strchr(pszAccess, 'l') != SHPLIB_NULLPTR;
+        if( strchr(pszAccess, 's') != SHPLIB_NULLPTR )
+            nAccessPattern = SA_ADVICE_SEQUENTIAL;
+        else if( strchr(pszAccess, 'i') != SHPLIB_NULLPTR )
+            nAccessPattern = SA_ADVICE_RANDOM;
         pszAccess = "rb";
     }
 
@@ -389,6 +531,9 @@ goSHPOpenLL( const char * pszLayer, const char * pszAccess, SAHooks *psHooks ) {
 
     free( pszFullname );
 
+    if( nAccessPattern != SA_ADVICE_NORMAL )
+        goSHPSetAccessPattern( psSHP, nAccessPattern );
+
 /* -------------------------------------------------------------------- */
 /*  Read the file size from the SHP file.               */
 /* -------------------------------------------------------------------- */
@@ -411,6 +556,13 @@ goSHPOpenLL( const char * pszLayer, const char * pszAccess, SAHooks *psHooks ) {
     else
         psSHP->nFileSize = (UINT_MAX / 2) * 2;
 
+    /* A header size of 4 GB or more means record offsets will not fit */
+    /* panRecOffset; in read mode they are then recovered as 64 bit. */
+    bool bLargeFile = psSHP->nFileSize == (UINT_MAX / 2) * 2 &&
+                      strcmp(pszAccess, "rb") == 0;
+    if( bLargeFile )
+        bLazySHXLoading = false;
+
 /* -------------------------------------------------------------------- */
 /*  Read SHX file Header info                                           */
 /* -------------------------------------------------------------------- */
@@ -589,6 +741,12 @@ goSHPOpenLL( const char * pszLayer, const char * pszAccess, SAHooks *psHooks ) {
         memcpy( &nLength, pabyBuf + i * 8 + 4, 4 );
         if( !bBigEndian ) SwapWord( 4, &nLength );
 
+        if( nOffset > STATIC_CAST(unsigned int, INT_MAX) &&
+            strcmp(pszAccess, "rb") == 0 )
+        {
+            bLargeFile = true;
+            break;
+        }
         if( nOffset > STATIC_CAST(unsigned int, INT_MAX) )
         {
             char str[128];
@@ -616,6 +774,13 @@ goSHPOpenLL( const char * pszLayer, const char * pszAccess, SAHooks *psHooks ) {
         psSHP->panRecOffset[i] = nOffset*2;
         psSHP->panRecSize[i] = nLength*2;
     }
+
+    if( bLargeFile && !SHPReadRecordOffsets64( psSHP, pabyBuf ) )
+    {
+        goSHPClose(psSHP);
+        free( pabyBuf );
+        return SHPLIB_NULLPTR;
+    }
     free( pabyBuf );
 
     return( psSHP );
@@ -838,6 +1003,7 @@ goSHPClose(SHPHandle psSHP ) {
 /*      Free all resources, and close files.                            */
 /* -------------------------------------------------------------------- */
     free( psSHP->panRecOffset );
+    free( psSHP->panRecOffset64 );
     free( psSHP->panRecSize );
 
     if ( psSHP->fpSHX != SHPLIB_NULLPTR)
@@ -883,6 +1049,32 @@ void SHPAPI_CALL goSHPSetFastModeReadObject( SHPHandle hSHP, int bFastMode )
     hSHP->bFastModeReadObject = bFastMode;
 }
 
+/************************************************************************/
+/*                       goSHPSetAccessPattern()                        */
+/*                                                                      */
+/*      Declare how the shapes will be read, so that the hooks can      */
+/*      tune read-ahead: SA_ADVICE_SEQUENTIAL for full scans,           */
+/*      SA_ADVICE_RANDOM for index driven reads (see also               */
+/*      goSHPPrefetchShapes()), or SA_ADVICE_NORMAL.                    */
+/************************************************************************/
+
+void SHPAPI_CALL goSHPSetAccessPattern( SHPHandle hSHP, int nAccessPattern )
+{
+    if( nAccessPattern != SA_ADVICE_NORMAL &&
+        nAccessPattern != SA_ADVICE_SEQUENTIAL &&
+        nAccessPattern != SA_ADVICE_RANDOM )
+        return;
+
+    hSHP->nAccessPattern = nAccessPattern;
+
+    if( hSHP->sHooks.FAdvise == SHPLIB_NULLPTR )
+        return;
+
+    hSHP->sHooks.FAdvise( hSHP->fpSHP, 0, 0, nAccessPattern );
+    if( hSHP->fpSHX != SHPLIB_NULLPTR )
+        hSHP->sHooks.FAdvise( hSHP->fpSHX, 0, 0, nAccessPattern );
+}
+
 /************************************************************************/
 /*                             goSHPGetInfo()                             */
 /*                                                                      */
@@ -1730,19 +1922,17 @@ static unsigned char* SHPReallocObjectBufIfNecessary ( SHPHandle psSHP,
 }
 
 /************************************************************************/
-/*                          goSHPReadObject()                             */
+/*                          SHPLocateRecord()                           */
 /*                                                                      */
-/*      Read the vertices, parts, and other non-attribute information	*/
-/*	for one shape.							*/
+/*      Make sure the offset and size of a record are known, reading    */
+/*      them from the .shx file if they were not loaded at open time.   */
 /************************************************************************/
 
-SHPObject SHPAPI_CALL1(*)
-goSHPReadObject( SHPHandle psSHP, int hEntity ) {
-/* -------------------------------------------------------------------- */
-/*      Validate the record/entity number.                              */
-/* -------------------------------------------------------------------- */
-    if( hEntity < 0 || hEntity >= psSHP->nRecords )
-        return SHPLIB_NULLPTR;
+static int SHPLocateRecord( SHPHandle psSHP, int hEntity ) {
+    /* All offsets of files beyond 4 GB are known from opening, and the */
+    /* low 32 bits of one may well be 0 */
+    if( psSHP->panRecOffset64 != SHPLIB_NULLPTR )
+        return TRUE;
 
 /* -------------------------------------------------------------------- */
 /*      Read offset/length from SHX loading if necessary.               */
@@ -1763,7 +1953,7 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
             str[sizeof(str)-1] = '\0';
 
             psSHP->sHooks.Error( str );
-            return SHPLIB_NULLPTR;
+            return FALSE;
         }
         if( !bBigEndian ) SwapWord( 4, &nOffset );
         if( !bBigEndian ) SwapWord( 4, &nLength );
@@ -1776,7 +1966,7 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
             str[sizeof(str)-1] = '\0';
 
             psSHP->sHooks.Error( str );
-            return SHPLIB_NULLPTR;
+            return FALSE;
         }
         if( nLength > STATIC_CAST(unsigned int, INT_MAX / 2 - 4) )
         {
@@ -1786,103 +1976,29 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
             str[sizeof(str)-1] = '\0';
 
             psSHP->sHooks.Error( str );
-            return SHPLIB_NULLPTR;
+            return FALSE;
         }
 
         psSHP->panRecOffset[hEntity] = nOffset*2;
         psSHP->panRecSize[hEntity] = nLength*2;
     }
 
-/* -------------------------------------------------------------------- */
-/*      Ensure our record buffer is large enough.                       */
-/* -------------------------------------------------------------------- */
-    const int nEntitySize = psSHP->panRecSize[hEntity]+8;
-    if( nEntitySize > psSHP->nBufSize )
-    {
-        int nNewBufSize = nEntitySize;
-        if( nNewBufSize < INT_MAX - nNewBufSize / 3 )
-            nNewBufSize += nNewBufSize / 3;
-        else
-            nNewBufSize = INT_MAX;
-
-        /* Before allocating too much memory, check that the file is big enough */
-        /* and do not trust the file size in the header the first time we */
-        /* need to allocate more than 10 MB */
-        if( nNewBufSize >= 10 * 1024 * 1024 )
-        {
-            if( psSHP->nBufSize < 10 * 1024 * 1024 )
-            {
-                SAOffset nFileSize;
-                psSHP->sHooks.FSeek( psSHP->fpSHP, 0, 2 );
-                nFileSize = psSHP->sHooks.FTell(psSHP->fpSHP);
-                if( nFileSize >= UINT_MAX )
-                    psSHP->nFileSize = UINT_MAX;
-                else
-                    psSHP->nFileSize = STATIC_CAST(unsigned int, nFileSize);
-            }
-
-            if( psSHP->panRecOffset[hEntity] >= psSHP->nFileSize ||
-                /* We should normally use nEntitySize instead of*/
-                /* psSHP->panRecSize[hEntity] in the below test, but because of */
-                /* the case of non conformant .shx files detailed a bit below, */
-                /* let be more tolerant */
-                psSHP->panRecSize[hEntity] > psSHP->nFileSize - psSHP->panRecOffset[hEntity] )
-            {
-                char str[128];
-                snprintf( str, sizeof(str),
-                            "Error in fread() reading object of size %d at offset %u from .shp file",
-                            nEntitySize, psSHP->panRecOffset[hEntity] );
-                str[sizeof(str)-1] = '\0';
-
-                psSHP->sHooks.Error( str );
-                return SHPLIB_NULLPTR;
-            }
-        }
-
-        uchar* pabyRecNew = STATIC_CAST(uchar *, realloc(psSHP->pabyRec, nNewBufSize));
-        if (pabyRecNew == SHPLIB_NULLPTR)
-        {
-            char szErrorMsg[160];
-            snprintf( szErrorMsg, sizeof(szErrorMsg),
-                     "Not enough memory to allocate requested memory (nNewBufSize=%d). "
-                     "Probably broken SHP file", nNewBufSize);
-            szErrorMsg[sizeof(szErrorMsg)-1] = '\0';
-            psSHP->sHooks.Error( szErrorMsg );
-            return SHPLIB_NULLPTR;
-        }
-
-        /* Only set new buffer size after successful alloc */
-        psSHP->pabyRec = pabyRecNew;
-        psSHP->nBufSize = nNewBufSize;
-    }
-
-    /* In case we were not able to reallocate the buffer on a previous step */
-    if (psSHP->pabyRec == SHPLIB_NULLPTR)
-    {
-        return SHPLIB_NULLPTR;
-    }
-
-/* -------------------------------------------------------------------- */
-/*      Read the record.                                                */
-/* -------------------------------------------------------------------- */
-    if( psSHP->sHooks.FSeek( psSHP->fpSHP, psSHP->panRecOffset[hEntity], 0 ) != 0 )
-    {
-        /*
-         * TODO - mloskot: Consider detailed diagnostics of shape file,
-         * for example to detect if file is truncated.
-         */
-        char str[128];
-        snprintf( str, sizeof(str),
-                 "Error in fseek() reading object from .shp file at offset %u",
-                 psSHP->panRecOffset[hEntity]);
-        str[sizeof(str)-1] = '\0';
-
-        psSHP->sHooks.Error( str );
-        return SHPLIB_NULLPTR;
-    }
+    return TRUE;
+}
 
-    const int nBytesRead = STATIC_CAST(int, psSHP->sHooks.FRead( psSHP->pabyRec, 1, nEntitySize, psSHP->fpSHP ));
+/************************************************************************/
+/*                          SHPDecodeRecord()                           */
+/*                                                                      */
+/*      Build a shape from a record read from the .shp file.            */
+/*      nBytesRead is the number of bytes of pabyRec actually read,     */
+/*      nEntitySize the number expected from the .shx.  In fast mode    */
+/*      the object and its arrays are owned by the handle, so only the  */
+/*      thread owning the handle may use it.                            */
+/************************************************************************/
 
+static SHPObject *SHPDecodeRecord( SHPHandle psSHP, int hEntity,
+                                   const uchar *pabyRec, int nEntitySize,
+                                   int nBytesRead, int bFastMode ) {
     /* Special case for a shapefile whose .shx content length field is not equal */
     /* to the content length field of the .shp, which is a violation of "The */
     /* content length stored in the index record is the same as the value stored in the main */
@@ -1893,7 +2009,7 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
     {
         /* Do a sanity check */
         int nSHPContentLength;
-        memcpy( &nSHPContentLength, psSHP->pabyRec + 4, 4 );
+        memcpy( &nSHPContentLength, pabyRec + 4, 4 );
         if( !bBigEndian ) SwapWord( 4, &(nSHPContentLength) );
         if( nSHPContentLength < 0 ||
             nSHPContentLength > INT_MAX / 2 - 4 ||
@@ -1917,8 +2033,9 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
          */
         char str[128];
         snprintf( str, sizeof(str),
-                 "Error in fread() reading object of size %d at offset %u from .shp file",
-                 nEntitySize, psSHP->panRecOffset[hEntity] );
+                 "Error in fread() reading object of size %d at offset %llu from .shp file",
+                 nEntitySize,
+                 STATIC_CAST(unsigned long long, SHPRecordOffset( psSHP, hEntity )) );
         str[sizeof(str)-1] = '\0';
 
         psSHP->sHooks.Error( str );
@@ -1936,7 +2053,7 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
         return SHPLIB_NULLPTR;
     }
     int nSHPType;
-    memcpy( &nSHPType, psSHP->pabyRec + 8, 4 );
+    memcpy( &nSHPType, pabyRec + 8, 4 );
 
     if( bBigEndian ) SwapWord( 4, &(nSHPType) );
 
@@ -1944,7 +2061,7 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
 /*	Allocate and minimally initialize the object.			*/
 /* -------------------------------------------------------------------- */
     SHPObject *psShape;
-    if( psSHP->bFastModeReadObject )
+    if( bFastMode )
     {
         if( psSHP->psCachedObject->bFastModeReadObject )
         {
@@ -1961,7 +2078,7 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
     psShape->nShapeId = hEntity;
     psShape->nSHPType = nSHPType;
     psShape->bMeasureIsUsed = FALSE;
-    psShape->bFastModeReadObject = psSHP->bFastModeReadObject;
+    psShape->bFastModeReadObject = bFastMode;
 
 /* ==================================================================== */
 /*  Extract vertices for a Polygon or Arc.				*/
@@ -1987,10 +2104,10 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
 /* -------------------------------------------------------------------- */
 /*	Get the X/Y bounds.						*/
 /* -------------------------------------------------------------------- */
-        memcpy( &(psShape->dfXMin), psSHP->pabyRec + 8 +  4, 8 );
-        memcpy( &(psShape->dfYMin), psSHP->pabyRec + 8 + 12, 8 );
-        memcpy( &(psShape->dfXMax), psSHP->pabyRec + 8 + 20, 8 );
-        memcpy( &(psShape->dfYMax), psSHP->pabyRec + 8 + 28, 8 );
+        memcpy( &(psShape->dfXMin), pabyRec + 8 +  4, 8 );
+        memcpy( &(psShape->dfYMin), pabyRec + 8 + 12, 8 );
+        memcpy( &(psShape->dfXMax), pabyRec + 8 + 20, 8 );
+        memcpy( &(psShape->dfYMax), pabyRec + 8 + 28, 8 );
 
         if( bBigEndian ) SwapWord( 8, &(psShape->dfXMin) );
         if( bBigEndian ) SwapWord( 8, &(psShape->dfYMin) );
@@ -2002,9 +2119,9 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
 /*      to proper size.                                                 */
 /* -------------------------------------------------------------------- */
         int32 nPoints;
-        memcpy( &nPoints, psSHP->pabyRec + 40 + 8, 4 );
+        memcpy( &nPoints, pabyRec + 40 + 8, 4 );
         int32 nParts;
-        memcpy( &nParts, psSHP->pabyRec + 36 + 8, 4 );
+        memcpy( &nParts, pabyRec + 36 + 8, 4 );
 
         if( bBigEndian ) SwapWord( 4, &nPoints );
         if( bBigEndian ) SwapWord( 4, &nParts );
@@ -2092,7 +2209,7 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
 /* -------------------------------------------------------------------- */
 /*      Copy out the part array from the record.                        */
 /* -------------------------------------------------------------------- */
-        memcpy( psShape->panPartStart, psSHP->pabyRec + 44 + 8, 4 * nParts );
+        memcpy( psShape->panPartStart, pabyRec + 44 + 8, 4 * nParts );
         for( int i = 0; STATIC_CAST(int32, i) < nParts; i++ )
         {
             if( bBigEndian ) SwapWord( 4, psShape->panPartStart+i );
@@ -2132,7 +2249,7 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
 /* -------------------------------------------------------------------- */
         if( psShape->nSHPType == SHPT_MULTIPATCH )
         {
-            memcpy( psShape->panPartType, psSHP->pabyRec + nOffset, 4*nParts );
+            memcpy( psShape->panPartType, pabyRec + nOffset, 4*nParts );
             for( int i = 0; STATIC_CAST(int32, i) < nParts; i++ )
             {
                 if( bBigEndian ) SwapWord( 4, psShape->panPartType+i );
@@ -2147,11 +2264,11 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
         for( int i = 0; STATIC_CAST(int32, i) < nPoints; i++ )
         {
             memcpy(psShape->padfX + i,
-                   psSHP->pabyRec + nOffset + i * 16,
+                   pabyRec + nOffset + i * 16,
                    8 );
 
             memcpy(psShape->padfY + i,
-                   psSHP->pabyRec + nOffset + i * 16 + 8,
+                   pabyRec + nOffset + i * 16 + 8,
                    8 );
 
             if( bBigEndian ) SwapWord( 8, psShape->padfX + i );
@@ -2167,8 +2284,8 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
             || psShape->nSHPType == SHPT_ARCZ
             || psShape->nSHPType == SHPT_MULTIPATCH )
         {
-            memcpy( &(psShape->dfZMin), psSHP->pabyRec + nOffset, 8 );
-            memcpy( &(psShape->dfZMax), psSHP->pabyRec + nOffset + 8, 8 );
+            memcpy( &(psShape->dfZMin), pabyRec + nOffset, 8 );
+            memcpy( &(psShape->dfZMax), pabyRec + nOffset + 8, 8 );
 
             if( bBigEndian ) SwapWord( 8, &(psShape->dfZMin) );
             if( bBigEndian ) SwapWord( 8, &(psShape->dfZMax) );
@@ -2176,7 +2293,7 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
             for( int i = 0; STATIC_CAST(int32, i) < nPoints; i++ )
             {
                 memcpy( psShape->padfZ + i,
-                        psSHP->pabyRec + nOffset + 16 + i*8, 8 );
+                        pabyRec + nOffset + 16 + i*8, 8 );
                 if( bBigEndian ) SwapWord( 8, psShape->padfZ + i );
             }
 
@@ -2195,8 +2312,8 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
 /* -------------------------------------------------------------------- */
         if( nEntitySize >= STATIC_CAST(int, nOffset + 16 + 8*nPoints) )
         {
-            memcpy( &(psShape->dfMMin), psSHP->pabyRec + nOffset, 8 );
-            memcpy( &(psShape->dfMMax), psSHP->pabyRec + nOffset + 8, 8 );
+            memcpy( &(psShape->dfMMin), pabyRec + nOffset, 8 );
+            memcpy( &(psShape->dfMMax), pabyRec + nOffset + 8, 8 );
 
             if( bBigEndian ) SwapWord( 8, &(psShape->dfMMin) );
             if( bBigEndian ) SwapWord( 8, &(psShape->dfMMax) );
@@ -2204,7 +2321,7 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
             for( int i = 0; STATIC_CAST(int32, i) < nPoints; i++ )
             {
                 memcpy( psShape->padfM + i,
-                        psSHP->pabyRec + nOffset + 16 + i*8, 8 );
+                        pabyRec + nOffset + 16 + i*8, 8 );
                 if( bBigEndian ) SwapWord( 8, psShape->padfM + i );
             }
             psShape->bMeasureIsUsed = TRUE;
@@ -2234,7 +2351,7 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
             return SHPLIB_NULLPTR;
         }
         int32 nPoints;
-        memcpy( &nPoints, psSHP->pabyRec + 44, 4 );
+        memcpy( &nPoints, pabyRec + 44, 4 );
 
         if( bBigEndian ) SwapWord( 4, &nPoints );
 
@@ -2302,8 +2419,8 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
 
         for( int i = 0; STATIC_CAST(int32, i) < nPoints; i++ )
         {
-            memcpy(psShape->padfX+i, psSHP->pabyRec + 48 + 16 * i, 8 );
-            memcpy(psShape->padfY+i, psSHP->pabyRec + 48 + 16 * i + 8, 8 );
+            memcpy(psShape->padfX+i, pabyRec + 48 + 16 * i, 8 );
+            memcpy(psShape->padfY+i, pabyRec + 48 + 16 * i + 8, 8 );
 
             if( bBigEndian ) SwapWord( 8, psShape->padfX + i );
             if( bBigEndian ) SwapWord( 8, psShape->padfY + i );
@@ -2314,10 +2431,10 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
 /* -------------------------------------------------------------------- */
 /*	Get the X/Y bounds.						*/
 /* -------------------------------------------------------------------- */
-        memcpy( &(psShape->dfXMin), psSHP->pabyRec + 8 +  4, 8 );
-        memcpy( &(psShape->dfYMin), psSHP->pabyRec + 8 + 12, 8 );
-        memcpy( &(psShape->dfXMax), psSHP->pabyRec + 8 + 20, 8 );
-        memcpy( &(psShape->dfYMax), psSHP->pabyRec + 8 + 28, 8 );
+        memcpy( &(psShape->dfXMin), pabyRec + 8 +  4, 8 );
+        memcpy( &(psShape->dfYMin), pabyRec + 8 + 12, 8 );
+        memcpy( &(psShape->dfXMax), pabyRec + 8 + 20, 8 );
+        memcpy( &(psShape->dfYMax), pabyRec + 8 + 28, 8 );
 
         if( bBigEndian ) SwapWord( 8, &(psShape->dfXMin) );
         if( bBigEndian ) SwapWord( 8, &(psShape->dfYMin) );
@@ -2329,8 +2446,8 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
 /* -------------------------------------------------------------------- */
         if( psShape->nSHPType == SHPT_MULTIPOINTZ )
         {
-            memcpy( &(psShape->dfZMin), psSHP->pabyRec + nOffset, 8 );
-            memcpy( &(psShape->dfZMax), psSHP->pabyRec + nOffset + 8, 8 );
+            memcpy( &(psShape->dfZMin), pabyRec + nOffset, 8 );
+            memcpy( &(psShape->dfZMax), pabyRec + nOffset + 8, 8 );
 
             if( bBigEndian ) SwapWord( 8, &(psShape->dfZMin) );
             if( bBigEndian ) SwapWord( 8, &(psShape->dfZMax) );
@@ -2338,7 +2455,7 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
             for( int i = 0; STATIC_CAST(int32, i) < nPoints; i++ )
             {
                 memcpy( psShape->padfZ + i,
-                        psSHP->pabyRec + nOffset + 16 + i*8, 8 );
+                        pabyRec + nOffset + 16 + i*8, 8 );
                 if( bBigEndian ) SwapWord( 8, psShape->padfZ + i );
             }
 
@@ -2355,8 +2472,8 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
 /* -------------------------------------------------------------------- */
         if( nEntitySize >= STATIC_CAST(int, nOffset + 16 + 8*nPoints) )
         {
-            memcpy( &(psShape->dfMMin), psSHP->pabyRec + nOffset, 8 );
-            memcpy( &(psShape->dfMMax), psSHP->pabyRec + nOffset + 8, 8 );
+            memcpy( &(psShape->dfMMin), pabyRec + nOffset, 8 );
+            memcpy( &(psShape->dfMMax), pabyRec + nOffset + 8, 8 );
 
             if( bBigEndian ) SwapWord( 8, &(psShape->dfMMin) );
             if( bBigEndian ) SwapWord( 8, &(psShape->dfMMax) );
@@ -2364,7 +2481,7 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
             for( int i = 0; STATIC_CAST(int32, i) < nPoints; i++ )
             {
                 memcpy( psShape->padfM + i,
-                        psSHP->pabyRec + nOffset + 16 + i*8, 8 );
+                        pabyRec + nOffset + 16 + i*8, 8 );
                 if( bBigEndian ) SwapWord( 8, psShape->padfM + i );
             }
             psShape->bMeasureIsUsed = TRUE;
@@ -2409,8 +2526,8 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
             goSHPDestroyObject(psShape);
             return SHPLIB_NULLPTR;
         }
-        memcpy( psShape->padfX, psSHP->pabyRec + 12, 8 );
-        memcpy( psShape->padfY, psSHP->pabyRec + 20, 8 );
+        memcpy( psShape->padfX, pabyRec + 12, 8 );
+        memcpy( psShape->padfY, pabyRec + 20, 8 );
 
         if( bBigEndian ) SwapWord( 8, psShape->padfX );
         if( bBigEndian ) SwapWord( 8, psShape->padfY );
@@ -2422,7 +2539,7 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
 /* -------------------------------------------------------------------- */
         if( psShape->nSHPType == SHPT_POINTZ )
         {
-            memcpy( psShape->padfZ, psSHP->pabyRec + nOffset, 8 );
+            memcpy( psShape->padfZ, pabyRec + nOffset, 8 );
 
             if( bBigEndian ) SwapWord( 8, psShape->padfZ );
 
@@ -2437,7 +2554,7 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
 /* -------------------------------------------------------------------- */
         if( nEntitySize >= nOffset + 8 )
         {
-            memcpy( psShape->padfM, psSHP->pabyRec + nOffset, 8 );
+            memcpy( psShape->padfM, pabyRec + nOffset, 8 );
 
             if( bBigEndian ) SwapWord( 8, psShape->padfM );
             psShape->bMeasureIsUsed = TRUE;
@@ -2456,6 +2573,348 @@ goSHPReadObject( SHPHandle psSHP, int hEntity ) {
     return( psShape );
 }
 
+/************************************************************************/
+/*                          goSHPReadObject()                             */
+/*                                                                      */
+/*      Read the vertices, parts, and other non-attribute information	*/
+/*	for one shape.							*/
+/************************************************************************/
+
+SHPObject SHPAPI_CALL1(*)
+goSHPReadObject( SHPHandle psSHP, int hEntity ) {
+/* -------------------------------------------------------------------- */
+/*      Validate the record/entity number.                              */
+/* -------------------------------------------------------------------- */
+    if( hEntity < 0 || hEntity >= psSHP->nRecords )
+        return SHPLIB_NULLPTR;
+
+    if( !SHPLocateRecord( psSHP, hEntity ) )
+        return SHPLIB_NULLPTR;
+
+/* -------------------------------------------------------------------- */
+/*      Ensure our record buffer is large enough.                       */
+/* -------------------------------------------------------------------- */
+    const int nEntitySize = psSHP->panRecSize[hEntity]+8;
+    if( nEntitySize > psSHP->nBufSize )
+    {
+        int nNewBufSize = nEntitySize;
+        if( nNewBufSize < INT_MAX - nNewBufSize / 3 )
+            nNewBufSize += nNewBufSize / 3;
+        else
+            nNewBufSize = INT_MAX;
+
+        /* Before allocating too much memory, check that the file is big enough */
+        /* and do not trust the file size in the header the first time we */
+        /* need to allocate more than 10 MB */
+        /* (offsets beyond 4 GB were checked against it when opening) */
+        if( nNewBufSize >= 10 * 1024 * 1024 &&
+            psSHP->panRecOffset64 == SHPLIB_NULLPTR )
+        {
+            if( psSHP->nBufSize < 10 * 1024 * 1024 )
+            {
+                SAOffset nFileSize;
+                psSHP->sHooks.FSeek( psSHP->fpSHP, 0, 2 );
+                nFileSize = psSHP->sHooks.FTell(psSHP->fpSHP);
+                if( nFileSize >= UINT_MAX )
+                    psSHP->nFileSize = UINT_MAX;
+                else
+                    psSHP->nFileSize = STATIC_CAST(unsigned int, nFileSize);
+            }
+
+            if( psSHP->panRecOffset[hEntity] >= psSHP->nFileSize ||
+                /* We should normally use nEntitySize instead of*/
+                /* psSHP->panRecSize[hEntity] in the below test, but because of */
+                /* the case of non conformant .shx files detailed a bit below, */
+                /* let be more tolerant */
+                psSHP->panRecSize[hEntity] > psSHP->nFileSize - psSHP->panRecOffset[hEntity] )
+            {
+                char str[128];
+                snprintf( str, sizeof(str),
+                            "Error in fread() reading object of size %d at offset %u from .shp file",
+                            nEntitySize, psSHP->panRecOffset[hEntity] );
+                str[sizeof(str)-1] = '\0';
+
+                psSHP->sHooks.Error( str );
+                return SHPLIB_NULLPTR;
+            }
+        }
+
+        uchar* pabyRecNew = STATIC_CAST(uchar *, realloc(psSHP->pabyRec, nNewBufSize));
+        if (pabyRecNew == SHPLIB_NULLPTR)
+        {
+            char szErrorMsg[160];
+            snprintf( szErrorMsg, sizeof(szErrorMsg),
+                     "Not enough memory to allocate requested memory (nNewBufSize=%d). "
+                     "Probably broken SHP file", nNewBufSize);
+            szErrorMsg[sizeof(szErrorMsg)-1] = '\0';
+            psSHP->sHooks.Error( szErrorMsg );
+            return SHPLIB_NULLPTR;
+        }
+
+        /* Only set new buffer size after successful alloc */
+        psSHP->pabyRec = pabyRecNew;
+        psSHP->nBufSize = nNewBufSize;
+    }
+
+    /* In case we were not able to reallocate the buffer on a previous step */
+    if (psSHP->pabyRec == SHPLIB_NULLPTR)
+    {
+        return SHPLIB_NULLPTR;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Read the record.                                                */
+/* -------------------------------------------------------------------- */
+    if( psSHP->sHooks.FSeek( psSHP->fpSHP, SHPRecordOffset( psSHP, hEntity ), 0 ) != 0 )
+    {
+        /*
+         * TODO - mloskot: Consider detailed diagnostics of shape file,
+         * for example to detect if file is truncated.
+         */
+        char str[128];
+        snprintf( str, sizeof(str),
+                 "Error in fseek() reading object from .shp file at offset %llu",
+                 STATIC_CAST(unsigned long long, SHPRecordOffset( psSHP, hEntity )));
+        str[sizeof(str)-1] = '\0';
+
+        psSHP->sHooks.Error( str );
+        return SHPLIB_NULLPTR;
+    }
+
+    const int nBytesRead = STATIC_CAST(int, psSHP->sHooks.FRead( psSHP->pabyRec, 1, nEntitySize, psSHP->fpSHP ));
+
+    return SHPDecodeRecord( psSHP, hEntity, psSHP->pabyRec, nEntitySize,
+                            nBytesRead, psSHP->bFastModeReadObject );
+}
+
+/* -------------------------------------------------------------------- */
+/*      Context of goSHPReadObjects() completion callbacks.             */
+/* -------------------------------------------------------------------- */
+typedef struct
+{
+    SHPHandle   psSHP;
+    const int  *panShapeIds;
+    SHPObject **papsObjects;
+} SHPBatchContext;
+
+/************************************************************************/
+/*                         SHPBatchRecordDone()                         */
+/************************************************************************/
+
+static void SHPBatchRecordDone( void *pUserData, SABatchRequest *psRequest ) {
+    SHPBatchContext *psContext = STATIC_CAST(SHPBatchContext *, pUserData);
+    const int i = psRequest->nUserId;
+
+    psContext->papsObjects[i] =
+        SHPDecodeRecord( psContext->psSHP, psContext->panShapeIds[i],
+                         STATIC_CAST(uchar *, psRequest->pBuffer),
+                         STATIC_CAST(int, psRequest->nSize),
+                         STATIC_CAST(int, psRequest->nRead), FALSE );
+
+    free( psRequest->pBuffer );
+    psRequest->pBuffer = SHPLIB_NULLPTR;
+}
+
+/************************************************************************/
+/*                          goSHPReadObjects()                          */
+/*                                                                      */
+/*      Read several shapes at once, typically the result of a spatial  */
+/*      index search.  All the record reads are submitted together      */
+/*      (see goSABatchRead()) and each shape is decoded as soon as its  */
+/*      record arrives.  Returns an array of nCount objects in the      */
+/*      order of panShapeIds, with NULL for shapes that could not be    */
+/*      read, to be released with goSHPDestroyObjects().  Fast read     */
+/*      mode does not apply.                                            */
+/************************************************************************/
+
+SHPObject SHPAPI_CALL1(**)
+goSHPReadObjects( SHPHandle psSHP, const int *panShapeIds, int nCount ) {
+    if( nCount < 0 )
+        return SHPLIB_NULLPTR;
+
+    SHPObject **papsObjects = STATIC_CAST(SHPObject **,
+        calloc(nCount ? nCount : 1, sizeof(SHPObject *)));
+    SABatchRequest *pasRequests = STATIC_CAST(SABatchRequest *,
+        calloc(nCount ? nCount : 1, sizeof(SABatchRequest)));
+    if( papsObjects == SHPLIB_NULLPTR || pasRequests == SHPLIB_NULLPTR )
+    {
+        free( papsObjects );
+        free( pasRequests );
+        psSHP->sHooks.Error( "Not enough memory to read shapes" );
+        return SHPLIB_NULLPTR;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Build one request per valid shape.  As in goSHPReadObject(),    */
+/*      large records are checked against the real file size before    */
+/*      trusting the .shx enough to allocate for them.                  */
+/* -------------------------------------------------------------------- */
+    int nRequests = 0;
+    bool bFileSizeKnown = false;
+    SAOffset nFileSize = 0;
+
+    for( int i = 0; i < nCount; i++ )
+    {
+        const int hEntity = panShapeIds[i];
+        if( hEntity < 0 || hEntity >= psSHP->nRecords ||
+            !SHPLocateRecord( psSHP, hEntity ) )
+            continue;
+
+        const int nEntitySize = psSHP->panRecSize[hEntity]+8;
+        if( nEntitySize >= 10 * 1024 * 1024 )
+        {
+            if( !bFileSizeKnown )
+            {
+                psSHP->sHooks.FSeek( psSHP->fpSHP, 0, 2 );
+                nFileSize = psSHP->sHooks.FTell( psSHP->fpSHP );
+                bFileSizeKnown = true;
+            }
+            const SAOffset nRecOffset = SHPRecordOffset( psSHP, hEntity );
+            if( nRecOffset >= nFileSize ||
+                psSHP->panRecSize[hEntity] > nFileSize - nRecOffset )
+            {
+                char str[128];
+                snprintf( str, sizeof(str),
+                          "Error in fread() reading object of size %d at offset %llu from .shp file",
+                          nEntitySize, STATIC_CAST(unsigned long long, nRecOffset) );
+                str[sizeof(str)-1] = '\0';
+
+                psSHP->sHooks.Error( str );
+                continue;
+            }
+        }
+
+        SABatchRequest *psRequest = pasRequests + nRequests;
+        psRequest->pBuffer = malloc( nEntitySize );
+        if( psRequest->pBuffer == SHPLIB_NULLPTR )
+        {
+            char szErrorMsg[160];
+            snprintf( szErrorMsg, sizeof(szErrorMsg),
+                      "Not enough memory to allocate requested memory (nEntitySize=%d) for shape %d. "
+                      "Probably broken SHP file", nEntitySize, hEntity );
+            szErrorMsg[sizeof(szErrorMsg)-1] = '\0';
+            psSHP->sHooks.Error( szErrorMsg );
+            continue;
+        }
+        psRequest->nOffset = SHPRecordOffset( psSHP, hEntity );
+        psRequest->nSize = nEntitySize;
+        psRequest->nUserId = i;
+        nRequests++;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Read and decode.  nUserId is the position in panShapeIds.       */
+/* -------------------------------------------------------------------- */
+    SHPBatchContext sContext;
+    sContext.psSHP = psSHP;
+    sContext.panShapeIds = panShapeIds;
+    sContext.papsObjects = papsObjects;
+
+    if( nRequests > 0 &&
+        !goSABatchRead( &(psSHP->sHooks), psSHP->fpSHP, pasRequests, nRequests,
+                        SHPBatchRecordDone, &sContext ) )
+    {
+        psSHP->sHooks.Error( "Error in batched read of .shp file" );
+    }
+
+    for( int i = 0; i < nRequests; i++ )
+        free( pasRequests[i].pBuffer );
+    free( pasRequests );
+
+    return papsObjects;
+}
+
+/************************************************************************/
+/*                         SHPCompareRange()                            */
+/************************************************************************/
+
+static int SHPCompareRange( const void *pA, const void *pB ) {
+    const SAOffset *panA = STATIC_CAST(const SAOffset *, pA);
+    const SAOffset *panB = STATIC_CAST(const SAOffset *, pB);
+
+    if( panA[0] < panB[0] )
+        return -1;
+    if( panA[0] > panB[0] )
+        return 1;
+    return 0;
+}
+
+/************************************************************************/
+/*                        goSHPPrefetchShapes()                         */
+/*                                                                      */
+/*      Ask the hooks to start reading the records of the given shapes  */
+/*      in the background.  Records closer than SHP_PREFETCH_GAP are    */
+/*      merged into a single range, so that the device sees few large   */
+/*      requests rather than one per shape.                             */
+/************************************************************************/
+
+#define SHP_PREFETCH_GAP    (64 * 1024)
+
+void SHPAPI_CALL
+goSHPPrefetchShapes( SHPHandle psSHP, const int *panShapeIds, int nCount ) {
+    if( psSHP->sHooks.FAdvise == SHPLIB_NULLPTR || nCount <= 0 )
+        return;
+
+    /* (start, end) pairs */
+    SAOffset *panRanges = STATIC_CAST(SAOffset *,
+        malloc(sizeof(SAOffset) * 2 * nCount));
+    if( panRanges == SHPLIB_NULLPTR )
+        return;
+
+    int nRanges = 0;
+    for( int i = 0; i < nCount; i++ )
+    {
+        const int hEntity = panShapeIds[i];
+        if( hEntity < 0 || hEntity >= psSHP->nRecords ||
+            !SHPLocateRecord( psSHP, hEntity ) )
+            continue;
+
+        panRanges[2*nRanges] = SHPRecordOffset( psSHP, hEntity );
+        panRanges[2*nRanges+1] = panRanges[2*nRanges] +
+                                 psSHP->panRecSize[hEntity] + 8;
+        nRanges++;
+    }
+
+    qsort( panRanges, nRanges, 2 * sizeof(SAOffset), SHPCompareRange );
+
+    int iRange = 0;
+    while( iRange < nRanges )
+    {
+        const SAOffset nStart = panRanges[2*iRange];
+        SAOffset nEnd = panRanges[2*iRange+1];
+        iRange++;
+        while( iRange < nRanges &&
+               panRanges[2*iRange] <= nEnd + SHP_PREFETCH_GAP )
+        {
+            if( panRanges[2*iRange+1] > nEnd )
+                nEnd = panRanges[2*iRange+1];
+            iRange++;
+        }
+
+        psSHP->sHooks.FAdvise( psSHP->fpSHP, nStart, nEnd - nStart,
+                               SA_ADVICE_WILLNEED );
+    }
+
+    free( panRanges );
+}
+
+/************************************************************************/
+/*                        goSHPDestroyObjects()                         */
+/************************************************************************/
+
+void SHPAPI_CALL
+goSHPDestroyObjects( SHPObject **papsObjects, int nCount ) {
+    if( papsObjects == SHPLIB_NULLPTR )
+        return;
+
+    for( int i = 0; i < nCount; i++ )
+    {
+        if( papsObjects[i] != SHPLIB_NULLPTR )
+            goSHPDestroyObject( papsObjects[i] );
+    }
+    free( papsObjects );
+}
+
 /************************************************************************/
 /*                            goSHPTypeName()                             */
 /************************************************************************/
@@ -635,6 +635,14 @@ goSHPTreeFindLikelyShapes( SHPTree * hTree,
     if( panShapeList != SHPLIB_NULLPTR )
         qsort(panShapeList, *pnShapeCount, sizeof(int), compare_ints);
 
+/* -------------------------------------------------------------------- */
+/*      For index driven access, get the records on their way before    */
+/*      the caller starts reading them one by one.                      */
+/* -------------------------------------------------------------------- */
+    if( panShapeList != SHPLIB_NULLPTR && hTree->hSHP != SHPLIB_NULLPTR &&
+        hTree->hSHP->nAccessPattern == SA_ADVICE_RANDOM )
+        goSHPPrefetchShapes( hTree->hSHP, panShapeList, *pnShapeCount );
+
     return panShapeList;
 }
 
@@ -0,0 +1,98 @@
+package shp
+
+import "fmt"
+
+// Field describes a field of an attribute table created with CreateTable.
+// Width and Decimals are those of the stored text of the values.
+type Field struct {
+	Name     string
+	Type     FieldType
+	Width    int
+	Decimals int
+}
+
+// TableWriter appends rows to an attribute table. Rows are formatted into a
+// large buffer that is written out in one piece whenever it fills up, and
+// the record count of the file is only updated by Close, which makes it
+// suitable for exports of many rows.
+type TableWriter struct {
+	h      DBFHandle
+	w      DBFWriterHandle
+	fields []Field
+}
+
+// CreateTable creates the attribute table path, for instance "roads.dbf",
+// with the given fields, to be filled with Append.
+func CreateTable(path string, fields []Field) (*TableWriter, error) {
+	h := goDBFCreate(path)
+	if h == nil {
+		return nil, fmt.Errorf("cannot create %s", path)
+	}
+	for _, field := range fields {
+		if field.Type < String || field.Type >= Invalid ||
+			goDBFAddField(h, field.Name, int(field.Type), field.Width, field.Decimals) < 0 {
+			goDBFClose(h)
+			return nil, fmt.Errorf("cannot add field %q to %s", field.Name, path)
+		}
+	}
+	w := goDBFCreateWriter(h, 0)
+	if w == nil {
+		goDBFClose(h)
+		return nil, fmt.Errorf("cannot write %s", path)
+	}
+	return &TableWriter{h: h, w: w, fields: fields}, nil
+}
+
+// Append adds a row with one value per field: a number for Integer and
+// Double fields, a string for String fields, a bool for Logical fields, or
+// nil for NULL. Rows with values of other types are rejected. Values too
+// wide for their field are truncated, and reported once the row is written.
+// Once rows could not be written, all further rows are rejected.
+func (t *TableWriter) Append(values ...interface{}) error {
+	if len(values) != len(t.fields) {
+		return fmt.Errorf("%d values for %d fields", len(values), len(t.fields))
+	}
+	for j, value := range values {
+		switch value.(type) {
+		case nil, int, int64, float64, string, bool:
+		default:
+			return fmt.Errorf("cannot write %T to field %q", value, t.fields[j].Name)
+		}
+	}
+	var err error
+	for j, value := range values {
+		var ok bool
+		switch v := value.(type) {
+		case nil:
+			ok = goDBFWriterSetNULL(t.w, j)
+		case int:
+			ok = goDBFWriterSetDouble(t.w, j, float64(v))
+		case int64:
+			ok = goDBFWriterSetDouble(t.w, j, float64(v))
+		case float64:
+			ok = goDBFWriterSetDouble(t.w, j, v)
+		case string:
+			ok = goDBFWriterSetString(t.w, j, v)
+		case bool:
+			ok = goDBFWriterSetLogical(t.w, j, v)
+		}
+		if !ok && err == nil {
+			err = fmt.Errorf("value of field %q truncated", t.fields[j].Name)
+		}
+	}
+	if !goDBFWriterEndRow(t.w) {
+		return fmt.Errorf("cannot write rows")
+	}
+	return err
+}
+
+// Close writes out the buffered rows and the record count, and closes the
+// file.
+func (t *TableWriter) Close() error {
+	ok := goDBFCloseWriter(t.w)
+	goDBFClose(t.h)
+	if !ok {
+		return fmt.Errorf("cannot write rows")
+	}
+	return nil
+}